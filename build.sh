@@ -2,6 +2,7 @@ source .env
 
 FLAGS='-O3 -fPIC -shared'
 WARNINGS='-Winline -Wno-invalid-noreturn'
+LIBS='-lm -pthread'
 COMPILER=gcc-12
 
 OUTPUT_LOC="$OUTPUT_DIR/graphrox-x86.dylib"
@@ -10,7 +11,7 @@ BUILD_SPECIFIC_FILES=''
 
 mkdir -p $OUTPUT_DIR
 
-$COMPILER $WARNINGS -fvisibility=hidden $FLAGS -I$INCLUDE_DIR $FILES $BUILD_SPECIFIC_FILES -o $OUTPUT_LOC &&
+$COMPILER $WARNINGS -fvisibility=hidden $FLAGS -I$INCLUDE_DIR $FILES $BUILD_SPECIFIC_FILES -o $OUTPUT_LOC $LIBS &&
 
 mkdir -p $LIB_DIR &&
 cp $OUTPUT_LOC $LIB_DIR
@@ -11,14 +11,25 @@ class _DynamicArrayU64_c(ctypes.Structure):
     _fields_ = [
         ("capacity", ctypes.c_size_t),
         ("size", ctypes.c_size_t),
-        ("arr", ctypes.POINTER(ctypes.c_uint64))]
+        ("arr", ctypes.POINTER(ctypes.c_uint64)),
+        ("ref_count", ctypes.c_void_p),
+        ("allocator", ctypes.c_void_p)]
 
     
 class _DynamicArrayDouble_c(ctypes.Structure):
     _fields_ = [
         ("capacity", ctypes.c_size_t),
         ("size", ctypes.c_size_t),
-        ("arr", ctypes.POINTER(ctypes.c_double))]
+        ("arr", ctypes.POINTER(ctypes.c_double)),
+        ("ref_count", ctypes.c_void_p),
+        ("allocator", ctypes.c_void_p)]
+
+
+class _DynamicArrayFloat_c(ctypes.Structure):
+    _fields_ = [
+        ("capacity", ctypes.c_size_t),
+        ("size", ctypes.c_size_t),
+        ("arr", ctypes.POINTER(ctypes.c_float))]
 
     
 class _GphrxCsrAdjacencyMatrix_c(ctypes.Structure):
@@ -31,7 +42,7 @@ class _GphrxCsrAdjacencyMatrix_c(ctypes.Structure):
 class _GphrxCsrMatrix_c(ctypes.Structure):
     _fields_ = [
         ("dimension", ctypes.c_uint64),
-        ("col_indices", _DynamicArrayDouble_c),
+        ("entries", _DynamicArrayDouble_c),
         ("col_indices", _DynamicArrayU64_c),
         ("row_indices", _DynamicArrayU64_c)]
 
@@ -39,7 +50,126 @@ class _GphrxCsrMatrix_c(ctypes.Structure):
 class _GphrxGraph_c(ctypes.Structure):
     _fields_ = [
         ("is_undirected", ctypes.c_bool),
-        ("adjacency_matrix", _GphrxCsrAdjacencyMatrix_c)]
+        ("adjacency_matrix", _GphrxCsrAdjacencyMatrix_c),
+        ("vertex_index", ctypes.c_void_p)]
+
+
+class _GphrxWeights_c(ctypes.Union):
+    _fields_ = [
+        ("f32", _DynamicArrayFloat_c),
+        ("f64", _DynamicArrayDouble_c)]
+
+
+class _GphrxWeightedGraph_c(ctypes.Structure):
+    _fields_ = [
+        ("is_undirected", ctypes.c_bool),
+        ("precision", ctypes.c_uint8),
+        ("adjacency_matrix", _GphrxCsrAdjacencyMatrix_c),
+        ("weights", _GphrxWeights_c)]
+
+
+class _GphrxAvgPoolSampler_c(ctypes.Structure):
+    _fields_ = [
+        ("dimension", ctypes.c_uint64),
+        ("block_dimension", ctypes.c_uint64),
+        ("edge_count", ctypes.c_uint64),
+        ("sampled_count", ctypes.c_uint64),
+        ("permutation_half_bits", ctypes.c_uint64),
+        ("permutation_keys", ctypes.c_uint64 * 4),
+        ("occurrences", ctypes.POINTER(ctypes.c_uint64))]
+
+
+class _GphrxSnapshotGuard_c(ctypes.Structure):
+    _fields_ = [
+        ("graph", ctypes.POINTER(_GphrxGraph_c)),
+        ("version", ctypes.c_uint64),
+        ("slot", ctypes.c_uint32),
+    ]
+
+
+class _GphrxBfsResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("reached_count", ctypes.c_uint64),
+        ("distances", ctypes.POINTER(ctypes.c_uint64)),
+        ("parents", ctypes.POINTER(ctypes.c_uint64))]
+
+
+class _GphrxComponentsResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("component_count", ctypes.c_uint64),
+        ("labels", ctypes.POINTER(ctypes.c_uint64)),
+        ("sizes", ctypes.POINTER(ctypes.c_uint64))]
+
+
+class _GphrxCoresResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("max_core", ctypes.c_uint64),
+        ("core_numbers", ctypes.POINTER(ctypes.c_uint64)),
+        ("degeneracy_order", ctypes.POINTER(ctypes.c_uint64))]
+
+
+class _GphrxSsspResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("reached_count", ctypes.c_uint64),
+        ("distances", ctypes.POINTER(ctypes.c_double)),
+        ("parents", ctypes.POINTER(ctypes.c_uint64)),
+        ("nearest_sources", ctypes.POINTER(ctypes.c_uint64))]
+
+
+class _GphrxCommunitiesOptions_c(ctypes.Structure):
+    _fields_ = [
+        ("max_iterations", ctypes.c_uint32),
+        ("tolerance", ctypes.c_double),
+        ("refine_with_louvain", ctypes.c_bool),
+        ("max_louvain_levels", ctypes.c_uint32)]
+
+
+class _GphrxCommunitiesResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("community_count", ctypes.c_uint64),
+        ("labels", ctypes.POINTER(ctypes.c_uint64)),
+        ("sizes", ctypes.POINTER(ctypes.c_uint64)),
+        ("permutation", ctypes.POINTER(ctypes.c_uint64)),
+        ("modularity", ctypes.c_double),
+        ("iteration_count", ctypes.c_uint32),
+        ("louvain_level_count", ctypes.c_uint32)]
+
+
+class _GphrxClusteringResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("triangle_count", ctypes.c_uint64),
+        ("triangle_counts", ctypes.POINTER(ctypes.c_uint64)),
+        ("coefficients", ctypes.POINTER(ctypes.c_double)),
+        ("average_coefficient", ctypes.c_double)]
+
+
+class _GphrxSimilarityResult_c(ctypes.Structure):
+    _fields_ = [
+        ("query_count", ctypes.c_size_t),
+        ("common_neighbor_counts", ctypes.POINTER(ctypes.c_uint64)),
+        ("jaccard_scores", ctypes.POINTER(ctypes.c_double)),
+        ("adamic_adar_scores", ctypes.POINTER(ctypes.c_double))]
+
+
+class _GphrxPageRankOptions_c(ctypes.Structure):
+    _fields_ = [
+        ("damping_factor", ctypes.c_double),
+        ("tolerance", ctypes.c_double),
+        ("max_iterations", ctypes.c_uint32)]
+
+
+class _GphrxPageRankResult_c(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count", ctypes.c_uint64),
+        ("scores", ctypes.POINTER(ctypes.c_double)),
+        ("iteration_count", ctypes.c_uint32),
+        ("residual", ctypes.c_double)]
 
 
 class _GphrxErrorCode(Enum):
@@ -91,6 +221,11 @@ _gphrx_lib.free_gphrx_csr_adj_matrix.restype = None
 _gphrx_lib.gphrx_csr_matrix_to_string.argtypes = (ctypes.POINTER(_GphrxCsrMatrix_c), ctypes.c_int)
 _gphrx_lib.gphrx_csr_matrix_to_string.restype = ctypes.c_void_p
 
+_gphrx_lib.gphrx_csr_matrix_threshold_and_scale.argtypes = (ctypes.POINTER(_GphrxCsrMatrix_c),
+                                                            ctypes.c_double,
+                                                            ctypes.c_double)
+_gphrx_lib.gphrx_csr_matrix_threshold_and_scale.restype = None
+
 _gphrx_lib.gphrx_csr_adj_matrix_to_string.argtypes = [ctypes.POINTER(_GphrxCsrAdjacencyMatrix_c)]
 _gphrx_lib.gphrx_csr_adj_matrix_to_string.restype = ctypes.c_void_p
 
@@ -100,6 +235,13 @@ _gphrx_lib.gphrx_shrink.restype = None
 _gphrx_lib.gphrx_does_edge_exist.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.c_uint64, ctypes.c_uint64)
 _gphrx_lib.gphrx_does_edge_exist.restype = ctypes.c_bool
 
+_gphrx_lib.gphrx_does_edges_exist.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                              ctypes.POINTER(ctypes.c_uint64),
+                                              ctypes.POINTER(ctypes.c_uint64),
+                                              ctypes.POINTER(ctypes.c_uint8),
+                                              ctypes.c_size_t)
+_gphrx_lib.gphrx_does_edges_exist.restype = None
+
 _gphrx_lib.gphrx_add_vertex.argtypes = (ctypes.POINTER(_GphrxGraph_c),
                                         ctypes.c_uint64,
                                         ctypes.POINTER(ctypes.c_uint64),
@@ -118,18 +260,253 @@ _gphrx_lib.gphrx_remove_edge.restype = ctypes.c_uint8
 _gphrx_lib.gphrx_find_avg_pool_matrix.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.c_uint64)
 _gphrx_lib.gphrx_find_avg_pool_matrix.restype = _GphrxCsrMatrix_c
 
+_gphrx_lib.new_gphrx_avg_pool_sampler.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.new_gphrx_avg_pool_sampler.restype = _GphrxAvgPoolSampler_c
+
+_gphrx_lib.free_gphrx_avg_pool_sampler.argtypes = [ctypes.POINTER(_GphrxAvgPoolSampler_c)]
+_gphrx_lib.free_gphrx_avg_pool_sampler.restype = None
+
+_gphrx_lib.gphrx_avg_pool_sampler_refine.argtypes = (ctypes.POINTER(_GphrxAvgPoolSampler_c),
+                                                     ctypes.POINTER(_GphrxGraph_c),
+                                                     ctypes.c_uint64)
+_gphrx_lib.gphrx_avg_pool_sampler_refine.restype = ctypes.c_uint64
+
+_gphrx_lib.gphrx_avg_pool_sampler_estimate.argtypes = (ctypes.POINTER(_GphrxAvgPoolSampler_c),
+                                                       ctypes.c_double,
+                                                       ctypes.POINTER(_GphrxCsrMatrix_c))
+_gphrx_lib.gphrx_avg_pool_sampler_estimate.restype = _GphrxCsrMatrix_c
+
 _gphrx_lib.approximate_gphrx.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.c_uint64, ctypes.c_double)
 _gphrx_lib.approximate_gphrx.restype = _GphrxGraph_c
 
+_gphrx_lib.gphrx_find_degree_quantile_boundaries.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.c_uint64)
+_gphrx_lib.gphrx_find_degree_quantile_boundaries.restype = _DynamicArrayU64_c
+
+_gphrx_lib.free_gphrx_block_boundaries.argtypes = [ctypes.POINTER(_DynamicArrayU64_c)]
+_gphrx_lib.free_gphrx_block_boundaries.restype = None
+
+_gphrx_lib.gphrx_find_avg_pool_matrix_with_boundaries.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                                                  ctypes.POINTER(_DynamicArrayU64_c))
+_gphrx_lib.gphrx_find_avg_pool_matrix_with_boundaries.restype = _GphrxCsrMatrix_c
+
+_gphrx_lib.approximate_gphrx_with_boundaries.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                                         ctypes.POINTER(_DynamicArrayU64_c),
+                                                         ctypes.c_double)
+_gphrx_lib.approximate_gphrx_with_boundaries.restype = _GphrxGraph_c
+
 _gphrx_lib.gphrx_to_byte_array.argtypes = [ctypes.POINTER(_GphrxGraph_c)]
 _gphrx_lib.gphrx_to_byte_array.restype = ctypes.POINTER(ctypes.c_ubyte)
 
 _gphrx_lib.gphrx_from_byte_array.argtypes = [ctypes.POINTER(ctypes.c_ubyte)]
 _gphrx_lib.gphrx_from_byte_array.restype = _GphrxGraph_c
 
+_gphrx_lib.gphrx_bfs.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.c_uint64)
+_gphrx_lib.gphrx_bfs.restype = _GphrxBfsResult_c
+
+_gphrx_lib.free_gphrx_bfs_result.argtypes = [ctypes.POINTER(_GphrxBfsResult_c)]
+_gphrx_lib.free_gphrx_bfs_result.restype = None
+
+_gphrx_lib.gphrx_find_components.argtypes = [ctypes.POINTER(_GphrxGraph_c)]
+_gphrx_lib.gphrx_find_components.restype = _GphrxComponentsResult_c
+
+_gphrx_lib.gphrx_find_approximate_components.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                                         ctypes.c_uint64,
+                                                         ctypes.c_double)
+_gphrx_lib.gphrx_find_approximate_components.restype = _GphrxComponentsResult_c
+
+_gphrx_lib.free_gphrx_components_result.argtypes = [ctypes.POINTER(_GphrxComponentsResult_c)]
+_gphrx_lib.free_gphrx_components_result.restype = None
+
+_gphrx_lib.gphrx_find_cores.argtypes = [ctypes.POINTER(_GphrxGraph_c)]
+_gphrx_lib.gphrx_find_cores.restype = _GphrxCoresResult_c
+
+_gphrx_lib.gphrx_find_k_core.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                         ctypes.POINTER(_GphrxCoresResult_c),
+                                         ctypes.c_uint64)
+_gphrx_lib.gphrx_find_k_core.restype = _GphrxGraph_c
+
+_gphrx_lib.free_gphrx_cores_result.argtypes = [ctypes.POINTER(_GphrxCoresResult_c)]
+_gphrx_lib.free_gphrx_cores_result.restype = None
+
+_gphrx_lib.gphrx_count_triangles.argtypes = [ctypes.POINTER(_GphrxGraph_c)]
+_gphrx_lib.gphrx_count_triangles.restype = ctypes.c_uint64
+
+_gphrx_lib.gphrx_find_clustering_coefficients.argtypes = [ctypes.POINTER(_GphrxGraph_c)]
+_gphrx_lib.gphrx_find_clustering_coefficients.restype = _GphrxClusteringResult_c
+
+_gphrx_lib.free_gphrx_clustering_result.argtypes = [ctypes.POINTER(_GphrxClusteringResult_c)]
+_gphrx_lib.free_gphrx_clustering_result.restype = None
+
+_gphrx_lib.gphrx_find_similarities.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                               ctypes.POINTER(ctypes.c_uint64),
+                                               ctypes.POINTER(ctypes.c_uint64),
+                                               ctypes.c_size_t)
+_gphrx_lib.gphrx_find_similarities.restype = _GphrxSimilarityResult_c
+
+_gphrx_lib.free_gphrx_similarity_result.argtypes = [ctypes.POINTER(_GphrxSimilarityResult_c)]
+_gphrx_lib.free_gphrx_similarity_result.restype = None
+
+_gphrx_lib.gphrx_pagerank.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                      ctypes.POINTER(_GphrxPageRankOptions_c),
+                                      ctypes.POINTER(ctypes.c_double))
+_gphrx_lib.gphrx_pagerank.restype = _GphrxPageRankResult_c
+
+_gphrx_lib.gphrx_pagerank_from_approximation.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                                         ctypes.c_uint64,
+                                                         ctypes.c_double,
+                                                         ctypes.POINTER(_GphrxPageRankOptions_c))
+_gphrx_lib.gphrx_pagerank_from_approximation.restype = _GphrxPageRankResult_c
+
+_gphrx_lib.free_gphrx_pagerank_result.argtypes = [ctypes.POINTER(_GphrxPageRankResult_c)]
+_gphrx_lib.free_gphrx_pagerank_result.restype = None
+
+_gphrx_lib.new_undirected_wgphrx.argtypes = [ctypes.c_uint8]
+_gphrx_lib.new_undirected_wgphrx.restype = _GphrxWeightedGraph_c
+
+_gphrx_lib.new_directed_wgphrx.argtypes = [ctypes.c_uint8]
+_gphrx_lib.new_directed_wgphrx.restype = _GphrxWeightedGraph_c
+
+_gphrx_lib.duplicate_wgphrx.argtypes = [ctypes.POINTER(_GphrxWeightedGraph_c)]
+_gphrx_lib.duplicate_wgphrx.restype = _GphrxWeightedGraph_c
+
+_gphrx_lib.free_wgphrx.argtypes = [ctypes.POINTER(_GphrxWeightedGraph_c)]
+_gphrx_lib.free_wgphrx.restype = None
+
+_gphrx_lib.wgphrx_shrink.argtypes = [ctypes.POINTER(_GphrxWeightedGraph_c)]
+_gphrx_lib.wgphrx_shrink.restype = None
+
+_gphrx_lib.wgphrx_does_edge_exist.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c), ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.wgphrx_does_edge_exist.restype = ctypes.c_bool
+
+_gphrx_lib.wgphrx_get_edge_weight.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c),
+                                              ctypes.c_uint64,
+                                              ctypes.c_uint64,
+                                              ctypes.POINTER(ctypes.c_uint8))
+_gphrx_lib.wgphrx_get_edge_weight.restype = ctypes.c_double
+
+_gphrx_lib.wgphrx_add_edge.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c),
+                                       ctypes.c_uint64,
+                                       ctypes.c_uint64,
+                                       ctypes.c_double)
+_gphrx_lib.wgphrx_add_edge.restype = None
+
+_gphrx_lib.wgphrx_remove_edge.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c), ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.wgphrx_remove_edge.restype = ctypes.c_uint8
+
+_gphrx_lib.wgphrx_find_avg_pool_matrix.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c), ctypes.c_uint64)
+_gphrx_lib.wgphrx_find_avg_pool_matrix.restype = _GphrxCsrMatrix_c
+
+_gphrx_lib.approximate_wgphrx.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c), ctypes.c_uint64, ctypes.c_double)
+_gphrx_lib.approximate_wgphrx.restype = _GphrxWeightedGraph_c
+
+_gphrx_lib.wgphrx_to_byte_array.argtypes = [ctypes.POINTER(_GphrxWeightedGraph_c)]
+_gphrx_lib.wgphrx_to_byte_array.restype = ctypes.POINTER(ctypes.c_ubyte)
+
+_gphrx_lib.wgphrx_from_byte_array.argtypes = (ctypes.POINTER(ctypes.c_ubyte), ctypes.POINTER(ctypes.c_uint8))
+_gphrx_lib.wgphrx_from_byte_array.restype = _GphrxWeightedGraph_c
+
+_gphrx_lib.gphrx_multi_source_sssp.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                               ctypes.POINTER(ctypes.c_uint64),
+                                               ctypes.c_uint64,
+                                               ctypes.c_double,
+                                               ctypes.c_double)
+_gphrx_lib.gphrx_multi_source_sssp.restype = _GphrxSsspResult_c
+
+_gphrx_lib.wgphrx_multi_source_sssp.argtypes = (ctypes.POINTER(_GphrxWeightedGraph_c),
+                                                ctypes.POINTER(ctypes.c_uint64),
+                                                ctypes.c_uint64,
+                                                ctypes.c_double,
+                                                ctypes.c_double)
+_gphrx_lib.wgphrx_multi_source_sssp.restype = _GphrxSsspResult_c
+
+_gphrx_lib.free_gphrx_sssp_result.argtypes = [ctypes.POINTER(_GphrxSsspResult_c)]
+_gphrx_lib.free_gphrx_sssp_result.restype = None
+
+_gphrx_lib.gphrx_find_communities.argtypes = (ctypes.POINTER(_GphrxGraph_c),
+                                              ctypes.POINTER(_GphrxCommunitiesOptions_c))
+_gphrx_lib.gphrx_find_communities.restype = _GphrxCommunitiesResult_c
+
+_gphrx_lib.free_gphrx_communities_result.argtypes = [ctypes.POINTER(_GphrxCommunitiesResult_c)]
+_gphrx_lib.free_gphrx_communities_result.restype = None
+
+_gphrx_lib.gphrx_permute_vertices.argtypes = (ctypes.POINTER(_GphrxGraph_c), ctypes.POINTER(ctypes.c_uint64))
+_gphrx_lib.gphrx_permute_vertices.restype = _GphrxGraph_c
+
 _gphrx_lib.free_gphrx_byte_array.argtypes = [ctypes.c_void_p]
 _gphrx_lib.free_gphrx_byte_array.restype = None
 
+_gphrx_lib.gphrx_set_num_threads.argtypes = [ctypes.c_uint32]
+_gphrx_lib.gphrx_set_num_threads.restype = None
+
+_gphrx_lib.gphrx_get_num_threads.argtypes = None
+_gphrx_lib.gphrx_get_num_threads.restype = ctypes.c_uint32
+
+_gphrx_lib.gphrx_use_small_graph_pool.argtypes = [ctypes.c_bool]
+_gphrx_lib.gphrx_use_small_graph_pool.restype = None
+
+_gphrx_lib.new_vgphrx.argtypes = [ctypes.POINTER(_GphrxGraph_c)]
+_gphrx_lib.new_vgphrx.restype = ctypes.c_void_p
+
+_gphrx_lib.free_vgphrx.argtypes = [ctypes.c_void_p]
+_gphrx_lib.free_vgphrx.restype = None
+
+_gphrx_lib.vgphrx_pin.argtypes = [ctypes.c_void_p]
+_gphrx_lib.vgphrx_pin.restype = _GphrxSnapshotGuard_c
+
+_gphrx_lib.vgphrx_unpin.argtypes = (ctypes.c_void_p, ctypes.POINTER(_GphrxSnapshotGuard_c))
+_gphrx_lib.vgphrx_unpin.restype = None
+
+_gphrx_lib.vgphrx_current_version.argtypes = [ctypes.c_void_p]
+_gphrx_lib.vgphrx_current_version.restype = ctypes.c_uint64
+
+_gphrx_lib.vgphrx_add_edge.argtypes = (ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.vgphrx_add_edge.restype = None
+
+_gphrx_lib.vgphrx_remove_edge.argtypes = (ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.vgphrx_remove_edge.restype = ctypes.c_uint8
+
+_gphrx_lib.vgphrx_publish.argtypes = [ctypes.c_void_p]
+_gphrx_lib.vgphrx_publish.restype = ctypes.c_uint64
+
+_gphrx_lib.vgphrx_reclaim.argtypes = [ctypes.c_void_p]
+_gphrx_lib.vgphrx_reclaim.restype = None
+
+_gphrx_lib.new_gphrx_ingest_buffer.argtypes = (ctypes.c_void_p, ctypes.c_uint32)
+_gphrx_lib.new_gphrx_ingest_buffer.restype = ctypes.c_void_p
+
+_gphrx_lib.free_gphrx_ingest_buffer.argtypes = [ctypes.c_void_p]
+_gphrx_lib.free_gphrx_ingest_buffer.restype = None
+
+_gphrx_lib.gphrx_ingest_add_edge.argtypes = (ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.gphrx_ingest_add_edge.restype = None
+
+_gphrx_lib.gphrx_ingest_flush.argtypes = [ctypes.c_void_p]
+_gphrx_lib.gphrx_ingest_flush.restype = ctypes.c_uint64
+
+_gphrx_lib.gphrx_ingest_pending_count.argtypes = [ctypes.c_void_p]
+_gphrx_lib.gphrx_ingest_pending_count.restype = ctypes.c_uint64
+
+_gphrx_lib.gphrx_ingest_does_edge_exist.argtypes = (ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint64)
+_gphrx_lib.gphrx_ingest_does_edge_exist.restype = ctypes.c_bool
+
+
+def set_num_threads(thread_count):
+    """Sets the number of threads GraphRox kernels may use. Zero restores the default, which is the
+    GPHRX_NUM_THREADS environment variable or the number of processors. The pool is shared by every
+    Python thread; a kernel that finds it busy runs single-threaded."""
+    _gphrx_lib.gphrx_set_num_threads(thread_count)
+
+
+def get_num_threads():
+    return _gphrx_lib.gphrx_get_num_threads()
+
+
+def use_small_graph_pool(enable=True):
+    """Allocates graphs created from now on from a pool of size classes rather than with malloc, which
+    cuts allocator overhead and heap fragmentation in programs that create and free many small graphs.
+    Graphs created before the call are unaffected."""
+    _gphrx_lib.gphrx_use_small_graph_pool(enable)
+
 
 class GphrxWeightedMatrix:
     def __init__(self, c_csr_matrix):
@@ -138,6 +515,12 @@ class GphrxWeightedMatrix:
     def dimension(self):
         return self._matrix.dimension
 
+    def entry_count(self):
+        return self._matrix.entries.size
+
+    def threshold_and_scale(self, threshold, scale_factor):
+        _gphrx_lib.gphrx_csr_matrix_threshold_and_scale(self._matrix, threshold, scale_factor)
+
     def to_string_with_precision(self, precision):
         c_str = _gphrx_lib.gphrx_csr_matrix_to_string(self._matrix, precision)
         py_str = ctypes.cast(c_str, ctypes.c_char_p).value
@@ -151,6 +534,27 @@ class GphrxWeightedMatrix:
         _gphrx_lib.free_gphrx_csr_matrix(self._matrix)
 
 
+class GphrxAvgPoolSampler:
+    def __init__(self, graph, block_dimension, seed=0):
+        # Keep a reference to the graph so it isn't freed while the sampler reads its edges
+        self._graph = graph
+        self._sampler = _gphrx_lib.new_gphrx_avg_pool_sampler(graph._graph, block_dimension, seed)
+
+    def sampled_count(self):
+        return self._sampler.sampled_count
+
+    def refine(self, sample_count):
+        return _gphrx_lib.gphrx_avg_pool_sampler_refine(self._sampler, self._graph._graph, sample_count)
+
+    def estimate(self, z_score=1.96):
+        c_margins = _GphrxCsrMatrix_c()
+        c_estimate = _gphrx_lib.gphrx_avg_pool_sampler_estimate(self._sampler, z_score, ctypes.byref(c_margins))
+        return GphrxWeightedMatrix(c_estimate), GphrxWeightedMatrix(c_margins)
+
+    def __del__(self):
+        _gphrx_lib.free_gphrx_avg_pool_sampler(self._sampler)
+
+
 class GphrxAdjacencyMatrix:
     def __init__(self, c_csr_adj_matrix):
         self._matrix = c_csr_adj_matrix
@@ -220,6 +624,19 @@ class GphrxGraph:
     def does_edge_exist(self, from_vertex_id, to_vertex_id):
         return _gphrx_lib.gphrx_does_edge_exist(self._graph, from_vertex_id, to_vertex_id)
 
+    def does_edges_exist(self, vertex_pairs):
+        """Checks a batch of (from, to) vertex pairs in a single call. Returns a list with True for each pair
+        that is an edge of the graph and False for each that isn't."""
+        pairs_arr = ctypes.c_uint64 * len(vertex_pairs)
+        from_vertex_ids = pairs_arr(*(int(pair[0]) for pair in vertex_pairs))
+        to_vertex_ids = pairs_arr(*(int(pair[1]) for pair in vertex_pairs))
+
+        out_bits = (ctypes.c_uint8 * ((len(vertex_pairs) + 7) // 8))()
+
+        _gphrx_lib.gphrx_does_edges_exist(self._graph, from_vertex_ids, to_vertex_ids, out_bits, len(vertex_pairs))
+
+        return [bool((out_bits[i // 8] >> (i % 8)) & 1) for i in range(len(vertex_pairs))]
+
     def add_vertex(self, vertex_id, vertex_edges=[]):
         edges_arr = ctypes.c_uint64 * len(vertex_edges)
         _gphrx_lib.gphrx_add_vertex(self._graph, vertex_id, edges_arr(*vertex_edges), len(vertex_edges))
@@ -241,6 +658,9 @@ class GphrxGraph:
         c_matrix = _gphrx_lib.gphrx_find_avg_pool_matrix(self._graph, block_dimension)
         return GphrxWeightedMatrix(c_matrix)
         
+    def avg_pool_sampler(self, block_dimension, seed=0):
+        return GphrxAvgPoolSampler(self, block_dimension, seed)
+
     def approximate(self, block_dimension, threshold):
         c_graph = _gphrx_lib.approximate_gphrx(self._graph, block_dimension, threshold)
         graph = GphrxUndirectedGraph() if c_graph.is_undirected else GphrxDirectedGraph()
@@ -250,6 +670,203 @@ class GphrxGraph:
 
         return graph
 
+    def approximate_degree_aware(self, blocks_per_row, threshold):
+        """Returns the approximation and the list of block boundaries it was built from."""
+        c_boundaries = _gphrx_lib.gphrx_find_degree_quantile_boundaries(self._graph, blocks_per_row)
+        boundaries = c_boundaries.arr[:c_boundaries.size]
+
+        c_graph = _gphrx_lib.approximate_gphrx_with_boundaries(self._graph, c_boundaries, threshold)
+        _gphrx_lib.free_gphrx_block_boundaries(c_boundaries)
+
+        graph = GphrxUndirectedGraph() if c_graph.is_undirected else GphrxDirectedGraph()
+
+        graph._graph = c_graph
+        graph.adjacency_matrix._matrix = c_graph.adjacency_matrix
+
+        return graph, boundaries
+
+    def bfs(self, source_vertex_id):
+        """Searches the graph breadth-first from the given vertex. Returns a list of each vertex's distance
+        from the source and a list of each vertex's parent on a shortest path from the source (the source
+        is its own parent). Both are None for vertices that can't be reached."""
+        c_result = _gphrx_lib.gphrx_bfs(self._graph, source_vertex_id)
+
+        unreached = 2 ** 64 - 1
+        distances = [None if d == unreached else d for d in c_result.distances[:c_result.vertex_count]]
+        parents = [None if p == unreached else p for p in c_result.parents[:c_result.vertex_count]]
+
+        _gphrx_lib.free_gphrx_bfs_result(c_result)
+
+        return distances, parents
+
+    def shortest_paths(self, source_vertex_ids, delta=0.0, max_distance=float('inf')):
+        """Finds the shortest paths from the nearest of the given source vertices (or from a single source
+        vertex) to every vertex, with every edge weighing one, by parallel delta-stepping. Returns lists of
+        each vertex's distance, its parent on a shortest path and its nearest source. All three are None for
+        vertices further than `max_distance` or that can't be reached. A `delta` of zero picks a bucket
+        width from the graph."""
+        sources = GphrxGraph._sssp_sources(source_vertex_ids)
+        c_result = _gphrx_lib.gphrx_multi_source_sssp(self._graph, sources, len(sources), delta, max_distance)
+        return GphrxGraph._sssp_result(c_result)
+
+    @staticmethod
+    def _sssp_sources(source_vertex_ids):
+        if isinstance(source_vertex_ids, int):
+            source_vertex_ids = [source_vertex_ids]
+
+        return (ctypes.c_uint64 * len(source_vertex_ids))(*source_vertex_ids)
+
+    @staticmethod
+    def _sssp_result(c_result):
+        unreached = 2 ** 64 - 1
+        count = c_result.vertex_count
+
+        parents = [None if p == unreached else p for p in c_result.parents[:count]]
+        distances = [None if p is None else d for d, p in zip(c_result.distances[:count], parents)]
+        nearest_sources = [None if s == unreached else s for s in c_result.nearest_sources[:count]]
+
+        _gphrx_lib.free_gphrx_sssp_result(c_result)
+
+        return distances, parents, nearest_sources
+
+    def components(self):
+        """Finds the graph's connected components, ignoring the direction of edges. Returns a list of each
+        vertex's component and a list of each component's size. Components are numbered in order of their
+        lowest vertex."""
+        return GphrxGraph._components_result(_gphrx_lib.gphrx_find_components(self._graph))
+
+    def approximate_components(self, block_dimension, threshold):
+        """Estimates the graph's connected components from an approximation of it, returning them like
+        `components`. With a threshold of zero, each estimated component is a union of whole components."""
+        c_result = _gphrx_lib.gphrx_find_approximate_components(self._graph, block_dimension, threshold)
+        return GphrxGraph._components_result(c_result)
+
+    @staticmethod
+    def _components_result(c_result):
+        labels = c_result.labels[:c_result.vertex_count]
+        sizes = c_result.sizes[:c_result.component_count]
+
+        _gphrx_lib.free_gphrx_components_result(c_result)
+
+        return labels, sizes
+
+    def cores(self):
+        """Finds the k-core decomposition of the graph, counting edges in both directions and ignoring
+        self-loops. Returns a list of each vertex's core number and a list of the vertices in degeneracy
+        order (the order they were peeled in, along which core numbers never decrease)."""
+        c_result = _gphrx_lib.gphrx_find_cores(self._graph)
+
+        core_numbers = c_result.core_numbers[:c_result.vertex_count]
+        degeneracy_order = c_result.degeneracy_order[:c_result.vertex_count]
+
+        _gphrx_lib.free_gphrx_cores_result(c_result)
+
+        return core_numbers, degeneracy_order
+
+    def k_core(self, k):
+        """Returns the k-core of the graph: the edges between vertices with a core number of at least k.
+        Vertex IDs are unchanged."""
+        c_graph = _gphrx_lib.gphrx_find_k_core(self._graph, None, k)
+        graph = GphrxUndirectedGraph() if c_graph.is_undirected else GphrxDirectedGraph()
+
+        graph._graph = c_graph
+        graph.adjacency_matrix._matrix = c_graph.adjacency_matrix
+
+        return graph
+
+    def communities(self, max_iterations=20, tolerance=0.01, refine_with_louvain=False, max_louvain_levels=10):
+        """Finds communities of densely connected vertices by parallel label propagation, optionally refined
+        by the Louvain method, ignoring the direction of edges. Returns a list of each vertex's community, a
+        list of each community's size, a permutation of the vertex IDs that makes each community's IDs
+        contiguous (see `permute_vertices`), and the modularity of the communities. Communities are numbered
+        in order of their lowest vertex."""
+        options = _GphrxCommunitiesOptions_c(max_iterations, tolerance, refine_with_louvain, max_louvain_levels)
+        c_result = _gphrx_lib.gphrx_find_communities(self._graph, options)
+
+        labels = c_result.labels[:c_result.vertex_count]
+        sizes = c_result.sizes[:c_result.community_count]
+        permutation = c_result.permutation[:c_result.vertex_count]
+        modularity = c_result.modularity
+
+        _gphrx_lib.free_gphrx_communities_result(c_result)
+
+        return labels, sizes, permutation, modularity
+
+    def permute_vertices(self, permutation):
+        """Returns a copy of the graph with each vertex v renamed to `permutation[v]`. The permutation must
+        hold a distinct ID below the graph's node count for each vertex."""
+        c_permutation = (ctypes.c_uint64 * len(permutation))(*permutation)
+        c_graph = _gphrx_lib.gphrx_permute_vertices(self._graph, c_permutation)
+        graph = GphrxUndirectedGraph() if c_graph.is_undirected else GphrxDirectedGraph()
+
+        graph._graph = c_graph
+        graph.adjacency_matrix._matrix = c_graph.adjacency_matrix
+
+        return graph
+
+    def count_triangles(self):
+        """Counts the triangles in the graph, ignoring self-loops and the direction of edges."""
+        return _gphrx_lib.gphrx_count_triangles(self._graph)
+
+    def clustering_coefficients(self):
+        """Returns a list of the number of triangles each vertex is part of, a list of each vertex's local
+        clustering coefficient, and the average clustering coefficient over every vertex."""
+        c_result = _gphrx_lib.gphrx_find_clustering_coefficients(self._graph)
+
+        triangle_counts = c_result.triangle_counts[:c_result.vertex_count]
+        coefficients = c_result.coefficients[:c_result.vertex_count]
+        average_coefficient = c_result.average_coefficient
+
+        _gphrx_lib.free_gphrx_clustering_result(c_result)
+
+        return triangle_counts, coefficients, average_coefficient
+
+    def similarities(self, vertex_pairs):
+        """Scores a batch of (from, to) vertex pairs in a single call. Returns a list of each pair's
+        common-neighbour count, a list of Jaccard scores, and a list of Adamic-Adar scores."""
+        pairs_arr = ctypes.c_uint64 * len(vertex_pairs)
+        from_vertex_ids = pairs_arr(*(pair[0] for pair in vertex_pairs))
+        to_vertex_ids = pairs_arr(*(pair[1] for pair in vertex_pairs))
+
+        c_result = _gphrx_lib.gphrx_find_similarities(self._graph, from_vertex_ids, to_vertex_ids, len(vertex_pairs))
+
+        common_neighbor_counts = c_result.common_neighbor_counts[:c_result.query_count]
+        jaccard_scores = c_result.jaccard_scores[:c_result.query_count]
+        adamic_adar_scores = c_result.adamic_adar_scores[:c_result.query_count]
+
+        _gphrx_lib.free_gphrx_similarity_result(c_result)
+
+        return common_neighbor_counts, jaccard_scores, adamic_adar_scores
+
+    def pagerank(self, damping_factor=0.85, tolerance=1e-9, max_iterations=100, initial_scores=None):
+        """Returns the PageRank score of each vertex and the number of iterations taken to find them.
+        `initial_scores`, if given, is a list of starting scores, one per vertex."""
+        options = _GphrxPageRankOptions_c(damping_factor, tolerance, max_iterations)
+        c_initial_scores = None
+
+        if initial_scores is not None:
+            c_initial_scores = (ctypes.c_double * len(initial_scores))(*initial_scores)
+
+        return GphrxGraph._pagerank_result(_gphrx_lib.gphrx_pagerank(self._graph, options, c_initial_scores))
+
+    def pagerank_from_approximation(self, block_dimension, threshold, damping_factor=0.85, tolerance=1e-9,
+                                    max_iterations=100):
+        """Like `pagerank`, but starts from scores estimated on an approximation of the graph, which usually
+        takes fewer iterations on the full graph."""
+        options = _GphrxPageRankOptions_c(damping_factor, tolerance, max_iterations)
+        c_result = _gphrx_lib.gphrx_pagerank_from_approximation(self._graph, block_dimension, threshold, options)
+
+        return GphrxGraph._pagerank_result(c_result)
+
+    @staticmethod
+    def _pagerank_result(c_result):
+        scores = c_result.scores[:c_result.vertex_count]
+        iteration_count = c_result.iteration_count
+
+        _gphrx_lib.free_gphrx_pagerank_result(c_result)
+
+        return scores, iteration_count
+
     def save_to_file(self, file_name):
         with open(file_name, 'wb') as f:
             f.write(bytes(self))
@@ -277,6 +894,85 @@ class GphrxGraph:
         return bytes_obj
 
 
+class GphrxVersionedGraph:
+    """A graph that can be queried from many threads while another thread modifies it. Changes become
+    visible to queries when they are published."""
+    def __init__(self, is_undirected=True):
+        self.is_undirected = is_undirected
+        c_graph = _gphrx_lib.new_undirected_gphrx() if is_undirected else _gphrx_lib.new_directed_gphrx()
+        self._versioned_graph = _gphrx_lib.new_vgphrx(c_graph)
+
+    def __del__(self):
+        _gphrx_lib.free_vgphrx(self._versioned_graph)
+
+    def version(self):
+        return _gphrx_lib.vgphrx_current_version(self._versioned_graph)
+
+    def add_edge(self, from_vertex_id, to_vertex_id):
+        _gphrx_lib.vgphrx_add_edge(self._versioned_graph, from_vertex_id, to_vertex_id)
+
+    def remove_edge(self, from_vertex_id, to_vertex_id):
+        error_code = _gphrx_lib.vgphrx_remove_edge(self._versioned_graph, from_vertex_id, to_vertex_id)
+
+        if error_code == _GphrxErrorCode.GPHRX_ERROR_NOT_FOUND.value:
+            raise ValueError("Edge from vertex " + str(from_vertex_id) +
+                             " to vertex " + str(to_vertex_id) + " does not exist")
+
+    def publish(self):
+        return _gphrx_lib.vgphrx_publish(self._versioned_graph)
+
+    def does_edge_exist(self, from_vertex_id, to_vertex_id):
+        guard = _gphrx_lib.vgphrx_pin(self._versioned_graph)
+        exists = _gphrx_lib.gphrx_does_edge_exist(guard.graph, from_vertex_id, to_vertex_id)
+        _gphrx_lib.vgphrx_unpin(self._versioned_graph, guard)
+
+        return exists
+
+    def edge_count(self):
+        guard = _gphrx_lib.vgphrx_pin(self._versioned_graph)
+        edges = guard.graph.contents.adjacency_matrix.col_indices.size
+        _gphrx_lib.vgphrx_unpin(self._versioned_graph, guard)
+
+        return int(edges / 2) if self.is_undirected else edges
+
+    def approximate(self, block_dimension, threshold):
+        guard = _gphrx_lib.vgphrx_pin(self._versioned_graph)
+        c_graph = _gphrx_lib.approximate_gphrx(guard.graph, block_dimension, threshold)
+        _gphrx_lib.vgphrx_unpin(self._versioned_graph, guard)
+
+        graph = GphrxUndirectedGraph() if c_graph.is_undirected else GphrxDirectedGraph()
+
+        graph._graph = c_graph
+        graph.adjacency_matrix._matrix = c_graph.adjacency_matrix
+
+        return graph
+
+
+class GphrxIngestBuffer:
+    """Stages edges added from many threads and merges them into a GphrxVersionedGraph, either every
+    merge_interval_ms milliseconds on a background thread or when flushed. Staged edges are visible to
+    does_edge_exist before they are merged."""
+    def __init__(self, versioned_graph, merge_interval_ms=0):
+        # Keeps the versioned graph alive for as long as the buffer merges into it
+        self.versioned_graph = versioned_graph
+        self._buffer = _gphrx_lib.new_gphrx_ingest_buffer(versioned_graph._versioned_graph, merge_interval_ms)
+
+    def __del__(self):
+        _gphrx_lib.free_gphrx_ingest_buffer(self._buffer)
+
+    def add_edge(self, from_vertex_id, to_vertex_id):
+        _gphrx_lib.gphrx_ingest_add_edge(self._buffer, from_vertex_id, to_vertex_id)
+
+    def flush(self):
+        return _gphrx_lib.gphrx_ingest_flush(self._buffer)
+
+    def pending_count(self):
+        return _gphrx_lib.gphrx_ingest_pending_count(self._buffer)
+
+    def does_edge_exist(self, from_vertex_id, to_vertex_id):
+        return _gphrx_lib.gphrx_ingest_does_edge_exist(self._buffer, from_vertex_id, to_vertex_id)
+
+
 class GphrxUndirectedGraph(GphrxGraph):
     def __init__(self):
         super().__init__(True)
@@ -287,6 +983,114 @@ class GphrxDirectedGraph(GphrxGraph):
         super().__init__(False)
 
 
+class GphrxWeightedGraph:
+    F32 = 4
+    F64 = 8
+
+    def __init__(self, is_undirected=True, precision=F64):
+        self.is_undirected = is_undirected
+        self._graph = (_gphrx_lib.new_undirected_wgphrx(precision) if is_undirected
+                       else _gphrx_lib.new_directed_wgphrx(precision))
+
+    @staticmethod
+    def _from_c_graph(c_graph):
+        graph = GphrxWeightedGraph.__new__(GphrxWeightedGraph)
+        graph.is_undirected = c_graph.is_undirected
+        graph._graph = c_graph
+        return graph
+
+    def __del__(self):
+        _gphrx_lib.free_wgphrx(self._graph)
+
+    def node_count(self):
+        return self._graph.adjacency_matrix.dimension
+
+    def edge_count(self):
+        edges = self._graph.adjacency_matrix.col_indices.size
+        return int(edges / 2) if self.is_undirected else edges
+
+    def precision(self):
+        return self._graph.precision
+
+    @staticmethod
+    def from_bytes(byte_array):
+        error_code = ctypes.c_uint8()
+        arr = (ctypes.c_ubyte * (len(byte_array))).from_buffer(bytearray(byte_array))
+        c_graph = _gphrx_lib.wgphrx_from_byte_array(arr, ctypes.byref(error_code))
+
+        if error_code.value != _GphrxErrorCode.GPHRX_NO_ERROR.value:
+            raise ValueError("GphrxWeightedGraph could not be constructed from the provided bytes")
+
+        return GphrxWeightedGraph._from_c_graph(c_graph)
+
+    def duplicate(self):
+        return GphrxWeightedGraph._from_c_graph(_gphrx_lib.duplicate_wgphrx(self._graph))
+
+    def shrink(self):
+        _gphrx_lib.wgphrx_shrink(self._graph)
+
+    def does_edge_exist(self, from_vertex_id, to_vertex_id):
+        return _gphrx_lib.wgphrx_does_edge_exist(self._graph, from_vertex_id, to_vertex_id)
+
+    def edge_weight(self, from_vertex_id, to_vertex_id):
+        error_code = ctypes.c_uint8()
+        weight = _gphrx_lib.wgphrx_get_edge_weight(self._graph, from_vertex_id, to_vertex_id,
+                                                   ctypes.byref(error_code))
+
+        if error_code.value == _GphrxErrorCode.GPHRX_ERROR_NOT_FOUND.value:
+            raise ValueError("Edge from vertex " + str(from_vertex_id) +
+                             " to vertex " + str(to_vertex_id) + " does not exist")
+
+        return weight
+
+    def add_edge(self, from_vertex_id, to_vertex_id, weight):
+        _gphrx_lib.wgphrx_add_edge(self._graph, from_vertex_id, to_vertex_id, weight)
+
+    def remove_edge(self, from_vertex_id, to_vertex_id):
+        error_code = _gphrx_lib.wgphrx_remove_edge(self._graph, from_vertex_id, to_vertex_id)
+
+        if error_code == _GphrxErrorCode.GPHRX_ERROR_NOT_FOUND.value:
+            raise ValueError("Edge from vertex " + str(from_vertex_id) +
+                             " to vertex " + str(to_vertex_id) + " does not exist")
+
+    def find_avg_pool_matrix(self, block_dimension):
+        c_matrix = _gphrx_lib.wgphrx_find_avg_pool_matrix(self._graph, block_dimension)
+        return GphrxWeightedMatrix(c_matrix)
+
+    def approximate(self, block_dimension, threshold):
+        c_graph = _gphrx_lib.approximate_wgphrx(self._graph, block_dimension, threshold)
+        return GphrxWeightedGraph._from_c_graph(c_graph)
+
+    def shortest_paths(self, source_vertex_ids, delta=0.0, max_distance=float('inf')):
+        """Finds the shortest paths from the nearest of the given source vertices (or from a single source
+        vertex) to every vertex by parallel delta-stepping, returning them like `GphrxGraph.shortest_paths`.
+        Weights must be non-negative."""
+        sources = GphrxGraph._sssp_sources(source_vertex_ids)
+        c_result = _gphrx_lib.wgphrx_multi_source_sssp(self._graph, sources, len(sources), delta, max_distance)
+        return GphrxGraph._sssp_result(c_result)
+
+    def save_to_file(self, file_name):
+        with open(file_name, 'wb') as f:
+            f.write(bytes(self))
+
+    @staticmethod
+    def load_from_file(file_name):
+        with open(file_name, 'rb') as f:
+            return GphrxWeightedGraph.from_bytes(f.read())
+
+    def __bytes__(self):
+        HEADER_SIZE_IN_BYTES = 26
+
+        edges = self._graph.adjacency_matrix.col_indices.size
+        total_array_size = HEADER_SIZE_IN_BYTES + edges * (2 * ctypes.sizeof(ctypes.c_uint64) + self._graph.precision)
+
+        byte_array_ptr = _gphrx_lib.wgphrx_to_byte_array(self._graph)
+        bytes_obj = bytes(byte_array_ptr[:total_array_size])
+        _gphrx_lib.free_gphrx_byte_array(byte_array_ptr)
+
+        return bytes_obj
+
+
 if __name__ == '__main__':
     test_graph = GphrxUndirectedGraph()
     
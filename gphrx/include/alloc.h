@@ -0,0 +1,174 @@
+#ifndef __ALLOC_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "intrinsics.h"
+
+/**
+ * An allocator for the buffers of GraphRox's arrays. `resize` and `free` are given the size the buffer was
+ * allocated (or last resized) with, so an allocator doesn't have to record it. Allocators embed this struct
+ * as their first member and are passed a pointer to it.
+ */
+typedef struct GphrxAllocator {
+    void *(*alloc)(struct GphrxAllocator *allocator, size_t size);
+    void *(*resize)(struct GphrxAllocator *allocator, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(struct GphrxAllocator *allocator, void *ptr, size_t size);
+} GphrxAllocator;
+
+/**
+ * Sets the allocator used for the arrays of graphs and matrices created from now on. Each array keeps the
+ * allocator it was created with, so changing the allocator doesn't affect existing graphs. Passing null
+ * restores the default, which uses malloc (or mmap for large arrays; see GPHRX_MAP_THRESHOLD). The
+ * allocator may be used from several threads at once, so arenas should not be set here.
+ */
+DLLEXPORT void gphrx_set_allocator(GphrxAllocator *allocator);
+
+/**
+ * Returns the allocator set with `gphrx_set_allocator`, or null if arrays use the default allocator.
+ */
+DLLEXPORT GphrxAllocator *gphrx_get_allocator();
+
+/**
+ * Makes new graphs use (or, if `enable` is false, stop using) a process-wide GphrxPool. Suited to programs
+ * that create and free many small graphs, such as the Python wrapper.
+ */
+DLLEXPORT void gphrx_use_small_graph_pool(bool enable);
+
+/**
+ * Buffers of at least this many bytes are allocated by the default allocator (and by the pool, which passes
+ * large buffers through to it) with mmap rather than malloc, where mmap is available. They are mapped in
+ * whole huge pages and marked for transparent huge pages with madvise, which cuts TLB misses when scanning
+ * large edge lists, and on Linux they grow and shrink with mremap, which moves pages instead of copying
+ * them.
+ */
+#define GPHRX_MAP_THRESHOLD (4 * 1024 * 1024)
+#define GPHRX_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Allocates, resizes, or frees a buffer with the given allocator, or with the default allocator if it is
+ * null. The default allocator uses malloc, realloc, and free, except for buffers of at least
+ * GPHRX_MAP_THRESHOLD bytes. It tells the two apart by size, so buffers it allocates must only be resized
+ * and freed through these functions, and always with their exact size.
+ */
+void *_gphrx_alloc(GphrxAllocator *allocator, size_t size);
+void *_gphrx_resize(GphrxAllocator *allocator, void *ptr, size_t old_size, size_t new_size);
+void _gphrx_free(GphrxAllocator *allocator, void *ptr, size_t size);
+
+/**
+ * Default size of the blocks an arena allocates from.
+ */
+#define GPHRX_ARENA_BLOCK_SIZE (256 * 1024)
+
+typedef struct GphrxArenaBlock {
+    struct GphrxArenaBlock *next;
+    size_t capacity;
+    size_t used;
+} GphrxArenaBlock;
+
+/**
+ * A bump allocator for temporaries that are all freed together. Allocating takes a pointer increment, and
+ * freeing a buffer does nothing unless it was the most recent allocation. Instead, the arena is rewound to
+ * a mark (or reset), which frees everything allocated since at once.
+ *
+ * The first block is kept when the arena is reset, so an arena that is reused for similar work soon stops
+ * calling malloc at all. Allocations larger than a block get a block of their own, which is freed when the
+ * arena is rewound past it. An arena must only be used by one thread at a time.
+ */
+typedef struct {
+    GphrxAllocator allocator;
+    GphrxArenaBlock *first;
+    GphrxArenaBlock *current;
+    size_t block_size;
+} GphrxArena;
+
+typedef struct {
+    GphrxArenaBlock *block;
+    size_t used;
+} GphrxArenaMark;
+
+/**
+ * Creates an arena that allocates blocks of `block_size` bytes (GPHRX_ARENA_BLOCK_SIZE if zero).
+ */
+DLLEXPORT GphrxArena *new_gphrx_arena(size_t block_size);
+
+/**
+ * Frees the arena and everything allocated from it.
+ */
+DLLEXPORT void free_gphrx_arena(GphrxArena *restrict arena);
+
+/**
+ * Frees everything allocated from the arena. This takes constant time unless the arena has had to allocate
+ * more than its first block.
+ */
+DLLEXPORT void gphrx_arena_reset(GphrxArena *restrict arena);
+
+/**
+ * Returns a mark that the arena can later be rewound to, freeing everything allocated after the mark.
+ */
+GphrxArenaMark gphrx_arena_mark(GphrxArena *restrict arena);
+void gphrx_arena_rewind(GphrxArena *restrict arena, GphrxArenaMark mark);
+
+/**
+ * Returns an arena belonging to the calling thread for the temporaries of a single call. Callers take a
+ * mark on entry and rewind to it before returning, so calls can nest. The arena is freed when the thread
+ * exits.
+ */
+GphrxArena *_gphrx_scratch_arena();
+
+/**
+ * The smallest and largest size classes of a GphrxPool. Each class is twice the size of the one before.
+ */
+#define GPHRX_POOL_MIN_CLASS_SIZE 16
+#define GPHRX_POOL_MAX_CLASS_SIZE (64 * 1024)
+#define GPHRX_POOL_CLASS_COUNT 13
+
+/**
+ * Size of the slabs that a GphrxPool carves its buffers from.
+ */
+#define GPHRX_POOL_SLAB_SIZE (256 * 1024)
+
+typedef struct GphrxPoolSlab {
+    struct GphrxPoolSlab *next;
+} GphrxPoolSlab;
+
+/**
+ * A thread-safe allocator that rounds small buffers up to a power-of-two size class and keeps a free list
+ * for each class, carving new buffers from large slabs. Buffers of the same class are interchangeable, so
+ * a program that creates and frees many small graphs reuses the same memory rather than fragmenting the
+ * heap. Buffers larger than GPHRX_POOL_MAX_CLASS_SIZE are passed through to the default allocator.
+ *
+ * Slabs are only returned to the system when the pool is freed.
+ */
+typedef struct {
+    GphrxAllocator allocator;
+    pthread_mutex_t lock;
+    void *free_lists[GPHRX_POOL_CLASS_COUNT];
+    GphrxPoolSlab *slabs;
+} GphrxPool;
+
+/**
+ * Creates an empty pool.
+ */
+DLLEXPORT GphrxPool *new_gphrx_pool();
+
+/**
+ * Frees the pool and its slabs. Every buffer allocated from the pool must have been freed (or must never
+ * be used again).
+ */
+DLLEXPORT void free_gphrx_pool(GphrxPool *restrict pool);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet alloc_h_register_tests();
+
+#endif
+
+
+#define __ALLOC_H
+#endif
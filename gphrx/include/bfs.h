@@ -0,0 +1,69 @@
+#ifndef __BFS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * Distance and parent of the vertices a search did not reach.
+ */
+#define GPHRX_UNREACHED UINT64_MAX
+
+/**
+ * Result of a breadth-first search. `distances[v]` is the number of edges on a shortest path from the
+ * source to v and `parents[v]` is the vertex before v on one such path (the source is its own parent). Both
+ * are GPHRX_UNREACHED for vertices the search did not reach.
+ */
+typedef struct {
+    u64 vertex_count;
+    u64 reached_count;
+    u64 *distances;
+    u64 *parents;
+} GphrxBfsResult;
+
+/**
+ * Searches the graph breadth-first from `source_vertex_id`, following edges from their from vertex to their
+ * to vertex.
+ *
+ * Each level is expanded either top-down, with the threads splitting the frontier and claiming the
+ * unvisited vertices its edges lead to, or bottom-up, with the threads splitting the unvisited vertices and
+ * checking each one's in-edges against a bitmap of the frontier until one hits. Bottom-up stops scanning a
+ * vertex at its first parent, so it is far cheaper than top-down in the few middle levels where the
+ * frontier holds a large share of the edges (as on small-world graphs), and far more expensive elsewhere.
+ * The search switches to bottom-up once the frontier's edges outnumber the unvisited vertices' edges by
+ * GPHRX_BFS_ALPHA, and back once the frontier shrinks below 1 / GPHRX_BFS_BETA of the vertices (Beamer et
+ * al., "Direction-Optimizing Breadth-First Search"). On directed graphs the first bottom-up level builds the
+ * graph's transpose to find in-edges.
+ *
+ * Which of several shortest-path parents a vertex gets depends on thread scheduling; distances don't. An
+ * approximation from `approximate_gphrx` can be searched like any other graph, from the block holding the
+ * source (`source_vertex_id / block_dimension`), to compare its distances with the original's.
+ */
+DLLEXPORT GphrxBfsResult gphrx_bfs(GphrxGraph *restrict graph, u64 source_vertex_id);
+
+/**
+ * Frees a result from `gphrx_bfs`.
+ */
+DLLEXPORT void free_gphrx_bfs_result(GphrxBfsResult *restrict result);
+
+/**
+ * Tuning parameters for the switch between top-down and bottom-up levels (see `gphrx_bfs`).
+ */
+#define GPHRX_BFS_ALPHA 15
+#define GPHRX_BFS_BETA 18
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet bfs_h_register_tests();
+
+#endif
+
+
+#define __BFS_H
+#endif
@@ -0,0 +1,108 @@
+#ifndef __COMMUNITIES_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+#define GPHRX_COMMUNITIES_DEFAULT_MAX_ITERATIONS 20
+#define GPHRX_COMMUNITIES_DEFAULT_TOLERANCE 0.01
+#define GPHRX_COMMUNITIES_DEFAULT_MAX_LOUVAIN_LEVELS 10
+
+/**
+ * Parameters of a community search. Each phase (label propagation, and each level of the Louvain
+ * refinement) stops once fewer than `tolerance` of its vertices changed community in one pass over them,
+ * or after `max_iterations` passes. The Louvain refinement runs only if `refine_with_louvain` is set, for
+ * at most `max_louvain_levels` levels.
+ */
+typedef struct {
+    u32 max_iterations;
+    double tolerance;
+    bool refine_with_louvain;
+    u32 max_louvain_levels;
+} GphrxCommunitiesOptions;
+
+/**
+ * Communities of a graph. `labels[v]` is the index of vertex v's community and `sizes[c]` is the number of
+ * vertices in community c. Communities are numbered in order of their lowest vertex ID. Every vertex ID
+ * below the graph's dimension is included, so vertices without edges are communities of their own.
+ *
+ * `permutation[v]` is a new ID for vertex v that puts the communities in contiguous ranges of IDs, in order
+ * of their index, with the vertices of each community kept in their original order. Pass it to
+ * `gphrx_permute_vertices` to relabel the graph, so that the blocks of `approximate_gphrx` fall within and
+ * between communities rather than cutting across them at random.
+ *
+ * `modularity` is the modularity of the communities, with the direction of edges ignored, and
+ * `iteration_count` is the number of passes made by label propagation. `louvain_level_count` is the number
+ * of Louvain levels that were run.
+ */
+typedef struct {
+    u64 vertex_count;
+    u64 community_count;
+    u64 *labels;
+    u64 *sizes;
+    u64 *permutation;
+    double modularity;
+    u32 iteration_count;
+    u32 louvain_level_count;
+} GphrxCommunitiesResult;
+
+/**
+ * Returns the default community search options, which run label propagation alone.
+ */
+DLLEXPORT GphrxCommunitiesOptions gphrx_default_communities_options();
+
+/**
+ * Finds communities of densely connected vertices in the graph, ignoring the direction of edges.
+ *
+ * Communities are first found by asynchronous label propagation (Raghavan et al., "Near linear time
+ * algorithm to detect community structures in large-scale networks"): every vertex starts in a community
+ * of its own and, on each pass, the threads split the vertices and move each one to the community most of
+ * its neighbours are in, writing the new labels in place so that later vertices see them within the same
+ * pass. A vertex is only revisited once one of its neighbours has moved, so later passes touch little more
+ * than the boundaries between communities. Ties are broken by staying put, then by a hash of the vertex and
+ * label, which spreads choices as a random tie-break would.
+ *
+ * With `refine_with_louvain`, the communities are then improved by the Louvain method (Blondel et al., "Fast
+ * unfolding of communities in large networks"), starting from the label propagation result rather than
+ * from single vertices. Vertices are moved, in parallel, to the neighbouring community that raises the
+ * modularity the most, and each community is then merged into one vertex of a smaller weighted graph on
+ * which the moves are repeated, until a level moves nothing. This costs several times more than label
+ * propagation but gives communities of higher modularity, and is less prone to a single community
+ * absorbing most of the graph.
+ *
+ * Each thread keeps a count for every possible community, so the search uses O(V) memory per thread. The
+ * communities found depend on how the threads interleave, so they can differ between runs with more than
+ * one thread.
+ *
+ * @param options, if null, are the default options.
+ */
+DLLEXPORT GphrxCommunitiesResult gphrx_find_communities(GphrxGraph *restrict graph,
+                                                        GphrxCommunitiesOptions *restrict options);
+
+/**
+ * Frees a result from `gphrx_find_communities`.
+ */
+DLLEXPORT void free_gphrx_communities_result(GphrxCommunitiesResult *restrict result);
+
+/**
+ * Returns a copy of the graph with every vertex v renamed to `permutation[v]`. `permutation` must hold a
+ * distinct ID below the graph's dimension for each vertex below it. The edges are renamed in parallel and
+ * sorted with `gphrx_sort_edges`.
+ */
+DLLEXPORT GphrxGraph gphrx_permute_vertices(GphrxGraph *restrict graph, u64 *restrict permutation);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet communities_h_register_tests();
+
+#endif
+
+
+#define __COMMUNITIES_H
+#endif
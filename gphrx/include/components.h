@@ -0,0 +1,76 @@
+#ifndef __COMPONENTS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * The (weakly) connected components of a graph. `labels[v]` is the index of vertex v's component, and
+ * `sizes[c]` is the number of vertices in component c. Components are numbered in order of their lowest
+ * vertex ID, so the numbering does not depend on how the work was split between threads. Every vertex ID
+ * below the graph's dimension is counted, so vertices without edges are components of their own.
+ */
+typedef struct {
+    u64 vertex_count;
+    u64 component_count;
+    u64 *labels;
+    u64 *sizes;
+} GphrxComponentsResult;
+
+/**
+ * Finds the graph's connected components, ignoring the direction of edges.
+ *
+ * This is the Afforest algorithm (Sutton et al., "Optimizing Parallel Graph Connectivity Computation via
+ * Subgraph Sampling"): a lock-free union-find, in which each vertex points towards the lowest vertex ID in
+ * its component and unions are made with compare-and-swap, run in parallel over the edge lists. Unions are
+ * first made along only the first GPHRX_COMPONENTS_NEIGHBOR_ROUNDS edges of each vertex, which usually
+ * joins most of the graph into one giant component. That component is then found by sampling, and on
+ * undirected graphs its vertices skip their remaining edges, since any edge that would join another
+ * component to it is also seen from the other end. Directed graphs store each edge only at its from
+ * vertex, so there every vertex goes through all of its edges.
+ */
+DLLEXPORT GphrxComponentsResult gphrx_find_components(GphrxGraph *restrict graph);
+
+/**
+ * Estimates the graph's connected components from its approximation (see `approximate_gphrx`), which is
+ * much smaller than the graph. Each vertex is given the component of its block in the approximation.
+ *
+ * If the threshold is low enough that a block with a single edge is kept (at most 1 / block_dimension^2),
+ * every path in the graph has a matching path in the approximation, so each estimated component is a union
+ * of whole components of the graph. This makes the estimate a safe way to split a very large graph into
+ * independent parts. With higher thresholds, sparse connections between blocks can be lost.
+ */
+DLLEXPORT GphrxComponentsResult gphrx_find_approximate_components(GphrxGraph *restrict graph,
+                                                                  u64 block_dimension,
+                                                                  double threshold);
+
+/**
+ * Frees a result from `gphrx_find_components` or `gphrx_find_approximate_components`.
+ */
+DLLEXPORT void free_gphrx_components_result(GphrxComponentsResult *restrict result);
+
+/**
+ * Number of neighbour-sampling rounds in `gphrx_find_components`.
+ */
+#define GPHRX_COMPONENTS_NEIGHBOR_ROUNDS 2
+
+/**
+ * Number of vertices sampled to find the largest component in `gphrx_find_components`.
+ */
+#define GPHRX_COMPONENTS_SAMPLE_COUNT 1024
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet components_h_register_tests();
+
+#endif
+
+
+#define __COMPONENTS_H
+#endif
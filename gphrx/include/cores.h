@@ -0,0 +1,65 @@
+#ifndef __CORES_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * The k-core decomposition of a graph. The k-core is the largest subgraph in which every vertex has at
+ * least k neighbours, and `core_numbers[v]` is the largest k for which vertex v is in the k-core.
+ * `max_core` is the largest core number (the graph's degeneracy).
+ *
+ * `degeneracy_order` lists every vertex in the order it was peeled from the graph. Core numbers never
+ * decrease along it, and each vertex has at most `max_core` neighbours later in the order, which makes it
+ * a good order for greedy colouring and for orienting edges in clique and triangle searches.
+ *
+ * Every vertex ID below the graph's dimension is included, so vertices without edges have a core number of
+ * zero.
+ */
+typedef struct {
+    u64 vertex_count;
+    u64 max_core;
+    u64 *core_numbers;
+    u64 *degeneracy_order;
+} GphrxCoresResult;
+
+/**
+ * Finds the core number of every vertex in the graph. A vertex's degree counts its edges in both
+ * directions (so on a directed graph it is the in-degree plus the out-degree) and ignores self-loops.
+ *
+ * This is the bucket algorithm of Batagelj and Zaversnik ("An O(m) Algorithm for Cores Decomposition of
+ * Networks"): vertices are kept sorted by their remaining degree in an array of buckets and peeled in
+ * order, and each peeled vertex moves its neighbours down one bucket in constant time, so the whole
+ * decomposition takes O(V + E) time. The degrees are counted in parallel. Peeling is sequential, since
+ * each vertex's place in the order depends on every vertex peeled before it, but it touches each edge once.
+ */
+DLLEXPORT GphrxCoresResult gphrx_find_cores(GphrxGraph *restrict graph);
+
+/**
+ * Returns the k-core of the graph: every edge whose vertices both have a core number of at least k, built
+ * in a single parallel pass over the edge lists rather than by removing vertices one at a time. Vertex IDs
+ * are unchanged. If `cores` is null, the core numbers are found first with `gphrx_find_cores`; otherwise it
+ * must be a result for this graph.
+ */
+DLLEXPORT GphrxGraph gphrx_find_k_core(GphrxGraph *restrict graph, GphrxCoresResult *restrict cores, u64 k);
+
+/**
+ * Frees a result from `gphrx_find_cores`.
+ */
+DLLEXPORT void free_gphrx_cores_result(GphrxCoresResult *restrict result);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet cores_h_register_tests();
+
+#endif
+
+
+#define __CORES_H
+#endif
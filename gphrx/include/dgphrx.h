@@ -0,0 +1,130 @@
+#ifndef __DGPHRX_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "dynarray.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * Default ratio of delta size (inserts plus deletes) to base size at which a GphrxDeltaGraph is compacted.
+ */
+#define GPHRX_DELTA_DEFAULT_COMPACTION_RATIO 0.125
+
+/**
+ * A delta smaller than this is never compacted automatically, so that small graphs don't compact on every
+ * mutation.
+ */
+#define GPHRX_DELTA_MIN_COMPACTION_SIZE 1024
+
+/**
+ * A graph that is cheap to mutate, stored as a large sorted base that only changes on compaction plus two
+ * small sorted overlays: edges inserted since the last compaction that are not in the base, and edges in
+ * the base that have since been deleted. A mutation shifts only the overlays, so it costs time proportional
+ * to the size of the delta rather than of the graph. Queries and pooling combine the base and delta on the
+ * fly.
+ *
+ * When the delta grows past `compaction_ratio` times the base (and past GPHRX_DELTA_MIN_COMPACTION_SIZE),
+ * it is merged into a new base in a single pass. As in GphrxGraph, undirected edges are stored in both
+ * directions.
+ */
+typedef struct {
+    GphrxGraph base;
+    GphrxCsrAdjacencyMatrix inserts;
+    GphrxCsrAdjacencyMatrix deletes;
+    double compaction_ratio;
+} GphrxDeltaGraph;
+
+/**
+ * Creates an empty undirected delta graph.
+ */
+DLLEXPORT GphrxDeltaGraph new_undirected_dgphrx();
+
+/**
+ * Creates an empty directed delta graph.
+ */
+DLLEXPORT GphrxDeltaGraph new_directed_dgphrx();
+
+/**
+ * Creates a delta graph whose base is the given graph. The graph is moved into the delta graph; the
+ * caller must not use or free it afterwards.
+ */
+DLLEXPORT GphrxDeltaGraph dgphrx_from_gphrx(GphrxGraph *restrict graph);
+
+/**
+ * Creates a GphrxGraph holding every edge of the delta graph. The delta graph is unchanged.
+ */
+DLLEXPORT GphrxGraph dgphrx_to_gphrx(GphrxDeltaGraph *restrict graph);
+
+/**
+ * Creates a copy of the given delta graph. As with `duplicate_gphrx`, the copy shares the original's lists
+ * until either graph modifies them. Edits that stay in the delta copy only the (small) overlays, so a
+ * duplicate used to try out a few edits costs memory in proportion to the edits rather than the graph.
+ */
+DLLEXPORT GphrxDeltaGraph duplicate_dgphrx(GphrxDeltaGraph *restrict graph);
+
+/**
+ * Frees the memory used by the given delta graph.
+ */
+DLLEXPORT void free_dgphrx(GphrxDeltaGraph *restrict graph);
+
+/**
+ * Returns the dimension of the delta graph's adjacency matrix (one more than the highest vertex ID).
+ */
+DLLEXPORT u64 dgphrx_dimension(GphrxDeltaGraph *restrict graph);
+
+/**
+ * Returns the number of entries in the delta graph's adjacency matrix (undirected edges count twice,
+ * except for self-loops).
+ */
+DLLEXPORT size_t dgphrx_edge_count(GphrxDeltaGraph *restrict graph);
+
+/**
+ * Returns true if the link from_vertex_id -> to_vertex_id exists.
+ */
+DLLEXPORT bool dgphrx_does_edge_exist(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Adds the link from_vertex_id -> to_vertex_id (and the reverse for an undirected graph), compacting the
+ * graph if the delta has grown past the compaction ratio.
+ */
+DLLEXPORT void dgphrx_add_edge(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Removes the link from_vertex_id -> to_vertex_id (and the reverse for an undirected graph), compacting
+ * the graph if the delta has grown past the compaction ratio. Returns GPHRX_ERROR_NOT_FOUND if the edge
+ * does not exist.
+ */
+DLLEXPORT GphrxErrorCode dgphrx_remove_edge(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Merges the delta into the base, leaving the delta empty.
+ */
+DLLEXPORT void dgphrx_compact(GphrxDeltaGraph *restrict graph);
+
+/**
+ * Finds the avg pool matrix of the delta graph, exactly as `gphrx_find_avg_pool_matrix` would for the
+ * compacted graph. The base is pooled in parallel and the delta's edges are then added to (or, for deletes,
+ * subtracted from) the block counts, so the graph does not need to be compacted first.
+ */
+DLLEXPORT GphrxCsrMatrix dgphrx_find_avg_pool_matrix(GphrxDeltaGraph *restrict graph, u64 block_dimension);
+
+/**
+ * Approximates the delta graph, exactly as `approximate_gphrx` would for the compacted graph.
+ */
+DLLEXPORT GphrxGraph approximate_dgphrx(GphrxDeltaGraph *restrict graph, u64 block_dimension, double threshold);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet dgphrx_h_register_tests();
+
+#endif
+
+
+#define __DGPHRX_H
+#endif
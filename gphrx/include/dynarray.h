@@ -1,9 +1,11 @@
 #ifndef __DYN_ARRAY_H
 
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "assert.h"
 #include "intrinsics.h"
 
@@ -16,11 +18,28 @@ typedef struct {
     size_t capacity;
     size_t size;
     Byte8Val *arr;
+
+    // Counts the arrays sharing `arr` (see dynarr8_share), or null if `arr` belongs to this array alone.
+    // Atomic because threads sharing the same array race to install it.
+    _Atomic(atomic_size_t*) ref_count;
+
+    // Allocator `arr` came from, or null for malloc
+    GphrxAllocator *allocator;
 } DynamicArray8;
 
+typedef union {
+    u32 u32_val;
+    float flt_val;
+} Byte4Val;
+
+typedef struct {
+    size_t capacity;
+    size_t size;
+    Byte4Val *arr;
+} DynamicArray4;
+
 /** Byte8Val */
 #define new_dynarr8() new_dynarr8_with_capacity(1)
-#define free_dynarr8(arr_ptr) free((arr_ptr)->arr)
 
 #define dynarr8_push(arr_ptr, item) _dynarr8_push_at((arr_ptr), item, (arr_ptr)->size)
 #define dynarr8_push_at(arr_ptr, item, idx) _dynarr8_push_at((arr_ptr), item, (idx))
@@ -30,6 +49,22 @@ typedef struct {
 #define dynarr8_pop(arr_ptr) ((arr_ptr)->arr[--((arr_ptr)->size)])
 
 DynamicArray8 new_dynarr8_with_capacity(size_t start_capacity);
+DynamicArray8 new_dynarr8_with_allocator(size_t start_capacity, GphrxAllocator *allocator);
+void free_dynarr8(DynamicArray8 *arr);
+
+/**
+ * Returns an array with the same contents as `arr` that shares its buffer instead of copying it. The two
+ * arrays are still independent: the first to be modified copies the buffer, which is freed with the last
+ * array still using it. Several threads may share or read the same array at once: the first share installs
+ * the reference count with a compare-and-swap. Sharing an array is not safe while another thread modifies it.
+ */
+DynamicArray8 dynarr8_share(DynamicArray8 *arr);
+
+/**
+ * Gives `arr` a buffer of its own if it shares one, so that it can be written to through `arr->arr`. The
+ * dynarr8 functions that modify an array do this themselves.
+ */
+void dynarr8_make_unique(DynamicArray8 *arr);
 
 void dynarr8_shrink(DynamicArray8 *arr);
 void dynarr8_expand(DynamicArray8 *arr, size_t desired_capacity);
@@ -41,6 +76,133 @@ void dynarr8_remove_multiple_at(DynamicArray8 *arr, size_t start_idx, size_t cou
 
 void _dynarr8_push_at(DynamicArray8 *arr, Byte8Val item, size_t idx);
 
+/** Byte4Val */
+#define new_dynarr4() new_dynarr4_with_capacity(1)
+#define free_dynarr4(arr_ptr) free((arr_ptr)->arr)
+
+#define dynarr4_push(arr_ptr, item) _dynarr4_push_at((arr_ptr), item, (arr_ptr)->size)
+#define dynarr4_push_at(arr_ptr, item, idx) _dynarr4_push_at((arr_ptr), item, (idx))
+
+#define dynarr4_get(arr_ptr, pos) ((arr_ptr)->arr[pos])
+#define dynarr4_get_ptr(arr_ptr, pos) ((arr_ptr)->arr + (pos))
+#define dynarr4_pop(arr_ptr) ((arr_ptr)->arr[--((arr_ptr)->size)])
+
+DynamicArray4 new_dynarr4_with_capacity(size_t start_capacity);
+
+void dynarr4_shrink(DynamicArray4 *arr);
+void dynarr4_expand(DynamicArray4 *arr, size_t desired_capacity);
+
+void dynarr4_remove_at(DynamicArray4 *arr, size_t idx);
+void dynarr4_remove_multiple_at(DynamicArray4 *arr, size_t start_idx, size_t count);
+
+void _dynarr4_push_at(DynamicArray4 *arr, Byte4Val item, size_t idx);
+
+/**
+ * Typed dynamic arrays. GPHRX_DEFINE_DYNARRAY(Name, prefix, T) declares a `Name` holding elements of type
+ * `T` with the functions below, which are inline so that pushes and appends compile down to a capacity
+ * check and a store (or memcpy). Loops over `arr` see a plain `T*` rather than a union, so the compiler can
+ * vectorize them, and elements take only as much space as `T`.
+ *
+ *   Name new_<prefix>_with_capacity(size_t start_capacity)
+ *   void free_<prefix>(Name *arr)
+ *   void <prefix>_reserve(Name *arr, size_t desired_capacity)
+ *   void <prefix>_push(Name *arr, T item)
+ *   void <prefix>_append(Name *arr, const T *items, size_t count)
+ *   T <prefix>_pop(Name *arr)
+ *   void <prefix>_shrink(Name *arr)
+ *
+ * Buffers come from the allocator set with `gphrx_set_allocator`. Unlike DynamicArray8, typed arrays can't
+ * be shared; they are meant for the working arrays of algorithms rather than for graph storage.
+ */
+#define GPHRX_DEFINE_DYNARRAY(Name, prefix, T)                                                              \
+    typedef struct {                                                                                        \
+        size_t capacity;                                                                                    \
+        size_t size;                                                                                        \
+        T *arr;                                                                                             \
+        GphrxAllocator *allocator;                                                                          \
+    } Name;                                                                                                 \
+                                                                                                            \
+    static inline Name new_##prefix##_with_capacity(size_t start_capacity)                                  \
+    {                                                                                                       \
+        GphrxAllocator *allocator = gphrx_get_allocator();                                                  \
+        T *arr = _gphrx_alloc(allocator, start_capacity * sizeof(T));                                       \
+        assert(arr != 0, "malloc failure");                                                                 \
+                                                                                                            \
+        Name vec = { .capacity = start_capacity, .size = 0, .arr = arr, .allocator = allocator };           \
+        return vec;                                                                                         \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void free_##prefix(Name *arr)                                                             \
+    {                                                                                                       \
+        _gphrx_free(arr->allocator, arr->arr, arr->capacity * sizeof(T));                                   \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void prefix##_reserve(Name *arr, size_t desired_capacity)                                 \
+    {                                                                                                       \
+        if (desired_capacity > arr->capacity)                                                               \
+            arr->arr = _gphrx_dynarr_grow(arr->allocator, arr->arr, &arr->capacity, desired_capacity,       \
+                                          sizeof(T));                                                       \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void prefix##_push(Name *arr, T item)                                                     \
+    {                                                                                                       \
+        if (arr->size == arr->capacity)                                                                     \
+            prefix##_reserve(arr, arr->size + 1);                                                           \
+                                                                                                            \
+        arr->arr[arr->size++] = item;                                                                       \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void prefix##_append(Name *arr, const T *items, size_t count)                             \
+    {                                                                                                       \
+        prefix##_reserve(arr, arr->size + count);                                                           \
+                                                                                                            \
+        memcpy(arr->arr + arr->size, items, count * sizeof(T));                                             \
+        arr->size += count;                                                                                 \
+    }                                                                                                       \
+                                                                                                            \
+    static inline T prefix##_pop(Name *arr)                                                                 \
+    {                                                                                                       \
+        assert(arr->size > 0, "Pop from empty array");                                                      \
+        return arr->arr[--arr->size];                                                                       \
+    }                                                                                                       \
+                                                                                                            \
+    static inline void prefix##_shrink(Name *arr)                                                           \
+    {                                                                                                       \
+        T *new_arr = _gphrx_resize(arr->allocator, arr->arr, arr->capacity * sizeof(T),                     \
+                                   arr->size * sizeof(T));                                                  \
+        assert(new_arr != 0, "realloc failue");                                                             \
+                                                                                                            \
+        arr->arr = new_arr;                                                                                 \
+        arr->capacity = arr->size;                                                                          \
+    }
+
+/**
+ * Grows a typed array's buffer to at least `desired_capacity` elements, at least doubling it so that pushes
+ * take amortized constant time. Returns the new buffer and updates `*capacity`.
+ */
+void *_gphrx_dynarr_grow(GphrxAllocator *allocator,
+                         void *arr,
+                         size_t *capacity,
+                         size_t desired_capacity,
+                         size_t element_size);
+
+typedef struct {
+    u64 from_vertex_id;
+    u64 to_vertex_id;
+} GphrxEdge;
+
+typedef struct {
+    u32 first;
+    u32 second;
+} GphrxU32Pair;
+
+GPHRX_DEFINE_DYNARRAY(DynamicArrayU32, dynarr_u32, u32)
+GPHRX_DEFINE_DYNARRAY(DynamicArrayU64, dynarr_u64, u64)
+GPHRX_DEFINE_DYNARRAY(DynamicArrayF32, dynarr_f32, float)
+GPHRX_DEFINE_DYNARRAY(DynamicArrayF64, dynarr_f64, double)
+GPHRX_DEFINE_DYNARRAY(DynamicArrayEdge, dynarr_edge, GphrxEdge)
+GPHRX_DEFINE_DYNARRAY(DynamicArrayU32Pair, dynarr_u32_pair, GphrxU32Pair)
+
 #ifdef TEST_MODE
 
 #include "test.h"
@@ -1,5 +1,6 @@
 #ifndef __GPHRX_H
 
+#include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -9,13 +10,8 @@
 #include "dynarray.h"
 #include "intrinsics.h"
 
-// TODO: In separate file, create a GphrxWeightedGraph struct and wgphrx_* functions. For
-//       approximation, the entries in the approximated GphrxWeightedGraph will be averaged
-//       together to form the entry in the approximated matrix.
-
 // TODO: Functions
 //         - Get from CSR matrix (give col and row, return entry)
-//         - Scale an approximation given a threshold and scale factor
 
 // TODO: Split matrices into their own files gphrx_matrix.h gphrx_matrix.c
 
@@ -65,13 +61,62 @@ typedef struct {
 } GphrxCsrMatrix;
 
 /**
- * Metadata and representation of a graph.
+ * Keys per node of a GphrxVertexIndex. Eight 64-bit keys fill one cache line (and one AVX-512 register).
+ */
+#define GPHRX_VERTEX_INDEX_NODE_KEYS 8
+
+/** States of a GphrxVertexIndex */
+typedef u8 GphrxVertexIndexState;
+
+#define GPHRX_VERTEX_INDEX_UNBUILT 0
+#define GPHRX_VERTEX_INDEX_BUILDING 1
+#define GPHRX_VERTEX_INDEX_BUILT 2
+
+/**
+ * A static search tree over the vertices that have edges in a graph, used to find a vertex's edges without
+ * binary searching the whole edge list. The vertex IDs are laid out as an implicit B-tree (an S-tree): each
+ * node is one cache line of GPHRX_VERTEX_INDEX_NODE_KEYS sorted keys, padded with UINT64_MAX, and the
+ * children of node k are nodes k * (GPHRX_VERTEX_INDEX_NODE_KEYS + 1) + i + 1. A search loads one line per
+ * level of the tree, compares the whole node at once, and descends without branching on the keys, so
+ * finding a vertex takes about log9 of the vertex count cache misses rather than log2 of the edge count.
+ *
+ * `edge_ranges` holds the range of edge indices of the vertex in each key's slot, as a start and an end, so
+ * that once a vertex is found its edges are found with one more load. Padding slots hold empty ranges at the
+ * end of the edge list.
+ */
+typedef struct GphrxVertexIndex {
+    _Atomic GphrxVertexIndexState state;
+    size_t node_count;
+    u64 *keys;
+    size_t *edge_ranges;
+} GphrxVertexIndex;
+
+/**
+ * Metadata and representation of a graph. `vertex_index` is null unless the graph has been shrunk (see
+ * `gphrx_shrink`).
  */
 typedef struct {
     bool is_undirected;
     GphrxCsrAdjacencyMatrix adjacency_matrix;
+    GphrxVertexIndex *vertex_index;
 } GphrxGraph;
 
+/**
+ * State for estimating an avg pool matrix from a uniform random sample of a graph's edges. Edges are
+ * visited in a pseudo-random order (a keyed permutation of the edge indices, so no O(E) shuffle buffer is
+ * needed), meaning every call to `gphrx_avg_pool_sampler_refine` extends the same sample without
+ * replacement. Once every edge has been sampled, the estimate is exactly the avg pool matrix.
+ */
+typedef struct {
+    u64 dimension;
+    u64 block_dimension;
+    u64 edge_count;
+    u64 sampled_count;
+    u64 permutation_half_bits;
+    u64 permutation_keys[4];
+    u64 *occurrences;
+} GphrxAvgPoolSampler;
+
 /**
  * Metadata and representation of a compressed graph.
  */
@@ -92,7 +137,9 @@ DLLEXPORT GphrxGraph new_undirected_gphrx();
 DLLEXPORT GphrxGraph new_directed_gphrx();
 
 /**
- * Creates a copy of the given GraphRox graph.
+ * Creates a copy of the given GraphRox graph. The copy shares the original's edge lists until either graph
+ * is modified, at which point the modified graph copies them, so duplicating a graph takes constant time.
+ * The copy has no vertex index until it is shrunk.
  */
 DLLEXPORT GphrxGraph duplicate_gphrx(GphrxGraph *restrict graph);
 
@@ -116,6 +163,14 @@ DLLEXPORT void free_gphrx_csr_adj_matrix(GphrxCsrAdjacencyMatrix *restrict matri
  */
 DLLEXPORT char *gphrx_csr_matrix_to_string(GphrxCsrMatrix *restrict matrix, int decimal_digits);
 
+/**
+ * Drops every entry in the given GphrxCsrMatrix that is below the threshold and multiplies the remaining
+ * entries by the scale factor. The matrix's lists are compacted in place in a single pass without being
+ * reallocated, so the relative order of the remaining entries is preserved. This is intended for turning
+ * an avg pool matrix into a scaled, weighted approximation.
+ */
+DLLEXPORT void gphrx_csr_matrix_threshold_and_scale(GphrxCsrMatrix *restrict matrix, double threshold, double scale_factor);
+
 /**
  * Converts the given GphrxCsrAdjacencyMatrix to a string representation.
  */
@@ -125,6 +180,11 @@ DLLEXPORT char *gphrx_csr_adj_matrix_to_string(GphrxCsrAdjacencyMatrix *restrict
  * Frees up excess memory used by the lists that describe the graph. This can substantially reduce memory
  * usage for graphs that are static (meaning edges and vertices are no longer being added), but can make
  * subsequent modifications to the graph slower.
+ *
+ * Shrinking also marks the graph as static: the first query that looks up a vertex's edges afterwards builds
+ * a GphrxVertexIndex, which that query and all later ones search instead of the edge list. Modifying the
+ * graph drops the index, so a graph that is modified again must be shrunk again to get it back. Queries made
+ * from several threads at once are safe; one of them builds the index while the others search without it.
  */
 DLLEXPORT void gphrx_shrink(GphrxGraph *restrict graph);
 
@@ -133,6 +193,23 @@ DLLEXPORT void gphrx_shrink(GphrxGraph *restrict graph);
  */
 DLLEXPORT bool gphrx_does_edge_exist(GphrxGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
 
+/**
+ * Checks whether each of the edges from_vertex_ids[i] -> to_vertex_ids[i] exists, for every i below
+ * `count`, setting bit i % 8 of out_bits[i / 8] if it does and clearing it if not. `out_bits` must hold
+ * (count + 7) / 8 bytes.
+ *
+ * The queries are sorted and split between the threads, and each thread answers its share in one galloping
+ * merge against the graph's sorted lists: every search starts where the last one ended instead of from
+ * scratch, and the queries a few places ahead are prefetched. If the graph has a vertex index (see
+ * `gphrx_shrink`), each vertex is looked up in it instead. This is much faster than calling
+ * `gphrx_does_edge_exist` for each edge once there are more than a handful.
+ */
+DLLEXPORT void gphrx_does_edges_exist(GphrxGraph *restrict graph,
+                                      u64 *from_vertex_ids,
+                                      u64 *to_vertex_ids,
+                                      u8 *out_bits,
+                                      size_t count);
+
 /**
  * Adds a vertex to the given graph.
  */
@@ -149,6 +226,14 @@ DLLEXPORT void gphrx_remove_vertex(GphrxGraph *restrict graph, u64 vertex_id);
  */
 DLLEXPORT void gphrx_add_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
 
+/**
+ * Adds the links from_vertex_ids[i] -> to_vertex_ids[i] for every i below `count`. Links that already
+ * exist (or repeat within the lists) are skipped. The links are sorted and merged into the graph in a
+ * single pass, which is much faster than calling `gphrx_add_edge` for each one once there are more than a
+ * handful.
+ */
+DLLEXPORT void gphrx_add_edges(GphrxGraph *restrict graph, u64 *from_vertex_ids, u64 *to_vertex_ids, size_t count);
+
 /**
  * Removes a link between two vertices. The "from" and "to" qualifiers on parameter names are only
  * significant when the graph is directed.
@@ -162,6 +247,42 @@ DLLEXPORT GphrxErrorCode gphrx_remove_edge(GphrxGraph *restrict graph, u64 from_
  */
 DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix(GphrxGraph *restrict graph, u64 block_dimension);
 
+/**
+ * Creates a sampler for estimating the avg pool matrix of the given graph. No edges are sampled until
+ * `gphrx_avg_pool_sampler_refine` is called. The seed determines the order in which edges are sampled. The
+ * sampler is only valid for as long as the graph's edges are not modified.
+ */
+DLLEXPORT GphrxAvgPoolSampler new_gphrx_avg_pool_sampler(GphrxGraph *restrict graph, u64 block_dimension, u64 seed);
+
+/**
+ * Frees the memory used by the given GphrxAvgPoolSampler.
+ */
+DLLEXPORT void free_gphrx_avg_pool_sampler(GphrxAvgPoolSampler *restrict sampler);
+
+/**
+ * Pools up to `sample_count` more edges (that haven't yet been sampled) into the sampler's estimate.
+ * Returns the number of edges that were actually sampled, which is less than `sample_count` only when the
+ * sample is exhausted.
+ */
+DLLEXPORT u64 gphrx_avg_pool_sampler_refine(GphrxAvgPoolSampler *restrict sampler,
+                                            GphrxGraph *restrict graph,
+                                            u64 sample_count);
+
+/**
+ * Returns the current estimate of the avg pool matrix. Sampled block counts are scaled up by the ratio of
+ * edges in the graph to edges sampled.
+ *
+ * @param z_score determines the width of the confidence intervals (e.g. 1.96 for 95% confidence).
+ *
+ * @param margins, if not null, receives a matrix with the same dimension and entry positions as the
+ * returned matrix where each entry is the half-width of the confidence interval for the corresponding
+ * estimated entry. The intervals account for sampling without replacement, so they shrink to zero once
+ * every edge has been sampled.
+ */
+DLLEXPORT GphrxCsrMatrix gphrx_avg_pool_sampler_estimate(GphrxAvgPoolSampler *restrict sampler,
+                                                         double z_score,
+                                                         GphrxCsrMatrix *restrict margins);
+
 /**
  * Generates an approximation of a graph. This is where the magic of GraphRox happens.
  *
@@ -177,6 +298,41 @@ DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix(GphrxGraph *restrict graph,
  */
 DLLEXPORT GphrxGraph approximate_gphrx(GphrxGraph *restrict graph, u64 block_dimension, double threshold);
 
+/**
+ * Finds block boundaries for approximating a graph with blocks of roughly equal edge mass rather than
+ * equal size. Vertex degrees (counting both incoming and outgoing edges) are accumulated in ID order and
+ * each boundary is placed, by binary search over the running total, where the total reaches the next
+ * multiple of 1 / blocks_per_row of all the degree mass. On graphs with skewed degree distributions this
+ * gives dense regions of the adjacency matrix more, smaller blocks and sparse regions fewer, larger blocks.
+ *
+ * The returned list holds the first vertex ID of each block followed by the graph's dimension, so block i
+ * covers IDs in [boundaries[i], boundaries[i + 1]). Because a block can't split a single vertex, fewer than
+ * blocks_per_row blocks are returned when a few vertices hold most of the edges.
+ */
+DLLEXPORT DynamicArray8 gphrx_find_degree_quantile_boundaries(GphrxGraph *restrict graph, u64 blocks_per_row);
+
+/**
+ * Frees the memory used by block boundaries returned from `gphrx_find_degree_quantile_boundaries`.
+ */
+DLLEXPORT void free_gphrx_block_boundaries(DynamicArray8 *restrict boundaries);
+
+/**
+ * Returns an avg pool matrix for a given graph where the blocks are given by the boundaries (see
+ * `gphrx_find_degree_quantile_boundaries`) rather than a fixed block dimension. Each entry is the
+ * proportion of entries in its block that are non-zero.
+ */
+DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix_with_boundaries(GphrxGraph *restrict graph,
+                                                                    DynamicArray8 *restrict boundaries);
+
+/**
+ * Generates an approximation of a graph like `approximate_gphrx`, but with the blocks given by the
+ * boundaries (see `gphrx_find_degree_quantile_boundaries`). Vertex i in the approximation represents the
+ * vertices with IDs in [boundaries[i], boundaries[i + 1]) in the original graph.
+ */
+DLLEXPORT GphrxGraph approximate_gphrx_with_boundaries(GphrxGraph *restrict graph,
+                                                       DynamicArray8 *restrict boundaries,
+                                                       double threshold);
+
 /**
  * Compresses a matrix by average pooling 8x8 blocks in a graph's adjacency matrix, applying a threshold
  * (blocks that fall below the threshold will be dropped in the compression, meaning those blocks in the
@@ -220,9 +376,78 @@ DLLEXPORT GphrxCompressedGraph gphrx_compressed_from_byte_array(byte *restrict a
  */
 DLLEXPORT void free_gphrx_byte_array(void *restrict arr);
 
+/**
+ * Returns the index in the given matrix's lists at which the edge with the given to and from vertex IDs
+ * is (or would be inserted if it does not exist). Shared with the other GraphRox modules.
+ */
+size_t _gphrx_index_of_edge(GphrxCsrAdjacencyMatrix *restrict matrix, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Returns the index in the given graph's lists of the first edge from the given vertex and sets `*end` to
+ * the index after its last edge, without building the offsets of every vertex. The graph's vertex index is
+ * searched if it has one. The range is empty for vertices without edges. Shared with the other GraphRox
+ * modules.
+ */
+size_t _gphrx_find_vertex_edge_range(GphrxGraph *restrict graph, u64 vertex_id, size_t *end);
+
+/**
+ * Frees the graph's vertex index, if it has one. Must be called before the graph's lists are modified other
+ * than through the functions above. Shared with the other GraphRox modules.
+ */
+void _gphrx_drop_vertex_index(GphrxGraph *restrict graph);
+
+/**
+ * Returns the number of blocks along each side of an avg pool matrix. Shared with the other GraphRox
+ * modules.
+ */
+u64 _gphrx_avg_pool_blocks_per_row(u64 vertex_count, u64 block_dimension);
+
+/**
+ * Returns a newly allocated array of `matrix->dimension + 1` edge indices in which entry v is the index of
+ * the first edge from vertex v (so the edges from v are those in [offsets[v], offsets[v + 1])). The array
+ * doubles as the cost offsets of a per-vertex `_gphrx_parallel_for_balanced` loop. The caller frees it.
+ */
+size_t *_gphrx_find_vertex_edge_offsets(GphrxCsrAdjacencyMatrix *restrict matrix);
+
+/**
+ * Returns the matrix's transpose: a newly allocated array holding the from vertex ID of every edge, ordered
+ * by to vertex ID and then by from vertex ID. `*in_offsets` is set to a newly allocated array of
+ * `matrix->dimension + 1` indices into it, so the edges to vertex v come from the vertices in
+ * [in_offsets[v], in_offsets[v + 1]). For algorithms that follow edges backwards on directed graphs (on
+ * undirected graphs, in-edges and out-edges are the same). The caller frees both arrays.
+ */
+u64 *_gphrx_find_vertex_in_edges(GphrxCsrAdjacencyMatrix *restrict matrix, size_t **in_offsets);
+
+/**
+ * Adds the number of edges in the given matrix that fall in each block to `occurrences`, a dense row-major
+ * array of `blocks_per_row * blocks_per_row` counts. `vertex_count` must be at least the matrix's
+ * dimension. Shared with the other GraphRox modules, which combine counts from several matrices.
+ */
+void _gphrx_count_block_occurrences(GphrxCsrAdjacencyMatrix *restrict matrix,
+                                    u64 *restrict occurrences,
+                                    u64 vertex_count,
+                                    u64 block_dimension,
+                                    u64 blocks_per_row);
+
+/**
+ * Builds an avg pool matrix from a dense row-major array of block occurrence counts. Each entry is the
+ * count multiplied by `scale` and divided by the number of entries in a block. The matrix's arrays are
+ * allocated with `allocator` (see alloc.h). Shared with the other GraphRox modules.
+ */
+GphrxCsrMatrix _gphrx_avg_pool_matrix_from_occurrences(u64 *occurrences, u64 blocks_per_row, u64 block_dimension,
+                                                      double scale, GphrxAllocator *allocator);
+
+/**
+ * Creates a graph with an edge for every entry in the avg pool matrix that meets the threshold, which is
+ * clamped to (0, 1] as in `approximate_gphrx`. Shared with the other GraphRox modules.
+ */
+GphrxGraph _gphrx_approximation_from_avg_pool_matrix(GphrxCsrMatrix *restrict occurrence_matrix,
+                                                     bool is_undirected,
+                                                     double threshold);
 
 #ifdef TEST_MODE
 
+#define GPHRX_TEST_GRAPH_FIXTURES
 #include "test.h"
 
 ModuleTestSet gphrx_h_register_tests();
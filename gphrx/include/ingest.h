@@ -0,0 +1,147 @@
+#ifndef __INGEST_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+#include "vgphrx.h"
+
+/**
+ * Number of edges held by each segment of a producer's log.
+ */
+#define GPHRX_INGEST_SEGMENT_CAPACITY 4096
+
+/**
+ * A fixed-size block of a producer's log. The entry at index i of the log is held at position
+ * i - first_index of the segment whose range contains it.
+ */
+typedef struct GphrxIngestSegment {
+    u64 first_index;
+    _Atomic(struct GphrxIngestSegment*) next;
+
+    // Epoch in which the merger unlinked the segment and the next segment waiting to be freed
+    u64 retired_epoch;
+    struct GphrxIngestSegment *next_retired;
+
+    u64 from_vertex_ids[GPHRX_INGEST_SEGMENT_CAPACITY];
+    u64 to_vertex_ids[GPHRX_INGEST_SEGMENT_CAPACITY];
+} GphrxIngestSegment;
+
+/**
+ * A single producer's append-only log of edges, made up of linked segments. Only the owning thread appends
+ * to a log and only the merger consumes from it, so neither needs a lock. The producer's and the merger's
+ * fields sit on separate cache lines.
+ */
+typedef struct GphrxIngestLog {
+    // Written by the producer
+    _Alignas(64) _Atomic u64 published_count;
+    GphrxIngestSegment *tail;
+    u64 owner_id;
+
+    // Written by the merger
+    _Alignas(64) _Atomic u64 consumed_count;
+    _Atomic(GphrxIngestSegment*) head;
+    u64 merge_target;
+
+    struct GphrxIngestLog *next;
+} GphrxIngestLog;
+
+/**
+ * A staging buffer for adding edges to a GphrxVersionedGraph from many threads at once. Each producer
+ * thread appends to its own log without locks or shared writes, and a merger (a background thread, or
+ * `gphrx_ingest_flush`) periodically sorts the pending edges, merges them into the working graph with
+ * `gphrx_add_edges`, and publishes a new snapshot. `gphrx_ingest_does_edge_exist` consults both the
+ * current snapshot and the edges that have not been merged yet.
+ *
+ * The buffer is insertion-only; edges are removed through the versioned graph as usual. Segments of the
+ * logs that have been merged are reclaimed with the versioned graph's epochs, so queries never block
+ * producers or the merger.
+ *
+ * A GphrxIngestBuffer must not be moved once created, so it is only handled through the pointer returned
+ * by `new_gphrx_ingest_buffer`.
+ */
+typedef struct {
+    GphrxVersionedGraph *versioned_graph;
+    u64 id;
+
+    // Pushed to by producers the first time they add an edge; logs are not removed until the buffer is freed
+    _Atomic(GphrxIngestLog*) logs;
+
+    // Guards the merger's fields of the logs and the retired segments
+    pthread_mutex_t merge_lock;
+    GphrxIngestSegment *retired;
+
+    // Background merger, if there is one
+    pthread_t merger_thread;
+    bool has_merger_thread;
+    u32 merge_interval_ms;
+    pthread_mutex_t merger_lock;
+    pthread_cond_t merger_cond;
+    bool should_merger_stop;
+} GphrxIngestBuffer;
+
+/**
+ * Creates an ingest buffer that merges into the given versioned graph, which must outlive the buffer. If
+ * `merge_interval_ms` is non-zero, a background thread merges pending edges at that interval; otherwise
+ * edges are only merged by `gphrx_ingest_flush`.
+ */
+DLLEXPORT GphrxIngestBuffer *new_gphrx_ingest_buffer(GphrxVersionedGraph *restrict versioned_graph,
+                                                    u32 merge_interval_ms);
+
+/**
+ * Stops the background merger, merges any pending edges and frees the buffer. No thread may be adding
+ * edges to or querying the buffer.
+ */
+DLLEXPORT void free_gphrx_ingest_buffer(GphrxIngestBuffer *restrict buffer);
+
+/**
+ * Appends the link from_vertex_id -> to_vertex_id to the calling thread's log. The edge is visible to
+ * `gphrx_ingest_does_edge_exist` as soon as this returns and reaches the versioned graph at the next merge.
+ */
+DLLEXPORT void gphrx_ingest_add_edge(GphrxIngestBuffer *restrict buffer, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Appends the links from_vertex_ids[i] -> to_vertex_ids[i] for every i below `count` to the calling
+ * thread's log, making them visible a segment at a time rather than one by one.
+ */
+DLLEXPORT void gphrx_ingest_add_edges(GphrxIngestBuffer *restrict buffer,
+                                      u64 *from_vertex_ids,
+                                      u64 *to_vertex_ids,
+                                      size_t count);
+
+/**
+ * Merges every edge added before the call into the versioned graph and publishes a new snapshot if any
+ * were pending. Returns the version of the current snapshot.
+ */
+DLLEXPORT u64 gphrx_ingest_flush(GphrxIngestBuffer *restrict buffer);
+
+/**
+ * Returns the number of edges that have been added but not yet merged.
+ */
+DLLEXPORT u64 gphrx_ingest_pending_count(GphrxIngestBuffer *restrict buffer);
+
+/**
+ * Returns true if the link from_vertex_id -> to_vertex_id is in the current snapshot of the versioned
+ * graph or is waiting to be merged.
+ */
+DLLEXPORT bool gphrx_ingest_does_edge_exist(GphrxIngestBuffer *restrict buffer,
+                                            u64 from_vertex_id,
+                                            u64 to_vertex_id);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet ingest_h_register_tests();
+
+#endif
+
+
+#define __INGEST_H
+#endif
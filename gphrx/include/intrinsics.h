@@ -1,7 +1,36 @@
 #ifndef __INTRINSICS_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// GCC and Clang build the AVX code paths on x86 whatever the target flags, marking each with a target
+// attribute, and `simd_level` picks one at runtime. Other compilers only build the paths the flags allow.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_RUNTIME_DISPATCH
+#define SIMD_AVX2
+#define SIMD_AVX512
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#endif
+#if defined(__AVX512F__)
+#define SIMD_AVX512
+#endif
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
 // NOTE: 64-bit
 typedef int8_t i8;
 typedef int16_t i16;
@@ -15,9 +44,6 @@ typedef uint64_t u64;
 
 typedef unsigned char byte;
 
-// TODO: Request page size from the OS instead
-#define PAGE_SIZE 4096
-
 #define fast_mod_pow_2(operand1, operand2) ((operand1) & ((operand2) - 1))
 #define fast_mult_pow_2(operand, pow) ((operand) << (pow))
 #define fast_div_pow_2(operand, pow) ((operand) >> (pow))
@@ -37,7 +63,116 @@ typedef unsigned char byte;
 #define DLLEXPORT __attribute__((visibility ("default")))
 #endif
 
+/**
+ * Precomputed form of a divisor for dividing many unsigned 64-bit integers by the same value without a
+ * hardware divide instruction. Powers of two become a shift. Other divisors become a multiply-high, a
+ * subtract, an add, and two shifts (the "round-up" method from Granlund and Montgomery, "Division by
+ * Invariant Integers using Multiplication"), which is exact for every 64-bit dividend.
+ *
+ * `magic_32` is the equivalent multiplier for dividends that fit in 32 bits. It lets SIMD code divide with
+ * 32x32->64-bit lane multiplies, which (unlike a 64-bit multiply-high) every AVX level provides. It is zero
+ * when the divisor itself doesn't fit in 32 bits.
+ */
+typedef struct {
+    u64 magic;
+    u32 magic_32;
+    u8 shift;
+    bool is_pow_2;
+} FastDivisor;
+
+FastDivisor new_fast_divisor(u64 divisor);
+
+u8 u64_log2_floor(u64 value);
+
+static FORCEINLINE u64 u64_mul_high(u64 operand1, u64 operand2)
+{
+#ifdef _MSC_VER
+    return __umulh(operand1, operand2);
+#else
+    return (u64) (((unsigned __int128) operand1 * operand2) >> 64);
+#endif
+}
+
+static FORCEINLINE u64 fast_divisor_divide(FastDivisor *divisor, u64 operand)
+{
+    if (divisor->is_pow_2)
+        return fast_div_pow_2(operand, divisor->shift);
+
+    u64 high = u64_mul_high(divisor->magic, operand);
+    return (high + ((operand - high) >> 1)) >> divisor->shift;
+}
+
+// Index of the lowest set bit. `value` must not be zero.
+static FORCEINLINE u8 u64_trailing_zeros(u64 value)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, value);
+    return (u8) idx;
+#else
+    return (u8) __builtin_ctzll(value);
+#endif
+}
+
+static FORCEINLINE u8 u64_popcount(u64 value)
+{
+#ifdef _MSC_VER
+    return (u8) __popcnt64(value);
+#else
+    return (u8) __builtin_popcountll(value);
+#endif
+}
+
+// Hints that the cache line holding `address` will soon be read
+static FORCEINLINE void prefetch(const void *address)
+{
+#ifdef _MSC_VER
+    _mm_prefetch((const char*) address, _MM_HINT_T0);
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
+typedef u8 SimdLevel;
+
+#define SIMD_LEVEL_NONE 0
+#define SIMD_LEVEL_AVX2 1
+#define SIMD_LEVEL_AVX512 2
+
+/**
+ * Returns the widest set of AVX instructions that both the CPU and the build support. Code with a SIMD path
+ * for a level is only built when `SIMD_AVX2` or `SIMD_AVX512` is defined, so this never returns a level
+ * without one.
+ */
+SimdLevel simd_level();
+
+#ifdef TEST_MODE
+// Limits the level `simd_level` returns, so that tests can run the narrower SIMD paths on a wide CPU
+void cap_simd_level(SimdLevel level);
+#endif
+
+#if defined(SIMD_AVX512)
+// Divides each 64-bit lane (which must hold a value that fits in 32 bits) using a FastDivisor's magic_32
+static FORCEINLINE TARGET_AVX512 __m512i fast_divisor_divide_u32_x8(__m512i operand, __m512i magic_32, __m128i shift)
+{
+    __m512i high = _mm512_srli_epi64(_mm512_mul_epu32(operand, magic_32), 32);
+    __m512i sum = _mm512_add_epi64(high, _mm512_srli_epi64(_mm512_sub_epi64(operand, high), 1));
+    return _mm512_srl_epi64(sum, shift);
+}
+#endif
+
+#if defined(SIMD_AVX2)
+// Divides each 64-bit lane (which must hold a value that fits in 32 bits) using a FastDivisor's magic_32
+static FORCEINLINE TARGET_AVX2 __m256i fast_divisor_divide_u32_x4(__m256i operand, __m256i magic_32, __m128i shift)
+{
+    __m256i high = _mm256_srli_epi64(_mm256_mul_epu32(operand, magic_32), 32);
+    __m256i sum = _mm256_add_epi64(high, _mm256_srli_epi64(_mm256_sub_epi64(operand, high), 1));
+    return _mm256_srl_epi64(sum, shift);
+}
+#endif
+
 u8 is_system_big_endian();
+size_t system_page_size();
 u16 u16_reverse_bits(u16 value);
 u32 u32_reverse_bits(u32 value);
 u64 u64_reverse_bits(u64 value);
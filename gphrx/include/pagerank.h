@@ -0,0 +1,97 @@
+#ifndef __PAGERANK_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "dynarray.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+#define GPHRX_PAGERANK_DEFAULT_DAMPING_FACTOR 0.85
+#define GPHRX_PAGERANK_DEFAULT_TOLERANCE 1e-9
+#define GPHRX_PAGERANK_DEFAULT_MAX_ITERATIONS 100
+
+/**
+ * Parameters of a PageRank computation. Iteration stops once the scores change by less than `tolerance`
+ * (summed over all vertices) in one iteration, or after `max_iterations` iterations.
+ */
+typedef struct {
+    double damping_factor;
+    double tolerance;
+    u32 max_iterations;
+} GphrxPageRankOptions;
+
+/**
+ * PageRank scores, which sum to one, and how many iterations it took to find them. `residual` is the
+ * change in the scores in the last iteration; it is above the tolerance if the iteration limit was hit.
+ */
+typedef struct {
+    u64 vertex_count;
+    double *scores;
+    u32 iteration_count;
+    double residual;
+} GphrxPageRankResult;
+
+/**
+ * Returns the default PageRank options.
+ */
+DLLEXPORT GphrxPageRankOptions gphrx_default_pagerank_options();
+
+/**
+ * Computes the PageRank of every vertex in the graph by power iteration, where each iteration is a pull
+ * `gphrx_spmv` over the graph's in-edges. The scores of vertices without out-edges are spread evenly
+ * across all vertices.
+ *
+ * @param initial_scores, if not null, holds a starting score for each of the graph's vertices (it is
+ * normalized to sum to one). A good guess, such as one from `gphrx_pagerank_warm_start`, cuts the number of
+ * iterations needed. The first iteration's scores are averaged with the guess, which cancels most of the
+ * error that would otherwise only flip sign from one iteration to the next. If null, every vertex starts
+ * with the same score.
+ */
+DLLEXPORT GphrxPageRankResult gphrx_pagerank(GphrxGraph *restrict graph,
+                                             GphrxPageRankOptions *restrict options,
+                                             double *restrict initial_scores);
+
+/**
+ * Maps the PageRank scores of an approximation back to the vertices of the original graph, to be used as
+ * `initial_scores`. Each block's score is split evenly between the vertices in the block, and the scores of
+ * each weakly connected component are then rescaled so that the component holds the same share of the total
+ * as it does when every vertex starts with the same score. No edge joins two components, so mass moved
+ * between them would only drift back through teleports. The result is written to `scores`, which must hold
+ * the graph's dimension values.
+ *
+ * @param boundaries, if not null, gives the block boundaries the approximation was built with (see
+ * `approximate_gphrx_with_boundaries`). Otherwise, the approximation is taken to have been built by
+ * `approximate_gphrx` with blocks of `block_dimension` vertices.
+ */
+DLLEXPORT void gphrx_pagerank_warm_start(GphrxGraph *restrict graph,
+                                         GphrxPageRankResult *restrict approximation_result,
+                                         u64 block_dimension,
+                                         DynamicArray8 *restrict boundaries,
+                                         double *restrict scores);
+
+/**
+ * Estimates the graph's PageRank scores on its approximation (see `approximate_gphrx`), then refines them
+ * on the full graph starting from that estimate. `iteration_count` in the result counts only the
+ * iterations on the full graph.
+ */
+DLLEXPORT GphrxPageRankResult gphrx_pagerank_from_approximation(GphrxGraph *restrict graph,
+                                                                u64 block_dimension,
+                                                                double threshold,
+                                                                GphrxPageRankOptions *restrict options);
+
+DLLEXPORT void free_gphrx_pagerank_result(GphrxPageRankResult *restrict result);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet pagerank_h_register_tests();
+
+#endif
+
+
+#define __PAGERANK_H
+#endif
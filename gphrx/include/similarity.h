@@ -0,0 +1,64 @@
+#ifndef __SIMILARITY_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * Scores of a batch of vertex pairs, in the order the pairs were given. For the pair (u, v):
+ *
+ * - `common_neighbor_counts[i]` is the number of vertices that both u and v have an edge to.
+ * - `jaccard_scores[i]` is that count divided by the number of vertices that either has an edge to (0 if
+ *   neither has any edges).
+ * - `adamic_adar_scores[i]` is the sum of 1 / ln(degree) over the common neighbours, which weighs
+ *   neighbours with few edges of their own more heavily. Common neighbours with a single edge are skipped.
+ *
+ * On directed graphs, neighbours and degrees only count edges from a vertex, not edges to it.
+ */
+typedef struct {
+    size_t query_count;
+    u64 *common_neighbor_counts;
+    double *jaccard_scores;
+    double *adamic_adar_scores;
+} GphrxSimilarityResult;
+
+/**
+ * Scores the vertex pairs (from_vertex_ids[i], to_vertex_ids[i]) for every i below `count`, such as
+ * candidate links in link prediction.
+ *
+ * The pairs are sorted by their first vertex, so that consecutive pairs with the same first vertex reuse
+ * its list of neighbours, and are then split between the threads. Each pair's neighbour lists are
+ * intersected with `gphrx_intersect_sorted`. Batches of fewer than `dimension / GPHRX_SIMILARITY_INDEX_RATIO`
+ * pairs find each vertex's neighbours by binary search; larger batches first find the offsets of every
+ * vertex's edges in one pass over the graph.
+ */
+DLLEXPORT GphrxSimilarityResult gphrx_find_similarities(GphrxGraph *restrict graph,
+                                                        u64 *from_vertex_ids,
+                                                        u64 *to_vertex_ids,
+                                                        size_t count);
+
+/**
+ * Frees a result from `gphrx_find_similarities`.
+ */
+DLLEXPORT void free_gphrx_similarity_result(GphrxSimilarityResult *restrict result);
+
+/**
+ * See `gphrx_find_similarities`.
+ */
+#define GPHRX_SIMILARITY_INDEX_RATIO 16
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet similarity_h_register_tests();
+
+#endif
+
+
+#define __SIMILARITY_H
+#endif
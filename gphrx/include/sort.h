@@ -0,0 +1,39 @@
+#ifndef __SORT_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "intrinsics.h"
+
+/**
+ * Sorts the edges from_vertex_ids[i] -> to_vertex_ids[i] for every i below `count` in place, by from
+ * vertex ID and then by to vertex ID (the order of a GphrxCsrAdjacencyMatrix's lists). Duplicate edges
+ * are kept.
+ *
+ * This is a parallel radix sort. When every vertex ID fits in 32 bits, each edge is packed into a single
+ * 64-bit key; otherwise the two lists are sorted as 128-bit keys. One pass over the whole input buckets the
+ * edges by their most significant bits, and the buckets (which fit in cache) are then finished in parallel
+ * with byte-wide passes from the least significant digit up. Digits that are the same for every edge (such
+ * as the high bytes of IDs in a graph with fewer than 2^24 vertices) are skipped.
+ */
+DLLEXPORT void gphrx_sort_edges(u64 *from_vertex_ids, u64 *to_vertex_ids, size_t count);
+
+/**
+ * Sorts `count` 64-bit keys in place with the same parallel radix sort as `gphrx_sort_edges`. Shared with
+ * the other GraphRox modules.
+ */
+void _gphrx_radix_sort_u64(u64 *keys, size_t count);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet sort_h_register_tests();
+
+#endif
+
+
+#define __SORT_H
+#endif
@@ -0,0 +1,94 @@
+#ifndef __SPMV_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "dynarray.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * How a sparse matrix-vector product is computed (see `gphrx_spmv`).
+ */
+typedef u8 GphrxSpmvDirection;
+
+#define GPHRX_SPMV_AUTO 0
+#define GPHRX_SPMV_PUSH 1
+#define GPHRX_SPMV_PULL 2
+
+/**
+ * With GPHRX_SPMV_AUTO, a product is pushed when the columns with non-zero entries in the input vector hold
+ * fewer than 1 / GPHRX_SPMV_PUSH_RATIO of the matrix's entries, and pulled otherwise.
+ */
+#define GPHRX_SPMV_PUSH_RATIO 16
+
+/**
+ * A sparse matrix prepared for repeated products with dense vectors. An adjacency matrix is treated as
+ * having a one at (row, column) = (to vertex, from vertex) for each edge, so a product sums the input
+ * values of each vertex's in-neighbours. A GphrxCsrMatrix has `entries[i]` at (`row_indices[i]`,
+ * `col_indices[i]`).
+ *
+ * The operator keeps the matrix's entries in the order the matrix stores them (grouped by column) for push
+ * products, sharing rather than copying its lists (see `dynarr8_share`), so it stays valid if the matrix is
+ * modified or freed. It also keeps a copy grouped by row for pull products, except for undirected graphs,
+ * whose adjacency matrices are symmetric.
+ */
+typedef struct {
+    u64 dimension;
+    size_t entry_count;
+    bool has_entries;
+
+    // Column c's entries are at [col_offsets[c], col_offsets[c + 1]). `col_entries` is unused if
+    // `has_entries` is false, in which case every entry is one.
+    size_t *col_offsets;
+    DynamicArray8 col_row_indices;
+    DynamicArray8 col_entries;
+
+    // Row r's entries are at [row_offsets[r], row_offsets[r + 1]). `row_entries` is null if `has_entries` is
+    // false.
+    size_t *row_offsets;
+    u64 *row_col_indices;
+    double *row_entries;
+} GphrxSpmvOperator;
+
+/**
+ * Prepares a graph's adjacency matrix for products.
+ */
+DLLEXPORT GphrxSpmvOperator new_gphrx_spmv_operator(GphrxGraph *restrict graph);
+
+/**
+ * Prepares a weighted matrix, such as an avg pool matrix, for products.
+ */
+DLLEXPORT GphrxSpmvOperator new_gphrx_spmv_operator_from_matrix(GphrxCsrMatrix *restrict matrix);
+
+DLLEXPORT void free_gphrx_spmv_operator(GphrxSpmvOperator *restrict op);
+
+/**
+ * Computes y = Mx, where x and y hold `op->dimension` values and must not overlap.
+ *
+ * A pull product splits the rows across the thread pool (balanced by their entry counts), and each row
+ * gathers the input values it needs, with AVX2 or AVX-512 gathers where the build targets them. A push
+ * product splits the columns, skips those whose input value is zero, and scatters each column's
+ * contributions into y with atomic adds. Pushing only touches the entries of the non-zero columns, so it is
+ * much faster for sparse input vectors, but its atomic adds make it slower for dense ones and make the
+ * order in which values are summed (and so the last bits of the result) depend on thread scheduling. Pull
+ * products are deterministic.
+ */
+DLLEXPORT void gphrx_spmv(GphrxSpmvOperator *restrict op,
+                          double *restrict x,
+                          double *restrict y,
+                          GphrxSpmvDirection direction);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet spmv_h_register_tests();
+
+#endif
+
+
+#define __SPMV_H
+#endif
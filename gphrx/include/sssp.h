@@ -0,0 +1,101 @@
+#ifndef __SSSP_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "bfs.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+#include "wgphrx.h"
+
+/**
+ * Result of a shortest-path search. `distances[v]` is the total weight of a shortest path to v from the
+ * nearest source, `parents[v]` is the vertex before v on one such path (sources are their own parents) and
+ * `nearest_sources[v]` is the source that path starts at. Vertices the search did not reach have a
+ * distance of INFINITY and a parent and nearest source of GPHRX_UNREACHED.
+ */
+typedef struct {
+    u64 vertex_count;
+    u64 reached_count;
+    double *distances;
+    u64 *parents;
+    u64 *nearest_sources;
+} GphrxSsspResult;
+
+/**
+ * Finds the shortest paths from `source_vertex_id` to every vertex of a weighted graph, following edges from
+ * their from vertex to their to vertex. Weights must be non-negative.
+ *
+ * This is delta-stepping (Meyer and Sanders, "Delta-stepping: a parallelizable shortest path algorithm"):
+ * vertices are kept in buckets of tentative distances `delta` wide, and the lowest non-empty bucket is
+ * relaxed in parallel, with the threads splitting its vertices and lowering their neighbours' distances with
+ * a compare-and-swap. A bucket is relaxed again until no vertex lands back in it, so paths of edges lighter
+ * than `delta` settle within a single bucket. A `delta` near the smallest weight does about as little work
+ * as Dijkstra's algorithm but has little parallelism per bucket; a `delta` near the largest weight does many
+ * more relaxations, as Bellman-Ford would, in far fewer buckets. If `delta` is not positive, the mean edge
+ * weight divided by the mean degree is used, as Meyer and Sanders suggest for random weights. Each thread
+ * also keeps relaxing its own share of the current bucket while that share stays small, rather than waiting
+ * for the other threads between every pass (Beamer et al., "The GAP Benchmark Suite").
+ *
+ * The search stops at `max_distance` (pass INFINITY for no limit): vertices further from the source are
+ * left unreached, and no bucket past the limit is relaxed. Distances found on an approximation of the graph
+ * (see `gphrx_sssp`) can be used to choose the limit, pruning the search on the full graph to the region
+ * that matters.
+ *
+ * Parents are assigned once the distances settle, by a parallel breadth-first pass from the sources over the
+ * edges that lie on shortest paths, so that they always form a tree even when edges weigh zero. Which of
+ * several shortest-path parents a vertex gets depends on thread scheduling; distances don't.
+ */
+DLLEXPORT GphrxSsspResult wgphrx_sssp(GphrxWeightedGraph *restrict graph,
+                                      u64 source_vertex_id,
+                                      double delta,
+                                      double max_distance);
+
+/**
+ * Finds the shortest paths to every vertex of a weighted graph from the nearest of several sources, in a
+ * single search. See `wgphrx_sssp`.
+ */
+DLLEXPORT GphrxSsspResult wgphrx_multi_source_sssp(GphrxWeightedGraph *restrict graph,
+                                                   u64 *source_vertex_ids,
+                                                   u64 source_count,
+                                                   double delta,
+                                                   double max_distance);
+
+/**
+ * Finds the shortest paths from `source_vertex_id` to every vertex of an unweighted graph, with every edge
+ * weighing one. See `wgphrx_sssp`. With a `delta` of one, each bucket is one level of a breadth-first
+ * search, so this is most useful with a `max_distance` or on an approximation from `approximate_gphrx`: if
+ * every edge of a graph falls in a block the approximation kept, a vertex's distance in the graph is at
+ * least its block's distance in the approximation times the graph's smallest edge weight, which bounds how
+ * far a search of the full weighted graph needs to go.
+ */
+DLLEXPORT GphrxSsspResult gphrx_sssp(GphrxGraph *restrict graph, u64 source_vertex_id, double delta, double max_distance);
+
+/**
+ * Finds the shortest paths to every vertex of an unweighted graph from the nearest of several sources, with
+ * every edge weighing one. See `wgphrx_sssp`.
+ */
+DLLEXPORT GphrxSsspResult gphrx_multi_source_sssp(GphrxGraph *restrict graph,
+                                                  u64 *source_vertex_ids,
+                                                  u64 source_count,
+                                                  double delta,
+                                                  double max_distance);
+
+/**
+ * Frees a result from one of the shortest-path searches.
+ */
+DLLEXPORT void free_gphrx_sssp_result(GphrxSsspResult *restrict result);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet sssp_h_register_tests();
+
+#endif
+
+
+#define __SSSP_H
+#endif
@@ -0,0 +1,159 @@
+#ifndef __THREADPOOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "intrinsics.h"
+
+/**
+ * Name of the environment variable read to size the thread pool when `gphrx_set_num_threads` has not
+ * been called (or was last called with zero).
+ */
+#define GPHRX_NUM_THREADS_ENV_VAR "GPHRX_NUM_THREADS"
+
+/**
+ * Sets the number of threads (including the calling thread) that parallel kernels may use. Passing zero
+ * restores the default, which is the value of the GPHRX_NUM_THREADS environment variable or, if that is
+ * unset or invalid, the number of online processors. Passing one disables parallelism entirely.
+ *
+ * Worker threads are started lazily, the first time a kernel has enough work to split. If the pool is
+ * already running with a different size, it is stopped and restarted at the new size on next use. This
+ * function blocks while a parallel kernel is running.
+ */
+DLLEXPORT void gphrx_set_num_threads(u32 thread_count);
+
+/**
+ * Returns the number of threads that parallel kernels may use (see `gphrx_set_num_threads`).
+ */
+DLLEXPORT u32 gphrx_get_num_threads();
+
+/**
+ * Body of a parallel loop. Called with a half-open index range [start, end) and the index of the thread
+ * running it, which is less than `gphrx_get_num_threads()`.
+ */
+typedef void (*GphrxParallelForFunc)(void *context, size_t start, size_t end, u32 thread_idx);
+
+/**
+ * Body of a parallel reduction. Called with a half-open index range [start, end) and a partial result
+ * that the range should be accumulated into.
+ */
+typedef void (*GphrxParallelReduceFunc)(void *context, size_t start, size_t end, void *partial);
+
+/**
+ * Folds a partial result into the accumulator of a parallel reduction.
+ */
+typedef void (*GphrxParallelCombineFunc)(void *context, void *accumulator, void *partial);
+
+/**
+ * Runs `func` over [start, end) split into ranges of at least `grain_size` indices. Ranges are handed out
+ * dynamically to the pool's workers and the calling thread, and this function returns once every range
+ * has been processed.
+ *
+ * If the range is too small to split, the pool is sized to one thread, the pool is already running
+ * another loop (e.g. when called concurrently from several application threads), or the caller is itself
+ * a pool worker, `func` is instead called once on the calling thread with the whole range and a thread
+ * index of zero. Callers therefore must not depend on how the range is split.
+ */
+void _gphrx_parallel_for(size_t start, size_t end, size_t grain_size, GphrxParallelForFunc func, void *context);
+
+/**
+ * Runs `func` over [start, end) for loops where indices cost very different amounts, such as per-vertex
+ * loops over graphs with heavy-tailed degree distributions. The cost of index i is one plus
+ * `cost_offsets[i + 1] - cost_offsets[i]`, so for a loop over vertices the offsets of each vertex's first
+ * edge give a cost proportional to degree (see `_gphrx_find_vertex_edge_offsets`). `cost_offsets` must
+ * be non-decreasing and hold entries `start` through `end`.
+ *
+ * The range is cut into chunks of roughly equal cost (at least `grain_cost`, except that a single index is
+ * never split) and each thread is given an equal share of the chunks in its own queue. A thread that
+ * empties its queue steals half of the remaining chunks from another thread's queue. When the loop is
+ * not worth splitting, `func` is called inline exactly as in `_gphrx_parallel_for`.
+ */
+void _gphrx_parallel_for_balanced(size_t start,
+                                  size_t end,
+                                  size_t *cost_offsets,
+                                  size_t grain_cost,
+                                  GphrxParallelForFunc func,
+                                  void *context);
+
+/**
+ * Reduces [start, end) into `result`, which must hold the identity value of the reduction on entry. Each
+ * range (of at least `grain_size` indices) is accumulated by `func` into its own copy of `result`, and the
+ * partials are folded into `result` with `combine` in index order, so the outcome does not depend on
+ * thread scheduling. See `_gphrx_parallel_for` for when the reduction runs on the calling thread alone.
+ */
+void _gphrx_parallel_reduce(size_t start,
+                            size_t end,
+                            size_t grain_size,
+                            void *result,
+                            size_t result_size,
+                            GphrxParallelReduceFunc func,
+                            GphrxParallelCombineFunc combine,
+                            void *context);
+
+/**
+ * Alignment of each thread's state in a parallel kernel. A kernel's per-thread state struct declares its
+ * first member with GPHRX_CACHE_ALIGNED, which pads the struct to whole cache lines, so that threads
+ * updating their own counters and lists don't invalidate each other's lines.
+ */
+#define GPHRX_CACHE_LINE_SIZE 64
+#define GPHRX_CACHE_ALIGNED _Alignas(GPHRX_CACHE_LINE_SIZE)
+
+/**
+ * Allocates an array of `thread_count` per-thread states of `state_size` bytes each, aligned to a cache
+ * line. `state_size` is the size of a struct whose first member is GPHRX_CACHE_ALIGNED. The caller frees
+ * the array.
+ */
+void *_gphrx_new_thread_states(size_t state_size, u32 thread_count);
+
+/**
+ * Word and bit of a vertex in a bitmap of one bit per vertex, packed into u64 words.
+ */
+#define GPHRX_BITMAP_WORD(v) ((v) >> 6)
+#define GPHRX_BITMAP_BIT(v) ((u64) 1 << ((v) & 63))
+
+// Bitmaps that threads update concurrently use relaxed atomics. The barrier at the end of each parallel
+// loop orders the updates for whatever runs after it.
+
+static FORCEINLINE bool _gphrx_atomic_bitmap_test(_Atomic u64 *bitmap, u64 v)
+{
+    return (atomic_load_explicit(bitmap + GPHRX_BITMAP_WORD(v), memory_order_relaxed) & GPHRX_BITMAP_BIT(v)) != 0;
+}
+
+static FORCEINLINE void _gphrx_atomic_bitmap_set(_Atomic u64 *bitmap, u64 v)
+{
+    atomic_fetch_or_explicit(bitmap + GPHRX_BITMAP_WORD(v), GPHRX_BITMAP_BIT(v), memory_order_relaxed);
+}
+
+static FORCEINLINE void _gphrx_atomic_bitmap_clear(_Atomic u64 *bitmap, u64 v)
+{
+    atomic_fetch_and_explicit(bitmap + GPHRX_BITMAP_WORD(v), ~GPHRX_BITMAP_BIT(v), memory_order_relaxed);
+}
+
+// Sets the vertex's bit, returning true if this call set it and false if it was already set. Used to claim
+// vertices: of several threads trying the same vertex, exactly one succeeds.
+static FORCEINLINE bool _gphrx_atomic_bitmap_try_set(_Atomic u64 *bitmap, u64 v)
+{
+    _Atomic u64 *word = bitmap + GPHRX_BITMAP_WORD(v);
+    u64 bit = GPHRX_BITMAP_BIT(v);
+
+    // Most attempts in a traversal find the bit already set, so check before writing to the cache line
+    if (atomic_load_explicit(word, memory_order_relaxed) & bit)
+        return false;
+
+    return (atomic_fetch_or_explicit(word, bit, memory_order_relaxed) & bit) == 0;
+}
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet threadpool_h_register_tests();
+
+#endif
+
+
+#define __THREADPOOL_H
+#endif
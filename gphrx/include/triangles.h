@@ -0,0 +1,78 @@
+#ifndef __TRIANGLES_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * Counts the values that appear in both of two sorted lists of distinct values (such as two vertices'
+ * lists of neighbours in `row_indices`). If `matches` is not null, the common values are also written to
+ * it in sorted order, so it must have room for the shorter list.
+ *
+ * Lists of similar length are merged a block at a time with SIMD compares when GraphRox is built for AVX2
+ * or AVX-512, which avoids the unpredictable branch of a scalar merge. When one list is more than
+ * GPHRX_INTERSECT_GALLOP_RATIO times longer than the other, each value of the shorter list is instead
+ * found in the longer one by galloping (exponential then binary) search.
+ */
+DLLEXPORT u64 gphrx_intersect_sorted(u64 *restrict a,
+                                     size_t a_count,
+                                     u64 *restrict b,
+                                     size_t b_count,
+                                     u64 *restrict matches);
+
+/**
+ * Counts the triangles in the graph, ignoring self-loops and the direction of edges (two vertices with
+ * edges both ways between them are joined once).
+ *
+ * Each edge is oriented from the endpoint with the lower degree to the one with the higher degree (ties go
+ * to the lower vertex ID), and each vertex's triangles are found by intersecting its oriented neighbours
+ * with each of their oriented neighbours. Every triangle is then found exactly once, at its lowest-ranked
+ * vertex, and no vertex intersects more than about sqrt(2 * edge_count) neighbours, however skewed the
+ * degrees are.
+ */
+DLLEXPORT u64 gphrx_count_triangles(GphrxGraph *restrict graph);
+
+/**
+ * Local clustering coefficients of a graph. `triangle_counts[v]` is the number of triangles that v is part
+ * of, and `coefficients[v]` is that count divided by the number of pairs of v's neighbours (0 for vertices
+ * with fewer than two neighbours). `average_coefficient` is the mean over every vertex.
+ */
+typedef struct {
+    u64 vertex_count;
+    u64 triangle_count;
+    u64 *triangle_counts;
+    double *coefficients;
+    double average_coefficient;
+} GphrxClusteringResult;
+
+/**
+ * Finds each vertex's triangle count and local clustering coefficient, counting triangles as in
+ * `gphrx_count_triangles`. A vertex's neighbours are the distinct vertices it has an edge to or from.
+ */
+DLLEXPORT GphrxClusteringResult gphrx_find_clustering_coefficients(GphrxGraph *restrict graph);
+
+/**
+ * Frees a result from `gphrx_find_clustering_coefficients`.
+ */
+DLLEXPORT void free_gphrx_clustering_result(GphrxClusteringResult *restrict result);
+
+/**
+ * How many times longer one list must be than the other for `gphrx_intersect_sorted` to gallop.
+ */
+#define GPHRX_INTERSECT_GALLOP_RATIO 32
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet triangles_h_register_tests();
+
+#endif
+
+
+#define __TRIANGLES_H
+#endif
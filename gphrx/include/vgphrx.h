@@ -0,0 +1,161 @@
+#ifndef __VGPHRX_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+
+#include "assert.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * Number of readers that can hold snapshots of a GphrxVersionedGraph at once. Further readers wait in
+ * `vgphrx_pin` until a slot frees up.
+ */
+#define GPHRX_VERSIONED_READER_SLOTS 64
+
+/**
+ * An immutable version of a GphrxVersionedGraph. Snapshots are reclaimed by the writers once no reader
+ * can still hold them; readers must not modify or free them.
+ */
+typedef struct GphrxSnapshot {
+    u64 version;
+    GphrxGraph graph;
+
+    // Epoch in which the snapshot was replaced and the next snapshot waiting to be reclaimed
+    u64 retired_epoch;
+    struct GphrxSnapshot *next_retired;
+} GphrxSnapshot;
+
+/**
+ * A reader's announcement of the epoch in which it pinned a snapshot, or zero for a free slot. Each slot
+ * has a cache line to itself so that readers pinning on different threads don't contend.
+ */
+typedef struct {
+    _Alignas(64) _Atomic u64 epoch;
+} GphrxReaderSlot;
+
+/**
+ * A graph that can be queried concurrently with mutation. Readers pin the current snapshot (an immutable
+ * version of the graph), query it with the usual read-only functions (`gphrx_does_edge_exist`,
+ * `approximate_gphrx`, etc.) and unpin it. Writers mutate a private working copy and publish it as a new
+ * snapshot, which readers that pin afterwards will see. Readers never block writers or each other.
+ *
+ * Replaced snapshots are reclaimed with epoch-based reclamation: a reader announces the current epoch
+ * when it pins, every publish advances the epoch, and a replaced snapshot is freed once every pinned reader
+ * announced a later epoch than the one in which the snapshot was replaced.
+ *
+ * A GphrxVersionedGraph must not be moved once created, so it is only handled through the pointer
+ * returned by `new_vgphrx`.
+ */
+typedef struct {
+    _Atomic(GphrxSnapshot*) current;
+    _Atomic u64 epoch;
+
+    GphrxReaderSlot reader_slots[GPHRX_VERSIONED_READER_SLOTS];
+
+    // Guards everything below, which only writers touch
+    pthread_mutex_t writer_lock;
+    GphrxGraph working_graph;
+    bool is_working_graph_dirty;
+    GphrxSnapshot *retired;
+    u64 retired_count;
+} GphrxVersionedGraph;
+
+/**
+ * A pinned snapshot. `graph` stays valid and unchanged until the guard is passed to `vgphrx_unpin`.
+ */
+typedef struct {
+    GphrxGraph *graph;
+    u64 version;
+    u32 slot;
+} GphrxSnapshotGuard;
+
+/**
+ * Creates a versioned graph whose first snapshot (version zero) holds the given graph. The graph is moved
+ * into the versioned graph; the caller must not use or free it afterwards.
+ */
+DLLEXPORT GphrxVersionedGraph *new_vgphrx(GphrxGraph *restrict graph);
+
+/**
+ * Frees a versioned graph and all of its snapshots. No snapshots may be pinned.
+ */
+DLLEXPORT void free_vgphrx(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Pins the current snapshot so it can be queried. Pinning is lock-free unless every reader slot is in use.
+ * A thread may hold several pins at once (each takes a slot).
+ */
+DLLEXPORT GphrxSnapshotGuard vgphrx_pin(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Releases a snapshot pinned by `vgphrx_pin`. The guard's graph must not be used afterwards.
+ */
+DLLEXPORT void vgphrx_unpin(GphrxVersionedGraph *restrict versioned_graph, GphrxSnapshotGuard *restrict guard);
+
+/**
+ * Returns the version of the current snapshot.
+ */
+DLLEXPORT u64 vgphrx_current_version(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Locks out other writers and returns the working graph, which can be modified with the usual functions
+ * (`gphrx_add_edge`, `gphrx_remove_vertex`, etc.). Changes are invisible to readers until published. Must
+ * be followed by `vgphrx_end_write` on the same thread.
+ */
+DLLEXPORT GphrxGraph *vgphrx_begin_write(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Releases the lock taken by `vgphrx_begin_write`. If `publish` is true, the working graph is published
+ * as a new snapshot. Returns the version of the current snapshot.
+ */
+DLLEXPORT u64 vgphrx_end_write(GphrxVersionedGraph *restrict versioned_graph, bool publish);
+
+/**
+ * Convenience wrappers that modify the working graph under the writer lock without publishing.
+ */
+DLLEXPORT void vgphrx_add_edge(GphrxVersionedGraph *restrict versioned_graph, u64 from_vertex_id, u64 to_vertex_id);
+DLLEXPORT GphrxErrorCode vgphrx_remove_edge(GphrxVersionedGraph *restrict versioned_graph,
+                                            u64 from_vertex_id,
+                                            u64 to_vertex_id);
+
+/**
+ * Publishes the working graph as a new snapshot if it has changed since the last publish, then frees any
+ * replaced snapshots that no reader can still hold. Returns the version of the current snapshot.
+ */
+DLLEXPORT u64 vgphrx_publish(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Frees any replaced snapshots that no reader can still hold. Publishing already does this, but a writer
+ * that publishes rarely may want to free memory held by snapshots that readers have since unpinned.
+ */
+DLLEXPORT void vgphrx_reclaim(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Announces a reader in the current epoch and returns its slot, without loading the snapshot. Memory that
+ * is retired after the announcement (with an epoch taken from the versioned graph's counter) stays valid
+ * until the slot is released by `vgphrx_unpin`. Shared with the other GraphRox modules, which use it to
+ * protect their own structures alongside a snapshot.
+ */
+u32 _vgphrx_announce_reader(GphrxVersionedGraph *restrict versioned_graph);
+
+/**
+ * Returns the oldest epoch announced by a pinned reader, or UINT64_MAX if there is none. Memory retired in
+ * an epoch older than this can be freed. Shared with the other GraphRox modules.
+ */
+u64 _vgphrx_oldest_pinned_epoch(GphrxVersionedGraph *restrict versioned_graph);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet vgphrx_h_register_tests();
+
+#endif
+
+
+#define __VGPHRX_H
+#endif
@@ -0,0 +1,132 @@
+#ifndef __WGPHRX_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "assert.h"
+#include "dynarray.h"
+#include "gphrx.h"
+#include "intrinsics.h"
+
+/**
+ * Precision of the weights in a GphrxWeightedGraph, given as the number of bytes used to store each
+ * weight. When a weighted graph is converted to a byte array, the precision is written to the `is_weighted`
+ * byte of the GphrxByteArrayHeader (an unweighted graph writes zero).
+ */
+typedef u8 GphrxWeightPrecision;
+
+#define GPHRX_WEIGHT_F32 4
+#define GPHRX_WEIGHT_F64 8
+
+/**
+ * Edge weights for a GphrxWeightedGraph. Which member is in use is determined by the graph's precision.
+ */
+typedef union {
+    DynamicArray4 f32;
+    DynamicArray8 f64;
+} GphrxWeights;
+
+/**
+ * Metadata and representation of a weighted graph. Weights are stored in their own list, parallel to the
+ * lists in the adjacency matrix (the weight at index i belongs to the edge at index i).
+ */
+typedef struct {
+    bool is_undirected;
+    GphrxWeightPrecision precision;
+    GphrxCsrAdjacencyMatrix adjacency_matrix;
+    GphrxWeights weights;
+} GphrxWeightedGraph;
+
+/**
+ * Creates an empty undirected weighted GraphRox graph with the given weight precision.
+ */
+DLLEXPORT GphrxWeightedGraph new_undirected_wgphrx(GphrxWeightPrecision precision);
+
+/**
+ * Creates an empty directed weighted GraphRox graph with the given weight precision.
+ */
+DLLEXPORT GphrxWeightedGraph new_directed_wgphrx(GphrxWeightPrecision precision);
+
+/**
+ * Creates a copy of the given weighted GraphRox graph.
+ */
+DLLEXPORT GphrxWeightedGraph duplicate_wgphrx(GphrxWeightedGraph *restrict graph);
+
+/**
+ * Frees the memory used by the given weighted graph.
+ */
+DLLEXPORT void free_wgphrx(GphrxWeightedGraph *restrict graph);
+
+/**
+ * Frees up excess memory used by the lists that describe the weighted graph. See `gphrx_shrink`.
+ */
+DLLEXPORT void wgphrx_shrink(GphrxWeightedGraph *restrict graph);
+
+/**
+ * Returns `true` if an edge with the given to and from vertex IDs exists and `false` otherwise.
+ */
+DLLEXPORT bool wgphrx_does_edge_exist(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Returns the weight of the edge with the given to and from vertex IDs. If the edge does not exist, zero
+ * is returned and `error` is set to GPHRX_ERROR_NOT_FOUND.
+ */
+DLLEXPORT double wgphrx_get_edge_weight(GphrxWeightedGraph *restrict graph,
+                                        u64 from_vertex_id,
+                                        u64 to_vertex_id,
+                                        GphrxErrorCode *restrict error);
+
+/**
+ * Adds a weighted link between two vertices. If the link already exists, its weight is replaced. The
+ * "from" and "to" qualifiers on parameter names are only significant when the graph is directed.
+ */
+DLLEXPORT void wgphrx_add_edge(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id, double weight);
+
+/**
+ * Removes a link (and its weight) between two vertices. The "from" and "to" qualifiers on parameter names
+ * are only significant when the graph is directed.
+ */
+DLLEXPORT GphrxErrorCode wgphrx_remove_edge(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id);
+
+/**
+ * Returns an avg pool matrix for a given weighted graph given a block dimension. Each entry is the average
+ * of all the entries (including the zero entries) in the corresponding block of the adjacency matrix,
+ * where the entry for an edge is its weight. See `gphrx_find_avg_pool_matrix`.
+ */
+DLLEXPORT GphrxCsrMatrix wgphrx_find_avg_pool_matrix(GphrxWeightedGraph *restrict graph, u64 block_dimension);
+
+/**
+ * Generates an approximation of a weighted graph. Blocks are kept or dropped exactly as they are by
+ * `approximate_gphrx` (based on the percentage of entries in the block that are non-zero), and the weight
+ * of each kept block is the average of the entries in the block. Occurrences and weights are pooled in a
+ * single pass over the edges. The approximation has the same weight precision as the given graph.
+ */
+DLLEXPORT GphrxWeightedGraph approximate_wgphrx(GphrxWeightedGraph *restrict graph, u64 block_dimension, double threshold);
+
+/**
+ * Converts the given GphrxWeightedGraph to a big-endian byte array representation. The layout matches
+ * that of `gphrx_to_byte_array` with the weights appended after the row indices.
+ */
+DLLEXPORT byte *wgphrx_to_byte_array(GphrxWeightedGraph *restrict graph);
+
+/**
+ * Converts the given byte array from big-endian byte array representation of a GphrxWeightedGraph to a
+ * GphrxWeightedGraph. Byte arrays for unweighted graphs are also accepted, in which case every edge is
+ * given a weight of one.
+ */
+DLLEXPORT GphrxWeightedGraph wgphrx_from_byte_array(byte *restrict arr, GphrxErrorCode *restrict error);
+
+
+#ifdef TEST_MODE
+
+#include "test.h"
+
+ModuleTestSet wgphrx_h_register_tests();
+
+#endif
+
+
+#define __WGPHRX_H
+#endif
@@ -0,0 +1,684 @@
+// For mremap
+#define _GNU_SOURCE
+
+#include "alloc.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define CAN_MAP_BUFFERS 1
+#else
+#define CAN_MAP_BUFFERS 0
+#endif
+
+#define ALIGNMENT 16
+#define ARENA_BLOCK_HEADER_SIZE ((sizeof(GphrxArenaBlock) + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1))
+#define POOL_SLAB_HEADER_SIZE ((sizeof(GphrxPoolSlab) + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1))
+
+static _Atomic(GphrxAllocator*) default_allocator = 0;
+
+static pthread_once_t small_graph_pool_once = PTHREAD_ONCE_INIT;
+static GphrxPool *small_graph_pool = 0;
+
+static pthread_once_t scratch_arena_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t scratch_arena_key;
+static _Thread_local GphrxArena *scratch_arena = 0;
+
+DLLEXPORT void gphrx_set_allocator(GphrxAllocator *allocator)
+{
+    atomic_store_explicit(&default_allocator, allocator, memory_order_release);
+}
+
+DLLEXPORT GphrxAllocator *gphrx_get_allocator()
+{
+    return atomic_load_explicit(&default_allocator, memory_order_acquire);
+}
+
+static void create_small_graph_pool()
+{
+    small_graph_pool = new_gphrx_pool();
+}
+
+DLLEXPORT void gphrx_use_small_graph_pool(bool enable)
+{
+    if (!enable)
+    {
+        gphrx_set_allocator(0);
+        return;
+    }
+
+    // The pool is never freed, as graphs allocated from it may outlive any later change of allocator
+    pthread_once(&small_graph_pool_once, create_small_graph_pool);
+    gphrx_set_allocator(&small_graph_pool->allocator);
+}
+
+static bool is_mapped_size(size_t size)
+{
+    return CAN_MAP_BUFFERS && size >= GPHRX_MAP_THRESHOLD;
+}
+
+#if CAN_MAP_BUFFERS
+
+// Mappings are whole huge pages where transparent huge pages are available, so that the kernel can back
+// all of a buffer with them
+static size_t mapping_granularity()
+{
+#ifdef MADV_HUGEPAGE
+    return GPHRX_HUGE_PAGE_SIZE;
+#else
+    return system_page_size();
+#endif
+}
+
+static size_t mapped_length(size_t size)
+{
+    size_t granularity = mapping_granularity();
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+static void advise_huge_pages(void *ptr, size_t length)
+{
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+}
+
+static void *map_buffer(size_t size)
+{
+    size_t length = mapped_length(size);
+    size_t granularity = mapping_granularity();
+
+    // Map an extra huge page and trim either end, so that the buffer starts on a huge page boundary
+    byte *region = mmap(0, length + granularity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (region == MAP_FAILED)
+        return 0;
+
+    size_t lead = (granularity - (size_t) region % granularity) % granularity;
+
+    if (lead != 0)
+        munmap(region, lead);
+
+    munmap(region + lead + length, granularity - lead);
+
+    advise_huge_pages(region + lead, length);
+
+    return region + lead;
+}
+
+static void *remap_buffer(void *ptr, size_t old_size, size_t new_size)
+{
+    size_t old_length = mapped_length(old_size);
+    size_t new_length = mapped_length(new_size);
+
+    if (old_length == new_length)
+        return ptr;
+
+#ifdef __linux__
+    // Moves the pages rather than copying them, so growing never needs two copies of the buffer at once
+    void *new_ptr = mremap(ptr, old_length, new_length, MREMAP_MAYMOVE);
+
+    if (new_ptr == MAP_FAILED)
+        return 0;
+
+    if (new_length > old_length)
+        advise_huge_pages(new_ptr, new_length);
+#else
+    void *new_ptr = map_buffer(new_size);
+
+    if (new_ptr == 0)
+        return 0;
+
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    munmap(ptr, old_length);
+#endif
+
+    return new_ptr;
+}
+
+#endif
+
+static void *default_alloc(size_t size)
+{
+#if CAN_MAP_BUFFERS
+    if (is_mapped_size(size))
+        return map_buffer(size);
+#endif
+
+    // malloc and realloc may return null for zero bytes, which would look like a failure
+    return malloc(size == 0 ? 1 : size);
+}
+
+static void default_free(void *ptr, size_t size)
+{
+#if CAN_MAP_BUFFERS
+    if (is_mapped_size(size))
+    {
+        munmap(ptr, mapped_length(size));
+        return;
+    }
+#endif
+
+    free(ptr);
+}
+
+static void *default_resize(void *ptr, size_t old_size, size_t new_size)
+{
+    bool was_mapped = is_mapped_size(old_size);
+    bool is_mapped = is_mapped_size(new_size);
+
+#if CAN_MAP_BUFFERS
+    if (was_mapped && is_mapped)
+        return remap_buffer(ptr, old_size, new_size);
+#endif
+
+    if (!was_mapped && !is_mapped)
+        return realloc(ptr, new_size == 0 ? 1 : new_size);
+
+    void *new_ptr = default_alloc(new_size);
+
+    if (new_ptr != 0)
+    {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        default_free(ptr, old_size);
+    }
+
+    return new_ptr;
+}
+
+void *_gphrx_alloc(GphrxAllocator *allocator, size_t size)
+{
+    if (allocator == 0)
+        return default_alloc(size);
+
+    return allocator->alloc(allocator, size);
+}
+
+void *_gphrx_resize(GphrxAllocator *allocator, void *ptr, size_t old_size, size_t new_size)
+{
+    if (allocator == 0)
+        return default_resize(ptr, old_size, new_size);
+
+    return allocator->resize(allocator, ptr, old_size, new_size);
+}
+
+void _gphrx_free(GphrxAllocator *allocator, void *ptr, size_t size)
+{
+    if (allocator == 0)
+        default_free(ptr, size);
+    else
+        allocator->free(allocator, ptr, size);
+}
+
+static size_t align_size(size_t size)
+{
+    if (size == 0)
+        return ALIGNMENT;
+
+    return (size + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1);
+}
+
+static byte *arena_block_data(GphrxArenaBlock *block)
+{
+    return (byte*) block + ARENA_BLOCK_HEADER_SIZE;
+}
+
+static GphrxArenaBlock *new_arena_block(size_t capacity)
+{
+    GphrxArenaBlock *block = malloc(ARENA_BLOCK_HEADER_SIZE + capacity);
+    assert(block != 0, "malloc failure");
+
+    block->next = 0;
+    block->capacity = capacity;
+    block->used = 0;
+
+    return block;
+}
+
+static bool is_last_arena_allocation(GphrxArena *arena, byte *ptr, size_t aligned_size)
+{
+    GphrxArenaBlock *block = arena->current;
+    return ptr + aligned_size == arena_block_data(block) + block->used;
+}
+
+static void *arena_alloc(GphrxAllocator *allocator, size_t size)
+{
+    GphrxArena *arena = (GphrxArena*) allocator;
+    size = align_size(size);
+
+    // Rewinding frees the blocks after the current one, so the current block is always the last
+    GphrxArenaBlock *block = arena->current;
+    if (block->capacity - block->used < size)
+    {
+        block = new_arena_block(size > arena->block_size ? size : arena->block_size);
+
+        arena->current->next = block;
+        arena->current = block;
+    }
+
+    void *ptr = arena_block_data(block) + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+static void *arena_resize(GphrxAllocator *allocator, void *ptr, size_t old_size, size_t new_size)
+{
+    GphrxArena *arena = (GphrxArena*) allocator;
+    GphrxArenaBlock *block = arena->current;
+
+    size_t old_aligned_size = align_size(old_size);
+    size_t new_aligned_size = align_size(new_size);
+
+    if (is_last_arena_allocation(arena, ptr, old_aligned_size) &&
+        block->capacity - (block->used - old_aligned_size) >= new_aligned_size)
+    {
+        block->used = block->used - old_aligned_size + new_aligned_size;
+        return ptr;
+    }
+
+    void *new_ptr = arena_alloc(allocator, new_size);
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+
+    return new_ptr;
+}
+
+static void arena_free(GphrxAllocator *allocator, void *ptr, size_t size)
+{
+    GphrxArena *arena = (GphrxArena*) allocator;
+    size_t aligned_size = align_size(size);
+
+    if (is_last_arena_allocation(arena, ptr, aligned_size))
+        arena->current->used -= aligned_size;
+}
+
+DLLEXPORT GphrxArena *new_gphrx_arena(size_t block_size)
+{
+    if (block_size == 0)
+        block_size = GPHRX_ARENA_BLOCK_SIZE;
+
+    GphrxArena *arena = malloc(sizeof(GphrxArena));
+    assert(arena != 0, "malloc failure");
+
+    arena->allocator.alloc = arena_alloc;
+    arena->allocator.resize = arena_resize;
+    arena->allocator.free = arena_free;
+
+    arena->block_size = align_size(block_size);
+    arena->first = new_arena_block(arena->block_size);
+    arena->current = arena->first;
+
+    return arena;
+}
+
+DLLEXPORT void free_gphrx_arena(GphrxArena *restrict arena)
+{
+    GphrxArenaBlock *block = arena->first;
+
+    while (block != 0)
+    {
+        GphrxArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
+
+GphrxArenaMark gphrx_arena_mark(GphrxArena *restrict arena)
+{
+    GphrxArenaMark mark = {
+        .block = arena->current,
+        .used = arena->current->used,
+    };
+
+    return mark;
+}
+
+void gphrx_arena_rewind(GphrxArena *restrict arena, GphrxArenaMark mark)
+{
+    GphrxArenaBlock *block = mark.block->next;
+
+    while (block != 0)
+    {
+        GphrxArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    mark.block->next = 0;
+    mark.block->used = mark.used;
+    arena->current = mark.block;
+}
+
+DLLEXPORT void gphrx_arena_reset(GphrxArena *restrict arena)
+{
+    GphrxArenaMark start = {
+        .block = arena->first,
+        .used = 0,
+    };
+
+    gphrx_arena_rewind(arena, start);
+}
+
+static void free_scratch_arena(void *arena)
+{
+    free_gphrx_arena(arena);
+}
+
+static void create_scratch_arena_key()
+{
+    pthread_key_create(&scratch_arena_key, free_scratch_arena);
+}
+
+GphrxArena *_gphrx_scratch_arena()
+{
+    if (scratch_arena == 0)
+    {
+        pthread_once(&scratch_arena_key_once, create_scratch_arena_key);
+
+        scratch_arena = new_gphrx_arena(0);
+        pthread_setspecific(scratch_arena_key, scratch_arena);
+    }
+
+    return scratch_arena;
+}
+
+static u32 pool_class_of(size_t size)
+{
+    u32 class_idx = 0;
+
+    for (size_t class_size = GPHRX_POOL_MIN_CLASS_SIZE; class_size < size; class_size <<= 1)
+        ++class_idx;
+
+    return class_idx;
+}
+
+// Must be called with the pool locked
+static void refill_pool_class(GphrxPool *pool, u32 class_idx)
+{
+    size_t class_size = (size_t) GPHRX_POOL_MIN_CLASS_SIZE << class_idx;
+
+    GphrxPoolSlab *slab = malloc(GPHRX_POOL_SLAB_SIZE);
+    assert(slab != 0, "malloc failure");
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    byte *buffers = (byte*) slab + POOL_SLAB_HEADER_SIZE;
+    size_t buffer_count = (GPHRX_POOL_SLAB_SIZE - POOL_SLAB_HEADER_SIZE) / class_size;
+
+    for (size_t i = 0; i < buffer_count; ++i)
+    {
+        void **buffer = (void**) (buffers + i * class_size);
+
+        *buffer = pool->free_lists[class_idx];
+        pool->free_lists[class_idx] = buffer;
+    }
+}
+
+static void *pool_alloc(GphrxAllocator *allocator, size_t size)
+{
+    GphrxPool *pool = (GphrxPool*) allocator;
+
+    if (size > GPHRX_POOL_MAX_CLASS_SIZE)
+        return default_alloc(size);
+
+    u32 class_idx = pool_class_of(size);
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (pool->free_lists[class_idx] == 0)
+        refill_pool_class(pool, class_idx);
+
+    void **buffer = pool->free_lists[class_idx];
+    pool->free_lists[class_idx] = *buffer;
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return buffer;
+}
+
+static void pool_free(GphrxAllocator *allocator, void *ptr, size_t size)
+{
+    GphrxPool *pool = (GphrxPool*) allocator;
+
+    if (size > GPHRX_POOL_MAX_CLASS_SIZE)
+    {
+        default_free(ptr, size);
+        return;
+    }
+
+    u32 class_idx = pool_class_of(size);
+    void **buffer = ptr;
+
+    pthread_mutex_lock(&pool->lock);
+
+    *buffer = pool->free_lists[class_idx];
+    pool->free_lists[class_idx] = buffer;
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_resize(GphrxAllocator *allocator, void *ptr, size_t old_size, size_t new_size)
+{
+    if (old_size > GPHRX_POOL_MAX_CLASS_SIZE && new_size > GPHRX_POOL_MAX_CLASS_SIZE)
+        return default_resize(ptr, old_size, new_size);
+
+    if (old_size <= GPHRX_POOL_MAX_CLASS_SIZE &&
+        new_size <= GPHRX_POOL_MAX_CLASS_SIZE &&
+        pool_class_of(old_size) == pool_class_of(new_size))
+    {
+        return ptr;
+    }
+
+    void *new_ptr = pool_alloc(allocator, new_size);
+
+    if (new_ptr != 0)
+    {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        pool_free(allocator, ptr, old_size);
+    }
+
+    return new_ptr;
+}
+
+DLLEXPORT GphrxPool *new_gphrx_pool()
+{
+    GphrxPool *pool = malloc(sizeof(GphrxPool));
+    assert(pool != 0, "malloc failure");
+
+    pool->allocator.alloc = pool_alloc;
+    pool->allocator.resize = pool_resize;
+    pool->allocator.free = pool_free;
+
+    pthread_mutex_init(&pool->lock, 0);
+    memset(pool->free_lists, 0, sizeof(pool->free_lists));
+    pool->slabs = 0;
+
+    return pool;
+}
+
+DLLEXPORT void free_gphrx_pool(GphrxPool *restrict pool)
+{
+    GphrxPoolSlab *slab = pool->slabs;
+
+    while (slab != 0)
+    {
+        GphrxPoolSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+#ifdef TEST_MODE
+
+#include "dynarray.h"
+
+static TEST_RESULT test_gphrx_arena()
+{
+    GphrxArena *arena = new_gphrx_arena(1024);
+    GphrxAllocator *allocator = &arena->allocator;
+
+    u64 *first = _gphrx_alloc(allocator, 10 * sizeof(u64));
+    u64 *second = _gphrx_alloc(allocator, 3);
+
+    assert((size_t) first % ALIGNMENT == 0 && (size_t) second % ALIGNMENT == 0, "Misaligned allocation");
+    assert((byte*) second == (byte*) first + 80, "Allocations not contiguous");
+
+    for (u64 i = 0; i < 10; ++i)
+        first[i] = i;
+
+    // The last allocation grows in place; earlier ones are copied
+    u64 *grown_second = _gphrx_resize(allocator, second, 3, 64);
+    assert(grown_second == second, "Last allocation was not grown in place");
+
+    u64 *grown_first = _gphrx_resize(allocator, first, 10 * sizeof(u64), 20 * sizeof(u64));
+    assert(grown_first != first, "Earlier allocation was grown in place");
+
+    for (u64 i = 0; i < 10; ++i)
+        assert(grown_first[i] == i, "Resize lost contents");
+
+    GphrxArenaMark mark = gphrx_arena_mark(arena);
+
+    // Too large for a block, so given its own and freed by the rewind
+    byte *large = _gphrx_alloc(allocator, 4096);
+    memset(large, 0xFF, 4096);
+
+    assert(arena->current != arena->first, "Large allocation was not given its own block");
+
+    gphrx_arena_rewind(arena, mark);
+
+    assert(arena->current == arena->first && arena->first->next == 0, "Rewind did not free later blocks");
+    assert(arena->first->used == mark.used, "Rewind did not free allocations");
+
+    // Freeing the last allocation gives its space back
+    size_t used = arena->current->used;
+    void *last = _gphrx_alloc(allocator, 100);
+    _gphrx_free(allocator, last, 100);
+    assert(arena->current->used == used, "Freeing last allocation did not give its space back");
+
+    gphrx_arena_reset(arena);
+    assert(arena->first->used == 0, "Reset did not free allocations");
+    assert(_gphrx_alloc(allocator, 8) == first, "Reset arena did not reuse its first block");
+
+    free_gphrx_arena(arena);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_pool()
+{
+    GphrxPool *pool = new_gphrx_pool();
+    GphrxAllocator *allocator = &pool->allocator;
+
+    u64 *small = _gphrx_alloc(allocator, 24);
+    for (u64 i = 0; i < 3; ++i)
+        small[i] = i;
+
+    // 24 and 32 bytes share a size class
+    assert(_gphrx_resize(allocator, small, 24, 32) == small, "Resize within size class moved buffer");
+
+    u64 *larger = _gphrx_resize(allocator, small, 32, 1000);
+    for (u64 i = 0; i < 3; ++i)
+        assert(larger[i] == i, "Resize lost contents");
+
+    // The freed buffer is reused by the next allocation of its class
+    assert(_gphrx_alloc(allocator, 20) == small, "Freed buffer was not reused");
+
+    byte *huge = _gphrx_alloc(allocator, GPHRX_POOL_MAX_CLASS_SIZE + 1);
+    memset(huge, 1, GPHRX_POOL_MAX_CLASS_SIZE + 1);
+
+    huge = _gphrx_resize(allocator, huge, GPHRX_POOL_MAX_CLASS_SIZE + 1, 2 * GPHRX_POOL_MAX_CLASS_SIZE);
+    assert(huge[GPHRX_POOL_MAX_CLASS_SIZE] == 1, "Resize lost contents");
+
+    _gphrx_free(allocator, huge, 2 * GPHRX_POOL_MAX_CLASS_SIZE);
+    _gphrx_free(allocator, larger, 1000);
+    _gphrx_free(allocator, small, 20);
+
+    // Arrays remember their allocator, so graphs made with the pool can be freed after switching back
+    gphrx_set_allocator(allocator);
+
+    DynamicArray8 arr = new_dynarr8();
+    for (u64 i = 0; i < 100; ++i)
+    {
+        Byte8Val val = { .u64_val = i };
+        dynarr8_push(&arr, val);
+    }
+
+    gphrx_set_allocator(0);
+
+    assert(arr.allocator == allocator, "Array did not use the pool");
+
+    for (u64 i = 0; i < 100; ++i)
+        assert(arr.arr[i].u64_val == i, "Incorrect value in array");
+
+    free_dynarr8(&arr);
+    free_gphrx_pool(pool);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_mapped_growth()
+{
+    const size_t mapped_count = 2 * GPHRX_MAP_THRESHOLD / sizeof(Byte8Val);
+
+    DynamicArray8 arr = new_dynarr8();
+    for (u64 i = 0; i < mapped_count; ++i)
+    {
+        Byte8Val val = { .u64_val = i };
+        dynarr8_push(&arr, val);
+    }
+
+    assert(arr.capacity * sizeof(Byte8Val) >= GPHRX_MAP_THRESHOLD, "Array did not grow past threshold");
+
+#if CAN_MAP_BUFFERS
+    assert((size_t) arr.arr % GPHRX_HUGE_PAGE_SIZE == 0, "Mapped buffer is not aligned to a huge page");
+#endif
+
+    for (u64 i = 0; i < mapped_count; ++i)
+        assert(arr.arr[i].u64_val == i, "Incorrect value in array");
+
+    // Growing and zeroing a mapped buffer
+    dynarr8_grow_and_zero(&arr, mapped_count * 3);
+    assert(arr.arr[mapped_count - 1].u64_val == mapped_count - 1, "Growth lost contents");
+
+    for (u64 i = mapped_count; i < mapped_count * 3; ++i)
+        assert(arr.arr[i].u64_val == 0, "Growth did not zero new elements");
+
+    // Shrinking back below the threshold moves the buffer back to the heap
+    dynarr8_remove_multiple_at(&arr, 100, mapped_count * 3 - 100);
+    dynarr8_shrink(&arr);
+
+    assert(arr.size == 100, "Incorrect array size");
+    assert(arr.capacity * sizeof(Byte8Val) < GPHRX_MAP_THRESHOLD, "Array did not shrink below threshold");
+
+    for (u64 i = 0; i < 100; ++i)
+        assert(arr.arr[i].u64_val == i, "Shrink lost contents");
+
+    free_dynarr8(&arr);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet alloc_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_arena);
+    register_test(&set, test_gphrx_pool);
+    register_test(&set, test_gphrx_mapped_growth);
+
+    return set;
+}
+
+#endif
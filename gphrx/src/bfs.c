@@ -0,0 +1,494 @@
+#include "bfs.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "dynarray.h"
+#include "threadpool.h"
+
+// Frontier vertices per range of a top-down level, and bitmap words (of 64 vertices each) per range of a
+// bottom-up level
+#define TOP_DOWN_GRAIN_SIZE 64
+#define BOTTOM_UP_GRAIN_SIZE 16
+
+typedef struct {
+    GPHRX_CACHE_ALIGNED DynamicArrayU64 next_frontier;
+    u64 awakened_count;
+    u64 awakened_edge_count;
+} BfsThreadState;
+
+typedef struct {
+    u32 thread_count;
+    u64 word_count;
+    u64 depth;
+
+    size_t *out_offsets;
+    u64 *out_edges;
+    size_t *in_offsets;
+    u64 *in_edges;
+
+    // Top-down levels claim vertices with an atomic OR. Bottom-up levels only update the words of the
+    // vertices in their own range, so they don't need to.
+    _Atomic u64 *visited;
+
+    u64 *frontier;
+    u64 *frontier_bitmap;
+    u64 *next_bitmap;
+
+    u64 *distances;
+    u64 *parents;
+
+    BfsThreadState *threads;
+} BfsSearch;
+
+static void expand_top_down(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    BfsSearch *search = context;
+    BfsThreadState *state = search->threads + thread_idx;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        u64 v = search->frontier[i];
+
+        for (size_t edge = search->out_offsets[v]; edge < search->out_offsets[v + 1]; ++edge)
+        {
+            u64 w = search->out_edges[edge];
+
+            if (!_gphrx_atomic_bitmap_try_set(search->visited, w))
+                continue;
+
+            search->distances[w] = search->depth;
+            search->parents[w] = v;
+
+            dynarr_u64_push(&state->next_frontier, w);
+            state->awakened_edge_count += search->out_offsets[w + 1] - search->out_offsets[w];
+        }
+    }
+}
+
+static void expand_bottom_up(void *context, size_t start_word, size_t end_word, u32 thread_idx)
+{
+    BfsSearch *search = context;
+    BfsThreadState *state = search->threads + thread_idx;
+
+    for (size_t word = start_word; word < end_word; ++word)
+    {
+        u64 visited = atomic_load_explicit(search->visited + word, memory_order_relaxed);
+        u64 unvisited = ~visited;
+        u64 awakened = 0;
+
+        while (unvisited != 0)
+        {
+            u64 v = word * 64 + u64_trailing_zeros(unvisited);
+            unvisited &= unvisited - 1;
+
+            for (size_t edge = search->in_offsets[v]; edge < search->in_offsets[v + 1]; ++edge)
+            {
+                u64 u = search->in_edges[edge];
+
+                if (search->frontier_bitmap[GPHRX_BITMAP_WORD(u)] & GPHRX_BITMAP_BIT(u))
+                {
+                    search->distances[v] = search->depth;
+                    search->parents[v] = u;
+
+                    awakened |= GPHRX_BITMAP_BIT(v);
+                    state->awakened_edge_count += search->out_offsets[v + 1] - search->out_offsets[v];
+
+                    break;
+                }
+            }
+        }
+
+        search->next_bitmap[word] = awakened;
+
+        if (awakened != 0)
+        {
+            atomic_store_explicit(search->visited + word, visited | awakened, memory_order_relaxed);
+            state->awakened_count += u64_popcount(awakened);
+        }
+    }
+}
+
+// Sums the threads' counts for the level just expanded and resets them
+static void collect_level_counts(BfsSearch *restrict search, u64 *awakened_count, u64 *awakened_edge_count)
+{
+    *awakened_count = 0;
+    *awakened_edge_count = 0;
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+    {
+        *awakened_count += search->threads[i].awakened_count + search->threads[i].next_frontier.size;
+        *awakened_edge_count += search->threads[i].awakened_edge_count;
+
+        search->threads[i].awakened_count = 0;
+        search->threads[i].awakened_edge_count = 0;
+    }
+}
+
+static u64 gather_next_frontier(BfsSearch *restrict search)
+{
+    u64 size = 0;
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+    {
+        DynamicArrayU64 *next_frontier = &search->threads[i].next_frontier;
+
+        memcpy(search->frontier + size, next_frontier->arr, next_frontier->size * sizeof(u64));
+        size += next_frontier->size;
+
+        next_frontier->size = 0;
+    }
+
+    return size;
+}
+
+static void frontier_to_bitmap(BfsSearch *restrict search, u64 frontier_size)
+{
+    memset(search->frontier_bitmap, 0, search->word_count * sizeof(u64));
+
+    for (u64 i = 0; i < frontier_size; ++i)
+        search->frontier_bitmap[GPHRX_BITMAP_WORD(search->frontier[i])] |= GPHRX_BITMAP_BIT(search->frontier[i]);
+}
+
+static u64 bitmap_to_frontier(BfsSearch *restrict search)
+{
+    u64 size = 0;
+
+    for (u64 word = 0; word < search->word_count; ++word)
+    {
+        for (u64 bits = search->frontier_bitmap[word]; bits != 0; bits &= bits - 1)
+            search->frontier[size++] = word * 64 + u64_trailing_zeros(bits);
+    }
+
+    return size;
+}
+
+DLLEXPORT GphrxBfsResult gphrx_bfs(GphrxGraph *restrict graph, u64 source_vertex_id)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+
+    // A source past the highest vertex ID is a vertex without edges
+    u64 vertex_count = matrix->dimension > source_vertex_id ? matrix->dimension : source_vertex_id + 1;
+
+    GphrxBfsResult result = {
+        .vertex_count = vertex_count,
+        .reached_count = 1,
+        .distances = malloc(sizeof(u64) * vertex_count),
+        .parents = malloc(sizeof(u64) * vertex_count),
+    };
+
+    assert(result.distances != 0 && result.parents != 0, "malloc failure");
+
+    memset(result.distances, 0xFF, sizeof(u64) * vertex_count);
+    memset(result.parents, 0xFF, sizeof(u64) * vertex_count);
+
+    result.distances[source_vertex_id] = 0;
+    result.parents[source_vertex_id] = source_vertex_id;
+
+    if (source_vertex_id >= matrix->dimension)
+        return result;
+
+    u32 thread_count = gphrx_get_num_threads();
+    u64 word_count = (vertex_count + 63) / 64;
+
+    BfsSearch search = {
+        .thread_count = thread_count,
+        .word_count = word_count,
+        .depth = 0,
+        .out_offsets = _gphrx_find_vertex_edge_offsets(matrix),
+        .out_edges = (u64*) matrix->row_indices.arr,
+        .in_offsets = 0,
+        .in_edges = 0,
+        .visited = calloc(word_count, sizeof(u64)),
+        .frontier = malloc(sizeof(u64) * vertex_count),
+        .frontier_bitmap = malloc(sizeof(u64) * word_count),
+        .next_bitmap = malloc(sizeof(u64) * word_count),
+        .distances = result.distances,
+        .parents = result.parents,
+        .threads = _gphrx_new_thread_states(sizeof(BfsThreadState), thread_count),
+    };
+
+    assert(search.visited != 0 && search.frontier != 0 && search.frontier_bitmap != 0 && search.next_bitmap != 0,
+           "malloc failure");
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        search.threads[i].next_frontier = new_dynarr_u64_with_capacity(64);
+        search.threads[i].awakened_count = 0;
+        search.threads[i].awakened_edge_count = 0;
+    }
+
+    // The bits past the last vertex are marked visited so that bottom-up levels skip them
+    if (vertex_count % 64 != 0)
+        atomic_store(search.visited + word_count - 1, ~(u64) 0 << (vertex_count % 64));
+
+    _gphrx_atomic_bitmap_set(search.visited, source_vertex_id);
+
+    search.frontier[0] = source_vertex_id;
+
+    u64 frontier_size = 1;
+    u64 frontier_edge_count = search.out_offsets[source_vertex_id + 1] - search.out_offsets[source_vertex_id];
+    u64 unvisited_edge_count = matrix->col_indices.size - frontier_edge_count;
+
+    bool is_bottom_up = false;
+
+    while (frontier_size != 0)
+    {
+        ++search.depth;
+
+        if (!is_bottom_up && frontier_edge_count > unvisited_edge_count / GPHRX_BFS_ALPHA)
+        {
+            is_bottom_up = true;
+
+            if (search.in_edges == 0)
+            {
+                if (graph->is_undirected)
+                {
+                    search.in_offsets = search.out_offsets;
+                    search.in_edges = search.out_edges;
+                }
+                else
+                {
+                    search.in_edges = _gphrx_find_vertex_in_edges(matrix, &search.in_offsets);
+                }
+            }
+
+            frontier_to_bitmap(&search, frontier_size);
+        }
+
+        u64 awakened_count;
+        u64 awakened_edge_count;
+
+        if (is_bottom_up)
+        {
+            _gphrx_parallel_for(0, word_count, BOTTOM_UP_GRAIN_SIZE, expand_bottom_up, &search);
+            collect_level_counts(&search, &awakened_count, &awakened_edge_count);
+
+            u64 *next_bitmap = search.next_bitmap;
+            search.next_bitmap = search.frontier_bitmap;
+            search.frontier_bitmap = next_bitmap;
+
+            // Stay bottom-up while the frontier is growing or still large
+            if (awakened_count < frontier_size && awakened_count < vertex_count / GPHRX_BFS_BETA)
+            {
+                is_bottom_up = false;
+                bitmap_to_frontier(&search);
+            }
+        }
+        else
+        {
+            _gphrx_parallel_for(0, frontier_size, TOP_DOWN_GRAIN_SIZE, expand_top_down, &search);
+            collect_level_counts(&search, &awakened_count, &awakened_edge_count);
+
+            gather_next_frontier(&search);
+        }
+
+        frontier_size = awakened_count;
+        frontier_edge_count = awakened_edge_count;
+        unvisited_edge_count -= awakened_edge_count;
+
+        result.reached_count += awakened_count;
+    }
+
+    for (u32 i = 0; i < thread_count; ++i)
+        free_dynarr_u64(&search.threads[i].next_frontier);
+
+    if (search.in_offsets != search.out_offsets)
+    {
+        free(search.in_offsets);
+        free(search.in_edges);
+    }
+
+    free(search.out_offsets);
+    free(search.visited);
+    free(search.frontier);
+    free(search.frontier_bitmap);
+    free(search.next_bitmap);
+    free(search.threads);
+
+    return result;
+}
+
+DLLEXPORT void free_gphrx_bfs_result(GphrxBfsResult *restrict result)
+{
+    free(result->distances);
+    free(result->parents);
+}
+
+
+#ifdef TEST_MODE
+
+// Checks a search's distances against a plain serial BFS, and that every parent is one edge closer to the
+// source along an edge of the graph
+static bool is_bfs_correct(GphrxGraph *restrict graph, GphrxBfsResult *restrict result, u64 source_vertex_id)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    size_t *offsets = _gphrx_find_vertex_edge_offsets(matrix);
+
+    u64 *expected = malloc(sizeof(u64) * result->vertex_count);
+    u64 *queue = malloc(sizeof(u64) * result->vertex_count);
+
+    memset(expected, 0xFF, sizeof(u64) * result->vertex_count);
+    expected[source_vertex_id] = 0;
+    queue[0] = source_vertex_id;
+
+    u64 queue_start = 0;
+    u64 queue_end = 1;
+
+    while (queue_start < queue_end)
+    {
+        u64 v = queue[queue_start++];
+
+        if (v >= matrix->dimension)
+            continue;
+
+        for (size_t edge = offsets[v]; edge < offsets[v + 1]; ++edge)
+        {
+            u64 w = dynarr8_get(&matrix->row_indices, edge).u64_val;
+
+            if (expected[w] == GPHRX_UNREACHED)
+            {
+                expected[w] = expected[v] + 1;
+                queue[queue_end++] = w;
+            }
+        }
+    }
+
+    bool is_correct = result->reached_count == queue_end;
+
+    for (u64 v = 0; v < result->vertex_count && is_correct; ++v)
+    {
+        is_correct = result->distances[v] == expected[v];
+
+        if (!is_correct || v == source_vertex_id || expected[v] == GPHRX_UNREACHED)
+        {
+            is_correct = is_correct && (v != source_vertex_id || result->parents[v] == v);
+            is_correct = is_correct && (expected[v] != GPHRX_UNREACHED || result->parents[v] == GPHRX_UNREACHED);
+            continue;
+        }
+
+        u64 parent = result->parents[v];
+
+        is_correct = parent < result->vertex_count &&
+            expected[parent] + 1 == expected[v] &&
+            gphrx_does_edge_exist(graph, parent, v);
+    }
+
+    free(offsets);
+    free(expected);
+    free(queue);
+
+    return is_correct;
+}
+
+static TEST_RESULT test_gphrx_bfs()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            // Dense enough that the middle levels run bottom-up
+            GphrxGraph graph = new_random_test_graph(is_undirected, 5000, 40000, 3 + is_undirected);
+
+            for (u64 source = 0; source < 5000; source += 1249)
+            {
+                GphrxBfsResult result = gphrx_bfs(&graph, source);
+
+                assert(result.vertex_count == graph.adjacency_matrix.dimension, "Incorrect vertex count");
+                assert(is_bfs_correct(&graph, &result, source), "Incorrect search");
+
+                free_gphrx_bfs_result(&result);
+            }
+
+            free_gphrx(&graph);
+
+            // Sparse enough that every level runs top-down, with unreachable vertices
+            graph = new_random_test_graph(is_undirected, 5000, 3000, 7 + is_undirected);
+
+            GphrxBfsResult result = gphrx_bfs(&graph, 1);
+            assert(is_bfs_correct(&graph, &result, 1), "Incorrect search");
+
+            free_gphrx_bfs_result(&result);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // A path is searched one vertex per level
+    GphrxGraph path = new_directed_gphrx();
+
+    for (u64 v = 0; v < 200; ++v)
+        gphrx_add_edge(&path, v, v + 1);
+
+    GphrxBfsResult result = gphrx_bfs(&path, 0);
+
+    assert(result.reached_count == 201, "Incorrect reached count");
+    assert(result.distances[200] == 200 && result.parents[200] == 199, "Incorrect search");
+
+    free_gphrx_bfs_result(&result);
+
+    // Searching against the edges' direction reaches nothing
+    result = gphrx_bfs(&path, 100);
+    assert(result.reached_count == 101 && result.distances[99] == GPHRX_UNREACHED, "Incorrect search");
+    free_gphrx_bfs_result(&result);
+
+    // A source past the end of the graph is an isolated vertex
+    result = gphrx_bfs(&path, 300);
+    assert(result.vertex_count == 301 && result.reached_count == 1, "Incorrect search");
+    assert(result.distances[300] == 0 && result.distances[0] == GPHRX_UNREACHED, "Incorrect search");
+    free_gphrx_bfs_result(&result);
+
+    free_gphrx(&path);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_bfs_on_approximation()
+{
+    GphrxGraph graph = new_random_test_graph(true, 1000, 20000, 11);
+    GphrxGraph approx_graph = approximate_gphrx(&graph, 10, 0.01);
+
+    GphrxBfsResult result = gphrx_bfs(&graph, 5);
+    GphrxBfsResult approx_result = gphrx_bfs(&approx_graph, 5 / 10);
+
+    assert(approx_result.vertex_count == approx_graph.adjacency_matrix.dimension, "Incorrect vertex count");
+    assert(is_bfs_correct(&approx_graph, &approx_result, 0), "Incorrect search");
+
+    // Every edge in the graph falls in a block that is kept at this threshold, so a vertex's block is never
+    // further from the source's block than the vertex is from the source
+    for (u64 v = 0; v < result.vertex_count; ++v)
+    {
+        if (result.distances[v] != GPHRX_UNREACHED)
+        {
+            assert(approx_result.distances[v / 10] <= result.distances[v], "Incorrect search");
+        }
+    }
+
+    free_gphrx_bfs_result(&result);
+    free_gphrx_bfs_result(&approx_result);
+    free_gphrx(&graph);
+    free_gphrx(&approx_graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet bfs_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_bfs);
+    register_test(&set, test_gphrx_bfs_on_approximation);
+
+    return set;
+}
+
+#endif
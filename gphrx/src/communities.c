@@ -0,0 +1,1241 @@
+#include "communities.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "dynarray.h"
+#include "sort.h"
+#include "threadpool.h"
+
+// Edges per range of a pass over the vertices or communities, vertices per range of the modularity sum,
+// and edges per range when renaming a graph's edges
+#define EDGE_GRAIN_COST 4096
+#define MODULARITY_GRAIN_SIZE 16384
+#define RENAME_GRAIN_SIZE 16384
+
+DLLEXPORT GphrxCommunitiesOptions gphrx_default_communities_options()
+{
+    GphrxCommunitiesOptions options = {
+        .max_iterations = GPHRX_COMMUNITIES_DEFAULT_MAX_ITERATIONS,
+        .tolerance = GPHRX_COMMUNITIES_DEFAULT_TOLERANCE,
+        .refine_with_louvain = false,
+        .max_louvain_levels = GPHRX_COMMUNITIES_DEFAULT_MAX_LOUVAIN_LEVELS,
+    };
+
+    return options;
+}
+
+// An undirected graph with weighted edges, each stored in the lists of both of its vertices (a self-loop
+// is stored once). The first level is the graph being searched, with the direction of its edges dropped and
+// every edge weighing one; each Louvain level after it has a vertex for every community of the level before,
+// with edges weighing the total weight of the edges between the two communities.
+typedef struct {
+    u64 vertex_count;
+    size_t *offsets;
+    u64 *neighbors;
+
+    // Null if every edge weighs one
+    u64 *weights;
+
+    // Total weight of each vertex's edges, and the total over all vertices (twice the total edge weight)
+    u64 *degrees;
+    u64 total_degree;
+
+    // The first level of an undirected graph borrows the graph's lists
+    bool owns_neighbors;
+} CommunityGraph;
+
+typedef struct {
+    // Total weight of the current vertex's edges into each community, zero for those not in `touched`
+    GPHRX_CACHE_ALIGNED u64 *community_weights;
+    DynamicArrayU64 touched;
+
+    u64 moved_count;
+} CommunityThreadState;
+
+typedef struct {
+    u32 thread_count;
+    CommunityGraph *graph;
+
+    // Community of each vertex of the current level. Passes update these in place, so threads read each
+    // other's moves as they go.
+    _Atomic u64 *labels;
+
+    // Vertices to visit in the current pass: those that haven't been visited yet, or that had a neighbour
+    // move since they were last visited
+    _Atomic u64 *active;
+
+    // Total degree of the vertices in each community, for the Louvain method
+    _Atomic u64 *community_degrees;
+
+    CommunityThreadState *threads;
+} CommunitySearch;
+
+typedef void (*CommunityMoveFunc)(CommunitySearch *restrict search, CommunityThreadState *restrict state, u64 v);
+
+// Sums the weights of a vertex's edges into each community, ignoring self-loops
+static void add_neighbor_weights(CommunitySearch *restrict search, CommunityThreadState *restrict state, u64 v)
+{
+    CommunityGraph *graph = search->graph;
+
+    for (size_t edge = graph->offsets[v]; edge < graph->offsets[v + 1]; ++edge)
+    {
+        u64 u = graph->neighbors[edge];
+
+        if (u == v)
+            continue;
+
+        u64 label = atomic_load_explicit(search->labels + u, memory_order_relaxed);
+
+        if (state->community_weights[label] == 0)
+            dynarr_u64_push(&state->touched, label);
+
+        state->community_weights[label] += graph->weights != 0 ? graph->weights[edge] : 1;
+    }
+}
+
+static void clear_neighbor_weights(CommunityThreadState *restrict state)
+{
+    for (size_t i = 0; i < state->touched.size; ++i)
+        state->community_weights[state->touched.arr[i]] = 0;
+
+    state->touched.size = 0;
+}
+
+static void move_vertex(CommunitySearch *restrict search, CommunityThreadState *restrict state, u64 v, u64 label)
+{
+    CommunityGraph *graph = search->graph;
+
+    atomic_store_explicit(search->labels + v, label, memory_order_relaxed);
+    ++state->moved_count;
+
+    for (size_t edge = graph->offsets[v]; edge < graph->offsets[v + 1]; ++edge)
+    {
+        u64 u = graph->neighbors[edge];
+        _gphrx_atomic_bitmap_set(search->active, u);
+    }
+}
+
+static u64 splitmix64(u64 value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Label propagation: moves the vertex to the community most of its edge weight leads to
+static void propagate_label(CommunitySearch *restrict search, CommunityThreadState *restrict state, u64 v)
+{
+    add_neighbor_weights(search, state, v);
+
+    u64 label = atomic_load_explicit(search->labels + v, memory_order_relaxed);
+    u64 best_label = label;
+    u64 best_weight = state->community_weights[label];
+    u64 best_key = UINT64_MAX;
+
+    // Ties between other communities go to the lowest of a hash of the label that differs from vertex to
+    // vertex. Preferring the lowest label outright would let the first labels flood across the few edges
+    // between communities while nearly every vertex is still tied between its neighbours' labels.
+    u64 vertex_key = splitmix64(v);
+
+    for (size_t i = 0; i < state->touched.size; ++i)
+    {
+        u64 candidate = state->touched.arr[i];
+        u64 weight = state->community_weights[candidate];
+
+        if (weight < best_weight || candidate == label)
+            continue;
+
+        u64 key = splitmix64(candidate ^ vertex_key);
+
+        if (weight > best_weight || (best_label != label && key < best_key))
+        {
+            best_label = candidate;
+            best_weight = weight;
+            best_key = key;
+        }
+    }
+
+    clear_neighbor_weights(state);
+
+    if (best_label != label)
+        move_vertex(search, state, v, best_label);
+}
+
+// The Louvain method: moves the vertex to the neighbouring community that raises the modularity the most.
+// Moving v from its community into community c raises it in proportion to
+//
+//     k_v,c - k_v * sum_c / 2m
+//
+// where k_v,c is the weight of v's edges into c, k_v is v's degree, sum_c is the total degree of c's
+// vertices (less v's own, for v's community) and 2m is the total degree of the graph.
+static void move_to_best_community(CommunitySearch *restrict search, CommunityThreadState *restrict state, u64 v)
+{
+    CommunityGraph *graph = search->graph;
+
+    add_neighbor_weights(search, state, v);
+
+    double degree = (double) graph->degrees[v];
+    double degree_scale = degree / (double) graph->total_degree;
+
+    u64 label = atomic_load_explicit(search->labels + v, memory_order_relaxed);
+    u64 label_degree = atomic_load_explicit(search->community_degrees + label, memory_order_relaxed);
+
+    u64 best_label = label;
+    double best_gain = (double) state->community_weights[label] - degree_scale * ((double) label_degree - degree);
+
+    for (size_t i = 0; i < state->touched.size; ++i)
+    {
+        u64 candidate = state->touched.arr[i];
+
+        if (candidate == label)
+            continue;
+
+        u64 candidate_degree = atomic_load_explicit(search->community_degrees + candidate, memory_order_relaxed);
+        double gain = (double) state->community_weights[candidate] - degree_scale * (double) candidate_degree;
+
+        if (gain > best_gain)
+        {
+            best_label = candidate;
+            best_gain = gain;
+        }
+    }
+
+    clear_neighbor_weights(state);
+
+    if (best_label != label)
+    {
+        atomic_fetch_sub_explicit(search->community_degrees + label, graph->degrees[v], memory_order_relaxed);
+        atomic_fetch_add_explicit(search->community_degrees + best_label, graph->degrees[v], memory_order_relaxed);
+
+        move_vertex(search, state, v, best_label);
+    }
+}
+
+typedef struct {
+    CommunitySearch *search;
+    CommunityMoveFunc move;
+} CommunityPass;
+
+static void run_pass_range(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    CommunityPass *pass = context;
+    CommunitySearch *search = pass->search;
+    CommunityThreadState *state = search->threads + thread_idx;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        if (!_gphrx_atomic_bitmap_test(search->active, v))
+            continue;
+
+        _gphrx_atomic_bitmap_clear(search->active, v);
+        pass->move(search, state, v);
+    }
+}
+
+// Runs passes of `move` over the current level until few enough vertices move, returning the number of
+// passes made. `moved_count` is set to the number of moves made over all of the passes.
+static u32 run_passes(CommunitySearch *restrict search,
+                      CommunityMoveFunc move,
+                      GphrxCommunitiesOptions *restrict options,
+                      u64 *moved_count)
+{
+    CommunityGraph *graph = search->graph;
+    u64 word_count = (graph->vertex_count + 63) / 64;
+
+    for (u64 word = 0; word < word_count; ++word)
+        atomic_store_explicit(search->active + word, ~(u64) 0, memory_order_relaxed);
+
+    // The bits past the last vertex are left clear so that they are never visited
+    if (graph->vertex_count % 64 != 0)
+        atomic_store_explicit(search->active + word_count - 1,
+                              ~(~(u64) 0 << (graph->vertex_count % 64)),
+                              memory_order_relaxed);
+
+    CommunityPass pass = {
+        .search = search,
+        .move = move,
+    };
+
+    u32 pass_count = 0;
+    *moved_count = 0;
+
+    while (pass_count < options->max_iterations)
+    {
+        _gphrx_parallel_for_balanced(0, graph->vertex_count, graph->offsets, EDGE_GRAIN_COST, run_pass_range, &pass);
+        ++pass_count;
+
+        u64 pass_moved_count = 0;
+
+        for (u32 i = 0; i < search->thread_count; ++i)
+        {
+            pass_moved_count += search->threads[i].moved_count;
+            search->threads[i].moved_count = 0;
+        }
+
+        *moved_count += pass_moved_count;
+
+        if ((double) pass_moved_count <= options->tolerance * (double) graph->vertex_count)
+            break;
+    }
+
+    return pass_count;
+}
+
+// Renumbers the labels from zero in order of their lowest vertex, returning the number of distinct labels.
+// `renumbering` is scratch space for a label per vertex.
+static u64 renumber_labels(_Atomic u64 *labels, u64 vertex_count, u64 *renumbering)
+{
+    memset(renumbering, 0xFF, sizeof(u64) * vertex_count);
+
+    u64 label_count = 0;
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        u64 label = atomic_load_explicit(labels + v, memory_order_relaxed);
+
+        if (renumbering[label] == UINT64_MAX)
+            renumbering[label] = label_count++;
+
+        atomic_store_explicit(labels + v, renumbering[label], memory_order_relaxed);
+    }
+
+    return label_count;
+}
+
+static void find_degrees(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    CommunityGraph *graph = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        if (graph->weights == 0)
+        {
+            graph->degrees[v] = graph->offsets[v + 1] - graph->offsets[v];
+            continue;
+        }
+
+        u64 degree = 0;
+
+        for (size_t edge = graph->offsets[v]; edge < graph->offsets[v + 1]; ++edge)
+            degree += graph->weights[edge];
+
+        graph->degrees[v] = degree;
+    }
+}
+
+static void find_total_degree(CommunityGraph *restrict graph)
+{
+    graph->degrees = malloc(sizeof(u64) * (graph->vertex_count + 1));
+    assert(graph->degrees != 0, "malloc failure");
+
+    _gphrx_parallel_for_balanced(0, graph->vertex_count, graph->offsets, EDGE_GRAIN_COST, find_degrees, graph);
+
+    graph->total_degree = 0;
+
+    for (u64 v = 0; v < graph->vertex_count; ++v)
+        graph->total_degree += graph->degrees[v];
+}
+
+typedef struct {
+    size_t *out_offsets;
+    u64 *out_edges;
+    size_t *in_offsets;
+    u64 *in_edges;
+    CommunityGraph *graph;
+} UndirectedCopy;
+
+static void copy_undirected_lists(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    UndirectedCopy *copy = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        size_t out_count = copy->out_offsets[v + 1] - copy->out_offsets[v];
+        size_t in_count = copy->in_offsets[v + 1] - copy->in_offsets[v];
+        u64 *neighbors = copy->graph->neighbors + copy->graph->offsets[v];
+
+        memcpy(neighbors, copy->out_edges + copy->out_offsets[v], sizeof(u64) * out_count);
+        memcpy(neighbors + out_count, copy->in_edges + copy->in_offsets[v], sizeof(u64) * in_count);
+    }
+}
+
+// The first level: the graph with the direction of its edges dropped. A directed graph's lists are merged
+// with its transpose's, so an edge in each direction between two vertices counts twice.
+static CommunityGraph new_first_level(GphrxGraph *restrict graph)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+
+    CommunityGraph level = {
+        .vertex_count = matrix->dimension,
+        .offsets = _gphrx_find_vertex_edge_offsets(matrix),
+        .neighbors = (u64*) matrix->row_indices.arr,
+        .weights = 0,
+        .owns_neighbors = false,
+    };
+
+    if (!graph->is_undirected)
+    {
+        size_t *in_offsets;
+        u64 *in_edges = _gphrx_find_vertex_in_edges(matrix, &in_offsets);
+
+        UndirectedCopy copy = {
+            .out_offsets = level.offsets,
+            .out_edges = level.neighbors,
+            .in_offsets = in_offsets,
+            .in_edges = in_edges,
+            .graph = &level,
+        };
+
+        level.offsets = malloc(sizeof(size_t) * (level.vertex_count + 1));
+        level.neighbors = malloc(sizeof(u64) * (matrix->col_indices.size * 2 + 1));
+        level.owns_neighbors = true;
+
+        assert(level.offsets != 0 && level.neighbors != 0, "malloc failure");
+
+        for (u64 v = 0; v <= level.vertex_count; ++v)
+            level.offsets[v] = copy.out_offsets[v] + copy.in_offsets[v];
+
+        _gphrx_parallel_for_balanced(0, level.vertex_count, level.offsets, EDGE_GRAIN_COST, copy_undirected_lists, &copy);
+
+        free(copy.out_offsets);
+        free(copy.in_offsets);
+        free(copy.in_edges);
+    }
+
+    find_total_degree(&level);
+
+    return level;
+}
+
+static void free_level(CommunityGraph *restrict level)
+{
+    free(level->offsets);
+    free(level->weights);
+    free(level->degrees);
+
+    if (level->owns_neighbors)
+        free(level->neighbors);
+}
+
+typedef struct {
+    CommunitySearch *search;
+
+    // The vertices of each community, and a bound on how many distinct neighbouring communities each has
+    // (the number of its vertices' edges), at which each community's list is first written
+    u64 *member_offsets;
+    u64 *members;
+    size_t *bound_offsets;
+
+    u64 *bounded_neighbors;
+    u64 *bounded_weights;
+    size_t *neighbor_counts;
+
+    CommunityGraph *next_level;
+} LevelAggregation;
+
+static void aggregate_communities(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    LevelAggregation *aggregation = context;
+    CommunitySearch *search = aggregation->search;
+    CommunityGraph *graph = search->graph;
+    CommunityThreadState *state = search->threads + thread_idx;
+
+    for (size_t c = start; c < end; ++c)
+    {
+        for (u64 i = aggregation->member_offsets[c]; i < aggregation->member_offsets[c + 1]; ++i)
+        {
+            u64 v = aggregation->members[i];
+
+            // Edges within the community, including self-loops, become its self-loop
+            for (size_t edge = graph->offsets[v]; edge < graph->offsets[v + 1]; ++edge)
+            {
+                u64 label = atomic_load_explicit(search->labels + graph->neighbors[edge], memory_order_relaxed);
+
+                if (state->community_weights[label] == 0)
+                    dynarr_u64_push(&state->touched, label);
+
+                state->community_weights[label] += graph->weights != 0 ? graph->weights[edge] : 1;
+            }
+        }
+
+        size_t list_start = aggregation->bound_offsets[c];
+
+        for (size_t i = 0; i < state->touched.size; ++i)
+        {
+            aggregation->bounded_neighbors[list_start + i] = state->touched.arr[i];
+            aggregation->bounded_weights[list_start + i] = state->community_weights[state->touched.arr[i]];
+        }
+
+        aggregation->neighbor_counts[c] = state->touched.size;
+
+        clear_neighbor_weights(state);
+    }
+}
+
+static void copy_aggregated_lists(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    LevelAggregation *aggregation = context;
+    CommunityGraph *next_level = aggregation->next_level;
+
+    for (size_t c = start; c < end; ++c)
+    {
+        size_t count = next_level->offsets[c + 1] - next_level->offsets[c];
+
+        memcpy(next_level->neighbors + next_level->offsets[c],
+               aggregation->bounded_neighbors + aggregation->bound_offsets[c],
+               sizeof(u64) * count);
+        memcpy(next_level->weights + next_level->offsets[c],
+               aggregation->bounded_weights + aggregation->bound_offsets[c],
+               sizeof(u64) * count);
+    }
+}
+
+// Merges the vertices of each of the current level's communities (whose labels run from zero to
+// `community_count`) into one vertex of a new level
+static CommunityGraph aggregate_level(CommunitySearch *restrict search, u64 community_count)
+{
+    CommunityGraph *graph = search->graph;
+
+    LevelAggregation aggregation = {
+        .search = search,
+        .member_offsets = calloc(community_count + 1, sizeof(u64)),
+        .members = malloc(sizeof(u64) * (graph->vertex_count + 1)),
+        .bound_offsets = calloc(community_count + 1, sizeof(size_t)),
+        .neighbor_counts = malloc(sizeof(size_t) * (community_count + 1)),
+    };
+
+    assert(aggregation.member_offsets != 0 && aggregation.members != 0, "malloc failure");
+    assert(aggregation.bound_offsets != 0 && aggregation.neighbor_counts != 0, "malloc failure");
+
+    for (u64 v = 0; v < graph->vertex_count; ++v)
+    {
+        u64 label = atomic_load_explicit(search->labels + v, memory_order_relaxed);
+
+        ++aggregation.member_offsets[label + 1];
+        aggregation.bound_offsets[label + 1] += graph->offsets[v + 1] - graph->offsets[v];
+    }
+
+    for (u64 c = 0; c < community_count; ++c)
+    {
+        aggregation.member_offsets[c + 1] += aggregation.member_offsets[c];
+        aggregation.bound_offsets[c + 1] += aggregation.bound_offsets[c];
+    }
+
+    // Counting sort of the vertices by community, with `neighbor_counts` as the write positions
+    memcpy(aggregation.neighbor_counts, aggregation.member_offsets, sizeof(u64) * community_count);
+
+    for (u64 v = 0; v < graph->vertex_count; ++v)
+    {
+        u64 label = atomic_load_explicit(search->labels + v, memory_order_relaxed);
+        aggregation.members[aggregation.neighbor_counts[label]++] = v;
+    }
+
+    size_t bound = aggregation.bound_offsets[community_count];
+
+    aggregation.bounded_neighbors = malloc(sizeof(u64) * (bound + 1));
+    aggregation.bounded_weights = malloc(sizeof(u64) * (bound + 1));
+
+    assert(aggregation.bounded_neighbors != 0 && aggregation.bounded_weights != 0, "malloc failure");
+
+    _gphrx_parallel_for_balanced(0,
+                                 community_count,
+                                 aggregation.bound_offsets,
+                                 EDGE_GRAIN_COST,
+                                 aggregate_communities,
+                                 &aggregation);
+
+    CommunityGraph next_level = {
+        .vertex_count = community_count,
+        .offsets = malloc(sizeof(size_t) * (community_count + 1)),
+        .owns_neighbors = true,
+    };
+
+    assert(next_level.offsets != 0, "malloc failure");
+
+    next_level.offsets[0] = 0;
+
+    for (u64 c = 0; c < community_count; ++c)
+        next_level.offsets[c + 1] = next_level.offsets[c] + aggregation.neighbor_counts[c];
+
+    next_level.neighbors = malloc(sizeof(u64) * (next_level.offsets[community_count] + 1));
+    next_level.weights = malloc(sizeof(u64) * (next_level.offsets[community_count] + 1));
+
+    assert(next_level.neighbors != 0 && next_level.weights != 0, "malloc failure");
+
+    aggregation.next_level = &next_level;
+
+    _gphrx_parallel_for_balanced(0,
+                                 community_count,
+                                 next_level.offsets,
+                                 EDGE_GRAIN_COST,
+                                 copy_aggregated_lists,
+                                 &aggregation);
+
+    find_total_degree(&next_level);
+
+    free(aggregation.member_offsets);
+    free(aggregation.members);
+    free(aggregation.bound_offsets);
+    free(aggregation.neighbor_counts);
+    free(aggregation.bounded_neighbors);
+    free(aggregation.bounded_weights);
+
+    return next_level;
+}
+
+// Refines the labels of the first level, which must be numbered from zero to `community_count`, with the
+// Louvain method. Returns the number of communities after refinement.
+static u64 refine_with_louvain(CommunitySearch *restrict search,
+                               GphrxCommunitiesOptions *restrict options,
+                               u64 community_count,
+                               u64 *restrict renumbering,
+                               u32 *restrict level_count)
+{
+    CommunityGraph *first_level = search->graph;
+    u64 vertex_count = first_level->vertex_count;
+
+    // The first level's labels stay in `labels`, and each later level's go in `level_labels`
+    _Atomic u64 *labels = search->labels;
+    _Atomic u64 *level_labels = malloc(sizeof(u64) * (vertex_count + 1));
+
+    assert(level_labels != 0, "malloc failure");
+
+    CommunityGraph level = *first_level;
+    bool is_first_level = true;
+
+    *level_count = 0;
+
+    while (*level_count < options->max_louvain_levels)
+    {
+        for (u64 c = 0; c < level.vertex_count; ++c)
+            atomic_store_explicit(search->community_degrees + c, 0, memory_order_relaxed);
+
+        for (u64 v = 0; v < level.vertex_count; ++v)
+        {
+            u64 label = atomic_load_explicit(search->labels + v, memory_order_relaxed);
+            atomic_fetch_add_explicit(search->community_degrees + label, level.degrees[v], memory_order_relaxed);
+        }
+
+        search->graph = &level;
+
+        u64 moved_count;
+        run_passes(search, move_to_best_community, options, &moved_count);
+
+        ++*level_count;
+
+        // A later level that moves nothing leaves every community as it was
+        if (moved_count == 0 && !is_first_level)
+            break;
+
+        u64 level_community_count = renumber_labels(search->labels, level.vertex_count, renumbering);
+
+        if (!is_first_level)
+        {
+            for (u64 v = 0; v < vertex_count; ++v)
+            {
+                u64 label = atomic_load_explicit(labels + v, memory_order_relaxed);
+                u64 merged_label = atomic_load_explicit(level_labels + label, memory_order_relaxed);
+
+                atomic_store_explicit(labels + v, merged_label, memory_order_relaxed);
+            }
+        }
+
+        community_count = level_community_count;
+
+        if (community_count == level.vertex_count && !is_first_level)
+            break;
+
+        CommunityGraph next_level = aggregate_level(search, community_count);
+
+        if (!is_first_level)
+            free_level(&level);
+
+        level = next_level;
+        is_first_level = false;
+
+        // Each community of the new level starts on its own
+        search->labels = level_labels;
+
+        for (u64 c = 0; c < community_count; ++c)
+            atomic_store_explicit(level_labels + c, c, memory_order_relaxed);
+    }
+
+    if (!is_first_level)
+        free_level(&level);
+
+    free(level_labels);
+
+    search->graph = first_level;
+    search->labels = labels;
+
+    return community_count;
+}
+
+typedef struct {
+    CommunityGraph *graph;
+    _Atomic u64 *labels;
+} ModularitySum;
+
+static void sum_internal_weights(void *context, size_t start, size_t end, void *partial)
+{
+    ModularitySum *sum = context;
+    u64 *internal_weight = partial;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        u64 label = atomic_load_explicit(sum->labels + v, memory_order_relaxed);
+
+        for (size_t edge = sum->graph->offsets[v]; edge < sum->graph->offsets[v + 1]; ++edge)
+        {
+            u64 u = sum->graph->neighbors[edge];
+            *internal_weight += atomic_load_explicit(sum->labels + u, memory_order_relaxed) == label;
+        }
+    }
+}
+
+static void add_weights(void *context, void *accumulator, void *partial)
+{
+    *(u64*) accumulator += *(u64*) partial;
+}
+
+// Modularity of the first level's labels, which must be numbered from zero to `community_count`
+static double find_modularity(CommunitySearch *restrict search, u64 community_count)
+{
+    CommunityGraph *graph = search->graph;
+
+    if (graph->total_degree == 0)
+        return 0.0;
+
+    ModularitySum sum = {
+        .graph = graph,
+        .labels = search->labels,
+    };
+
+    u64 internal_weight = 0;
+
+    _gphrx_parallel_reduce(0,
+                           graph->vertex_count,
+                           MODULARITY_GRAIN_SIZE,
+                           &internal_weight,
+                           sizeof(u64),
+                           sum_internal_weights,
+                           add_weights,
+                           &sum);
+
+    u64 *community_degrees = calloc(community_count + 1, sizeof(u64));
+    assert(community_degrees != 0, "calloc failure");
+
+    for (u64 v = 0; v < graph->vertex_count; ++v)
+        community_degrees[atomic_load_explicit(search->labels + v, memory_order_relaxed)] += graph->degrees[v];
+
+    double total_degree = (double) graph->total_degree;
+    double expected_weight = 0.0;
+
+    for (u64 c = 0; c < community_count; ++c)
+        expected_weight += ((double) community_degrees[c] / total_degree) * ((double) community_degrees[c] / total_degree);
+
+    free(community_degrees);
+
+    return (double) internal_weight / total_degree - expected_weight;
+}
+
+DLLEXPORT GphrxCommunitiesResult gphrx_find_communities(GphrxGraph *restrict graph,
+                                                        GphrxCommunitiesOptions *restrict options)
+{
+    GphrxCommunitiesOptions default_options = gphrx_default_communities_options();
+
+    if (options == 0)
+        options = &default_options;
+
+    u32 thread_count = gphrx_get_num_threads();
+
+    CommunityGraph first_level = new_first_level(graph);
+    u64 vertex_count = first_level.vertex_count;
+
+    CommunitySearch search = {
+        .thread_count = thread_count,
+        .graph = &first_level,
+        .labels = malloc(sizeof(u64) * (vertex_count + 1)),
+        .active = malloc(sizeof(u64) * ((vertex_count + 63) / 64 + 1)),
+        .community_degrees = 0,
+        .threads = _gphrx_new_thread_states(sizeof(CommunityThreadState), thread_count),
+    };
+
+    assert(search.labels != 0 && search.active != 0, "malloc failure");
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        search.threads[i].community_weights = calloc(vertex_count + 1, sizeof(u64));
+        search.threads[i].touched = new_dynarr_u64_with_capacity(64);
+        search.threads[i].moved_count = 0;
+
+        assert(search.threads[i].community_weights != 0, "calloc failure");
+    }
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        atomic_init(search.labels + v, v);
+
+    GphrxCommunitiesResult result = {
+        .vertex_count = vertex_count,
+        .community_count = 0,
+        .modularity = 0.0,
+        .iteration_count = 0,
+        .louvain_level_count = 0,
+    };
+
+    u64 moved_count;
+    result.iteration_count = run_passes(&search, propagate_label, options, &moved_count);
+
+    u64 *renumbering = malloc(sizeof(u64) * (vertex_count + 1));
+    assert(renumbering != 0, "malloc failure");
+
+    result.community_count = renumber_labels(search.labels, vertex_count, renumbering);
+
+    if (options->refine_with_louvain && first_level.total_degree != 0)
+    {
+        search.community_degrees = malloc(sizeof(u64) * (vertex_count + 1));
+        assert(search.community_degrees != 0, "malloc failure");
+
+        refine_with_louvain(&search, options, result.community_count, renumbering, &result.louvain_level_count);
+
+        // Communities are numbered by their lowest vertex in the first level, not in the last
+        result.community_count = renumber_labels(search.labels, vertex_count, renumbering);
+
+        free(search.community_degrees);
+    }
+
+    result.modularity = find_modularity(&search, result.community_count);
+
+    // The labels array is handed over to the result
+    result.labels = (u64*) search.labels;
+    result.sizes = calloc(result.community_count + 1, sizeof(u64));
+    result.permutation = malloc(sizeof(u64) * (vertex_count + 1));
+
+    assert(result.sizes != 0 && result.permutation != 0, "malloc failure");
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        ++result.sizes[result.labels[v]];
+
+    // `renumbering` now holds the first new ID of each community
+    u64 next_id = 0;
+
+    for (u64 c = 0; c < result.community_count; ++c)
+    {
+        renumbering[c] = next_id;
+        next_id += result.sizes[c];
+    }
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        result.permutation[v] = renumbering[result.labels[v]]++;
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        free(search.threads[i].community_weights);
+        free_dynarr_u64(&search.threads[i].touched);
+    }
+
+    free_level(&first_level);
+
+    free(search.active);
+    free(search.threads);
+    free(renumbering);
+
+    return result;
+}
+
+DLLEXPORT void free_gphrx_communities_result(GphrxCommunitiesResult *restrict result)
+{
+    free(result->labels);
+    free(result->sizes);
+    free(result->permutation);
+}
+
+typedef struct {
+    u64 *permutation;
+    u64 *col_indices;
+    u64 *row_indices;
+    u64 *renamed_col_indices;
+    u64 *renamed_row_indices;
+} EdgeRenaming;
+
+static void rename_edges(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    EdgeRenaming *renaming = context;
+
+    for (size_t edge = start; edge < end; ++edge)
+    {
+        renaming->renamed_col_indices[edge] = renaming->permutation[renaming->col_indices[edge]];
+        renaming->renamed_row_indices[edge] = renaming->permutation[renaming->row_indices[edge]];
+    }
+}
+
+DLLEXPORT GphrxGraph gphrx_permute_vertices(GphrxGraph *restrict graph, u64 *restrict permutation)
+{
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+
+    GphrxGraph permuted_graph = {
+        .is_undirected = graph->is_undirected,
+        .adjacency_matrix = {
+            .dimension = graph->adjacency_matrix.dimension,
+            .col_indices = new_dynarr8_with_capacity(edge_count + 1),
+            .row_indices = new_dynarr8_with_capacity(edge_count + 1),
+        },
+    };
+
+    EdgeRenaming renaming = {
+        .permutation = permutation,
+        .col_indices = (u64*) graph->adjacency_matrix.col_indices.arr,
+        .row_indices = (u64*) graph->adjacency_matrix.row_indices.arr,
+        .renamed_col_indices = (u64*) permuted_graph.adjacency_matrix.col_indices.arr,
+        .renamed_row_indices = (u64*) permuted_graph.adjacency_matrix.row_indices.arr,
+    };
+
+    _gphrx_parallel_for(0, edge_count, RENAME_GRAIN_SIZE, rename_edges, &renaming);
+
+    gphrx_sort_edges(renaming.renamed_col_indices, renaming.renamed_row_indices, edge_count);
+
+    permuted_graph.adjacency_matrix.col_indices.size = edge_count;
+    permuted_graph.adjacency_matrix.row_indices.size = edge_count;
+
+    return permuted_graph;
+}
+
+
+#ifdef TEST_MODE
+
+// Groups of `group_size` consecutive vertices, with each pair in a group joined with the given probability
+// (in percent) and `bridge_count` random edges between groups. The groups are shuffled across the vertex
+// IDs by multiplying by a number coprime to the vertex count.
+static GphrxGraph new_planted_test_graph(bool is_undirected,
+                                         u64 group_count,
+                                         u64 group_size,
+                                         u64 percent,
+                                         u64 bridge_count,
+                                         u64 seed)
+{
+    GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+    u64 vertex_count = group_count * group_size;
+
+    DynamicArrayU64 from_vertex_ids = new_dynarr_u64_with_capacity(64);
+    DynamicArrayU64 to_vertex_ids = new_dynarr_u64_with_capacity(64);
+
+    u64 rng_state = seed;
+
+    for (u64 group = 0; group < group_count; ++group)
+    {
+        for (u64 i = 0; i < group_size; ++i)
+        {
+            for (u64 j = i + 1; j < group_size; ++j)
+            {
+                if (test_random(&rng_state) % 100 >= percent)
+                    continue;
+
+                dynarr_u64_push(&from_vertex_ids, (group * group_size + i) * 7 % vertex_count);
+                dynarr_u64_push(&to_vertex_ids, (group * group_size + j) * 7 % vertex_count);
+            }
+        }
+    }
+
+    for (u64 i = 0; i < bridge_count; ++i)
+    {
+        dynarr_u64_push(&from_vertex_ids, test_random(&rng_state) % vertex_count);
+        dynarr_u64_push(&to_vertex_ids, test_random(&rng_state) % vertex_count);
+    }
+
+    gphrx_add_edges(&graph, from_vertex_ids.arr, to_vertex_ids.arr, from_vertex_ids.size);
+
+    free_dynarr_u64(&from_vertex_ids);
+    free_dynarr_u64(&to_vertex_ids);
+
+    return graph;
+}
+
+// The planted group of vertex v in a graph from `new_planted_test_graph`
+static u64 planted_group(u64 v, u64 group_size, u64 vertex_count)
+{
+    // 7 * 7^-1 = 1 modulo any vertex count coprime to 7
+    for (u64 inverse = 1; inverse < vertex_count; ++inverse)
+    {
+        if (inverse * 7 % vertex_count == 1)
+            return v * inverse % vertex_count / group_size;
+    }
+
+    return 0;
+}
+
+// Checks the numbering, sizes and permutation of a result, and its modularity against a plain serial sum
+static bool is_communities_result_consistent(GphrxGraph *restrict graph, GphrxCommunitiesResult *restrict result)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+
+    if (result->vertex_count != matrix->dimension)
+        return false;
+
+    u64 *sizes = calloc(result->vertex_count + 1, sizeof(u64));
+    u64 *first_ids = malloc(sizeof(u64) * (result->vertex_count + 1));
+    u64 *community_degrees = calloc(result->vertex_count + 1, sizeof(u64));
+
+    u64 community_count = 0;
+    bool is_consistent = true;
+
+    // Communities are numbered by their lowest vertex
+    for (u64 v = 0; v < result->vertex_count && is_consistent; ++v)
+    {
+        u64 label = result->labels[v];
+
+        is_consistent = label < result->community_count && label <= community_count;
+        community_count += label == community_count;
+
+        ++sizes[label];
+    }
+
+    is_consistent = is_consistent && community_count == result->community_count;
+
+    for (u64 c = 0, next_id = 0; c < community_count && is_consistent; ++c)
+    {
+        is_consistent = sizes[c] == result->sizes[c];
+        first_ids[c] = next_id;
+        next_id += sizes[c];
+    }
+
+    // Each community's vertices get consecutive new IDs, in order
+    for (u64 v = 0; v < result->vertex_count && is_consistent; ++v)
+        is_consistent = result->permutation[v] == first_ids[result->labels[v]]++;
+
+    // Modularity, with every edge counted at both ends (and a directed graph's edges in both directions)
+    u64 internal_weight = 0;
+    u64 total_degree = 0;
+
+    for (size_t edge = 0; edge < matrix->col_indices.size && is_consistent; ++edge)
+    {
+        u64 from_vertex_id = dynarr8_get(&matrix->col_indices, edge).u64_val;
+        u64 to_vertex_id = dynarr8_get(&matrix->row_indices, edge).u64_val;
+        u64 weight = graph->is_undirected ? 1 : 2;
+
+        // An undirected graph already stores each edge at both ends
+        community_degrees[result->labels[from_vertex_id]] += 1;
+        community_degrees[result->labels[to_vertex_id]] += weight - 1;
+        total_degree += weight;
+
+        if (result->labels[from_vertex_id] == result->labels[to_vertex_id])
+            internal_weight += weight;
+    }
+
+    double expected_modularity = 0.0;
+
+    if (total_degree != 0)
+    {
+        expected_modularity = (double) internal_weight / (double) total_degree;
+
+        for (u64 c = 0; c < community_count; ++c)
+        {
+            double share = (double) community_degrees[c] / (double) total_degree;
+            expected_modularity -= share * share;
+        }
+    }
+
+    is_consistent = is_consistent && fabs(result->modularity - expected_modularity) < 1e-9;
+
+    free(sizes);
+    free(first_ids);
+    free(community_degrees);
+
+    return is_consistent;
+}
+
+static TEST_RESULT test_gphrx_find_communities()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    GphrxCommunitiesOptions options = gphrx_default_communities_options();
+    GphrxCommunitiesOptions louvain_options = gphrx_default_communities_options();
+    louvain_options.refine_with_louvain = true;
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            // Dense groups with a few edges between them. Label propagation can leave a group split in two
+            // when both halves hold together, but never merges groups; the refinement finds them exactly.
+            GphrxGraph graph = new_planted_test_graph(is_undirected, 40, 50, 40, 100, 3 + is_undirected);
+
+            GphrxCommunitiesResult result = gphrx_find_communities(&graph, &options);
+            GphrxCommunitiesResult refined_result = gphrx_find_communities(&graph, &louvain_options);
+
+            assert(is_communities_result_consistent(&graph, &result), "Inconsistent communities");
+            assert(is_communities_result_consistent(&graph, &refined_result), "Inconsistent communities");
+
+            assert(result.community_count >= 40 && refined_result.community_count == 40, "Incorrect communities");
+            assert(result.louvain_level_count == 0 && refined_result.louvain_level_count >= 1, "Incorrect level count");
+
+            u64 *group_labels = malloc(sizeof(u64) * result.community_count);
+
+            for (u64 v = 0; v < result.vertex_count; ++v)
+                group_labels[result.labels[v]] = planted_group(v, 50, result.vertex_count);
+
+            for (u64 v = 0; v < result.vertex_count; ++v)
+            {
+                u64 group = planted_group(v, 50, result.vertex_count);
+                u64 first_in_group = group * 50 * 7 % result.vertex_count;
+
+                assert(group_labels[result.labels[v]] == group, "Incorrect communities");
+                assert(refined_result.labels[v] == refined_result.labels[first_in_group], "Incorrect communities");
+            }
+
+            free(group_labels);
+
+            free_gphrx_communities_result(&result);
+            free_gphrx_communities_result(&refined_result);
+            free_gphrx(&graph);
+
+            // Sparse groups with many edges between them, where label propagation alone does worse
+            graph = new_planted_test_graph(is_undirected, 100, 30, 15, 6000, 5 + is_undirected);
+
+            result = gphrx_find_communities(&graph, &options);
+            refined_result = gphrx_find_communities(&graph, &louvain_options);
+
+            assert(is_communities_result_consistent(&graph, &result), "Inconsistent communities");
+            assert(is_communities_result_consistent(&graph, &refined_result), "Inconsistent communities");
+
+            // Each Louvain move raises the modularity when moves are made one at a time
+            if (thread_counts[t] == 1)
+            {
+                assert(refined_result.modularity >= result.modularity, "Refinement lowered modularity");
+            }
+
+            assert(refined_result.modularity > 0.45, "Incorrect communities");
+
+            free_gphrx_communities_result(&result);
+            free_gphrx_communities_result(&refined_result);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // Two triangles joined by an edge, and an isolated vertex
+    GphrxGraph graph = new_undirected_gphrx();
+
+    gphrx_add_edge(&graph, 0, 1);
+    gphrx_add_edge(&graph, 1, 2);
+    gphrx_add_edge(&graph, 2, 0);
+    gphrx_add_edge(&graph, 2, 3);
+    gphrx_add_edge(&graph, 3, 4);
+    gphrx_add_edge(&graph, 4, 5);
+    gphrx_add_edge(&graph, 5, 3);
+    gphrx_add_edge(&graph, 7, 7);
+
+    GphrxCommunitiesResult result = gphrx_find_communities(&graph, &louvain_options);
+
+    assert(is_communities_result_consistent(&graph, &result), "Inconsistent communities");
+    assert(result.community_count == 4, "Incorrect communities");
+    assert(result.labels[0] == 0 && result.labels[2] == 0 && result.labels[3] == 1 && result.labels[5] == 1,
+           "Incorrect communities");
+    assert(result.labels[6] == 2 && result.labels[7] == 3, "Incorrect communities");
+
+    free_gphrx_communities_result(&result);
+    free_gphrx(&graph);
+
+    // An empty graph has no communities
+    graph = new_directed_gphrx();
+    result = gphrx_find_communities(&graph, 0);
+
+    assert(result.vertex_count == 0 && result.community_count == 0 && result.modularity == 0.0,
+           "Incorrect communities");
+
+    free_gphrx_communities_result(&result);
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_permute_vertices()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    GphrxCommunitiesOptions options = gphrx_default_communities_options();
+    options.refine_with_louvain = true;
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = new_planted_test_graph(is_undirected, 20, 40, 30, 50, 7 + is_undirected);
+            GphrxCommunitiesResult result = gphrx_find_communities(&graph, &options);
+            GphrxGraph permuted_graph = gphrx_permute_vertices(&graph, result.permutation);
+
+            GphrxCsrAdjacencyMatrix *matrix = &graph.adjacency_matrix;
+            GphrxCsrAdjacencyMatrix *permuted_matrix = &permuted_graph.adjacency_matrix;
+
+            assert(permuted_graph.is_undirected == graph.is_undirected, "Incorrect graph metadata");
+            assert(permuted_matrix->dimension == matrix->dimension, "Incorrect graph dimension");
+            assert(permuted_matrix->col_indices.size == matrix->col_indices.size, "Incorrect edge count");
+
+            for (size_t edge = 0; edge < matrix->col_indices.size; ++edge)
+            {
+                u64 from_vertex_id = dynarr8_get(&matrix->col_indices, edge).u64_val;
+                u64 to_vertex_id = dynarr8_get(&matrix->row_indices, edge).u64_val;
+
+                assert(gphrx_does_edge_exist(&permuted_graph,
+                                             result.permutation[from_vertex_id],
+                                             result.permutation[to_vertex_id]),
+                       "Edge not renamed");
+            }
+
+            // The renamed edges are sorted
+            for (size_t edge = 1; edge < permuted_matrix->col_indices.size; ++edge)
+            {
+                u64 previous_col = dynarr8_get(&permuted_matrix->col_indices, edge - 1).u64_val;
+                u64 col = dynarr8_get(&permuted_matrix->col_indices, edge).u64_val;
+                u64 previous_row = dynarr8_get(&permuted_matrix->row_indices, edge - 1).u64_val;
+                u64 row = dynarr8_get(&permuted_matrix->row_indices, edge).u64_val;
+
+                assert(previous_col < col || (previous_col == col && previous_row < row), "Edges not sorted");
+            }
+
+            // The groups are scattered across the original IDs, so only grouping them shows up in an
+            // approximation, as the blocks on its diagonal
+            GphrxGraph approx_graph = approximate_gphrx(&graph, 40, 0.1);
+            GphrxGraph permuted_approx_graph = approximate_gphrx(&permuted_graph, 40, 0.1);
+
+            assert(permuted_approx_graph.adjacency_matrix.col_indices.size == 20, "Incorrect approximation");
+            assert(approx_graph.adjacency_matrix.col_indices.size < 20, "Incorrect approximation");
+
+            for (u64 block = 0; block < 20; ++block)
+                assert(gphrx_does_edge_exist(&permuted_approx_graph, block, block), "Incorrect approximation");
+
+            free_gphrx_communities_result(&result);
+            free_gphrx(&graph);
+            free_gphrx(&permuted_graph);
+            free_gphrx(&approx_graph);
+            free_gphrx(&permuted_approx_graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet communities_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_find_communities);
+    register_test(&set, test_gphrx_permute_vertices);
+
+    return set;
+}
+
+#endif
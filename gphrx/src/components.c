@@ -0,0 +1,494 @@
+#include "components.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "threadpool.h"
+
+// Vertices per range of a neighbour round or a compression pass, and edges per range of the final pass
+#define VERTEX_GRAIN_SIZE 1024
+#define EDGE_GRAIN_COST 4096
+
+#define NO_COMPONENT UINT64_MAX
+
+typedef struct {
+    u64 vertex_count;
+    size_t *offsets;
+    u64 *edges;
+
+    // Each vertex's parent in the union-find forest. A parent is never greater than its child, so every
+    // tree's root is the lowest vertex ID in it and parents only ever move towards the root.
+    _Atomic u64 *parents;
+
+    u64 round;
+    u64 skipped_component;
+} ComponentsSearch;
+
+static u64 load_parent(_Atomic u64 *parents, u64 v)
+{
+    return atomic_load_explicit(parents + v, memory_order_relaxed);
+}
+
+// Joins the trees holding u and v by pointing the higher of the two roots at the lower. If another thread
+// changes the higher root's parent first, the compare-and-swap fails and the roots are found again. Each
+// retry looks two levels up, which halves the paths it follows.
+static void link(_Atomic u64 *parents, u64 u, u64 v)
+{
+    u64 u_parent = load_parent(parents, u);
+    u64 v_parent = load_parent(parents, v);
+
+    while (u_parent != v_parent)
+    {
+        u64 high = u_parent > v_parent ? u_parent : v_parent;
+        u64 low = u_parent > v_parent ? v_parent : u_parent;
+
+        u64 high_parent = load_parent(parents, high);
+
+        if (high_parent == low)
+            break;
+
+        if (high_parent == high &&
+            atomic_compare_exchange_strong_explicit(parents + high,
+                                                    &high_parent,
+                                                    low,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed))
+            break;
+
+        u_parent = load_parent(parents, load_parent(parents, high));
+        v_parent = load_parent(parents, low);
+    }
+}
+
+static void link_round_neighbors(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    ComponentsSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        size_t edge = search->offsets[v] + search->round;
+
+        if (edge < search->offsets[v + 1])
+            link(search->parents, v, search->edges[edge]);
+    }
+}
+
+static void link_remaining_neighbors(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    ComponentsSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        if (load_parent(search->parents, v) == search->skipped_component)
+            continue;
+
+        for (size_t edge = search->offsets[v] + search->round; edge < search->offsets[v + 1]; ++edge)
+            link(search->parents, v, search->edges[edge]);
+    }
+}
+
+// Points every vertex directly at its root
+static void compress(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    ComponentsSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        u64 parent = load_parent(search->parents, v);
+        u64 grandparent = load_parent(search->parents, parent);
+
+        while (parent != grandparent)
+        {
+            atomic_store_explicit(search->parents + v, grandparent, memory_order_relaxed);
+
+            parent = grandparent;
+            grandparent = load_parent(search->parents, parent);
+        }
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    u64 a_val = *(const u64*) a;
+    u64 b_val = *(const u64*) b;
+
+    return (a_val > b_val) - (a_val < b_val);
+}
+
+// Returns the root of the component that the most of a fixed sample of vertices belong to
+static u64 find_frequent_component(ComponentsSearch *restrict search)
+{
+    u64 samples[GPHRX_COMPONENTS_SAMPLE_COUNT];
+
+    u64 rng_state = 0x9E3779B97F4A7C15ULL;
+
+    for (u32 i = 0; i < GPHRX_COMPONENTS_SAMPLE_COUNT; ++i)
+    {
+        rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        samples[i] = load_parent(search->parents, (rng_state >> 11) % search->vertex_count);
+    }
+
+    qsort(samples, GPHRX_COMPONENTS_SAMPLE_COUNT, sizeof(u64), compare_u64);
+
+    u64 frequent_component = samples[0];
+    u32 frequent_count = 0;
+
+    for (u32 i = 0, run_start = 0; i < GPHRX_COMPONENTS_SAMPLE_COUNT; ++i)
+    {
+        if (samples[i] != samples[run_start])
+            run_start = i;
+
+        if (i - run_start + 1 > frequent_count)
+        {
+            frequent_component = samples[i];
+            frequent_count = i - run_start + 1;
+        }
+    }
+
+    return frequent_component;
+}
+
+// Numbers the components in order of their roots and counts their vertices. Roots come before the rest of
+// their component, so the roots' parents can be overwritten with their component's number as they are
+// found and every other vertex then reads its number from its root.
+static GphrxComponentsResult label_components(u64 *parents, u64 vertex_count)
+{
+    GphrxComponentsResult result = {
+        .vertex_count = vertex_count,
+        .component_count = 0,
+        .labels = parents,
+        .sizes = 0,
+    };
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        if (parents[v] == v)
+            parents[v] = result.component_count++;
+        else
+            parents[v] = parents[parents[v]];
+    }
+
+    result.sizes = calloc(result.component_count, sizeof(u64));
+    assert(result.sizes != 0 || result.component_count == 0, "calloc failure");
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        ++result.sizes[parents[v]];
+
+    return result;
+}
+
+DLLEXPORT GphrxComponentsResult gphrx_find_components(GphrxGraph *restrict graph)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    u64 vertex_count = matrix->dimension;
+
+    if (vertex_count == 0)
+    {
+        GphrxComponentsResult result = {0};
+        return result;
+    }
+
+    u64 *parents = malloc(sizeof(u64) * vertex_count);
+    assert(parents != 0, "malloc failure");
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        parents[v] = v;
+
+    // The union-find runs on the array that will hold the labels. _Atomic u64 has the layout of a u64.
+    ComponentsSearch search = {
+        .vertex_count = vertex_count,
+        .offsets = _gphrx_find_vertex_edge_offsets(matrix),
+        .edges = (u64*) matrix->row_indices.arr,
+        .parents = (_Atomic u64*) parents,
+        .round = 0,
+        .skipped_component = NO_COMPONENT,
+    };
+
+    for (; search.round < GPHRX_COMPONENTS_NEIGHBOR_ROUNDS; ++search.round)
+    {
+        _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, link_round_neighbors, &search);
+        _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, compress, &search);
+    }
+
+    // On a directed graph, an edge into the frequent component from outside it is only stored at its from
+    // vertex, so no vertex can skip its edges
+    if (graph->is_undirected)
+        search.skipped_component = find_frequent_component(&search);
+
+    _gphrx_parallel_for_balanced(0, vertex_count, search.offsets, EDGE_GRAIN_COST, link_remaining_neighbors, &search);
+    _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, compress, &search);
+
+    free(search.offsets);
+
+    return label_components(parents, vertex_count);
+}
+
+DLLEXPORT GphrxComponentsResult gphrx_find_approximate_components(GphrxGraph *restrict graph,
+                                                                  u64 block_dimension,
+                                                                  double threshold)
+{
+    // `approximate_gphrx` returns a copy of these graphs rather than an approximation
+    if (block_dimension <= 1 || graph->adjacency_matrix.col_indices.size <= 1)
+        return gphrx_find_components(graph);
+
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+    u64 block_count = (vertex_count + block_dimension - 1) / block_dimension;
+
+    GphrxGraph approx_graph = approximate_gphrx(graph, block_dimension, threshold);
+    GphrxComponentsResult block_result = gphrx_find_components(&approx_graph);
+
+    assert(block_result.vertex_count <= block_count, "Approximation has more blocks than the graph");
+
+    // Blocks past the approximation's highest block ID have no edges, so each is a component of its own.
+    // Numbering them after the approximation's components keeps components in order of their lowest vertex.
+    GphrxComponentsResult result = {
+        .vertex_count = vertex_count,
+        .component_count = block_result.component_count + (block_count - block_result.vertex_count),
+        .labels = malloc(sizeof(u64) * vertex_count),
+        .sizes = calloc(block_result.component_count + (block_count - block_result.vertex_count), sizeof(u64)),
+    };
+
+    assert(result.labels != 0 && result.sizes != 0, "malloc failure");
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        u64 block = v / block_dimension;
+
+        result.labels[v] = block < block_result.vertex_count
+            ? block_result.labels[block]
+            : block_result.component_count + (block - block_result.vertex_count);
+
+        ++result.sizes[result.labels[v]];
+    }
+
+    free_gphrx_components_result(&block_result);
+    free_gphrx(&approx_graph);
+
+    return result;
+}
+
+DLLEXPORT void free_gphrx_components_result(GphrxComponentsResult *restrict result)
+{
+    free(result->labels);
+    free(result->sizes);
+}
+
+
+#ifdef TEST_MODE
+
+// A graph of `cluster_count` random clusters of consecutive vertex IDs, with no edges between clusters, so
+// that it has many components of different sizes
+static GphrxGraph new_clustered_test_graph(bool is_undirected,
+                                           u64 vertex_count,
+                                           u64 cluster_count,
+                                           size_t edge_count,
+                                           u64 seed)
+{
+    GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+    u64 *from_vertex_ids = malloc(sizeof(u64) * edge_count);
+    u64 *to_vertex_ids = malloc(sizeof(u64) * edge_count);
+
+    u64 rng_state = seed;
+    u64 cluster_size = vertex_count / cluster_count;
+
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        u64 cluster_start = test_random(&rng_state) % cluster_count * cluster_size;
+
+        from_vertex_ids[i] = cluster_start + test_random(&rng_state) % cluster_size;
+        to_vertex_ids[i] = cluster_start + test_random(&rng_state) % cluster_size;
+    }
+
+    gphrx_add_edges(&graph, from_vertex_ids, to_vertex_ids, edge_count);
+
+    free(from_vertex_ids);
+    free(to_vertex_ids);
+
+    return graph;
+}
+
+static u64 find_test_root(u64 *parents, u64 v)
+{
+    while (parents[v] != v)
+        v = parents[v];
+
+    return v;
+}
+
+// Checks a result against a plain serial union-find. Vertices must share a label exactly when they share a
+// root, and labels must be numbered in order of each component's lowest vertex.
+static bool are_components_correct(GphrxGraph *restrict graph, GphrxComponentsResult *restrict result)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    u64 vertex_count = matrix->dimension;
+
+    if (result->vertex_count != vertex_count)
+        return false;
+
+    u64 *parents = malloc(sizeof(u64) * vertex_count);
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        parents[v] = v;
+
+    for (size_t i = 0; i < matrix->col_indices.size; ++i)
+    {
+        u64 u_root = find_test_root(parents, dynarr8_get(&matrix->col_indices, i).u64_val);
+        u64 v_root = find_test_root(parents, dynarr8_get(&matrix->row_indices, i).u64_val);
+
+        if (u_root < v_root)
+            parents[v_root] = u_root;
+        else
+            parents[u_root] = v_root;
+    }
+
+    u64 *sizes = calloc(vertex_count, sizeof(u64));
+    u64 component_count = 0;
+    bool is_correct = true;
+
+    for (u64 v = 0; v < vertex_count && is_correct; ++v)
+    {
+        u64 root = find_test_root(parents, v);
+
+        if (root == v)
+            is_correct = result->labels[v] == component_count++;
+        else
+            is_correct = result->labels[v] == result->labels[root];
+
+        ++sizes[root];
+    }
+
+    is_correct = is_correct && result->component_count == component_count;
+
+    for (u64 v = 0; v < vertex_count && is_correct; ++v)
+    {
+        if (find_test_root(parents, v) == v)
+            is_correct = result->sizes[result->labels[v]] == sizes[v];
+    }
+
+    free(parents);
+    free(sizes);
+
+    return is_correct;
+}
+
+static TEST_RESULT test_gphrx_find_components()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            // One cluster dense enough to be the frequent component, and sparse ones that split into many
+            GphrxGraph graph = new_clustered_test_graph(is_undirected, 20000, 1, 30000, 3 + is_undirected);
+            GphrxComponentsResult result = gphrx_find_components(&graph);
+
+            assert(are_components_correct(&graph, &result), "Incorrect components");
+
+            free_gphrx_components_result(&result);
+            free_gphrx(&graph);
+
+            graph = new_clustered_test_graph(is_undirected, 20000, 50, 12000, 5 + is_undirected);
+            result = gphrx_find_components(&graph);
+
+            assert(result.component_count > 50, "Incorrect component count");
+            assert(are_components_correct(&graph, &result), "Incorrect components");
+
+            free_gphrx_components_result(&result);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // A directed path is one weak component, whichever way its edges point
+    GphrxGraph path = new_directed_gphrx();
+
+    for (u64 v = 0; v < 300; ++v)
+        gphrx_add_edge(&path, 300 - v, 299 - v);
+
+    gphrx_add_edge(&path, 500, 400);
+
+    GphrxComponentsResult result = gphrx_find_components(&path);
+
+    assert(result.vertex_count == 501, "Incorrect vertex count");
+    assert(result.component_count == 1 + 99 + 1 + 99, "Incorrect component count");
+    assert(result.labels[0] == 0 && result.labels[300] == 0 && result.sizes[0] == 301, "Incorrect components");
+    assert(result.labels[301] == 1 && result.sizes[1] == 1, "Incorrect components");
+    assert(result.labels[400] == result.labels[500] && result.sizes[result.labels[400]] == 2,
+           "Incorrect components");
+
+    free_gphrx_components_result(&result);
+    free_gphrx(&path);
+
+    GphrxGraph empty_graph = new_undirected_gphrx();
+    result = gphrx_find_components(&empty_graph);
+
+    assert(result.vertex_count == 0 && result.component_count == 0, "Incorrect empty result");
+
+    free_gphrx_components_result(&result);
+    free_gphrx(&empty_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_find_approximate_components()
+{
+    for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+    {
+        GphrxGraph graph = new_clustered_test_graph(is_undirected, 10000, 20, 6000, 9 + is_undirected);
+
+        GphrxComponentsResult result = gphrx_find_components(&graph);
+        GphrxComponentsResult approx_result = gphrx_find_approximate_components(&graph, 10, 0.0);
+
+        assert(approx_result.vertex_count == result.vertex_count, "Incorrect vertex count");
+        assert(approx_result.component_count <= result.component_count, "Incorrect component count");
+
+        u64 size_sum = 0;
+
+        for (u64 c = 0; c < approx_result.component_count; ++c)
+            size_sum += approx_result.sizes[c];
+
+        assert(size_sum == approx_result.vertex_count, "Incorrect component sizes");
+
+        // Every block with an edge is kept, so each component of the graph lies within one estimated
+        // component, and the clusters fill whole blocks, so they are never merged
+        GphrxCsrAdjacencyMatrix *matrix = &graph.adjacency_matrix;
+
+        for (size_t i = 0; i < matrix->col_indices.size; ++i)
+        {
+            u64 from_vertex_id = dynarr8_get(&matrix->col_indices, i).u64_val;
+            u64 to_vertex_id = dynarr8_get(&matrix->row_indices, i).u64_val;
+
+            assert(approx_result.labels[from_vertex_id] == approx_result.labels[to_vertex_id],
+                   "Component split by estimate");
+        }
+
+        assert(approx_result.labels[499] != approx_result.labels[500], "Clusters merged by estimate");
+
+        free_gphrx_components_result(&result);
+        free_gphrx_components_result(&approx_result);
+        free_gphrx(&graph);
+    }
+
+    return TEST_PASS;
+}
+
+ModuleTestSet components_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_find_components);
+    register_test(&set, test_gphrx_find_approximate_components);
+
+    return set;
+}
+
+#endif
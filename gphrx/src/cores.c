@@ -0,0 +1,614 @@
+#include "cores.h"
+
+#include <string.h>
+
+#include "threadpool.h"
+
+// Edges per range of the degree count, and edges per chunk when copying a k-core
+#define EDGE_GRAIN_COST 4096
+#define EDGE_CHUNK_SIZE 16384
+
+typedef struct {
+    u64 *degrees;
+    size_t *offsets;
+    u64 *edges;
+
+    // The transpose, for following edges backwards on directed graphs. Null on undirected graphs, where
+    // every edge is stored in both directions.
+    size_t *in_offsets;
+    u64 *in_edges;
+} CoresSearch;
+
+static u64 count_neighbors(u64 *edges, size_t start, size_t end, u64 v)
+{
+    u64 count = 0;
+
+    for (size_t edge = start; edge < end; ++edge)
+        count += edges[edge] != v;
+
+    return count;
+}
+
+static void count_degrees(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    CoresSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        search->degrees[v] = count_neighbors(search->edges, search->offsets[v], search->offsets[v + 1], v);
+
+        if (search->in_offsets != 0)
+        {
+            search->degrees[v] += count_neighbors(search->in_edges,
+                                                  search->in_offsets[v],
+                                                  search->in_offsets[v + 1],
+                                                  v);
+        }
+    }
+}
+
+// Moves u from its bucket down to the next, by swapping it with the first vertex of its bucket and then
+// moving the bucket's start past it. Only vertices that haven't been peeled yet are moved, so the order
+// before the peeled vertex is never disturbed.
+static void lower_degree(u64 *restrict degrees,
+                         u64 *restrict order,
+                         u64 *restrict positions,
+                         size_t *restrict bucket_starts,
+                         u64 v,
+                         u64 u)
+{
+    if (u == v || degrees[u] <= degrees[v])
+        return;
+
+    u64 degree = degrees[u];
+    size_t u_position = positions[u];
+    size_t first_position = bucket_starts[degree];
+    u64 first = order[first_position];
+
+    order[u_position] = first;
+    positions[first] = u_position;
+    order[first_position] = u;
+    positions[u] = first_position;
+
+    ++bucket_starts[degree];
+    --degrees[u];
+}
+
+// Peels the vertices in order of remaining degree, leaving each vertex's core number in `degrees` and the
+// order the vertices were peeled in in `order`
+static void peel(CoresSearch *restrict search, u64 vertex_count, u64 *restrict order)
+{
+    u64 *degrees = search->degrees;
+    u64 max_degree = 0;
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        max_degree = degrees[v] > max_degree ? degrees[v] : max_degree;
+
+    size_t *bucket_starts = calloc(max_degree + 2, sizeof(size_t));
+    u64 *positions = malloc(sizeof(u64) * vertex_count);
+
+    assert(bucket_starts != 0, "calloc failure");
+    assert(positions != 0, "malloc failure");
+
+    // Sort the vertices into buckets by degree, using each bucket's start as the cursor it is filled from
+    // and then moving the starts back
+    for (u64 v = 0; v < vertex_count; ++v)
+        ++bucket_starts[degrees[v] + 1];
+
+    for (u64 degree = 1; degree <= max_degree + 1; ++degree)
+        bucket_starts[degree] += bucket_starts[degree - 1];
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        positions[v] = bucket_starts[degrees[v]]++;
+        order[positions[v]] = v;
+    }
+
+    for (u64 degree = max_degree + 1; degree > 0; --degree)
+        bucket_starts[degree] = bucket_starts[degree - 1];
+
+    bucket_starts[0] = 0;
+
+    for (u64 i = 0; i < vertex_count; ++i)
+    {
+        u64 v = order[i];
+
+        for (size_t edge = search->offsets[v]; edge < search->offsets[v + 1]; ++edge)
+            lower_degree(degrees, order, positions, bucket_starts, v, search->edges[edge]);
+
+        if (search->in_offsets == 0)
+            continue;
+
+        for (size_t edge = search->in_offsets[v]; edge < search->in_offsets[v + 1]; ++edge)
+            lower_degree(degrees, order, positions, bucket_starts, v, search->in_edges[edge]);
+    }
+
+    free(bucket_starts);
+    free(positions);
+}
+
+DLLEXPORT GphrxCoresResult gphrx_find_cores(GphrxGraph *restrict graph)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    u64 vertex_count = matrix->dimension;
+
+    if (vertex_count == 0)
+    {
+        GphrxCoresResult result = {0};
+        return result;
+    }
+
+    GphrxCoresResult result = {
+        .vertex_count = vertex_count,
+        .max_core = 0,
+        .core_numbers = malloc(sizeof(u64) * vertex_count),
+        .degeneracy_order = malloc(sizeof(u64) * vertex_count),
+    };
+
+    assert(result.core_numbers != 0 && result.degeneracy_order != 0, "malloc failure");
+
+    CoresSearch search = {
+        .degrees = result.core_numbers,
+        .offsets = _gphrx_find_vertex_edge_offsets(matrix),
+        .edges = (u64*) matrix->row_indices.arr,
+        .in_offsets = 0,
+        .in_edges = 0,
+    };
+
+    if (!graph->is_undirected)
+        search.in_edges = _gphrx_find_vertex_in_edges(matrix, &search.in_offsets);
+
+    _gphrx_parallel_for_balanced(0, vertex_count, search.offsets, EDGE_GRAIN_COST, count_degrees, &search);
+    peel(&search, vertex_count, result.degeneracy_order);
+
+    // Core numbers never decrease along the peeling order
+    result.max_core = result.core_numbers[result.degeneracy_order[vertex_count - 1]];
+
+    free(search.offsets);
+    free(search.in_offsets);
+    free(search.in_edges);
+
+    return result;
+}
+
+typedef struct {
+    u64 *core_numbers;
+    u64 k;
+
+    u64 *col_indices;
+    u64 *row_indices;
+    size_t edge_count;
+
+    // The number of kept edges before each chunk of EDGE_CHUNK_SIZE edges
+    size_t *chunk_offsets;
+
+    u64 *kept_col_indices;
+    u64 *kept_row_indices;
+} KCoreCopy;
+
+static bool is_edge_kept(KCoreCopy *restrict copy, size_t edge)
+{
+    return copy->core_numbers[copy->col_indices[edge]] >= copy->k &&
+        copy->core_numbers[copy->row_indices[edge]] >= copy->k;
+}
+
+static void count_kept_edges(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    KCoreCopy *copy = context;
+
+    for (size_t chunk = start; chunk < end; ++chunk)
+    {
+        size_t chunk_end = (chunk + 1) * EDGE_CHUNK_SIZE;
+        chunk_end = chunk_end < copy->edge_count ? chunk_end : copy->edge_count;
+
+        size_t kept_count = 0;
+
+        for (size_t edge = chunk * EDGE_CHUNK_SIZE; edge < chunk_end; ++edge)
+            kept_count += is_edge_kept(copy, edge);
+
+        copy->chunk_offsets[chunk + 1] = kept_count;
+    }
+}
+
+static void copy_kept_edges(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    KCoreCopy *copy = context;
+
+    for (size_t chunk = start; chunk < end; ++chunk)
+    {
+        size_t chunk_end = (chunk + 1) * EDGE_CHUNK_SIZE;
+        chunk_end = chunk_end < copy->edge_count ? chunk_end : copy->edge_count;
+
+        size_t kept_idx = copy->chunk_offsets[chunk];
+
+        for (size_t edge = chunk * EDGE_CHUNK_SIZE; edge < chunk_end; ++edge)
+        {
+            if (is_edge_kept(copy, edge))
+            {
+                copy->kept_col_indices[kept_idx] = copy->col_indices[edge];
+                copy->kept_row_indices[kept_idx] = copy->row_indices[edge];
+                ++kept_idx;
+            }
+        }
+    }
+}
+
+DLLEXPORT GphrxGraph gphrx_find_k_core(GphrxGraph *restrict graph, GphrxCoresResult *restrict cores, u64 k)
+{
+    // Every vertex is in the 0-core
+    if (k == 0)
+        return duplicate_gphrx(graph);
+
+    GphrxCoresResult found_cores = {0};
+
+    if (cores == 0)
+    {
+        found_cores = gphrx_find_cores(graph);
+        cores = &found_cores;
+    }
+
+    assert(cores->vertex_count == graph->adjacency_matrix.dimension, "Core numbers are for a different graph");
+
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+    size_t chunk_count = (edge_count + EDGE_CHUNK_SIZE - 1) / EDGE_CHUNK_SIZE;
+
+    KCoreCopy copy = {
+        .core_numbers = cores->core_numbers,
+        .k = k,
+        .col_indices = (u64*) graph->adjacency_matrix.col_indices.arr,
+        .row_indices = (u64*) graph->adjacency_matrix.row_indices.arr,
+        .edge_count = edge_count,
+        .chunk_offsets = calloc(chunk_count + 1, sizeof(size_t)),
+        .kept_col_indices = 0,
+        .kept_row_indices = 0,
+    };
+
+    assert(copy.chunk_offsets != 0, "calloc failure");
+
+    _gphrx_parallel_for(0, chunk_count, 1, count_kept_edges, &copy);
+
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+        copy.chunk_offsets[chunk + 1] += copy.chunk_offsets[chunk];
+
+    size_t kept_count = copy.chunk_offsets[chunk_count];
+
+    // Every vertex in a k-core (for k >= 1) has an edge in it, so the highest such vertex sets the dimension
+    u64 dimension = 0;
+
+    for (u64 v = 0; v < cores->vertex_count; ++v)
+    {
+        if (cores->core_numbers[v] >= k)
+            dimension = v + 1;
+    }
+
+    GphrxGraph k_core = {
+        .is_undirected = graph->is_undirected,
+        .adjacency_matrix = {
+            .dimension = dimension,
+            .col_indices = new_dynarr8_with_capacity(kept_count + 1),
+            .row_indices = new_dynarr8_with_capacity(kept_count + 1),
+        },
+    };
+
+    copy.kept_col_indices = (u64*) k_core.adjacency_matrix.col_indices.arr;
+    copy.kept_row_indices = (u64*) k_core.adjacency_matrix.row_indices.arr;
+
+    _gphrx_parallel_for(0, chunk_count, 1, copy_kept_edges, &copy);
+
+    k_core.adjacency_matrix.col_indices.size = kept_count;
+    k_core.adjacency_matrix.row_indices.size = kept_count;
+
+    free(copy.chunk_offsets);
+
+    if (cores == &found_cores)
+        free_gphrx_cores_result(&found_cores);
+
+    return k_core;
+}
+
+DLLEXPORT void free_gphrx_cores_result(GphrxCoresResult *restrict result)
+{
+    free(result->core_numbers);
+    free(result->degeneracy_order);
+}
+
+
+#ifdef TEST_MODE
+
+// Finds core numbers by repeatedly removing every vertex with fewer than k remaining neighbours
+static u64 *find_core_numbers_by_removal(u64 *from_vertex_ids, u64 *to_vertex_ids, size_t edge_count,
+                                         u64 vertex_count)
+{
+    u64 *core_numbers = calloc(vertex_count, sizeof(u64));
+    bool *is_removed = calloc(vertex_count, sizeof(bool));
+    u64 *degrees = malloc(sizeof(u64) * vertex_count);
+
+    for (u64 k = 1; ; ++k)
+    {
+        bool did_remove = true;
+
+        while (did_remove)
+        {
+            did_remove = false;
+            memset(degrees, 0, sizeof(u64) * vertex_count);
+
+            for (size_t i = 0; i < edge_count; ++i)
+            {
+                u64 u = from_vertex_ids[i];
+                u64 v = to_vertex_ids[i];
+
+                if (u != v && !is_removed[u] && !is_removed[v])
+                {
+                    ++degrees[u];
+                    ++degrees[v];
+                }
+            }
+
+            for (u64 v = 0; v < vertex_count; ++v)
+            {
+                if (!is_removed[v] && degrees[v] < k)
+                {
+                    is_removed[v] = true;
+                    did_remove = true;
+                }
+            }
+        }
+
+        bool is_any_left = false;
+
+        for (u64 v = 0; v < vertex_count; ++v)
+        {
+            if (!is_removed[v])
+            {
+                core_numbers[v] = k;
+                is_any_left = true;
+            }
+        }
+
+        if (!is_any_left)
+            break;
+    }
+
+    free(is_removed);
+    free(degrees);
+
+    return core_numbers;
+}
+
+static TEST_RESULT test_gphrx_find_cores()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            const u64 vertex_count = 300;
+            const size_t edge_count = 2000;
+
+            GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+            u64 *from_vertex_ids = malloc(sizeof(u64) * edge_count);
+            u64 *to_vertex_ids = malloc(sizeof(u64) * edge_count);
+
+            u64 rng_state = 17 + is_undirected;
+
+            // A dense group of low IDs in a sparse graph, so the core numbers vary, with some self-loops
+            for (size_t i = 0; i < edge_count; ++i)
+            {
+                u64 range = i % 2 == 0 ? 40 : vertex_count;
+
+                from_vertex_ids[i] = test_random(&rng_state) % range;
+                to_vertex_ids[i] = i % 50 == 0 ? from_vertex_ids[i] : test_random(&rng_state) % range;
+            }
+
+            gphrx_add_edges(&graph, from_vertex_ids, to_vertex_ids, edge_count);
+
+            // The reference counts both directions of each edge it is given, which matches the in-degree plus
+            // out-degree of a directed graph. An undirected graph stores each edge twice, so it gets one copy.
+            size_t stored_count = graph.adjacency_matrix.col_indices.size;
+            u64 *stored_from_vertex_ids = (u64*) graph.adjacency_matrix.col_indices.arr;
+            u64 *stored_to_vertex_ids = (u64*) graph.adjacency_matrix.row_indices.arr;
+
+            size_t reference_count = 0;
+
+            for (size_t i = 0; i < stored_count; ++i)
+            {
+                if (is_undirected && stored_from_vertex_ids[i] > stored_to_vertex_ids[i])
+                    continue;
+
+                from_vertex_ids[reference_count] = stored_from_vertex_ids[i];
+                to_vertex_ids[reference_count] = stored_to_vertex_ids[i];
+                ++reference_count;
+            }
+
+            u64 *expected = find_core_numbers_by_removal(from_vertex_ids,
+                                                         to_vertex_ids,
+                                                         reference_count,
+                                                         graph.adjacency_matrix.dimension);
+
+            GphrxCoresResult result = gphrx_find_cores(&graph);
+
+            assert(result.vertex_count == graph.adjacency_matrix.dimension, "Incorrect vertex count");
+
+            u64 max_core = 0;
+
+            for (u64 v = 0; v < result.vertex_count; ++v)
+            {
+                assert(result.core_numbers[v] == expected[v], "Incorrect core number");
+                max_core = expected[v] > max_core ? expected[v] : max_core;
+            }
+
+            assert(result.max_core == max_core, "Incorrect max core");
+            assert(max_core >= 3, "Test graph should have a dense core");
+
+            // The order is a permutation along which core numbers never decrease
+            bool *is_seen = calloc(result.vertex_count, sizeof(bool));
+
+            for (u64 i = 0; i < result.vertex_count; ++i)
+            {
+                u64 v = result.degeneracy_order[i];
+
+                assert(v < result.vertex_count && !is_seen[v], "Degeneracy order is not a permutation");
+                is_seen[v] = true;
+
+                if (i > 0)
+                {
+                    assert(result.core_numbers[result.degeneracy_order[i - 1]] <= result.core_numbers[v],
+                           "Core numbers decrease along the degeneracy order");
+                }
+            }
+
+            free(is_seen);
+            free(expected);
+            free(from_vertex_ids);
+            free(to_vertex_ids);
+            free_gphrx_cores_result(&result);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // A 4-clique with a path hanging off it and an isolated vertex (6) below the highest ID
+    GphrxGraph graph = new_undirected_gphrx();
+
+    u64 from_vertex_ids[] = { 0, 0, 0, 1, 1, 2, 3, 4, 7 };
+    u64 to_vertex_ids[] = { 1, 2, 3, 2, 3, 3, 4, 5, 5 };
+    u64 expected[] = { 3, 3, 3, 3, 1, 1, 0, 1 };
+
+    gphrx_add_edges(&graph, from_vertex_ids, to_vertex_ids, 9);
+
+    GphrxCoresResult result = gphrx_find_cores(&graph);
+
+    assert(result.vertex_count == 8, "Incorrect vertex count");
+    assert(result.max_core == 3, "Incorrect max core");
+
+    for (u64 v = 0; v < 8; ++v)
+        assert(result.core_numbers[v] == expected[v], "Incorrect core number");
+
+    free_gphrx_cores_result(&result);
+    free_gphrx(&graph);
+
+    GphrxGraph empty_graph = new_directed_gphrx();
+    result = gphrx_find_cores(&empty_graph);
+
+    assert(result.vertex_count == 0 && result.core_numbers == 0, "Empty graph should have no core numbers");
+
+    free_gphrx_cores_result(&result);
+    free_gphrx(&empty_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_find_k_core()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+            // Enough edges for several copy chunks
+            const size_t edge_count = 60000;
+
+            u64 *from_vertex_ids = malloc(sizeof(u64) * edge_count);
+            u64 *to_vertex_ids = malloc(sizeof(u64) * edge_count);
+
+            u64 rng_state = 29 + is_undirected;
+
+            for (size_t i = 0; i < edge_count; ++i)
+            {
+                u64 range = i % 3 == 0 ? 500 : 20000;
+
+                from_vertex_ids[i] = test_random(&rng_state) % range;
+                to_vertex_ids[i] = test_random(&rng_state) % range;
+            }
+
+            gphrx_add_edges(&graph, from_vertex_ids, to_vertex_ids, edge_count);
+
+            GphrxCoresResult cores = gphrx_find_cores(&graph);
+
+            u64 ks[] = { 0, 1, 2, cores.max_core / 2, cores.max_core, cores.max_core + 1 };
+
+            for (u32 i = 0; i < sizeof(ks) / sizeof(ks[0]); ++i)
+            {
+                u64 k = ks[i];
+
+                // Alternate between passing the core numbers and having them found
+                GphrxGraph k_core = gphrx_find_k_core(&graph, i % 2 == 0 ? &cores : 0, k);
+
+                assert(k_core.is_undirected == graph.is_undirected, "Incorrect k-core direction");
+
+                // The k-core holds exactly the edges between vertices with core numbers of at least k, in
+                // their original order
+                size_t kept_idx = 0;
+                u64 dimension = k == 0 ? graph.adjacency_matrix.dimension : 0;
+
+                for (size_t edge = 0; edge < graph.adjacency_matrix.col_indices.size; ++edge)
+                {
+                    u64 from = dynarr8_get(&graph.adjacency_matrix.col_indices, edge).u64_val;
+                    u64 to = dynarr8_get(&graph.adjacency_matrix.row_indices, edge).u64_val;
+
+                    if (cores.core_numbers[from] < k || cores.core_numbers[to] < k)
+                        continue;
+
+                    assert(kept_idx < k_core.adjacency_matrix.col_indices.size, "Too few k-core edges");
+                    assert(dynarr8_get(&k_core.adjacency_matrix.col_indices, kept_idx).u64_val == from &&
+                           dynarr8_get(&k_core.adjacency_matrix.row_indices, kept_idx).u64_val == to,
+                           "Incorrect k-core edge");
+
+                    dimension = from + 1 > dimension ? from + 1 : dimension;
+                    dimension = to + 1 > dimension ? to + 1 : dimension;
+                    ++kept_idx;
+                }
+
+                assert(kept_idx == k_core.adjacency_matrix.col_indices.size, "Too many k-core edges");
+                assert(k_core.adjacency_matrix.dimension == dimension, "Incorrect k-core dimension");
+
+                // Peeling the k-core leaves the core numbers of its vertices as they were in the graph
+                GphrxCoresResult k_core_cores = gphrx_find_cores(&k_core);
+
+                for (u64 v = 0; v < k_core_cores.vertex_count; ++v)
+                {
+                    u64 expected_core = cores.core_numbers[v] >= k ? cores.core_numbers[v] : 0;
+                    assert(k_core_cores.core_numbers[v] == expected_core, "Incorrect k-core core number");
+                }
+
+                free_gphrx_cores_result(&k_core_cores);
+                free_gphrx(&k_core);
+            }
+
+            free(from_vertex_ids);
+            free(to_vertex_ids);
+            free_gphrx_cores_result(&cores);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet cores_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_find_cores);
+    register_test(&set, test_gphrx_find_k_core);
+
+    return set;
+}
+
+#endif
@@ -0,0 +1,662 @@
+#include "dgphrx.h"
+
+static GphrxCsrAdjacencyMatrix new_delta_matrix()
+{
+    GphrxCsrAdjacencyMatrix matrix = {
+        .dimension = 0,
+        .col_indices = new_dynarr8(),
+        .row_indices = new_dynarr8(),
+    };
+
+    return matrix;
+}
+
+static GphrxDeltaGraph new_dgphrx(GphrxGraph base)
+{
+    GphrxDeltaGraph graph = {
+        .base = base,
+        .inserts = new_delta_matrix(),
+        .deletes = new_delta_matrix(),
+        .compaction_ratio = GPHRX_DELTA_DEFAULT_COMPACTION_RATIO,
+    };
+
+    return graph;
+}
+
+DLLEXPORT GphrxDeltaGraph new_undirected_dgphrx()
+{
+    return new_dgphrx(new_undirected_gphrx());
+}
+
+DLLEXPORT GphrxDeltaGraph new_directed_dgphrx()
+{
+    return new_dgphrx(new_directed_gphrx());
+}
+
+DLLEXPORT GphrxDeltaGraph dgphrx_from_gphrx(GphrxGraph *restrict graph)
+{
+    return new_dgphrx(*graph);
+}
+
+DLLEXPORT GphrxDeltaGraph duplicate_dgphrx(GphrxDeltaGraph *restrict graph)
+{
+    GphrxDeltaGraph duplicate_graph = {
+        .base = duplicate_gphrx(&graph->base),
+        .inserts = {
+            .dimension = graph->inserts.dimension,
+            .col_indices = dynarr8_share(&graph->inserts.col_indices),
+            .row_indices = dynarr8_share(&graph->inserts.row_indices),
+        },
+        .deletes = {
+            .dimension = graph->deletes.dimension,
+            .col_indices = dynarr8_share(&graph->deletes.col_indices),
+            .row_indices = dynarr8_share(&graph->deletes.row_indices),
+        },
+        .compaction_ratio = graph->compaction_ratio,
+    };
+
+    return duplicate_graph;
+}
+
+DLLEXPORT void free_dgphrx(GphrxDeltaGraph *restrict graph)
+{
+    free_gphrx(&graph->base);
+    free_gphrx_csr_adj_matrix(&graph->inserts);
+    free_gphrx_csr_adj_matrix(&graph->deletes);
+}
+
+DLLEXPORT u64 dgphrx_dimension(GphrxDeltaGraph *restrict graph)
+{
+    u64 base_dimension = graph->base.adjacency_matrix.dimension;
+    return graph->inserts.dimension > base_dimension ? graph->inserts.dimension : base_dimension;
+}
+
+DLLEXPORT size_t dgphrx_edge_count(GphrxDeltaGraph *restrict graph)
+{
+    // Deletes are always edges of the base and inserts never are
+    return graph->base.adjacency_matrix.col_indices.size
+        - graph->deletes.col_indices.size
+        + graph->inserts.col_indices.size;
+}
+
+// Returns the index of the first edge in the matrix that is not less than from_vertex_id -> to_vertex_id
+static size_t lower_bound_edge(GphrxCsrAdjacencyMatrix *restrict matrix, u64 from_vertex_id, u64 to_vertex_id)
+{
+    u64 *col_indices = (u64*) matrix->col_indices.arr;
+    u64 *row_indices = (u64*) matrix->row_indices.arr;
+
+    size_t low = 0;
+    size_t high = matrix->col_indices.size;
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if (col_indices[middle] < from_vertex_id ||
+            (col_indices[middle] == from_vertex_id && row_indices[middle] < to_vertex_id))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+// Returns true if the matrix holds the edge. Either way, `idx` is set to where the edge is or would go.
+static bool find_edge(GphrxCsrAdjacencyMatrix *restrict matrix, u64 from_vertex_id, u64 to_vertex_id, size_t *idx)
+{
+    *idx = lower_bound_edge(matrix, from_vertex_id, to_vertex_id);
+
+    return *idx < matrix->col_indices.size &&
+        dynarr8_get(&matrix->col_indices, *idx).u64_val == from_vertex_id &&
+        dynarr8_get(&matrix->row_indices, *idx).u64_val == to_vertex_id;
+}
+
+static void insert_edge_at(GphrxCsrAdjacencyMatrix *restrict matrix, u64 from_vertex_id, u64 to_vertex_id, size_t idx)
+{
+    Byte8Val from_vertex_id_bv = { .u64_val = from_vertex_id };
+    Byte8Val to_vertex_id_bv = { .u64_val = to_vertex_id };
+
+    dynarr8_push_at(&matrix->col_indices, from_vertex_id_bv, idx);
+    dynarr8_push_at(&matrix->row_indices, to_vertex_id_bv, idx);
+}
+
+static void remove_edge_at(GphrxCsrAdjacencyMatrix *restrict matrix, size_t idx)
+{
+    dynarr8_remove_at(&matrix->col_indices, idx);
+    dynarr8_remove_at(&matrix->row_indices, idx);
+}
+
+static void add_directed_edge(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    size_t idx;
+
+    // Re-adding a deleted edge of the base just forgets the delete
+    if (find_edge(&graph->deletes, from_vertex_id, to_vertex_id, &idx))
+    {
+        remove_edge_at(&graph->deletes, idx);
+        return;
+    }
+
+    if (find_edge(&graph->base.adjacency_matrix, from_vertex_id, to_vertex_id, &idx))
+        return;
+
+    if (!find_edge(&graph->inserts, from_vertex_id, to_vertex_id, &idx))
+        insert_edge_at(&graph->inserts, from_vertex_id, to_vertex_id, idx);
+}
+
+// The edge must exist
+static void remove_directed_edge(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    size_t idx;
+
+    if (find_edge(&graph->inserts, from_vertex_id, to_vertex_id, &idx))
+    {
+        remove_edge_at(&graph->inserts, idx);
+        return;
+    }
+
+    if (!find_edge(&graph->deletes, from_vertex_id, to_vertex_id, &idx))
+        insert_edge_at(&graph->deletes, from_vertex_id, to_vertex_id, idx);
+}
+
+static void compact_if_needed(GphrxDeltaGraph *restrict graph)
+{
+    size_t delta_size = graph->inserts.col_indices.size + graph->deletes.col_indices.size;
+
+    if (delta_size >= GPHRX_DELTA_MIN_COMPACTION_SIZE &&
+        delta_size > graph->compaction_ratio * graph->base.adjacency_matrix.col_indices.size)
+    {
+        dgphrx_compact(graph);
+    }
+}
+
+DLLEXPORT bool dgphrx_does_edge_exist(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    size_t idx;
+
+    if (find_edge(&graph->inserts, from_vertex_id, to_vertex_id, &idx))
+        return true;
+
+    if (find_edge(&graph->deletes, from_vertex_id, to_vertex_id, &idx))
+        return false;
+
+    return find_edge(&graph->base.adjacency_matrix, from_vertex_id, to_vertex_id, &idx);
+}
+
+DLLEXPORT void dgphrx_add_edge(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    add_directed_edge(graph, from_vertex_id, to_vertex_id);
+
+    if (graph->base.is_undirected && from_vertex_id != to_vertex_id)
+        add_directed_edge(graph, to_vertex_id, from_vertex_id);
+
+    if (from_vertex_id + 1 > graph->inserts.dimension)
+        graph->inserts.dimension = from_vertex_id + 1;
+
+    if (to_vertex_id + 1 > graph->inserts.dimension)
+        graph->inserts.dimension = to_vertex_id + 1;
+
+    compact_if_needed(graph);
+}
+
+DLLEXPORT GphrxErrorCode dgphrx_remove_edge(GphrxDeltaGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    if (!dgphrx_does_edge_exist(graph, from_vertex_id, to_vertex_id))
+        return GPHRX_ERROR_NOT_FOUND;
+
+    remove_directed_edge(graph, from_vertex_id, to_vertex_id);
+
+    if (graph->base.is_undirected && from_vertex_id != to_vertex_id)
+        remove_directed_edge(graph, to_vertex_id, from_vertex_id);
+
+    compact_if_needed(graph);
+
+    return GPHRX_NO_ERROR;
+}
+
+DLLEXPORT GphrxGraph dgphrx_to_gphrx(GphrxDeltaGraph *restrict graph)
+{
+    size_t base_count = graph->base.adjacency_matrix.col_indices.size;
+    size_t insert_count = graph->inserts.col_indices.size;
+    size_t delete_count = graph->deletes.col_indices.size;
+    size_t edge_count = dgphrx_edge_count(graph);
+
+    if (insert_count == 0 && delete_count == 0)
+    {
+        GphrxGraph duplicate_base = duplicate_gphrx(&graph->base);
+        duplicate_base.adjacency_matrix.dimension = dgphrx_dimension(graph);
+
+        return duplicate_base;
+    }
+
+    GphrxGraph merged = {
+        .is_undirected = graph->base.is_undirected,
+        .adjacency_matrix = {
+            .dimension = dgphrx_dimension(graph),
+            .col_indices = new_dynarr8_with_capacity(edge_count + 1),
+            .row_indices = new_dynarr8_with_capacity(edge_count + 1),
+        },
+    };
+
+    u64 *base_cols = (u64*) graph->base.adjacency_matrix.col_indices.arr;
+    u64 *base_rows = (u64*) graph->base.adjacency_matrix.row_indices.arr;
+    u64 *insert_cols = (u64*) graph->inserts.col_indices.arr;
+    u64 *insert_rows = (u64*) graph->inserts.row_indices.arr;
+    u64 *delete_cols = (u64*) graph->deletes.col_indices.arr;
+    u64 *delete_rows = (u64*) graph->deletes.row_indices.arr;
+    u64 *merged_cols = (u64*) merged.adjacency_matrix.col_indices.arr;
+    u64 *merged_rows = (u64*) merged.adjacency_matrix.row_indices.arr;
+
+    size_t base_idx = 0;
+    size_t insert_idx = 0;
+    size_t delete_idx = 0;
+    size_t merged_idx = 0;
+
+    // The deletes are a sorted subset of the base, so they are skipped by walking them alongside it
+    while (base_idx < base_count || insert_idx < insert_count)
+    {
+        bool is_insert_next = base_idx == base_count ||
+            (insert_idx < insert_count &&
+             (insert_cols[insert_idx] < base_cols[base_idx] ||
+              (insert_cols[insert_idx] == base_cols[base_idx] && insert_rows[insert_idx] < base_rows[base_idx])));
+
+        if (is_insert_next)
+        {
+            merged_cols[merged_idx] = insert_cols[insert_idx];
+            merged_rows[merged_idx] = insert_rows[insert_idx];
+            ++insert_idx;
+            ++merged_idx;
+        }
+        else if (delete_idx < delete_count &&
+                 delete_cols[delete_idx] == base_cols[base_idx] &&
+                 delete_rows[delete_idx] == base_rows[base_idx])
+        {
+            ++delete_idx;
+            ++base_idx;
+        }
+        else
+        {
+            merged_cols[merged_idx] = base_cols[base_idx];
+            merged_rows[merged_idx] = base_rows[base_idx];
+            ++base_idx;
+            ++merged_idx;
+        }
+    }
+
+    merged.adjacency_matrix.col_indices.size = merged_idx;
+    merged.adjacency_matrix.row_indices.size = merged_idx;
+
+    return merged;
+}
+
+DLLEXPORT void dgphrx_compact(GphrxDeltaGraph *restrict graph)
+{
+    if (graph->inserts.col_indices.size == 0 && graph->deletes.col_indices.size == 0)
+        return;
+
+    GphrxGraph merged = dgphrx_to_gphrx(graph);
+
+    free_gphrx(&graph->base);
+    graph->base = merged;
+
+    graph->inserts.dimension = 0;
+    graph->inserts.col_indices.size = 0;
+    graph->inserts.row_indices.size = 0;
+    graph->deletes.col_indices.size = 0;
+    graph->deletes.row_indices.size = 0;
+}
+
+// Adds `delta` to the count of the block holding each edge of the matrix
+static void adjust_block_occurrences(GphrxCsrAdjacencyMatrix *restrict matrix,
+                                     u64 *restrict occurrences,
+                                     FastDivisor *restrict divisor,
+                                     u64 blocks_per_row,
+                                     u64 delta)
+{
+    for (size_t i = 0; i < matrix->col_indices.size; ++i)
+    {
+        u64 col_pos = fast_divisor_divide(divisor, dynarr8_get(&matrix->col_indices, i).u64_val);
+        u64 row_pos = fast_divisor_divide(divisor, dynarr8_get(&matrix->row_indices, i).u64_val);
+
+        occurrences[row_pos * blocks_per_row + col_pos] += delta;
+    }
+}
+
+static GphrxCsrMatrix find_avg_pool_matrix(GphrxDeltaGraph *restrict graph,
+                                           u64 block_dimension,
+                                           GphrxAllocator *allocator)
+{
+    if (block_dimension < 1)
+        block_dimension = 1;
+
+    u64 vertex_count = dgphrx_dimension(graph);
+
+    if (block_dimension > vertex_count)
+        block_dimension = vertex_count;
+
+    u64 blocks_per_row = _gphrx_avg_pool_blocks_per_row(vertex_count, block_dimension);
+    u64 block_count = blocks_per_row * blocks_per_row;
+
+    u64 *occurrences = calloc(block_count, sizeof(u64));
+    assert(occurrences != 0, "calloc failure");
+
+    _gphrx_count_block_occurrences(&graph->base.adjacency_matrix,
+                                   occurrences,
+                                   vertex_count,
+                                   block_dimension,
+                                   blocks_per_row);
+
+    // Every delete was counted with the base, so subtracting it (by wrapping around) can't underflow a block
+    FastDivisor divisor = new_fast_divisor(block_dimension);
+    adjust_block_occurrences(&graph->inserts, occurrences, &divisor, blocks_per_row, 1);
+    adjust_block_occurrences(&graph->deletes, occurrences, &divisor, blocks_per_row, (u64) -1);
+
+    GphrxCsrMatrix occurrence_matrix = _gphrx_avg_pool_matrix_from_occurrences(occurrences,
+                                                                              blocks_per_row,
+                                                                              block_dimension,
+                                                                              1.0,
+                                                                              allocator);
+
+    free(occurrences);
+
+    return occurrence_matrix;
+}
+
+DLLEXPORT GphrxCsrMatrix dgphrx_find_avg_pool_matrix(GphrxDeltaGraph *restrict graph, u64 block_dimension)
+{
+    return find_avg_pool_matrix(graph, block_dimension, gphrx_get_allocator());
+}
+
+DLLEXPORT GphrxGraph approximate_dgphrx(GphrxDeltaGraph *restrict graph, u64 block_dimension, double threshold)
+{
+    if (block_dimension <= 1 || dgphrx_edge_count(graph) <= 1)
+        return dgphrx_to_gphrx(graph);
+
+    GphrxArena *scratch_arena = _gphrx_scratch_arena();
+    GphrxArenaMark scratch_mark = gphrx_arena_mark(scratch_arena);
+
+    GphrxCsrMatrix occurrence_matrix = find_avg_pool_matrix(graph, block_dimension, &scratch_arena->allocator);
+    GphrxGraph approx_graph = _gphrx_approximation_from_avg_pool_matrix(&occurrence_matrix,
+                                                                        graph->base.is_undirected,
+                                                                        threshold);
+
+    gphrx_arena_rewind(scratch_arena, scratch_mark);
+
+    return approx_graph;
+}
+
+
+#ifdef TEST_MODE
+
+#define TEST_VERTEX_COUNT 64
+
+// Checks the delta graph against a dense adjacency matrix
+static bool matches_dense_matrix(GphrxDeltaGraph *restrict graph, bool *dense)
+{
+    size_t edge_count = 0;
+
+    for (u64 from = 0; from < TEST_VERTEX_COUNT; ++from)
+    {
+        for (u64 to = 0; to < TEST_VERTEX_COUNT; ++to)
+        {
+            if (dgphrx_does_edge_exist(graph, from, to) != dense[from * TEST_VERTEX_COUNT + to])
+                return false;
+
+            edge_count += dense[from * TEST_VERTEX_COUNT + to];
+        }
+    }
+
+    if (dgphrx_edge_count(graph) != edge_count)
+        return false;
+
+    GphrxGraph merged = dgphrx_to_gphrx(graph);
+    bool is_match = merged.adjacency_matrix.col_indices.size == edge_count;
+
+    for (size_t i = 0; is_match && i < edge_count; ++i)
+    {
+        u64 from = dynarr8_get(&merged.adjacency_matrix.col_indices, i).u64_val;
+        u64 to = dynarr8_get(&merged.adjacency_matrix.row_indices, i).u64_val;
+
+        is_match = dense[from * TEST_VERTEX_COUNT + to];
+
+        if (i != 0)
+        {
+            u64 prev_from = dynarr8_get(&merged.adjacency_matrix.col_indices, i - 1).u64_val;
+            u64 prev_to = dynarr8_get(&merged.adjacency_matrix.row_indices, i - 1).u64_val;
+
+            is_match = is_match && (prev_from < from || (prev_from == from && prev_to < to));
+        }
+    }
+
+    free_gphrx(&merged);
+
+    return is_match;
+}
+
+static TEST_RESULT test_dgphrx_add_and_remove_edge()
+{
+    bool *dense = malloc(sizeof(bool) * TEST_VERTEX_COUNT * TEST_VERTEX_COUNT);
+
+    for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+    {
+        GphrxDeltaGraph graph = is_undirected ? new_undirected_dgphrx() : new_directed_dgphrx();
+        memset(dense, 0, sizeof(bool) * TEST_VERTEX_COUNT * TEST_VERTEX_COUNT);
+
+        u64 rng_state = 17 + is_undirected;
+
+        for (u32 step = 0; step < 6000; ++step)
+        {
+            u64 from = test_random(&rng_state) % TEST_VERTEX_COUNT;
+            u64 to = test_random(&rng_state) % TEST_VERTEX_COUNT;
+
+            // Adds outnumber removes so the graph grows past the minimum compaction size
+            if (test_random(&rng_state) % 3 != 0)
+            {
+                dgphrx_add_edge(&graph, from, to);
+
+                dense[from * TEST_VERTEX_COUNT + to] = true;
+                if (is_undirected)
+                    dense[to * TEST_VERTEX_COUNT + from] = true;
+            }
+            else
+            {
+                GphrxErrorCode error = dgphrx_remove_edge(&graph, from, to);
+                assert(error == (dense[from * TEST_VERTEX_COUNT + to] ? GPHRX_NO_ERROR : GPHRX_ERROR_NOT_FOUND),
+                       "Incorrect error removing edge");
+
+                dense[from * TEST_VERTEX_COUNT + to] = false;
+                if (is_undirected)
+                    dense[to * TEST_VERTEX_COUNT + from] = false;
+            }
+
+            if (step % 500 == 0)
+            {
+                assert(matches_dense_matrix(&graph, dense), "Delta graph does not match reference");
+            }
+
+            // Deletes are only ever recorded for edges of the base
+            if (step % 2000 == 1999)
+                dgphrx_compact(&graph);
+        }
+
+        assert(matches_dense_matrix(&graph, dense), "Delta graph does not match reference");
+        assert(graph.base.adjacency_matrix.col_indices.size > GPHRX_DELTA_MIN_COMPACTION_SIZE, "Graph too small");
+
+        dgphrx_compact(&graph);
+        assert(graph.inserts.col_indices.size == 0 && graph.deletes.col_indices.size == 0, "Delta not emptied");
+        assert(matches_dense_matrix(&graph, dense), "Compacted graph does not match reference");
+
+        free_dgphrx(&graph);
+    }
+
+    free(dense);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_dgphrx_compaction_ratio()
+{
+    GphrxDeltaGraph graph = new_directed_dgphrx();
+
+    for (u64 i = 0; i < 20000; ++i)
+    {
+        dgphrx_add_edge(&graph, i % 1000, i / 1000);
+
+        size_t delta_size = graph.inserts.col_indices.size + graph.deletes.col_indices.size;
+        size_t base_size = graph.base.adjacency_matrix.col_indices.size;
+
+        assert(delta_size <= GPHRX_DELTA_MIN_COMPACTION_SIZE || delta_size <= graph.compaction_ratio * base_size + 1,
+               "Delta grew past the compaction ratio");
+    }
+
+    assert(dgphrx_edge_count(&graph) == 20000, "Incorrect edge count");
+    assert(dgphrx_dimension(&graph) == 1000, "Incorrect dimension");
+
+    free_dgphrx(&graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_duplicate_dgphrx()
+{
+    GphrxGraph base = new_directed_gphrx();
+
+    for (u64 i = 0; i < 5000; ++i)
+        gphrx_add_edge(&base, i % 100, i / 100);
+
+    GphrxDeltaGraph graph = dgphrx_from_gphrx(&base);
+    dgphrx_add_edge(&graph, 200, 1);
+
+    GphrxDeltaGraph duplicate_graph = duplicate_dgphrx(&graph);
+
+    // Editing the duplicate leaves the base shared and copies only the overlays
+    dgphrx_add_edge(&duplicate_graph, 300, 2);
+    assert(dgphrx_remove_edge(&duplicate_graph, 5, 5) == GPHRX_NO_ERROR, "Failed to remove edge");
+
+    assert(duplicate_graph.base.adjacency_matrix.col_indices.arr == graph.base.adjacency_matrix.col_indices.arr,
+           "Duplicate did not share base");
+    assert(duplicate_graph.inserts.col_indices.arr != graph.inserts.col_indices.arr,
+           "Modified duplicate still shares inserts");
+
+    assert(dgphrx_edge_count(&graph) == 5001, "Incorrect edge count");
+    assert(dgphrx_edge_count(&duplicate_graph) == 5001, "Incorrect edge count");
+    assert(dgphrx_dimension(&duplicate_graph) == 301, "Incorrect dimension");
+
+    assert(dgphrx_does_edge_exist(&graph, 5, 5), "Modifying duplicate changed the original");
+    assert(!dgphrx_does_edge_exist(&graph, 300, 2), "Modifying duplicate changed the original");
+    assert(!dgphrx_does_edge_exist(&duplicate_graph, 5, 5), "Edge not removed");
+    assert(dgphrx_does_edge_exist(&duplicate_graph, 300, 2), "Edge not added");
+    assert(dgphrx_does_edge_exist(&duplicate_graph, 200, 1), "Shared edge lost");
+
+    free_dgphrx(&graph);
+
+    GphrxGraph merged = dgphrx_to_gphrx(&duplicate_graph);
+    assert(merged.adjacency_matrix.col_indices.size == 5001, "Incorrect edge count");
+
+    dgphrx_compact(&duplicate_graph);
+    assert(dgphrx_does_edge_exist(&duplicate_graph, 300, 2), "Compaction lost edge");
+
+    // With an empty delta, the base is shared with the converted graph
+    GphrxGraph converted = dgphrx_to_gphrx(&duplicate_graph);
+    assert(converted.adjacency_matrix.col_indices.arr == duplicate_graph.base.adjacency_matrix.col_indices.arr,
+           "Converted graph did not share base");
+    assert(converted.adjacency_matrix.dimension == 301, "Incorrect dimension");
+
+    free_dgphrx(&duplicate_graph);
+    free_gphrx(&merged);
+    free_gphrx(&converted);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_dgphrx_avg_pool_and_approximate()
+{
+    GphrxGraph base = new_directed_gphrx();
+
+    for (u64 i = 0; i < 40; ++i)
+    {
+        gphrx_add_edge(&base, i, (i * 7) % 40);
+        gphrx_add_edge(&base, i, (i * 3 + 1) % 40);
+    }
+
+    GphrxDeltaGraph graph = dgphrx_from_gphrx(&base);
+
+    // Stays well below the minimum compaction size, so the delta is pooled alongside the base
+    for (u64 i = 0; i < 40; i += 3)
+        dgphrx_remove_edge(&graph, i, (i * 7) % 40);
+
+    for (u64 i = 0; i < 45; i += 2)
+        dgphrx_add_edge(&graph, (i * 5) % 45, i);
+
+    assert(graph.inserts.col_indices.size != 0 && graph.deletes.col_indices.size != 0, "Delta unexpectedly empty");
+
+    GphrxGraph merged = dgphrx_to_gphrx(&graph);
+
+    u64 block_dimensions[] = {1, 3, 4, 7, 45, 100};
+    for (u32 i = 0; i < sizeof(block_dimensions) / sizeof(u64); ++i)
+    {
+        GphrxCsrMatrix expected = gphrx_find_avg_pool_matrix(&merged, block_dimensions[i]);
+        GphrxCsrMatrix actual = dgphrx_find_avg_pool_matrix(&graph, block_dimensions[i]);
+
+        assert(actual.dimension == expected.dimension, "Incorrect avg pool matrix dimension");
+        assert(actual.entries.size == expected.entries.size, "Incorrect avg pool matrix");
+
+        for (size_t j = 0; j < expected.entries.size; ++j)
+        {
+            assert(dynarr8_get(&actual.entries, j).dbl_val == dynarr8_get(&expected.entries, j).dbl_val,
+                   "Incorrect avg pool matrix");
+            assert(dynarr8_get(&actual.col_indices, j).u64_val == dynarr8_get(&expected.col_indices, j).u64_val,
+                   "Incorrect avg pool matrix");
+            assert(dynarr8_get(&actual.row_indices, j).u64_val == dynarr8_get(&expected.row_indices, j).u64_val,
+                   "Incorrect avg pool matrix");
+        }
+
+        free_gphrx_csr_matrix(&expected);
+        free_gphrx_csr_matrix(&actual);
+
+        GphrxGraph expected_approx = approximate_gphrx(&merged, block_dimensions[i], 0.1);
+        GphrxGraph actual_approx = approximate_dgphrx(&graph, block_dimensions[i], 0.1);
+
+        assert(actual_approx.adjacency_matrix.dimension == expected_approx.adjacency_matrix.dimension,
+               "Incorrect approximation dimension");
+        assert(actual_approx.adjacency_matrix.col_indices.size == expected_approx.adjacency_matrix.col_indices.size,
+               "Incorrect approximation");
+
+        for (size_t j = 0; j < expected_approx.adjacency_matrix.col_indices.size; ++j)
+        {
+            assert(dynarr8_get(&actual_approx.adjacency_matrix.col_indices, j).u64_val ==
+                   dynarr8_get(&expected_approx.adjacency_matrix.col_indices, j).u64_val,
+                   "Incorrect approximation");
+            assert(dynarr8_get(&actual_approx.adjacency_matrix.row_indices, j).u64_val ==
+                   dynarr8_get(&expected_approx.adjacency_matrix.row_indices, j).u64_val,
+                   "Incorrect approximation");
+        }
+
+        free_gphrx(&expected_approx);
+        free_gphrx(&actual_approx);
+    }
+
+    free_gphrx(&merged);
+    free_dgphrx(&graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet dgphrx_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_dgphrx_add_and_remove_edge);
+    register_test(&set, test_dgphrx_compaction_ratio);
+    register_test(&set, test_duplicate_dgphrx);
+    register_test(&set, test_dgphrx_avg_pool_and_approximate);
+
+    return set;
+}
+
+#endif
@@ -2,7 +2,12 @@
 
 DynamicArray8 new_dynarr8_with_capacity(size_t start_capacity)
 {
-    Byte8Val *arr = malloc(sizeof(Byte8Val) * start_capacity);
+    return new_dynarr8_with_allocator(start_capacity, gphrx_get_allocator());
+}
+
+DynamicArray8 new_dynarr8_with_allocator(size_t start_capacity, GphrxAllocator *allocator)
+{
+    Byte8Val *arr = _gphrx_alloc(allocator, sizeof(Byte8Val) * start_capacity);
 
     assert(arr != 0, "malloc failure");
 
@@ -10,20 +15,123 @@ DynamicArray8 new_dynarr8_with_capacity(size_t start_capacity)
         .capacity = start_capacity,
         .size = 0,
         .arr = arr,
+        .ref_count = 0,
+        .allocator = allocator,
     };
     
     return vec;
 }
 
-void dynarr8_shrink(DynamicArray8 *arr)
+void free_dynarr8(DynamicArray8 *arr)
 {
-    size_t new_capacity = arr->size;
-    Byte8Val *new_arr = realloc(arr->arr, new_capacity * sizeof(Byte8Val));
-    
-    assert(new_arr != 0, "realloc failue");
-    
+    if (arr->ref_count != 0)
+    {
+        if (atomic_fetch_sub_explicit(arr->ref_count, 1, memory_order_acq_rel) != 1)
+            return;
+
+        free(arr->ref_count);
+    }
+
+    _gphrx_free(arr->allocator, arr->arr, arr->capacity * sizeof(Byte8Val));
+}
+
+DynamicArray8 dynarr8_share(DynamicArray8 *arr)
+{
+    atomic_size_t *ref_count = atomic_load_explicit(&arr->ref_count, memory_order_acquire);
+
+    // Threads that share an unshared array at the same time each allocate a count. The first to install
+    // its count wins, and the others free theirs and use the winner's.
+    if (ref_count == 0)
+    {
+        atomic_size_t *new_ref_count = malloc(sizeof(atomic_size_t));
+        assert(new_ref_count != 0, "malloc failure");
+
+        atomic_init(new_ref_count, 1);
+
+        if (atomic_compare_exchange_strong_explicit(&arr->ref_count, &ref_count, new_ref_count,
+                                                    memory_order_acq_rel, memory_order_acquire))
+            ref_count = new_ref_count;
+        else
+            free(new_ref_count);
+    }
+
+    atomic_fetch_add_explicit(ref_count, 1, memory_order_relaxed);
+
+    // Built field by field rather than copied, so the count is only ever read atomically
+    DynamicArray8 shared = {
+        .capacity = arr->capacity,
+        .size = arr->size,
+        .arr = arr->arr,
+        .ref_count = ref_count,
+        .allocator = arr->allocator,
+    };
+
+    return shared;
+}
+
+// Moves the array's contents into a buffer of the given capacity. A shared buffer is copied rather than
+// reallocated, and left to the arrays still sharing it.
+static void reallocate_dynarr8(DynamicArray8 *arr, size_t new_capacity)
+{
+    if (arr->ref_count != 0 && atomic_load_explicit(arr->ref_count, memory_order_acquire) == 1)
+    {
+        free(arr->ref_count);
+        arr->ref_count = 0;
+    }
+
+    if (arr->ref_count == 0)
+    {
+        Byte8Val *new_arr = _gphrx_resize(arr->allocator,
+                                          arr->arr,
+                                          arr->capacity * sizeof(Byte8Val),
+                                          new_capacity * sizeof(Byte8Val));
+
+        assert(new_arr != 0, "realloc failue");
+
+        arr->arr = new_arr;
+        arr->capacity = new_capacity;
+
+        return;
+    }
+
+    Byte8Val *new_arr = _gphrx_alloc(arr->allocator, new_capacity * sizeof(Byte8Val));
+
+    assert(new_arr != 0, "malloc failure");
+
+    memcpy(new_arr, arr->arr, (arr->size < new_capacity ? arr->size : new_capacity) * sizeof(Byte8Val));
+
+    // Only let go of the shared buffer once it has been copied, as the last array sharing it may free it
+    if (atomic_fetch_sub_explicit(arr->ref_count, 1, memory_order_acq_rel) == 1)
+    {
+        free(arr->ref_count);
+        _gphrx_free(arr->allocator, arr->arr, arr->capacity * sizeof(Byte8Val));
+    }
+
     arr->arr = new_arr;
     arr->capacity = new_capacity;
+    arr->ref_count = 0;
+}
+
+void dynarr8_make_unique(DynamicArray8 *arr)
+{
+    if (arr->ref_count == 0)
+        return;
+
+    // The other arrays that shared the buffer have all been freed or modified
+    if (atomic_load_explicit(arr->ref_count, memory_order_acquire) == 1)
+    {
+        free(arr->ref_count);
+        arr->ref_count = 0;
+
+        return;
+    }
+
+    reallocate_dynarr8(arr, arr->capacity);
+}
+
+void dynarr8_shrink(DynamicArray8 *arr)
+{
+    reallocate_dynarr8(arr, arr->size);
 }
 
 void dynarr8_expand(DynamicArray8 *arr, size_t desired_capacity)
@@ -31,12 +139,7 @@ void dynarr8_expand(DynamicArray8 *arr, size_t desired_capacity)
     if (desired_capacity <= arr->capacity)
         return;
     
-    Byte8Val *new_arr = realloc(arr->arr, desired_capacity * sizeof(Byte8Val));
-    
-    assert(new_arr != 0, "realloc failue");
-    
-    arr->arr = new_arr;
-    arr->capacity = desired_capacity;
+    reallocate_dynarr8(arr, desired_capacity);
 }
 
 void dynarr8_grow_and_zero(DynamicArray8* arr, size_t desired_size)
@@ -45,9 +148,10 @@ void dynarr8_grow_and_zero(DynamicArray8* arr, size_t desired_size)
         return;
     
     dynarr8_expand(arr, desired_size);
+    dynarr8_make_unique(arr);
     
     size_t delta = desired_size - arr->size;
-    memset(arr->arr + arr->size, 0, delta);
+    memset(arr->arr + arr->size, 0, delta * sizeof(Byte8Val));
     
     arr->size = desired_size;
 }
@@ -56,17 +160,14 @@ void dynarr8_push_multiple(DynamicArray8 *arr, Byte8Val *item_arr, size_t count)
 {
     if (arr->size + count >= arr->capacity)
     {
-        size_t new_capacity = arr->capacity * 2;
+        size_t new_capacity = arr->capacity == 0 ? 1 : arr->capacity * 2;
         for(; new_capacity < arr->size + count; new_capacity *= 2);
 
-        Byte8Val *new_arr = realloc(arr->arr, new_capacity * sizeof(Byte8Val));
-
-        assert(new_arr != 0, "realloc failue");
-
-        arr->arr = new_arr;
-        arr->capacity = new_capacity;
+        reallocate_dynarr8(arr, new_capacity);
     }
 
+    dynarr8_make_unique(arr);
+
     memcpy(arr->arr + arr->size, item_arr, count * sizeof(Byte8Val));
     arr->size += count;
 }
@@ -74,6 +175,7 @@ void dynarr8_push_multiple(DynamicArray8 *arr, Byte8Val *item_arr, size_t count)
 void dynarr8_remove_at(DynamicArray8 *arr, size_t idx)
 {
     assert(arr->size > idx, "Invalid array index");
+    dynarr8_make_unique(arr);
     memmove(arr->arr + idx, arr->arr + idx + 1, (arr->size - idx - 1) * sizeof(Byte8Val));
     --arr->size;
 }
@@ -81,6 +183,7 @@ void dynarr8_remove_at(DynamicArray8 *arr, size_t idx)
 void dynarr8_remove_multiple_at(DynamicArray8 *arr, size_t start_idx, size_t count)
 {
     assert(arr->size >= start_idx + count, "Invalid array index or count");
+    dynarr8_make_unique(arr);
     memmove(arr->arr + start_idx,
             arr->arr + start_idx + count,
             (arr->size - start_idx - count) * sizeof(Byte8Val));
@@ -93,23 +196,123 @@ void _dynarr8_push_at(DynamicArray8 *arr, Byte8Val item, size_t idx)
     
     if (arr->size == arr->capacity)
     {
-        Byte8Val *new_arr = realloc(arr->arr, arr->capacity * sizeof(Byte8Val) * 2);
+        // Arrays created empty (e.g. by duplicating an empty graph) have no capacity to double
+        reallocate_dynarr8(arr, arr->capacity == 0 ? 1 : arr->capacity * 2);
+    }
+
+    dynarr8_make_unique(arr);
+
+    Byte8Val *location = arr->arr + idx;
+    
+    if (idx != arr->size)
+        memmove(location + 1, location, (arr->size - idx) * sizeof(Byte8Val));
+
+    arr->arr[idx] = item;
+    ++arr->size;
+}
+
+DynamicArray4 new_dynarr4_with_capacity(size_t start_capacity)
+{
+    Byte4Val *arr = malloc(sizeof(Byte4Val) * start_capacity);
+
+    assert(arr != 0, "malloc failure");
+
+    DynamicArray4 vec = {
+        .capacity = start_capacity,
+        .size = 0,
+        .arr = arr,
+    };
+    
+    return vec;
+}
+
+void dynarr4_shrink(DynamicArray4 *arr)
+{
+    size_t new_capacity = arr->size;
+
+    // realloc may return null for zero bytes, which would look like a failure
+    Byte4Val *new_arr = realloc(arr->arr, (new_capacity == 0 ? 1 : new_capacity) * sizeof(Byte4Val));
+    
+    assert(new_arr != 0, "realloc failue");
+    
+    arr->arr = new_arr;
+    arr->capacity = new_capacity;
+}
+
+void dynarr4_expand(DynamicArray4 *arr, size_t desired_capacity)
+{
+    if (desired_capacity <= arr->capacity)
+        return;
+    
+    Byte4Val *new_arr = realloc(arr->arr, desired_capacity * sizeof(Byte4Val));
+    
+    assert(new_arr != 0, "realloc failue");
+    
+    arr->arr = new_arr;
+    arr->capacity = desired_capacity;
+}
+
+void dynarr4_remove_at(DynamicArray4 *arr, size_t idx)
+{
+    assert(arr->size > idx, "Invalid array index");
+    memmove(arr->arr + idx, arr->arr + idx + 1, (arr->size - idx - 1) * sizeof(Byte4Val));
+    --arr->size;
+}
+
+void dynarr4_remove_multiple_at(DynamicArray4 *arr, size_t start_idx, size_t count)
+{
+    assert(arr->size >= start_idx + count, "Invalid array index or count");
+    memmove(arr->arr + start_idx,
+            arr->arr + start_idx + count,
+            (arr->size - start_idx - count) * sizeof(Byte4Val));
+    arr->size -= count;
+}
+
+void _dynarr4_push_at(DynamicArray4 *arr, Byte4Val item, size_t idx)
+{
+    assert(arr->size >= idx, "Invalid array index");
+    
+    if (arr->size == arr->capacity)
+    {
+        // Arrays created empty (e.g. by duplicating an empty graph) have no capacity to double
+        size_t new_capacity = arr->capacity == 0 ? 1 : arr->capacity * 2;
+        Byte4Val *new_arr = realloc(arr->arr, new_capacity * sizeof(Byte4Val));
 
         assert(new_arr != 0, "realloc failue");
 
         arr->arr = new_arr;
-        arr->capacity *= 2;
+        arr->capacity = new_capacity;
     }
 
-    Byte8Val *location = arr->arr + idx;
+    Byte4Val *location = arr->arr + idx;
     
     if (idx != arr->size)
-        memmove(location + 1, location, (arr->size - idx) * sizeof(Byte8Val));
+        memmove(location + 1, location, (arr->size - idx) * sizeof(Byte4Val));
 
     arr->arr[idx] = item;
     ++arr->size;
 }
 
+void *_gphrx_dynarr_grow(GphrxAllocator *allocator,
+                         void *arr,
+                         size_t *capacity,
+                         size_t desired_capacity,
+                         size_t element_size)
+{
+    size_t new_capacity = *capacity * 2;
+
+    if (new_capacity < desired_capacity)
+        new_capacity = desired_capacity;
+
+    void *new_arr = _gphrx_resize(allocator, arr, *capacity * element_size, new_capacity * element_size);
+
+    assert(new_arr != 0, "realloc failue");
+
+    *capacity = new_capacity;
+
+    return new_arr;
+}
+
 #ifdef TEST_MODE
 
 static TEST_RESULT test_new_dynarr8() {
@@ -461,6 +664,179 @@ static TEST_RESULT test_dynarr8_remove_multiple_at() {
     return TEST_PASS;
 }
 
+static TEST_RESULT test_dynarr8_share() {
+    DynamicArray8 arr = new_dynarr8();
+
+    for (u64 i = 0; i < 10; ++i)
+    {
+        Byte8Val val = { .u64_val = i };
+        dynarr8_push(&arr, val);
+    }
+
+    DynamicArray8 shared1 = dynarr8_share(&arr);
+    DynamicArray8 shared2 = dynarr8_share(&arr);
+
+    assert(shared1.arr == arr.arr && shared2.arr == arr.arr, "Array not shared");
+    assert(*arr.ref_count == 3, "Incorrect reference count");
+
+    Byte8Val val = { .u64_val = 100 };
+    dynarr8_push_at(&shared1, val, 0);
+    dynarr8_remove_at(&shared2, 9);
+
+    assert(shared1.arr != arr.arr && shared2.arr != arr.arr, "Modified array still shared");
+    assert(shared1.ref_count == 0 && shared2.ref_count == 0, "Modified array still shared");
+
+    assert(arr.size == 10, "Incorrect array size");
+    assert(shared1.size == 11, "Incorrect array size");
+    assert(shared2.size == 9, "Incorrect array size");
+
+    for (u64 i = 0; i < 10; ++i)
+    {
+        assert(arr.arr[i].u64_val == i, "Modifying shared array changed the original");
+        assert(shared1.arr[i + 1].u64_val == i, "Incorrect value in array");
+    }
+
+    assert(shared1.arr[0].u64_val == 100, "Incorrect value in array");
+    assert(shared2.arr[8].u64_val == 8, "Incorrect value in array");
+
+    // The original is the last array left using the buffer, so it can keep it
+    Byte8Val *original_buffer = arr.arr;
+    dynarr8_make_unique(&arr);
+
+    assert(arr.arr == original_buffer, "Unshared buffer was copied");
+    assert(arr.ref_count == 0, "Unshared array still counts references");
+
+    free_dynarr8(&arr);
+    free_dynarr8(&shared1);
+    free_dynarr8(&shared2);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_dynarr4_push_at() {
+    DynamicArray4 arr = new_dynarr4();
+
+    Byte4Val val1 = { .u32_val = 41 };
+    Byte4Val val2 = { .u32_val = 66 };
+    Byte4Val val3 = { .flt_val = 1.7f };
+    Byte4Val val4 = { .u32_val = 167 };
+
+    dynarr4_push(&arr, val1);
+    dynarr4_push(&arr, val2);
+    dynarr4_push(&arr, val3);
+
+    dynarr4_push_at(&arr, val4, 1);
+
+    assert(arr.size == 4, "Incorrect array size");
+    assert(arr.capacity == 4, "Incorrect array capacity");
+
+    assert(arr.arr[0].u32_val == val1.u32_val, "Incorrect value in array");
+    assert(arr.arr[1].u32_val == val4.u32_val, "Incorrect value in array");
+    assert(arr.arr[2].u32_val == val2.u32_val, "Incorrect value in array");
+    assert(arr.arr[3].flt_val == val3.flt_val, "Incorrect value in array");
+
+    free_dynarr4(&arr);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_dynarr4_remove_multiple_at() {
+    DynamicArray4 arr = new_dynarr4();
+
+    for (u32 i = 0; i < 10; ++i)
+    {
+        Byte4Val val = { .u32_val = i };
+        dynarr4_push(&arr, val);
+    }
+
+    assert(arr.size == 10, "Incorrect array size");
+
+    dynarr4_remove_multiple_at(&arr, 3, 4);
+    dynarr4_remove_at(&arr, 0);
+
+    assert(arr.size == 5, "Incorrect array size");
+
+    assert(arr.arr[0].u32_val == 1, "Incorrect value in array");
+    assert(arr.arr[1].u32_val == 2, "Incorrect value in array");
+    assert(arr.arr[2].u32_val == 7, "Incorrect value in array");
+    assert(arr.arr[3].u32_val == 8, "Incorrect value in array");
+    assert(arr.arr[4].u32_val == 9, "Incorrect value in array");
+
+    dynarr4_shrink(&arr);
+    assert(arr.capacity == 5, "Incorrect array capacity");
+
+    // An emptied array can still be shrunk and then grown again
+    dynarr4_remove_multiple_at(&arr, 0, 5);
+    dynarr4_shrink(&arr);
+
+    assert(arr.size == 0, "Incorrect array size");
+    assert(arr.capacity == 0, "Incorrect array capacity");
+
+    Byte4Val val = { .u32_val = 42 };
+    dynarr4_push(&arr, val);
+
+    assert(arr.size == 1, "Incorrect array size");
+    assert(arr.arr[0].u32_val == 42, "Incorrect value in array");
+
+    free_dynarr4(&arr);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_typed_dynarr() {
+    DynamicArrayU32 arr = new_dynarr_u32_with_capacity(0);
+
+    for (u32 i = 0; i < 100; ++i)
+        dynarr_u32_push(&arr, i);
+
+    assert(arr.size == 100, "Incorrect array size");
+    assert(arr.capacity >= 100, "Incorrect array capacity");
+
+    u32 more[3] = { 7, 8, 9 };
+    dynarr_u32_append(&arr, more, 3);
+
+    assert(arr.size == 103, "Incorrect array size");
+
+    for (u32 i = 0; i < 100; ++i)
+        assert(arr.arr[i] == i, "Incorrect value in array");
+
+    assert(dynarr_u32_pop(&arr) == 9, "Incorrect value popped");
+    assert(arr.arr[100] == 7 && arr.arr[101] == 8, "Incorrect value in array");
+
+    dynarr_u32_shrink(&arr);
+    assert(arr.capacity == 102, "Incorrect array capacity");
+
+    // Reserving grows exactly to the requested capacity when that is more than double
+    dynarr_u32_reserve(&arr, 1000);
+    assert(arr.capacity == 1000 && arr.size == 102, "Incorrect array capacity");
+
+    free_dynarr_u32(&arr);
+
+    DynamicArrayEdge edges = new_dynarr_edge_with_capacity(1);
+
+    for (u64 i = 0; i < 10; ++i)
+    {
+        GphrxEdge edge = { .from_vertex_id = i, .to_vertex_id = i * 2 };
+        dynarr_edge_push(&edges, edge);
+    }
+
+    assert(sizeof(edges.arr[0]) == 16, "Edges are not packed");
+
+    for (u64 i = 0; i < 10; ++i)
+        assert(edges.arr[i].from_vertex_id == i && edges.arr[i].to_vertex_id == i * 2, "Incorrect edge");
+
+    free_dynarr_edge(&edges);
+
+    DynamicArrayF32 floats = new_dynarr_f32_with_capacity(4);
+    dynarr_f32_push(&floats, 1.5f);
+
+    assert(sizeof(floats.arr[0]) == 4 && floats.arr[0] == 1.5f, "Incorrect value in array");
+
+    free_dynarr_f32(&floats);
+
+    return TEST_PASS;
+}
+
 ModuleTestSet dynarray_h_register_tests()
 {
     ModuleTestSet set = {
@@ -481,6 +857,10 @@ ModuleTestSet dynarray_h_register_tests()
     register_test(&set, test_dynarr8_grow_and_zero);
     register_test(&set, test_dynarr8_push_multiple);
     register_test(&set, test_dynarr8_remove_at);
+    register_test(&set, test_dynarr8_share);
+    register_test(&set, test_dynarr4_push_at);
+    register_test(&set, test_dynarr4_remove_multiple_at);
+    register_test(&set, test_typed_dynarr);
 
     return set;
 }
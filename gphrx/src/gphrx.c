@@ -1,4 +1,6 @@
 #include "gphrx.h"
+#include "sort.h"
+#include "threadpool.h"
 
 static GphrxGraph new_gphrx(bool is_undirected)
 {
@@ -28,25 +30,13 @@ DLLEXPORT GphrxGraph new_directed_gphrx()
 
 DLLEXPORT GphrxGraph duplicate_gphrx(GphrxGraph *restrict graph)
 {
-    size_t edge_count = graph->adjacency_matrix.col_indices.size;
-        
+    // The lists are shared until one of the graphs is modified, so duplicating costs nothing up front
     GphrxCsrAdjacencyMatrix adjacency_matrix = {
         .dimension = graph->adjacency_matrix.dimension,
-        .col_indices = new_dynarr8_with_capacity(edge_count),
-        .row_indices = new_dynarr8_with_capacity(edge_count),
+        .col_indices = dynarr8_share(&graph->adjacency_matrix.col_indices),
+        .row_indices = dynarr8_share(&graph->adjacency_matrix.row_indices),
     };
 
-    adjacency_matrix.col_indices.size = edge_count;
-    adjacency_matrix.row_indices.size = edge_count;
-
-    memcpy(adjacency_matrix.col_indices.arr,
-           graph->adjacency_matrix.col_indices.arr,
-           edge_count * sizeof(u64));
-
-    memcpy(adjacency_matrix.row_indices.arr,
-           graph->adjacency_matrix.row_indices.arr,
-           edge_count * sizeof(u64));
-
     GphrxGraph duplicate_graph = {
         .is_undirected = graph->is_undirected,
         .adjacency_matrix = adjacency_matrix,
@@ -57,6 +47,7 @@ DLLEXPORT GphrxGraph duplicate_gphrx(GphrxGraph *restrict graph)
 
 DLLEXPORT void free_gphrx(GphrxGraph *restrict graph)
 {
+    _gphrx_drop_vertex_index(graph);
     free_gphrx_csr_adj_matrix(&graph->adjacency_matrix);
 }
 
@@ -148,6 +139,134 @@ DLLEXPORT char *gphrx_csr_matrix_to_string(GphrxCsrMatrix *restrict matrix, int
     return buffer;
 }
 
+// The vectorized loops compact whole vectors of entries from the front of the lists. Each returns the number
+// of entries it read and adds the number it kept to `*kept`. The lanes stored past the kept entries only ever
+// overwrite entries that have already been read.
+#if defined(SIMD_AVX512)
+static TARGET_AVX512 size_t threshold_and_scale_avx512(double *restrict entries,
+                                                       u64 *restrict col_indices,
+                                                       u64 *restrict row_indices,
+                                                       size_t count,
+                                                       double threshold,
+                                                       double scale_factor,
+                                                       size_t *restrict kept)
+{
+    __m512d threshold_vec = _mm512_set1_pd(threshold);
+    __m512d scale_vec = _mm512_set1_pd(scale_factor);
+
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512d entry_vec = _mm512_loadu_pd(entries + i);
+        __m512i col_vec = _mm512_loadu_si512((void*) (col_indices + i));
+        __m512i row_vec = _mm512_loadu_si512((void*) (row_indices + i));
+
+        __mmask8 keep_mask = _mm512_cmp_pd_mask(entry_vec, threshold_vec, _CMP_GE_OQ);
+
+        _mm512_mask_compressstoreu_pd(entries + *kept, keep_mask, _mm512_mul_pd(entry_vec, scale_vec));
+        _mm512_mask_compressstoreu_epi64(col_indices + *kept, keep_mask, col_vec);
+        _mm512_mask_compressstoreu_epi64(row_indices + *kept, keep_mask, row_vec);
+
+        *kept += __builtin_popcount(keep_mask);
+    }
+
+    return i;
+}
+#endif
+
+#if defined(SIMD_AVX2)
+// For each 4-bit mask of kept lanes, the 32-bit lane permutation that moves the kept 64-bit lanes to the
+// front of the vector (in order)
+static const u32 compaction_permutations[16][8] = {
+    {0, 1, 2, 3, 4, 5, 6, 7}, {0, 1, 2, 3, 4, 5, 6, 7}, {2, 3, 0, 1, 4, 5, 6, 7}, {0, 1, 2, 3, 4, 5, 6, 7},
+    {4, 5, 0, 1, 2, 3, 6, 7}, {0, 1, 4, 5, 2, 3, 6, 7}, {2, 3, 4, 5, 0, 1, 6, 7}, {0, 1, 2, 3, 4, 5, 6, 7},
+    {6, 7, 0, 1, 2, 3, 4, 5}, {0, 1, 6, 7, 2, 3, 4, 5}, {2, 3, 6, 7, 0, 1, 4, 5}, {0, 1, 2, 3, 6, 7, 4, 5},
+    {4, 5, 6, 7, 0, 1, 2, 3}, {0, 1, 4, 5, 6, 7, 2, 3}, {2, 3, 4, 5, 6, 7, 0, 1}, {0, 1, 2, 3, 4, 5, 6, 7},
+};
+
+static TARGET_AVX2 size_t threshold_and_scale_avx2(double *restrict entries,
+                                                   u64 *restrict col_indices,
+                                                   u64 *restrict row_indices,
+                                                   size_t count,
+                                                   double threshold,
+                                                   double scale_factor,
+                                                   size_t *restrict kept)
+{
+    __m256d threshold_vec = _mm256_set1_pd(threshold);
+    __m256d scale_vec = _mm256_set1_pd(scale_factor);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d entry_vec = _mm256_loadu_pd(entries + i);
+        __m256i col_vec = _mm256_loadu_si256((__m256i*) (col_indices + i));
+        __m256i row_vec = _mm256_loadu_si256((__m256i*) (row_indices + i));
+
+        int keep_mask = _mm256_movemask_pd(_mm256_cmp_pd(entry_vec, threshold_vec, _CMP_GE_OQ));
+        __m256i permutation = _mm256_loadu_si256((__m256i*) compaction_permutations[keep_mask]);
+
+        __m256i scaled_vec = _mm256_castpd_si256(_mm256_mul_pd(entry_vec, scale_vec));
+
+        _mm256_storeu_si256((__m256i*) (entries + *kept), _mm256_permutevar8x32_epi32(scaled_vec, permutation));
+        _mm256_storeu_si256((__m256i*) (col_indices + *kept), _mm256_permutevar8x32_epi32(col_vec, permutation));
+        _mm256_storeu_si256((__m256i*) (row_indices + *kept), _mm256_permutevar8x32_epi32(row_vec, permutation));
+
+        *kept += __builtin_popcount(keep_mask);
+    }
+
+    return i;
+}
+#endif
+
+DLLEXPORT void gphrx_csr_matrix_threshold_and_scale(GphrxCsrMatrix *restrict matrix, double threshold, double scale_factor)
+{
+    // The lists are rewritten in place, so arrays sharing them (such as an SpMV operator's) keep the originals
+    dynarr8_make_unique(&matrix->entries);
+    dynarr8_make_unique(&matrix->col_indices);
+    dynarr8_make_unique(&matrix->row_indices);
+
+    double *entries = (double*) matrix->entries.arr;
+    u64 *col_indices = (u64*) matrix->col_indices.arr;
+    u64 *row_indices = (u64*) matrix->row_indices.arr;
+
+    size_t count = matrix->entries.size;
+    size_t kept = 0;
+    size_t i = 0;
+
+    // Each kept entry is written at or before the position it was read from, so the lists can be compacted
+    // in place
+#if defined(SIMD_AVX512)
+    if (simd_level() == SIMD_LEVEL_AVX512)
+        i = threshold_and_scale_avx512(entries, col_indices, row_indices, count, threshold, scale_factor, &kept);
+#endif
+
+#if defined(SIMD_AVX2)
+    if (simd_level() == SIMD_LEVEL_AVX2)
+        i = threshold_and_scale_avx2(entries, col_indices, row_indices, count, threshold, scale_factor, &kept);
+#endif
+
+    // Branchless compaction: every entry is written to the next open position, but the position is only
+    // advanced past it if the entry is kept
+    for (; i < count; ++i)
+    {
+        double entry = entries[i];
+        u64 col = col_indices[i];
+        u64 row = row_indices[i];
+
+        entries[kept] = entry * scale_factor;
+        col_indices[kept] = col;
+        row_indices[kept] = row;
+
+        kept += (entry >= threshold);
+    }
+
+    matrix->entries.size = kept;
+    matrix->col_indices.size = kept;
+    matrix->row_indices.size = kept;
+}
+
 DLLEXPORT char *gphrx_csr_adj_matrix_to_string(GphrxCsrAdjacencyMatrix *restrict matrix)
 {
     // Each row of the matrix is represented like this: [ 0, 0, 1, 0, 1, 1, 0 ]
@@ -209,68 +328,529 @@ DLLEXPORT void gphrx_shrink(GphrxGraph *restrict graph)
 {
     dynarr8_shrink(&graph->adjacency_matrix.col_indices);
     dynarr8_shrink(&graph->adjacency_matrix.row_indices);
+
+    // The index is built by the first query that needs it, so shrinking a graph that is never queried
+    // costs nothing extra
+    if (graph->vertex_index == 0)
+    {
+        graph->vertex_index = calloc(1, sizeof(GphrxVertexIndex));
+        assert(graph->vertex_index != 0, "calloc failure");
+
+        atomic_init(&graph->vertex_index->state, GPHRX_VERTEX_INDEX_UNBUILT);
+    }
 }
 
-static size_t binary_search_first(u64 vertex_id, u64 *arr, size_t start, size_t end)
+void _gphrx_drop_vertex_index(GphrxGraph *restrict graph)
 {
-    size_t low = start;
-    size_t high = end;
-    size_t middle = start;
+    GphrxVertexIndex *index = graph->vertex_index;
+
+    if (index == 0)
+        return;
+
+    free(index->keys);
+    free(index->edge_ranges);
+    free(index);
+
+    graph->vertex_index = 0;
+}
 
-    while (low <= high)
+// Fills the subtree rooted at `node` with the next vertices in sorted order (an in-order traversal), so that
+// the keys of a node fall between those of its children. `vertex_offsets` holds the index of each vertex's
+// first edge followed by the edge count.
+static void fill_vertex_index_node(GphrxVertexIndex *restrict index,
+                                   u64 *vertex_ids,
+                                   size_t *vertex_offsets,
+                                   size_t vertex_count,
+                                   size_t node,
+                                   size_t *next_vertex)
+{
+    if (node >= index->node_count)
+        return;
+
+    for (size_t i = 0; i <= GPHRX_VERTEX_INDEX_NODE_KEYS; ++i)
     {
-        middle = (low + high) / 2;
-        u64 curr = arr[middle];
+        size_t child = node * (GPHRX_VERTEX_INDEX_NODE_KEYS + 1) + i + 1;
+        fill_vertex_index_node(index, vertex_ids, vertex_offsets, vertex_count, child, next_vertex);
 
-        if (vertex_id == curr)
-            break;
-        else if (middle != 0 && arr[middle - 1] < vertex_id &&  arr[middle] > vertex_id)
+        if (i == GPHRX_VERTEX_INDEX_NODE_KEYS)
             break;
-        else if (vertex_id > curr)
-            low = middle + 1;
-        else
+
+        size_t slot = node * GPHRX_VERTEX_INDEX_NODE_KEYS + i;
+        size_t vertex = *next_vertex < vertex_count ? *next_vertex : vertex_count;
+
+        index->keys[slot] = vertex < vertex_count ? vertex_ids[vertex] : UINT64_MAX;
+        index->edge_ranges[2 * slot] = vertex_offsets[vertex];
+        index->edge_ranges[2 * slot + 1] = vertex_offsets[vertex < vertex_count ? vertex + 1 : vertex];
+
+        ++*next_vertex;
+    }
+}
+
+static void build_vertex_index(GphrxVertexIndex *restrict index, GphrxCsrAdjacencyMatrix *restrict matrix)
+{
+    u64 *col_indices = (u64*) matrix->col_indices.arr;
+    size_t edge_count = matrix->col_indices.size;
+
+    size_t vertex_count = 0;
+
+    for (size_t i = 0; i < edge_count; ++i)
+        vertex_count += i == 0 || col_indices[i] != col_indices[i - 1];
+
+    u64 *vertex_ids = malloc(sizeof(u64) * (vertex_count + 1));
+    size_t *vertex_offsets = malloc(sizeof(size_t) * (vertex_count + 1));
+
+    assert(vertex_ids != 0 && vertex_offsets != 0, "malloc failure");
+
+    size_t vertex = 0;
+
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        if (i == 0 || col_indices[i] != col_indices[i - 1])
         {
-            if (middle == 0)
-                return 0;
-            
-            high = middle - 1;
+            vertex_ids[vertex] = col_indices[i];
+            vertex_offsets[vertex] = i;
+            ++vertex;
         }
     }
 
-    for (; middle > 0 && arr[middle - 1] == vertex_id; --middle);
-    
-    return middle;
+    vertex_offsets[vertex_count] = edge_count;
+
+    index->node_count = (vertex_count + GPHRX_VERTEX_INDEX_NODE_KEYS - 1) / GPHRX_VERTEX_INDEX_NODE_KEYS;
+
+    // Nodes are aligned to cache lines so that each is loaded with one miss
+    size_t slot_count = GPHRX_VERTEX_INDEX_NODE_KEYS * (index->node_count + 1);
+
+    index->keys = aligned_alloc(64, sizeof(u64) * slot_count);
+    index->edge_ranges = malloc(sizeof(size_t) * 2 * slot_count);
+
+    assert(index->keys != 0, "aligned_alloc failure");
+    assert(index->edge_ranges != 0, "malloc failure");
+
+    size_t next_vertex = 0;
+    fill_vertex_index_node(index, vertex_ids, vertex_offsets, vertex_count, 0, &next_vertex);
+
+    free(vertex_ids);
+    free(vertex_offsets);
+}
+
+// Returns the graph's vertex index, building it if this is the first query since the graph was shrunk, or
+// null if the graph has no index or another thread is still building it
+static GphrxVertexIndex *find_vertex_index(GphrxGraph *restrict graph)
+{
+    GphrxVertexIndex *index = graph->vertex_index;
+
+    if (index == 0)
+        return 0;
+
+    GphrxVertexIndexState state = atomic_load_explicit(&index->state, memory_order_acquire);
+
+    if (state == GPHRX_VERTEX_INDEX_BUILT)
+        return index;
+
+    if (state == GPHRX_VERTEX_INDEX_UNBUILT &&
+        atomic_compare_exchange_strong(&index->state, &state, GPHRX_VERTEX_INDEX_BUILDING))
+    {
+        build_vertex_index(index, &graph->adjacency_matrix);
+        atomic_store_explicit(&index->state, GPHRX_VERTEX_INDEX_BUILT, memory_order_release);
+
+        return index;
+    }
+
+    return 0;
+}
+
+// Each of these returns the number of keys in the node that are less than `value`. The keys are sorted, so
+// this is also the position of the first that isn't.
+static FORCEINLINE u32 count_node_keys_below(u64 *node_keys, u64 value)
+{
+    u32 count = 0;
+
+    for (u32 i = 0; i < GPHRX_VERTEX_INDEX_NODE_KEYS; ++i)
+        count += node_keys[i] < value;
+
+    return count;
+}
+
+#if defined(SIMD_AVX512)
+static FORCEINLINE TARGET_AVX512 u32 count_node_keys_below_avx512(u64 *node_keys, u64 value)
+{
+    __m512i keys = _mm512_load_si512((void*) node_keys);
+    return u64_popcount(_mm512_cmplt_epu64_mask(keys, _mm512_set1_epi64((long long) value)));
+}
+#endif
+
+#if defined(SIMD_AVX2)
+static FORCEINLINE TARGET_AVX2 u32 count_node_keys_below_avx2(u64 *node_keys, u64 value)
+{
+    // AVX2 only compares signed integers, so flipping the sign bits turns the signed compare into an
+    // unsigned one
+    __m256i sign_bits = _mm256_set1_epi64x(INT64_MIN);
+    __m256i target = _mm256_xor_si256(_mm256_set1_epi64x((long long) value), sign_bits);
+    __m256i low_keys = _mm256_xor_si256(_mm256_load_si256((__m256i*) node_keys), sign_bits);
+    __m256i high_keys = _mm256_xor_si256(_mm256_load_si256((__m256i*) (node_keys + 4)), sign_bits);
+
+    u32 low_mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(target, low_keys)));
+    u32 high_mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(target, high_keys)));
+
+    return u64_popcount(low_mask | (high_mask << 4));
+}
+#endif
+
+// Walks the index down to the slot of the given vertex. It is inlined into a copy for each SIMD level along
+// with that level's node search, so the search isn't an indirect call.
+static FORCEINLINE size_t find_vertex_index_slot(GphrxVertexIndex *restrict index,
+                                                 u64 vertex_id,
+                                                 u32 (*count_keys_below)(u64*, u64))
+{
+    size_t found_slot = SIZE_MAX;
+    size_t node = 0;
+
+    while (node < index->node_count)
+    {
+        u64 *node_keys = index->keys + node * GPHRX_VERTEX_INDEX_NODE_KEYS;
+        u32 key_idx = count_keys_below(node_keys, vertex_id);
+
+        // Each key found is smaller than the one found in the level above, so the last is the lower bound
+        if (key_idx < GPHRX_VERTEX_INDEX_NODE_KEYS)
+            found_slot = node * GPHRX_VERTEX_INDEX_NODE_KEYS + key_idx;
+
+        node = node * (GPHRX_VERTEX_INDEX_NODE_KEYS + 1) + key_idx + 1;
+    }
+
+    return found_slot;
+}
+
+#if defined(SIMD_AVX512)
+static TARGET_AVX512 size_t find_vertex_index_slot_avx512(GphrxVertexIndex *restrict index, u64 vertex_id)
+{
+    return find_vertex_index_slot(index, vertex_id, count_node_keys_below_avx512);
+}
+#endif
+
+#if defined(SIMD_AVX2)
+static TARGET_AVX2 size_t find_vertex_index_slot_avx2(GphrxVertexIndex *restrict index, u64 vertex_id)
+{
+    return find_vertex_index_slot(index, vertex_id, count_node_keys_below_avx2);
+}
+#endif
+
+// Returns the index of the first edge from the given vertex and sets `*end` to the index after its last
+static size_t find_indexed_vertex_edge_range(GphrxVertexIndex *restrict index,
+                                             size_t edge_count,
+                                             u64 vertex_id,
+                                             size_t *end)
+{
+    size_t found_slot;
+
+#if defined(SIMD_AVX512)
+    if (simd_level() == SIMD_LEVEL_AVX512)
+        found_slot = find_vertex_index_slot_avx512(index, vertex_id);
+    else
+#endif
+#if defined(SIMD_AVX2)
+    if (simd_level() == SIMD_LEVEL_AVX2)
+        found_slot = find_vertex_index_slot_avx2(index, vertex_id);
+    else
+#endif
+        found_slot = find_vertex_index_slot(index, vertex_id, count_node_keys_below);
+
+    if (found_slot == SIZE_MAX)
+    {
+        *end = edge_count;
+        return edge_count;
+    }
+
+    // A vertex without edges isn't indexed, and its empty range is where its edges would go
+    size_t start = index->edge_ranges[2 * found_slot];
+    *end = index->keys[found_slot] == vertex_id ? index->edge_ranges[2 * found_slot + 1] : start;
+
+    return start;
+}
+
+// Returns the index of the first value in arr[start..end) that is not less than `value`. The loop runs the
+// same number of times for every value, so the compare compiles to a conditional move rather than a branch
+// that mispredicts half the time.
+static size_t binary_search_first(u64 value, u64 *arr, size_t start, size_t end)
+{
+    if (start == end)
+        return start;
+
+    size_t base = start;
+    size_t length = end - start;
+
+    while (length > 1)
+    {
+        size_t half = length / 2;
+
+        prefetch(arr + base + half / 2);
+        prefetch(arr + base + half + half / 2);
+
+        base = arr[base + half - 1] < value ? base + half : base;
+        length -= half;
+    }
+
+    return base + (arr[base] < value);
+}
+
+// Returns the index of the first value in arr[start..end) that is not less than `value` (if `or_equal` is
+// false) or greater than it (if `or_equal` is true). The search gallops out from `start` in doubling steps
+// and then narrows by binary search, so it is cheap when the answer is near `start`. Both halves the binary
+// search could go to next are prefetched, so that the next load doesn't wait on the current compare.
+static size_t gallop_search(u64 *arr, size_t start, size_t end, u64 value, bool or_equal)
+{
+    size_t low = start;
+    size_t high = start;
+    size_t step = 1;
+
+    while (high < end && (arr[high] < value || (or_equal && arr[high] == value)))
+    {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+
+    if (high > end)
+        high = end;
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        prefetch(arr + low + (middle - low) / 2);
+        prefetch(arr + middle + 1 + (high - middle - 1) / 2);
+
+        if (arr[middle] < value || (or_equal && arr[middle] == value))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+static size_t find_vertex_edge_range(GphrxCsrAdjacencyMatrix *restrict matrix, u64 vertex_id, size_t *end)
+{
+    u64 *col_indices = (u64*) matrix->col_indices.arr;
+    size_t edge_count = matrix->col_indices.size;
+
+    size_t start = binary_search_first(vertex_id, col_indices, 0, edge_count);
+
+    // Most vertices have few edges, so the end is close to the start
+    *end = gallop_search(col_indices, start, edge_count, vertex_id, true);
+
+    return start;
+}
+
+size_t _gphrx_find_vertex_edge_range(GphrxGraph *restrict graph, u64 vertex_id, size_t *end)
+{
+    GphrxVertexIndex *index = find_vertex_index(graph);
+
+    if (index == 0)
+        return find_vertex_edge_range(&graph->adjacency_matrix, vertex_id, end);
+
+    return find_indexed_vertex_edge_range(index, graph->adjacency_matrix.col_indices.size, vertex_id, end);
+}
+
+// Returns the index in the matrix's lists of the edge from `from_vertex_id` to `to_vertex_id`, or where it
+// would be inserted if it does not exist. The vertex's edges are sorted, so they are searched rather than
+// walked.
+static size_t index_of_edge(GphrxCsrAdjacencyMatrix *restrict matrix, u64 from_vertex_id, u64 to_vertex_id)
+{
+    size_t vertex_end;
+    size_t vertex_start = find_vertex_edge_range(matrix, from_vertex_id, &vertex_end);
+
+    return gallop_search((u64*) matrix->row_indices.arr, vertex_start, vertex_end, to_vertex_id, false);
 }
 
-static size_t index_of_vertex(DynamicArray8 *col_arr, DynamicArray8 *row_arr,
-                              u64 from_vertex_id, u64 to_vertex_id)
+size_t _gphrx_index_of_edge(GphrxCsrAdjacencyMatrix *restrict matrix, u64 from_vertex_id, u64 to_vertex_id)
 {
-    size_t curr_idx = binary_search_first(from_vertex_id, (u64*) col_arr->arr, 0, col_arr->size);
-    for (; curr_idx < col_arr->size &&
-             dynarr8_get(col_arr, curr_idx).u64_val == from_vertex_id &&
-             dynarr8_get(row_arr, curr_idx).u64_val < to_vertex_id; ++curr_idx);
-    return curr_idx;
+    return index_of_edge(matrix, from_vertex_id, to_vertex_id);
 }
 
 DLLEXPORT bool gphrx_does_edge_exist(GphrxGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
 {
-    if (from_vertex_id > graph->adjacency_matrix.dimension || to_vertex_id > graph->adjacency_matrix.dimension)
+    if (from_vertex_id >= graph->adjacency_matrix.dimension || to_vertex_id >= graph->adjacency_matrix.dimension)
         return false;
-    
-    size_t vertex_idx = index_of_vertex(&graph->adjacency_matrix.col_indices,
-                                        &graph->adjacency_matrix.row_indices,
-                                        from_vertex_id, to_vertex_id);
 
-    if (vertex_idx >= graph->adjacency_matrix.col_indices.size)
-        return false;
+    size_t vertex_end;
+    size_t vertex_start = _gphrx_find_vertex_edge_range(graph, from_vertex_id, &vertex_end);
+
+    u64 *row_indices = (u64*) graph->adjacency_matrix.row_indices.arr;
+    size_t edge_idx = gallop_search(row_indices, vertex_start, vertex_end, to_vertex_id, false);
+
+    return edge_idx < vertex_end && row_indices[edge_idx] == to_vertex_id;
+}
+
+// Queries per range of a batched edge lookup, and how many queries ahead each thread prefetches
+#define EDGE_QUERY_GRAIN_SIZE 4096
+#define EDGE_QUERY_PREFETCH_DISTANCE 16
+
+// Bytes of packed results per range
+#define EDGE_QUERY_PACK_GRAIN_SIZE 8192
+
+typedef struct {
+    u64 *col_indices;
+    u64 *row_indices;
+    size_t edge_count;
+
+    // Null if the graph has no vertex index, in which case each vertex is found by galloping on from the last
+    GphrxVertexIndex *vertex_index;
+
+    // The queries' from vertex IDs in sorted order, and the index of the query each came from. If the
+    // queries were given sorted, these are the caller's from vertex IDs and the indices are null.
+    u64 *sorted_from_vertex_ids;
+    u64 *query_indices;
+
+    u64 *to_vertex_ids;
+
+    // One byte per query, in the order the queries were given
+    u8 *is_found;
+    u8 *out_bits;
+} EdgeQueryContext;
+
+static void find_edges_in_range(void *context_ptr, size_t start, size_t end, u32 thread_idx)
+{
+    EdgeQueryContext *context = context_ptr;
+
+    size_t vertex_start = 0;
+    size_t vertex_end = 0;
+    size_t edge_cursor = 0;
 
-    if (dynarr8_get(&graph->adjacency_matrix.col_indices, vertex_idx).u64_val == from_vertex_id
-        && dynarr8_get(&graph->adjacency_matrix.row_indices, vertex_idx).u64_val == to_vertex_id)
+    u64 from_vertex_id = 0;
+    u64 last_to_vertex_id = 0;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        u64 query = i;
+
+        if (context->query_indices != 0)
+        {
+            query = context->query_indices[i];
+
+            // Sorting scatters the queries' to vertex IDs and results across the caller's order
+            if (i + EDGE_QUERY_PREFETCH_DISTANCE < end)
+            {
+                u64 ahead = context->query_indices[i + EDGE_QUERY_PREFETCH_DISTANCE];
+
+                prefetch(context->to_vertex_ids + ahead);
+                prefetch(context->is_found + ahead);
+            }
+        }
+
+        if (i == start || context->sorted_from_vertex_ids[i] != from_vertex_id)
+        {
+            from_vertex_id = context->sorted_from_vertex_ids[i];
+
+            if (context->vertex_index != 0)
+            {
+                vertex_start = find_indexed_vertex_edge_range(context->vertex_index,
+                                                              context->edge_count,
+                                                              from_vertex_id,
+                                                              &vertex_end);
+            }
+            else
+            {
+                vertex_start = gallop_search(context->col_indices, vertex_end, context->edge_count,
+                                             from_vertex_id, false);
+                vertex_end = gallop_search(context->col_indices, vertex_start, context->edge_count,
+                                           from_vertex_id, true);
+            }
+
+            edge_cursor = vertex_start;
+            last_to_vertex_id = 0;
+        }
+
+        u64 to_vertex_id = context->to_vertex_ids[query];
+
+        // Queries from the same vertex are in order of to vertex only if they were given that way
+        if (to_vertex_id < last_to_vertex_id)
+            edge_cursor = vertex_start;
+
+        edge_cursor = gallop_search(context->row_indices, edge_cursor, vertex_end, to_vertex_id, false);
+        last_to_vertex_id = to_vertex_id;
+
+        context->is_found[query] = edge_cursor < vertex_end && context->row_indices[edge_cursor] == to_vertex_id;
+    }
+}
+
+static void pack_edge_query_results(void *context_ptr, size_t start, size_t end, u32 thread_idx)
+{
+    EdgeQueryContext *context = context_ptr;
+
+    for (size_t byte_idx = start; byte_idx < end; ++byte_idx)
+    {
+        u8 bits = 0;
+
+        for (u32 bit = 0; bit < 8; ++bit)
+            bits |= context->is_found[byte_idx * 8 + bit] << bit;
+
+        context->out_bits[byte_idx] = bits;
+    }
+}
+
+DLLEXPORT void gphrx_does_edges_exist(GphrxGraph *restrict graph,
+                                      u64 *from_vertex_ids,
+                                      u64 *to_vertex_ids,
+                                      u8 *out_bits,
+                                      size_t count)
+{
+    if (count == 0)
+        return;
+
+    size_t byte_count = (count + 7) / 8;
+
+    EdgeQueryContext context = {
+        .col_indices = (u64*) graph->adjacency_matrix.col_indices.arr,
+        .row_indices = (u64*) graph->adjacency_matrix.row_indices.arr,
+        .edge_count = graph->adjacency_matrix.col_indices.size,
+        .vertex_index = find_vertex_index(graph),
+        .sorted_from_vertex_ids = from_vertex_ids,
+        .query_indices = 0,
+        .to_vertex_ids = to_vertex_ids,
+
+        // Padded to whole bytes so that the last byte packs without a bounds check
+        .is_found = calloc(byte_count * 8, sizeof(u8)),
+        .out_bits = out_bits,
+    };
+
+    assert(context.is_found != 0, "calloc failure");
+
+    // Queries made from a graph's own lists (as when verifying a graph) are often already sorted
+    bool is_sorted = true;
+
+    for (size_t i = 1; i < count && is_sorted; ++i)
+    {
+        is_sorted = from_vertex_ids[i - 1] < from_vertex_ids[i] ||
+            (from_vertex_ids[i - 1] == from_vertex_ids[i] && to_vertex_ids[i - 1] <= to_vertex_ids[i]);
+    }
+
+    if (!is_sorted)
+    {
+        context.sorted_from_vertex_ids = malloc(sizeof(u64) * count);
+        context.query_indices = malloc(sizeof(u64) * count);
+
+        assert(context.sorted_from_vertex_ids != 0 && context.query_indices != 0, "malloc failure");
+
+        memcpy(context.sorted_from_vertex_ids, from_vertex_ids, sizeof(u64) * count);
+
+        for (size_t i = 0; i < count; ++i)
+            context.query_indices[i] = i;
+
+        // Sorting by query index rather than by to vertex keeps the keys to 64 bits for most graphs. Each
+        // vertex has few enough edges that searching them out of order costs little.
+        gphrx_sort_edges(context.sorted_from_vertex_ids, context.query_indices, count);
+    }
+
+    _gphrx_parallel_for(0, count, EDGE_QUERY_GRAIN_SIZE, find_edges_in_range, &context);
+    _gphrx_parallel_for(0, byte_count, EDGE_QUERY_PACK_GRAIN_SIZE, pack_edge_query_results, &context);
+
+    if (!is_sorted)
     {
-        return true;
+        free(context.sorted_from_vertex_ids);
+        free(context.query_indices);
     }
 
-    return false;
+    free(context.is_found);
 }
 
 DLLEXPORT void gphrx_add_vertex(GphrxGraph *restrict graph, u64 vertex_id, u64 *vertex_edges, u64 vertex_edge_count)
@@ -286,31 +866,20 @@ DLLEXPORT void gphrx_add_vertex(GphrxGraph *restrict graph, u64 vertex_id, u64 *
 
 DLLEXPORT void gphrx_remove_vertex(GphrxGraph *restrict graph, u64 vertex_id)
 {
-    size_t vertex_idx = binary_search_first(vertex_id,
-                                            (u64*) graph->adjacency_matrix.col_indices.arr,
-                                            0,
-                                            graph->adjacency_matrix.col_indices.size);
-    
-    size_t first_edge_idx = vertex_idx;
-    size_t last_edge_idx = vertex_idx;
+    _gphrx_drop_vertex_index(graph);
 
-    while (first_edge_idx >= 1 &&
-           dynarr8_get(&graph->adjacency_matrix.col_indices, first_edge_idx - 1).u64_val == vertex_id)
-        --first_edge_idx;
+    size_t last_edge_end;
+    size_t first_edge_idx = find_vertex_edge_range(&graph->adjacency_matrix, vertex_id, &last_edge_end);
 
-    while (last_edge_idx < graph->adjacency_matrix.col_indices.size - 1 &&
-           dynarr8_get(&graph->adjacency_matrix.col_indices, last_edge_idx + 1).u64_val == vertex_id)
-        ++last_edge_idx;
-
-    if (first_edge_idx != graph->adjacency_matrix.col_indices.size)
+    if (last_edge_end != first_edge_idx)
     {
         dynarr8_remove_multiple_at(&graph->adjacency_matrix.col_indices,
                                       first_edge_idx,
-                                      last_edge_idx + 1 - first_edge_idx);
+                                      last_edge_end - first_edge_idx);
 
         dynarr8_remove_multiple_at(&graph->adjacency_matrix.row_indices,
                                       first_edge_idx,
-                                      last_edge_idx + 1 - first_edge_idx);
+                                      last_edge_end - first_edge_idx);
     }
 
     for (size_t i = 0; i < graph->adjacency_matrix.row_indices.size; ++i)
@@ -331,9 +900,7 @@ DLLEXPORT void gphrx_add_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u6
 {
     size_t vertex_idx = from_vertex_id >= graph->adjacency_matrix.dimension
         ? graph->adjacency_matrix.col_indices.size
-        : index_of_vertex(&graph->adjacency_matrix.col_indices,
-                          &graph->adjacency_matrix.row_indices,
-                          from_vertex_id, to_vertex_id);
+        : index_of_edge(&graph->adjacency_matrix, from_vertex_id, to_vertex_id);
 
     if (vertex_idx < graph->adjacency_matrix.col_indices.size &&
         dynarr8_get(&graph->adjacency_matrix.col_indices, vertex_idx).u64_val == from_vertex_id &&
@@ -343,6 +910,8 @@ DLLEXPORT void gphrx_add_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u6
         return;
     }
 
+    _gphrx_drop_vertex_index(graph);
+
     Byte8Val from_vertex_id_bv = { .u64_val = from_vertex_id };
     Byte8Val to_vertex_id_bv = { .u64_val = to_vertex_id };
 
@@ -351,9 +920,7 @@ DLLEXPORT void gphrx_add_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u6
     
     if (graph->is_undirected && from_vertex_id != to_vertex_id)
     {
-        size_t vertex_idx = index_of_vertex(&graph->adjacency_matrix.col_indices,
-                                            &graph->adjacency_matrix.row_indices,
-                                            to_vertex_id, from_vertex_id);
+        size_t vertex_idx = index_of_edge(&graph->adjacency_matrix, to_vertex_id, from_vertex_id);
 
         dynarr8_push_at(&graph->adjacency_matrix.col_indices, to_vertex_id_bv, vertex_idx);
         dynarr8_push_at(&graph->adjacency_matrix.row_indices, from_vertex_id_bv, vertex_idx);
@@ -366,24 +933,141 @@ DLLEXPORT void gphrx_add_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u6
         graph->adjacency_matrix.dimension = to_vertex_id + 1;
 }
 
-DLLEXPORT GphrxErrorCode gphrx_remove_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+DLLEXPORT void gphrx_add_edges(GphrxGraph *restrict graph, u64 *from_vertex_ids, u64 *to_vertex_ids, size_t count)
 {
-    size_t vertex_idx = index_of_vertex(&graph->adjacency_matrix.col_indices,
-                                        &graph->adjacency_matrix.row_indices,
-                                        from_vertex_id, to_vertex_id);
+    if (count == 0)
+        return;
 
-    if (dynarr8_get(&graph->adjacency_matrix.col_indices, vertex_idx).u64_val != from_vertex_id ||
-        dynarr8_get(&graph->adjacency_matrix.row_indices, vertex_idx).u64_val != to_vertex_id)
-        return GPHRX_ERROR_NOT_FOUND;
-    
-    dynarr8_remove_at(&graph->adjacency_matrix.col_indices, vertex_idx);
-    dynarr8_remove_at(&graph->adjacency_matrix.row_indices, vertex_idx);
+    size_t max_key_count = count * (graph->is_undirected ? 2 : 1);
+    u64 *key_cols = malloc(sizeof(u64) * max_key_count);
+    u64 *key_rows = malloc(sizeof(u64) * max_key_count);
 
-    if (graph->is_undirected)
-    {
-        size_t vertex_idx = index_of_vertex(&graph->adjacency_matrix.col_indices,
-                                            &graph->adjacency_matrix.row_indices,
-                                            to_vertex_id, from_vertex_id);
+    assert(key_cols != 0, "malloc failure");
+    assert(key_rows != 0, "malloc failure");
+
+    size_t key_count = 0;
+    u64 highest_vertex_id = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        key_cols[key_count] = from_vertex_ids[i];
+        key_rows[key_count] = to_vertex_ids[i];
+        ++key_count;
+
+        if (graph->is_undirected && from_vertex_ids[i] != to_vertex_ids[i])
+        {
+            key_cols[key_count] = to_vertex_ids[i];
+            key_rows[key_count] = from_vertex_ids[i];
+            ++key_count;
+        }
+
+        if (from_vertex_ids[i] > highest_vertex_id)
+            highest_vertex_id = from_vertex_ids[i];
+
+        if (to_vertex_ids[i] > highest_vertex_id)
+            highest_vertex_id = to_vertex_ids[i];
+    }
+
+    gphrx_sort_edges(key_cols, key_rows, key_count);
+
+    // Drop keys that repeat within the batch or that are already in the graph. Both lists are sorted, so one
+    // pass over each finds them.
+    u64 *col_indices = (u64*) graph->adjacency_matrix.col_indices.arr;
+    u64 *row_indices = (u64*) graph->adjacency_matrix.row_indices.arr;
+    size_t existing_count = graph->adjacency_matrix.col_indices.size;
+
+    size_t new_count = 0;
+    size_t existing_idx = 0;
+
+    for (size_t i = 0; i < key_count; ++i)
+    {
+        if (new_count != 0 && key_cols[i] == key_cols[new_count - 1] && key_rows[i] == key_rows[new_count - 1])
+            continue;
+
+        while (existing_idx < existing_count &&
+               (col_indices[existing_idx] < key_cols[i] ||
+                (col_indices[existing_idx] == key_cols[i] && row_indices[existing_idx] < key_rows[i])))
+        {
+            ++existing_idx;
+        }
+
+        if (existing_idx < existing_count &&
+            col_indices[existing_idx] == key_cols[i] &&
+            row_indices[existing_idx] == key_rows[i])
+        {
+            continue;
+        }
+
+        key_cols[new_count] = key_cols[i];
+        key_rows[new_count] = key_rows[i];
+        ++new_count;
+    }
+
+    if (new_count != 0)
+        _gphrx_drop_vertex_index(graph);
+
+    // Merge from the back so the existing edges can be moved into place without a second copy of the lists
+    dynarr8_expand(&graph->adjacency_matrix.col_indices, existing_count + new_count);
+    dynarr8_expand(&graph->adjacency_matrix.row_indices, existing_count + new_count);
+    dynarr8_make_unique(&graph->adjacency_matrix.col_indices);
+    dynarr8_make_unique(&graph->adjacency_matrix.row_indices);
+
+    col_indices = (u64*) graph->adjacency_matrix.col_indices.arr;
+    row_indices = (u64*) graph->adjacency_matrix.row_indices.arr;
+
+    size_t write_idx = existing_count + new_count;
+    size_t key_idx = new_count;
+    existing_idx = existing_count;
+
+    while (key_idx > 0)
+    {
+        --write_idx;
+
+        if (existing_idx > 0 &&
+            (col_indices[existing_idx - 1] > key_cols[key_idx - 1] ||
+             (col_indices[existing_idx - 1] == key_cols[key_idx - 1] &&
+              row_indices[existing_idx - 1] > key_rows[key_idx - 1])))
+        {
+            --existing_idx;
+            col_indices[write_idx] = col_indices[existing_idx];
+            row_indices[write_idx] = row_indices[existing_idx];
+        }
+        else
+        {
+            --key_idx;
+            col_indices[write_idx] = key_cols[key_idx];
+            row_indices[write_idx] = key_rows[key_idx];
+        }
+    }
+
+    graph->adjacency_matrix.col_indices.size = existing_count + new_count;
+    graph->adjacency_matrix.row_indices.size = existing_count + new_count;
+
+    if (highest_vertex_id + 1 > graph->adjacency_matrix.dimension)
+        graph->adjacency_matrix.dimension = highest_vertex_id + 1;
+
+    free(key_cols);
+    free(key_rows);
+}
+
+DLLEXPORT GphrxErrorCode gphrx_remove_edge(GphrxGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    size_t vertex_idx = index_of_edge(&graph->adjacency_matrix, from_vertex_id, to_vertex_id);
+
+    if (vertex_idx >= graph->adjacency_matrix.col_indices.size ||
+        dynarr8_get(&graph->adjacency_matrix.col_indices, vertex_idx).u64_val != from_vertex_id ||
+        dynarr8_get(&graph->adjacency_matrix.row_indices, vertex_idx).u64_val != to_vertex_id)
+        return GPHRX_ERROR_NOT_FOUND;
+
+    _gphrx_drop_vertex_index(graph);
+    
+    dynarr8_remove_at(&graph->adjacency_matrix.col_indices, vertex_idx);
+    dynarr8_remove_at(&graph->adjacency_matrix.row_indices, vertex_idx);
+
+    // A self loop is stored once, even in an undirected graph
+    if (graph->is_undirected && from_vertex_id != to_vertex_id)
+    {
+        size_t vertex_idx = index_of_edge(&graph->adjacency_matrix, to_vertex_id, from_vertex_id);
         
         dynarr8_remove_at(&graph->adjacency_matrix.col_indices, vertex_idx);
         dynarr8_remove_at(&graph->adjacency_matrix.row_indices, vertex_idx);
@@ -392,9 +1076,331 @@ DLLEXPORT GphrxErrorCode gphrx_remove_edge(GphrxGraph *restrict graph, u64 from_
     return GPHRX_NO_ERROR;
 }
 
+u64 _gphrx_avg_pool_blocks_per_row(u64 vertex_count, u64 block_dimension)
+{
+    bool are_edge_blocks_padded = !(vertex_count % block_dimension == 0);
+    return (vertex_count / block_dimension) + (are_edge_blocks_padded ? 1 : 0);
+}
+
+GphrxCsrMatrix _gphrx_avg_pool_matrix_from_occurrences(u64 *occurrences, u64 blocks_per_row, u64 block_dimension,
+                                                      double scale, GphrxAllocator *allocator)
+{
+    u64 block_count = blocks_per_row * blocks_per_row;
+
+    GphrxCsrMatrix occurrence_matrix = {
+        .dimension = blocks_per_row,
+        .entries = new_dynarr8_with_allocator(block_count, allocator),
+        .col_indices = new_dynarr8_with_allocator(block_count, allocator),
+        .row_indices = new_dynarr8_with_allocator(block_count, allocator),
+    };
+    
+    double block_size = block_dimension * block_dimension;
+    for (size_t col = 0; col < blocks_per_row; ++col)
+    {
+        for (size_t row = 0; row < blocks_per_row; ++row)
+        {
+            size_t row_start = row * blocks_per_row;
+            double entry = occurrences[row_start + col] * scale / (double) block_size;
+
+            if (entry != 0.0)
+            {
+                Byte8Val entry_bv = { .dbl_val = entry };
+                Byte8Val col_bv = { .u64_val = col };
+                Byte8Val row_bv = { .u64_val = row };
+
+                dynarr8_push(&occurrence_matrix.entries, entry_bv);
+                dynarr8_push(&occurrence_matrix.col_indices, col_bv);
+                dynarr8_push(&occurrence_matrix.row_indices, row_bv);
+            }
+        }
+    }
+
+    return occurrence_matrix;
+}
+
+// The vectorized loops find the block positions of several edges at once with the divisor's 32-bit
+// multiplier, counting edges from `start` in whole vectors, and return the index of the first edge they left
+// uncounted. The increments themselves stay scalar because neighbouring edges often fall in the same block.
+#if defined(SIMD_AVX512)
+static TARGET_AVX512 size_t pool_block_occurrences_avx512(u64 *restrict occurrences,
+                                                          u64 *restrict col_indices,
+                                                          u64 *restrict row_indices,
+                                                          size_t start,
+                                                          size_t end,
+                                                          FastDivisor *restrict divisor,
+                                                          u64 blocks_per_row)
+{
+    __m512i magic_32 = _mm512_set1_epi64(divisor->magic_32);
+    __m128i shift = _mm_cvtsi32_si128(divisor->shift);
+    __m512i blocks_per_row_vec = _mm512_set1_epi64(blocks_per_row);
+
+    u64 positions[8];
+    size_t i = start;
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m512i col_pos = fast_divisor_divide_u32_x8(_mm512_loadu_si512((void*) (col_indices + i)), magic_32, shift);
+        __m512i row_pos = fast_divisor_divide_u32_x8(_mm512_loadu_si512((void*) (row_indices + i)), magic_32, shift);
+
+        _mm512_storeu_si512((void*) positions,
+                            _mm512_add_epi64(_mm512_mul_epu32(row_pos, blocks_per_row_vec), col_pos));
+
+        for (int lane = 0; lane < 8; ++lane)
+            ++occurrences[positions[lane]];
+    }
+
+    return i;
+}
+#endif
+
+#if defined(SIMD_AVX2)
+static TARGET_AVX2 size_t pool_block_occurrences_avx2(u64 *restrict occurrences,
+                                                      u64 *restrict col_indices,
+                                                      u64 *restrict row_indices,
+                                                      size_t start,
+                                                      size_t end,
+                                                      FastDivisor *restrict divisor,
+                                                      u64 blocks_per_row)
+{
+    __m256i magic_32 = _mm256_set1_epi64x(divisor->magic_32);
+    __m128i shift = _mm_cvtsi32_si128(divisor->shift);
+    __m256i blocks_per_row_vec = _mm256_set1_epi64x(blocks_per_row);
+
+    u64 positions[4];
+    size_t i = start;
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m256i col_pos = fast_divisor_divide_u32_x4(_mm256_loadu_si256((__m256i*) (col_indices + i)), magic_32, shift);
+        __m256i row_pos = fast_divisor_divide_u32_x4(_mm256_loadu_si256((__m256i*) (row_indices + i)), magic_32, shift);
+
+        _mm256_storeu_si256((__m256i*) positions,
+                            _mm256_add_epi64(_mm256_mul_epu32(row_pos, blocks_per_row_vec), col_pos));
+
+        ++occurrences[positions[0]];
+        ++occurrences[positions[1]];
+        ++occurrences[positions[2]];
+        ++occurrences[positions[3]];
+    }
+
+    return i;
+}
+#endif
+
+// Counts the edges in [start, end) into a dense, row-major array of block occurrences. Block positions are
+// found with a FastDivisor rather than a hardware divide.
+static void pool_block_occurrences(u64 *restrict occurrences,
+                                   u64 *restrict col_indices,
+                                   u64 *restrict row_indices,
+                                   size_t start,
+                                   size_t end,
+                                   FastDivisor *restrict divisor,
+                                   u64 blocks_per_row)
+{
+    size_t i = start;
+
+    if (divisor->is_pow_2)
+    {
+        u8 shift = divisor->shift;
+
+        for (; i < end; ++i)
+        {
+            u64 col_pos = fast_div_pow_2(col_indices[i], shift);
+            u64 row_pos = fast_div_pow_2(row_indices[i], shift);
+
+            ++occurrences[row_pos * blocks_per_row + col_pos];
+        }
+
+        return;
+    }
+
+#if defined(SIMD_AVX512)
+    if (divisor->magic_32 != 0 && simd_level() == SIMD_LEVEL_AVX512)
+        i = pool_block_occurrences_avx512(occurrences, col_indices, row_indices, start, end, divisor, blocks_per_row);
+#endif
+
+#if defined(SIMD_AVX2)
+    if (divisor->magic_32 != 0 && simd_level() == SIMD_LEVEL_AVX2)
+        i = pool_block_occurrences_avx2(occurrences, col_indices, row_indices, start, end, divisor, blocks_per_row);
+#endif
+
+    for (; i < end; ++i)
+    {
+        u64 col_pos = fast_divisor_divide(divisor, col_indices[i]);
+        u64 row_pos = fast_divisor_divide(divisor, row_indices[i]);
+
+        ++occurrences[row_pos * blocks_per_row + col_pos];
+    }
+}
+
+#define POOLING_GRAIN_SIZE 32768
+
+// Returns the index of the first edge in [low, high) from a vertex with an ID of at least `vertex_id` (or
+// `high` if there is none)
+static size_t first_edge_from_vertex(u64 *col_indices, size_t low, size_t high, u64 vertex_id)
+{
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if (col_indices[middle] < vertex_id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+typedef struct {
+    u64 *col_indices;
+    size_t edge_count;
+    u64 vertex_count;
+    size_t *offsets;
+} VertexOffsetsContext;
+
+// Writes the offset of every vertex whose offset is an edge index in [start, end). Vertices without edges
+// share the offset of the next vertex that has edges, so they are written by the same range.
+static void find_vertex_offsets_in_range(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    VertexOffsetsContext *offsets_context = context;
+    u64 *col_indices = offsets_context->col_indices;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        if (i != 0 && col_indices[i] == col_indices[i - 1])
+            continue;
+
+        for (u64 v = (i == 0 ? 0 : col_indices[i - 1] + 1); v <= col_indices[i]; ++v)
+            offsets_context->offsets[v] = i;
+    }
+
+    if (end == offsets_context->edge_count)
+    {
+        for (u64 v = col_indices[end - 1] + 1; v <= offsets_context->vertex_count; ++v)
+            offsets_context->offsets[v] = end;
+    }
+}
+
+size_t *_gphrx_find_vertex_edge_offsets(GphrxCsrAdjacencyMatrix *restrict matrix)
+{
+    size_t *offsets = malloc(sizeof(size_t) * (matrix->dimension + 1));
+    assert(offsets != 0, "malloc failure");
+
+    VertexOffsetsContext context = {
+        .col_indices = (u64*) matrix->col_indices.arr,
+        .edge_count = matrix->col_indices.size,
+        .vertex_count = matrix->dimension,
+        .offsets = offsets,
+    };
+
+    if (context.edge_count == 0)
+        memset(offsets, 0, sizeof(size_t) * (matrix->dimension + 1));
+    else
+        _gphrx_parallel_for(0, context.edge_count, POOLING_GRAIN_SIZE, find_vertex_offsets_in_range, &context);
+
+    return offsets;
+}
+
+u64 *_gphrx_find_vertex_in_edges(GphrxCsrAdjacencyMatrix *restrict matrix, size_t **in_offsets)
+{
+    u64 *col_indices = (u64*) matrix->col_indices.arr;
+    u64 *row_indices = (u64*) matrix->row_indices.arr;
+    size_t edge_count = matrix->col_indices.size;
+
+    size_t *offsets = calloc(matrix->dimension + 1, sizeof(size_t));
+    u64 *in_edges = malloc(sizeof(u64) * (edge_count + 1));
+    assert(offsets != 0 && in_edges != 0, "malloc failure");
+
+    // Counting sort by to vertex. Edges are visited in order of from vertex, so each vertex's in-edges come
+    // out sorted.
+    for (size_t i = 0; i < edge_count; ++i)
+        ++offsets[row_indices[i] + 1];
+
+    for (u64 v = 0; v < matrix->dimension; ++v)
+        offsets[v + 1] += offsets[v];
+
+    size_t *next_slots = malloc(sizeof(size_t) * (matrix->dimension + 1));
+    assert(next_slots != 0, "malloc failure");
+
+    memcpy(next_slots, offsets, sizeof(size_t) * (matrix->dimension + 1));
+
+    for (size_t i = 0; i < edge_count; ++i)
+        in_edges[next_slots[row_indices[i]]++] = col_indices[i];
+
+    free(next_slots);
+
+    *in_offsets = offsets;
+    return in_edges;
+}
+
+typedef struct {
+    u64 *occurrences;
+    u64 *col_indices;
+    u64 *row_indices;
+    size_t *block_col_offsets;
+    FastDivisor divisor;
+    u64 blocks_per_row;
+} PoolingContext;
+
+// Edges are sorted by column, so each block column's edges are contiguous and no two block columns count
+// into the same entry of the occurrences array
+static void pool_block_col_range(void *context, size_t first_block_col, size_t end_block_col, u32 thread_idx)
+{
+    PoolingContext *pooling = context;
+
+    pool_block_occurrences(pooling->occurrences,
+                           pooling->col_indices,
+                           pooling->row_indices,
+                           pooling->block_col_offsets[first_block_col],
+                           pooling->block_col_offsets[end_block_col],
+                           &pooling->divisor,
+                           pooling->blocks_per_row);
+}
+
+void _gphrx_count_block_occurrences(GphrxCsrAdjacencyMatrix *restrict matrix,
+                                    u64 *restrict occurrences,
+                                    u64 vertex_count,
+                                    u64 block_dimension,
+                                    u64 blocks_per_row)
+{
+    u64 *col_indices = (u64*) matrix->col_indices.arr;
+    size_t edge_count = matrix->col_indices.size;
+
+    size_t *block_col_offsets = malloc(sizeof(size_t) * (blocks_per_row + 1));
+    assert(block_col_offsets != 0, "malloc failure");
+
+    block_col_offsets[0] = 0;
+    for (u64 block_col = 1; block_col < blocks_per_row; ++block_col)
+    {
+        block_col_offsets[block_col] = first_edge_from_vertex(col_indices,
+                                                              block_col_offsets[block_col - 1],
+                                                              edge_count,
+                                                              block_col * block_dimension);
+    }
+    block_col_offsets[blocks_per_row] = edge_count;
+
+    PoolingContext context = {
+        .occurrences = occurrences,
+        .col_indices = col_indices,
+        .row_indices = (u64*) matrix->row_indices.arr,
+        .block_col_offsets = block_col_offsets,
+        .divisor = new_fast_divisor(block_dimension),
+        .blocks_per_row = blocks_per_row,
+    };
+
+    // The 32-bit multiplier only divides IDs that fit in 32 bits, so larger graphs keep to the scalar path
+    if (vertex_count > (1ULL << 32))
+        context.divisor.magic_32 = 0;
+
+    _gphrx_parallel_for_balanced(0, blocks_per_row, block_col_offsets, POOLING_GRAIN_SIZE, pool_block_col_range, &context);
+
+    free(block_col_offsets);
+}
+
 // TODO: This allocates a block the size of the entire adjacency matrix for the approximated graph.
 //       It doesn't need to.
-DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix(GphrxGraph *restrict graph, u64 block_dimension)
+static GphrxCsrMatrix find_avg_pool_matrix(GphrxGraph *restrict graph, u64 block_dimension, GphrxAllocator *allocator)
 {
     if (block_dimension < 1)
         block_dimension = 1;
@@ -404,43 +1410,421 @@ DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix(GphrxGraph *restrict graph,
     if (block_dimension > vertex_count)
         block_dimension = vertex_count;
 
-    bool are_edge_blocks_padded = !(vertex_count % block_dimension == 0);
+    u64 blocks_per_row = _gphrx_avg_pool_blocks_per_row(vertex_count, block_dimension);
+    u64 block_count = blocks_per_row * blocks_per_row;
+
+    u64 *occurrences = calloc(block_count, sizeof(u64));
+    assert(occurrences != 0, "calloc failure");
+
+    _gphrx_count_block_occurrences(&graph->adjacency_matrix, occurrences, vertex_count, block_dimension, blocks_per_row);
+
+    GphrxCsrMatrix occurrence_matrix = _gphrx_avg_pool_matrix_from_occurrences(occurrences,
+                                                                              blocks_per_row,
+                                                                              block_dimension,
+                                                                              1.0,
+                                                                              allocator);
+
+    free(occurrences);
+
+    return occurrence_matrix;
+}
+
+DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix(GphrxGraph *restrict graph, u64 block_dimension)
+{
+    return find_avg_pool_matrix(graph, block_dimension, gphrx_get_allocator());
+}
+
+static u64 splitmix64(u64 value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Maps an index in [0, sampler->edge_count) to a unique index in the same range using a four-round Feistel
+// network over the smallest even-bit-width domain that covers the range. Outputs that land outside the
+// range are fed back through the network (cycle walking), which terminates because the network is a
+// bijection on its domain. The domain is at most four times the range, so few walks are needed.
+static u64 sampler_permute_index(GphrxAvgPoolSampler *restrict sampler, u64 idx)
+{
+    u64 half_bits = sampler->permutation_half_bits;
+    u64 half_mask = (1ULL << half_bits) - 1;
+
+    do
+    {
+        u64 left = idx >> half_bits;
+        u64 right = idx & half_mask;
+
+        for (int round = 0; round < 4; ++round)
+        {
+            u64 temp = right;
+            right = left ^ (splitmix64(right ^ sampler->permutation_keys[round]) & half_mask);
+            left = temp;
+        }
+
+        idx = (left << half_bits) | right;
+    } while (idx >= sampler->edge_count);
+
+    return idx;
+}
+
+DLLEXPORT GphrxAvgPoolSampler new_gphrx_avg_pool_sampler(GphrxGraph *restrict graph, u64 block_dimension, u64 seed)
+{
+    if (block_dimension < 1)
+        block_dimension = 1;
+
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    if (block_dimension > vertex_count && vertex_count != 0)
+        block_dimension = vertex_count;
+
+    u64 blocks_per_row = _gphrx_avg_pool_blocks_per_row(vertex_count, block_dimension);
+    u64 edge_count = graph->adjacency_matrix.col_indices.size;
+
+    u64 domain_bits = 2;
+    for (; domain_bits < 64 && (1ULL << domain_bits) < edge_count; ++domain_bits);
+
+    GphrxAvgPoolSampler sampler = {
+        .dimension = blocks_per_row,
+        .block_dimension = block_dimension,
+        .edge_count = edge_count,
+        .sampled_count = 0,
+        .permutation_half_bits = (domain_bits + 1) / 2,
+        .permutation_keys = {0},
+        .occurrences = calloc(blocks_per_row * blocks_per_row + 1, sizeof(u64)),
+    };
+
+    assert(sampler.occurrences != 0, "calloc failure");
+
+    for (int i = 0; i < 4; ++i)
+    {
+        seed = splitmix64(seed);
+        sampler.permutation_keys[i] = seed;
+    }
+
+    return sampler;
+}
+
+DLLEXPORT void free_gphrx_avg_pool_sampler(GphrxAvgPoolSampler *restrict sampler)
+{
+    free(sampler->occurrences);
+}
+
+DLLEXPORT u64 gphrx_avg_pool_sampler_refine(GphrxAvgPoolSampler *restrict sampler,
+                                            GphrxGraph *restrict graph,
+                                            u64 sample_count)
+{
+    assert(sampler->edge_count == graph->adjacency_matrix.col_indices.size,
+           "Graph was modified after the sampler was created");
+
+    u64 remaining = sampler->edge_count - sampler->sampled_count;
+    if (sample_count > remaining)
+        sample_count = remaining;
+
+    u64 *col_indices = (u64*) graph->adjacency_matrix.col_indices.arr;
+    u64 *row_indices = (u64*) graph->adjacency_matrix.row_indices.arr;
+
+    FastDivisor divisor = new_fast_divisor(sampler->block_dimension);
+
+    u64 end = sampler->sampled_count + sample_count;
+    for (u64 i = sampler->sampled_count; i < end; ++i)
+    {
+        u64 edge_idx = sampler_permute_index(sampler, i);
+
+        u64 col_pos = fast_divisor_divide(&divisor, col_indices[edge_idx]);
+        u64 row_pos = fast_divisor_divide(&divisor, row_indices[edge_idx]);
+
+        ++sampler->occurrences[row_pos * sampler->dimension + col_pos];
+    }
+
+    sampler->sampled_count = end;
+
+    return sample_count;
+}
+
+DLLEXPORT GphrxCsrMatrix gphrx_avg_pool_sampler_estimate(GphrxAvgPoolSampler *restrict sampler,
+                                                         double z_score,
+                                                         GphrxCsrMatrix *restrict margins)
+{
+    double sampled = (double) sampler->sampled_count;
+    double population = (double) sampler->edge_count;
+    double scale = sampler->sampled_count == 0 ? 0.0 : population / sampled;
+
+    GphrxCsrMatrix estimate = _gphrx_avg_pool_matrix_from_occurrences(sampler->occurrences,
+                                                               sampler->dimension,
+                                                               sampler->block_dimension,
+                                                               scale,
+                                                               gphrx_get_allocator());
+
+    if (margins == 0)
+        return estimate;
+
+    margins->dimension = estimate.dimension;
+    margins->entries = new_dynarr8_with_capacity(estimate.entries.size + 1);
+    margins->col_indices = new_dynarr8_with_capacity(estimate.entries.size + 1);
+    margins->row_indices = new_dynarr8_with_capacity(estimate.entries.size + 1);
+
+    // The count in a block is population * p, where p is the proportion of edges that fall in the block.
+    // p is estimated by the proportion of sampled edges in the block, whose variance is reduced by the
+    // finite population correction because edges are sampled without replacement.
+    double finite_population_correction = population > 1.0
+        ? (population - sampled) / (population - 1.0)
+        : 0.0;
+    double block_size = (double) sampler->block_dimension * (double) sampler->block_dimension;
+
+    for (size_t i = 0; i < estimate.entries.size; ++i)
+    {
+        u64 col = dynarr8_get(&estimate.col_indices, i).u64_val;
+        u64 row = dynarr8_get(&estimate.row_indices, i).u64_val;
+
+        double proportion = sampler->occurrences[row * sampler->dimension + col] / sampled;
+        double variance = proportion * (1.0 - proportion) / sampled * finite_population_correction;
+        double margin = z_score * sqrt(variance) * population / block_size;
+
+        Byte8Val margin_bv = { .dbl_val = margin };
+
+        dynarr8_push(&margins->entries, margin_bv);
+        dynarr8_push(&margins->col_indices, dynarr8_get(&estimate.col_indices, i));
+        dynarr8_push(&margins->row_indices, dynarr8_get(&estimate.row_indices, i));
+    }
+
+    return estimate;
+}
+
+GphrxGraph _gphrx_approximation_from_avg_pool_matrix(GphrxCsrMatrix *restrict occurrence_matrix,
+                                                     bool is_undirected,
+                                                     double threshold)
+{
+    if (threshold > 1.0f)
+        threshold = 1.0f;
+    else if (threshold <= 0.0f)
+        threshold = 0.00000001f;
+
+    GphrxCsrAdjacencyMatrix approx_adj_matrix = {
+        .dimension = occurrence_matrix->dimension,
+        .col_indices = new_dynarr8_with_capacity(occurrence_matrix->entries.size + 1),
+        .row_indices = new_dynarr8_with_capacity(occurrence_matrix->entries.size + 1),
+    };
+
+    GphrxGraph approx_graph = {
+        .is_undirected = is_undirected,
+        .adjacency_matrix = approx_adj_matrix,
+    };
+
+    for (size_t i = 0; i < occurrence_matrix->entries.size; ++i)
+    {
+        if (dynarr8_get(&occurrence_matrix->entries, i).dbl_val >= threshold)
+        {
+            Byte8Val col_bv = { .u64_val = dynarr8_get(&occurrence_matrix->col_indices, i).u64_val };
+            Byte8Val row_bv = { .u64_val = dynarr8_get(&occurrence_matrix->row_indices, i).u64_val };
+            
+            dynarr8_push(&approx_graph.adjacency_matrix.col_indices, col_bv);
+            dynarr8_push(&approx_graph.adjacency_matrix.row_indices, row_bv);
+        }
+    }
+
+    return approx_graph;
+}
+
+DLLEXPORT GphrxGraph approximate_gphrx(GphrxGraph *restrict graph, u64 block_dimension, double threshold)
+{
+    if (block_dimension <= 1 || graph->adjacency_matrix.col_indices.size <= 1)
+        return duplicate_gphrx(graph);
+
+    // The avg pool matrix is only needed until the approximation is built, so it goes in the scratch arena
+    GphrxArena *scratch_arena = _gphrx_scratch_arena();
+    GphrxArenaMark scratch_mark = gphrx_arena_mark(scratch_arena);
+
+    GphrxCsrMatrix occurrence_matrix = find_avg_pool_matrix(graph, block_dimension, &scratch_arena->allocator);
+    GphrxGraph approx_graph = _gphrx_approximation_from_avg_pool_matrix(&occurrence_matrix,
+                                                                        graph->is_undirected,
+                                                                        threshold);
+
+    gphrx_arena_rewind(scratch_arena, scratch_mark);
     
-    u64 blocks_per_row = (vertex_count / block_dimension) + (are_edge_blocks_padded ? 1 : 0);
+    return approx_graph;
+}
+
+DLLEXPORT DynamicArray8 gphrx_find_degree_quantile_boundaries(GphrxGraph *restrict graph, u64 blocks_per_row)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+
+    if (blocks_per_row < 1)
+        blocks_per_row = 1;
+
+    if (blocks_per_row > vertex_count && vertex_count != 0)
+        blocks_per_row = vertex_count;
+
+    // degree_prefix_sum[v] is the number of edge endpoints (counting both the "from" and "to" ends of each
+    // edge) belonging to vertices with IDs less than v
+    u64 *degree_prefix_sum = calloc(vertex_count + 1, sizeof(u64));
+
+    assert(degree_prefix_sum != 0, "calloc failure");
+
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        ++degree_prefix_sum[dynarr8_get(&graph->adjacency_matrix.col_indices, i).u64_val + 1];
+        ++degree_prefix_sum[dynarr8_get(&graph->adjacency_matrix.row_indices, i).u64_val + 1];
+    }
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        degree_prefix_sum[v + 1] += degree_prefix_sum[v];
+
+    u64 total_degree = degree_prefix_sum[vertex_count];
+
+    DynamicArray8 boundaries = new_dynarr8_with_capacity(blocks_per_row + 1);
+
+    Byte8Val first_bv = { .u64_val = 0 };
+    dynarr8_push(&boundaries, first_bv);
+
+    for (u64 block = 1; block < blocks_per_row && total_degree != 0; ++block)
+    {
+        // The block starts at the first vertex whose prefix sum reaches the block's share of the degree mass
+        u64 target = (u64) (((double) block / blocks_per_row) * total_degree);
+
+        u64 low = 0;
+        u64 high = vertex_count;
+        while (low < high)
+        {
+            u64 middle = low + (high - low) / 2;
+
+            if (degree_prefix_sum[middle] < target)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        // A hub can hold more than a block's share of the degree mass on its own. Blocks can't split a
+        // vertex, so boundaries that would repeat are skipped.
+        if (low > dynarr8_get(&boundaries, boundaries.size - 1).u64_val && low < vertex_count)
+        {
+            Byte8Val boundary_bv = { .u64_val = low };
+            dynarr8_push(&boundaries, boundary_bv);
+        }
+    }
+
+    Byte8Val last_bv = { .u64_val = vertex_count };
+    dynarr8_push(&boundaries, last_bv);
+
+    free(degree_prefix_sum);
+
+    return boundaries;
+}
+
+DLLEXPORT void free_gphrx_block_boundaries(DynamicArray8 *restrict boundaries)
+{
+    free_dynarr8(boundaries);
+}
+
+typedef struct {
+    u64 *occurrences;
+    u64 *col_indices;
+    u64 *row_indices;
+    size_t *block_col_offsets;
+    u64 *vertex_blocks;
+    u64 blocks_per_row;
+} BoundaryPoolingContext;
+
+static void pool_boundary_block_col_range(void *context, size_t first_block_col, size_t end_block_col, u32 thread_idx)
+{
+    BoundaryPoolingContext *pooling = context;
+
+    size_t end = pooling->block_col_offsets[end_block_col];
+    for (size_t i = pooling->block_col_offsets[first_block_col]; i < end; ++i)
+    {
+        u64 col_pos = pooling->vertex_blocks[pooling->col_indices[i]];
+        u64 row_pos = pooling->vertex_blocks[pooling->row_indices[i]];
+
+        ++pooling->occurrences[row_pos * pooling->blocks_per_row + col_pos];
+    }
+}
+
+static GphrxCsrMatrix find_avg_pool_matrix_with_boundaries(GphrxGraph *restrict graph,
+                                                           DynamicArray8 *restrict boundaries,
+                                                           GphrxAllocator *allocator)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+    u64 blocks_per_row = boundaries->size - 1;
     u64 block_count = blocks_per_row * blocks_per_row;
 
-    u64 occurrences = calloc(block_count, sizeof(u64));
+    assert(boundaries->size >= 2, "Block boundaries must include the start and end of the vertex range");
+    assert(dynarr8_get(boundaries, boundaries->size - 1).u64_val >= vertex_count,
+           "Block boundaries do not cover the graph");
+
+    // Map every vertex to its block once so the pass over the edges doesn't need to search the boundaries
+    u64 *vertex_blocks = malloc((vertex_count + 1) * sizeof(u64));
 
-    for (size_t i = 0; i < graph->adjacency_matrix.col_indices.size; ++i)
+    assert(vertex_blocks != 0, "malloc failure");
+
+    for (u64 block = 0; block < blocks_per_row; ++block)
     {
-        u64 col = dynarr8_get(&graph->adjacency_matrix.col_indices, i).u64_val;
-        u64 row = dynarr8_get(&graph->adjacency_matrix.row_indices, i).u64_val;
+        u64 block_end = dynarr8_get(boundaries, block + 1).u64_val;
+        for (u64 v = dynarr8_get(boundaries, block).u64_val; v < block_end && v < vertex_count; ++v)
+            vertex_blocks[v] = block;
+    }
+
+    u64 *occurrences = calloc(block_count + 1, sizeof(u64));
+    size_t *block_col_offsets = malloc(sizeof(size_t) * (blocks_per_row + 1));
 
-        u64 col_pos = col / block_dimension;
-        u64 row_pos = row / block_dimension;
+    assert(occurrences != 0, "calloc failure");
+    assert(block_col_offsets != 0, "malloc failure");
 
-        size_t occurrences_pos = row_pos * blocks_per_row + col_pos;
-        ++occurrences[occurrences_pos];
+    u64 *col_indices = (u64*) graph->adjacency_matrix.col_indices.arr;
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+
+    block_col_offsets[0] = 0;
+    for (u64 block_col = 1; block_col < blocks_per_row; ++block_col)
+    {
+        block_col_offsets[block_col] = first_edge_from_vertex(col_indices,
+                                                              block_col_offsets[block_col - 1],
+                                                              edge_count,
+                                                              dynarr8_get(boundaries, block_col).u64_val);
     }
+    block_col_offsets[blocks_per_row] = edge_count;
+
+    BoundaryPoolingContext context = {
+        .occurrences = occurrences,
+        .col_indices = col_indices,
+        .row_indices = (u64*) graph->adjacency_matrix.row_indices.arr,
+        .block_col_offsets = block_col_offsets,
+        .vertex_blocks = vertex_blocks,
+        .blocks_per_row = blocks_per_row,
+    };
+
+    // Degree-quantile boundaries give block columns similar edge counts, but a hub can still make one block
+    // column much heavier than the rest, so the block columns are balanced by edge count
+    _gphrx_parallel_for_balanced(0,
+                                 blocks_per_row,
+                                 block_col_offsets,
+                                 POOLING_GRAIN_SIZE,
+                                 pool_boundary_block_col_range,
+                                 &context);
+
+    free(block_col_offsets);
 
     GphrxCsrMatrix occurrence_matrix = {
         .dimension = blocks_per_row,
-        .entries = new_dynarr8_with_capacity(block_count),
-        .col_indices = new_dynarr8_with_capacity(block_count),
-        .row_indices = new_dynarr8_with_capacity(block_count),
+        .entries = new_dynarr8_with_allocator(1, allocator),
+        .col_indices = new_dynarr8_with_allocator(1, allocator),
+        .row_indices = new_dynarr8_with_allocator(1, allocator),
     };
-    
-    double block_size = block_dimension * block_dimension;
-    for (size_t col = 0; col < blocks_per_row; ++col)
+
+    for (u64 col = 0; col < blocks_per_row; ++col)
     {
-        for (size_t row = 0; row < blocks_per_row; ++row)
+        double col_width = (double) (dynarr8_get(boundaries, col + 1).u64_val - dynarr8_get(boundaries, col).u64_val);
+
+        for (u64 row = 0; row < blocks_per_row; ++row)
         {
-            size_t row_start = row * blocks_per_row;
-            double entry = occurrences[row_start + col] / (double) block_size;
+            u64 count = occurrences[row * blocks_per_row + col];
 
-            if (entry != 0.0)
+            if (count != 0)
             {
-                Byte8Val entry_bv = { .dbl_val = entry };
+                double row_width = (double) (dynarr8_get(boundaries, row + 1).u64_val -
+                                             dynarr8_get(boundaries, row).u64_val);
+
+                Byte8Val entry_bv = { .dbl_val = count / (col_width * row_width) };
                 Byte8Val col_bv = { .u64_val = col };
                 Byte8Val row_bv = { .u64_val = row };
 
@@ -452,58 +1836,59 @@ DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix(GphrxGraph *restrict graph,
     }
 
     free(occurrences);
+    free(vertex_blocks);
+
+    return occurrence_matrix;
+}
 
-    return occurrence_matrix;
+DLLEXPORT GphrxCsrMatrix gphrx_find_avg_pool_matrix_with_boundaries(GphrxGraph *restrict graph,
+                                                                    DynamicArray8 *restrict boundaries)
+{
+    return find_avg_pool_matrix_with_boundaries(graph, boundaries, gphrx_get_allocator());
 }
 
-DLLEXPORT GphrxGraph approximate_gphrx(GphrxGraph *restrict graph, u64 block_dimension, double threshold)
+DLLEXPORT GphrxGraph approximate_gphrx_with_boundaries(GphrxGraph *restrict graph,
+                                                       DynamicArray8 *restrict boundaries,
+                                                       double threshold)
 {
-    if (block_dimension <= 1 || graph->adjacency_matrix.col_indices.size <= 1)
-        return duplicate_gphrx(graph);
+    GphrxArena *scratch_arena = _gphrx_scratch_arena();
+    GphrxArenaMark scratch_mark = gphrx_arena_mark(scratch_arena);
 
-    u64 vertex_count = graph->adjacency_matrix.dimension;
+    GphrxCsrMatrix occurrence_matrix = find_avg_pool_matrix_with_boundaries(graph,
+                                                                           boundaries,
+                                                                           &scratch_arena->allocator);
+    GphrxGraph approx_graph = _gphrx_approximation_from_avg_pool_matrix(&occurrence_matrix,
+                                                                        graph->is_undirected,
+                                                                        threshold);
 
-    if (block_dimension > vertex_count)
-        block_dimension = vertex_count;
+    gphrx_arena_rewind(scratch_arena, scratch_mark);
 
-    bool are_edge_blocks_padded = !(vertex_count % block_dimension == 0);
-    
-    u64 blocks_per_row = (vertex_count / block_dimension) + (are_edge_blocks_padded ? 1 : 0);
-    u64 block_count = blocks_per_row * blocks_per_row;
-    
-    if (threshold > 1.0f)
-        threshold = 1.0f;
-    else if (threshold <= 0.0f)
-        threshold = 0.00000001f;
+    return approx_graph;
+}
 
-    GphrxCsrMatrix occurrence_matrix = gphrx_find_avg_pool_matrix(graph, block_dimension);
+#define BYTE_SWAP_GRAIN_SIZE 65536
 
-    GphrxCsrAdjacencyMatrix approx_adj_matrix = {
-        .dimension = occurrence_matrix.dimension,
-        .col_indices = new_dynarr8_with_capacity(block_count),
-        .row_indices = new_dynarr8_with_capacity(block_count),
-    };
+typedef struct {
+    Byte8Val *col_src;
+    Byte8Val *row_src;
+    byte *col_dst;
+    byte *row_dst;
+} ByteSwapContext;
 
-    GphrxGraph approx_graph = {
-        .is_undirected = graph->is_undirected,
-        .adjacency_matrix = approx_adj_matrix,
-    };
+// Writes the byte-reversed column and row indices in [start, end) to the destination buffers, which may
+// be the source arrays themselves
+static void byte_swap_range(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    ByteSwapContext *swap = context;
 
-    for (size_t i = 0; i < occurrence_matrix.entries.size; ++i)
+    for (size_t i = start; i < end; ++i)
     {
-        if (dynarr8_get(&occurrence_matrix.entries, i).dbl_val >= threshold)
-        {
-            Byte8Val col_bv = { .u64_val = dynarr8_get(&occurrence_matrix.col_indices, i).u64_val };
-            Byte8Val row_bv = { .u64_val = dynarr8_get(&occurrence_matrix.row_indices, i).u64_val };
-            
-            dynarr8_push(&approx_graph.adjacency_matrix.col_indices, col_bv);
-            dynarr8_push(&approx_graph.adjacency_matrix.row_indices, row_bv);
-        }
-    }
+        u64 col = u64_reverse_bits(swap->col_src[i].u64_val);
+        u64 row = u64_reverse_bits(swap->row_src[i].u64_val);
 
-    free_gphrx_csr_matrix(&occurrence_matrix);
-    
-    return approx_graph;
+        memcpy(swap->col_dst + i * sizeof(u64), &col, sizeof(u64));
+        memcpy(swap->row_dst + i * sizeof(u64), &row, sizeof(u64));
+    }
 }
 
 DLLEXPORT byte *gphrx_to_byte_array(GphrxGraph *restrict graph)
@@ -565,17 +1950,14 @@ DLLEXPORT byte *gphrx_to_byte_array(GphrxGraph *restrict graph)
         memcpy(buffer + pos, &temp_u8, sizeof(u8));
         pos += sizeof(u8);
         
-        for (size_t i = 0; i < graph->adjacency_matrix.col_indices.size; ++i, pos += sizeof(u64))
-        {
-            temp8 = u64_reverse_bits(graph->adjacency_matrix.col_indices.arr[i].u64_val);
-            memcpy(buffer + pos, &temp8, sizeof(u64));
-        }
-
-        for (size_t i = 0; i < graph->adjacency_matrix.row_indices.size; ++i, pos += sizeof(u64))
-        {
-            temp8 = u64_reverse_bits(graph->adjacency_matrix.row_indices.arr[i].u64_val);
-            memcpy(buffer + pos, &temp8, sizeof(u64));
-        }
+        ByteSwapContext context = {
+            .col_src = graph->adjacency_matrix.col_indices.arr,
+            .row_src = graph->adjacency_matrix.row_indices.arr,
+            .col_dst = buffer + pos,
+            .row_dst = buffer + pos + sizeof(u64) * graph->adjacency_matrix.col_indices.size,
+        };
+
+        _gphrx_parallel_for(0, graph->adjacency_matrix.col_indices.size, BYTE_SWAP_GRAIN_SIZE, byte_swap_range, &context);
     }
 
     return buffer;
@@ -586,7 +1968,7 @@ DLLEXPORT GphrxGraph gphrx_from_byte_array(byte *restrict arr, GphrxErrorCode *r
     *error = GPHRX_NO_ERROR;
     GphrxGraph graph = {
         .is_undirected = 0,
-        .adjacency_matrix = 0,
+        .adjacency_matrix = {0},
     };
     
     size_t pos = 0;
@@ -649,17 +2031,14 @@ DLLEXPORT GphrxGraph gphrx_from_byte_array(byte *restrict arr, GphrxErrorCode *r
 
     if (!is_system_big_endian())
     {
-        for (size_t i = 0; i < header.csr_adjacency_matrix_size; ++i)
-        {
-            graph.adjacency_matrix.col_indices.arr[i].u64_val =
-                u64_reverse_bits(graph.adjacency_matrix.col_indices.arr[i].u64_val);
-        }
-
-        for (size_t i = 0; i < header.csr_adjacency_matrix_size; ++i)
-        {
-            graph.adjacency_matrix.row_indices.arr[i].u64_val =
-                u64_reverse_bits(graph.adjacency_matrix.row_indices.arr[i].u64_val);
-        }
+        ByteSwapContext context = {
+            .col_src = graph.adjacency_matrix.col_indices.arr,
+            .row_src = graph.adjacency_matrix.row_indices.arr,
+            .col_dst = (byte*) graph.adjacency_matrix.col_indices.arr,
+            .row_dst = (byte*) graph.adjacency_matrix.row_indices.arr,
+        };
+
+        _gphrx_parallel_for(0, header.csr_adjacency_matrix_size, BYTE_SWAP_GRAIN_SIZE, byte_swap_range, &context);
     }
     
     return graph;
@@ -746,6 +2125,23 @@ static TEST_RESULT test_duplicate_gphrx()
                == dup_directed_graph.adjacency_matrix.row_indices.arr[i].u64_val,
                "Graph was incorrectly duplicated");
     }
+
+    // The lists are shared until one of the graphs is modified
+    assert(directed_graph.adjacency_matrix.col_indices.arr == dup_directed_graph.adjacency_matrix.col_indices.arr,
+           "Duplicate graph did not share lists");
+
+    gphrx_add_edge(&dup_directed_graph, 2, 3);
+    gphrx_add_edge(&directed_graph, 4, 5);
+
+    assert(directed_graph.adjacency_matrix.col_indices.arr != dup_directed_graph.adjacency_matrix.col_indices.arr,
+           "Modified graph still shares lists");
+    assert(directed_graph.adjacency_matrix.col_indices.size == 4, "Incorrect edge count");
+    assert(dup_directed_graph.adjacency_matrix.col_indices.size == 4, "Incorrect edge count");
+    assert(!gphrx_does_edge_exist(&directed_graph, 2, 3), "Modifying duplicate changed the original");
+    assert(gphrx_does_edge_exist(&directed_graph, 4, 5), "Edge not added");
+    assert(gphrx_does_edge_exist(&dup_directed_graph, 2, 3), "Edge not added");
+    assert(!gphrx_does_edge_exist(&dup_directed_graph, 4, 5), "Modifying original changed the duplicate");
+    assert(gphrx_does_edge_exist(&dup_directed_graph, 500, 7), "Shared edge lost");
     
     free_gphrx(&undirected_graph);
     free_gphrx(&directed_graph);
@@ -756,6 +2152,59 @@ static TEST_RESULT test_duplicate_gphrx()
     return TEST_PASS;
 }
 
+typedef struct {
+    GphrxGraph *graph;
+    GphrxGraph *duplicates;
+} DuplicateTestContext;
+
+static void duplicate_in_range(void *context_ptr, size_t start, size_t end, u32 thread_idx)
+{
+    DuplicateTestContext *context = context_ptr;
+
+    for (size_t i = start; i < end; ++i)
+        context->duplicates[i] = duplicate_gphrx(context->graph);
+}
+
+// Threads that duplicate the same graph at once all share its lists under a single reference count
+static TEST_RESULT test_duplicate_gphrx_concurrently()
+{
+    gphrx_set_num_threads(8);
+
+    for (u64 round = 0; round < 200; ++round)
+    {
+        GphrxGraph graph = new_random_test_graph(false, 100, 300, round);
+        GphrxGraph duplicates[64];
+
+        DuplicateTestContext context = {
+            .graph = &graph,
+            .duplicates = duplicates,
+        };
+
+        _gphrx_parallel_for(0, 64, 1, duplicate_in_range, &context);
+
+        atomic_size_t *ref_count = graph.adjacency_matrix.col_indices.ref_count;
+        assert(ref_count != 0 && atomic_load(ref_count) == 65, "Incorrect reference count");
+
+        for (u32 i = 0; i < 64; ++i)
+        {
+            assert(duplicates[i].adjacency_matrix.col_indices.ref_count == ref_count,
+                   "Duplicates counted references separately");
+            assert(duplicates[i].adjacency_matrix.row_indices.ref_count ==
+                   graph.adjacency_matrix.row_indices.ref_count, "Duplicates counted references separately");
+
+            free_gphrx(duplicates + i);
+        }
+
+        assert(atomic_load(ref_count) == 1, "Incorrect reference count");
+
+        free_gphrx(&graph);
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
 static TEST_RESULT test_free_gphrx()
 {
     GphrxGraph undirected_graph = new_undirected_gphrx();
@@ -857,70 +2306,381 @@ static TEST_RESULT test_gphrx_csr_adj_matrix_to_string()
     free_gphrx_byte_array(undir_adj_matrix_str);
     free_gphrx(&undirected_graph);
 
-    return TEST_PASS;
-}
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_csr_matrix_threshold_and_scale()
+{
+    GphrxCsrMatrix matrix = {
+        .dimension = 10,
+        .entries = new_dynarr8(),
+        .col_indices = new_dynarr8(),
+        .row_indices = new_dynarr8(),
+    };
+
+    // Enough entries to pass through the vectorized loops and the scalar tail
+    for (u64 i = 0; i < 21; ++i)
+    {
+        Byte8Val entry_bv = { .dbl_val = (i % 3 == 0) ? 0.1 : 0.25 * (i % 4 + 1) };
+        Byte8Val col_bv = { .u64_val = i / 10 };
+        Byte8Val row_bv = { .u64_val = i % 10 };
+
+        dynarr8_push(&matrix.entries, entry_bv);
+        dynarr8_push(&matrix.col_indices, col_bv);
+        dynarr8_push(&matrix.row_indices, row_bv);
+    }
+
+    size_t capacity = matrix.entries.capacity;
+    Byte8Val *entries_arr = matrix.entries.arr;
+
+    gphrx_csr_matrix_threshold_and_scale(&matrix, 0.5, 2.0);
+
+    assert(matrix.entries.capacity == capacity, "Matrix was reallocated");
+    assert(matrix.entries.arr == entries_arr, "Matrix was reallocated");
+    assert(matrix.dimension == 10, "Incorrect matrix dimension");
+
+    size_t kept = 0;
+    for (u64 i = 0; i < 21; ++i)
+    {
+        double entry = (i % 3 == 0) ? 0.1 : 0.25 * (i % 4 + 1);
+
+        if (entry < 0.5)
+            continue;
+
+        assert(dynarr8_get(&matrix.entries, kept).dbl_val == entry * 2.0, "Incorrect scaled entry");
+        assert(dynarr8_get(&matrix.col_indices, kept).u64_val == i / 10, "Incorrect compacted column");
+        assert(dynarr8_get(&matrix.row_indices, kept).u64_val == i % 10, "Incorrect compacted row");
+
+        ++kept;
+    }
+
+    assert(matrix.entries.size == kept, "Incorrect matrix size");
+    assert(matrix.col_indices.size == kept, "Incorrect matrix size");
+    assert(matrix.row_indices.size == kept, "Incorrect matrix size");
+
+    gphrx_csr_matrix_threshold_and_scale(&matrix, 10.0, 1.0);
+
+    assert(matrix.entries.size == 0, "Incorrect matrix size");
+    assert(matrix.col_indices.size == 0, "Incorrect matrix size");
+    assert(matrix.row_indices.size == 0, "Incorrect matrix size");
+
+    free_gphrx_csr_matrix(&matrix);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_shrink()
+{
+    GphrxGraph undirected_graph = new_undirected_gphrx();
+    GphrxGraph directed_graph = new_directed_gphrx();
+
+    dynarr8_expand(&undirected_graph.adjacency_matrix.col_indices, 500);
+    dynarr8_expand(&undirected_graph.adjacency_matrix.row_indices, 300);
+    assert(undirected_graph.adjacency_matrix.col_indices.capacity == 500, "Incorrect matrix cols size");
+    assert(undirected_graph.adjacency_matrix.row_indices.capacity == 300, "Incorrect matrix rows size");
+
+    dynarr8_expand(&directed_graph.adjacency_matrix.col_indices, 500);
+    dynarr8_expand(&directed_graph.adjacency_matrix.row_indices, 300);
+    assert(directed_graph.adjacency_matrix.col_indices.capacity == 500, "Incorrect matrix cols size");
+    assert(directed_graph.adjacency_matrix.row_indices.capacity == 300, "Incorrect matrix rows size");
+
+    gphrx_shrink(&undirected_graph);
+    assert(undirected_graph.adjacency_matrix.col_indices.capacity == 0, "Incorrect matrix cols size");
+    assert(undirected_graph.adjacency_matrix.row_indices.capacity == 0, "Incorrect matrix rows size");
+
+    gphrx_shrink(&directed_graph);
+    assert(directed_graph.adjacency_matrix.col_indices.capacity == 0, "Incorrect matrix cols size");
+    assert(directed_graph.adjacency_matrix.row_indices.capacity == 0, "Incorrect matrix rows size");
+
+    free_gphrx(&undirected_graph);
+    free_gphrx(&directed_graph);
+    
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_does_edge_exist()
+{
+    GphrxGraph undirected_graph = new_undirected_gphrx();
+    GphrxGraph directed_graph = new_directed_gphrx();
+
+    assert(!gphrx_does_edge_exist(&undirected_graph, 1, 1000), "Edge should not exist");
+    assert(!gphrx_does_edge_exist(&undirected_graph, 1000, 1), "Edge should not exist");
+    assert(!gphrx_does_edge_exist(&directed_graph, 1, 1000), "Edge should not exist");
+    
+    gphrx_add_edge(&undirected_graph, 1, 1000);
+    gphrx_add_edge(&directed_graph, 1, 1000);
+    
+    assert(gphrx_does_edge_exist(&undirected_graph, 1, 1000), "Edge should exist");
+    assert(gphrx_does_edge_exist(&undirected_graph, 1000, 1), "Edge should exist");
+    assert(gphrx_does_edge_exist(&directed_graph, 1, 1000), "Edge should exist");
+    
+    assert(!gphrx_does_edge_exist(&directed_graph, 1000, 1), "Edge should not exist");
+    gphrx_add_edge(&directed_graph, 1000, 1);
+    assert(gphrx_does_edge_exist(&directed_graph, 1000, 1), "Edge should exist");
+
+    assert(!gphrx_does_edge_exist(&undirected_graph, 100, 100), "Edge should not exist");
+    assert(!gphrx_does_edge_exist(&directed_graph, 100, 100), "Edge should not exist");
+    
+    gphrx_add_edge(&undirected_graph, 100, 100);
+    gphrx_add_edge(&directed_graph, 100, 100);
+    
+    assert(gphrx_does_edge_exist(&undirected_graph, 100, 100), "Edge should exist");
+    assert(gphrx_does_edge_exist(&directed_graph, 100, 100), "Edge should exist");
+    
+    free_gphrx(&undirected_graph);
+    free_gphrx(&directed_graph);
+    
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_does_edges_exist()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+            const size_t edge_count = 20000;
+            const size_t query_count = 30001;
+
+            u64 *from_vertex_ids = malloc(sizeof(u64) * query_count);
+            u64 *to_vertex_ids = malloc(sizeof(u64) * query_count);
+            u8 *out_bits = malloc((query_count + 7) / 8);
+
+            u64 seed = 7 + is_undirected;
+
+            for (size_t i = 0; i < edge_count; ++i)
+            {
+                seed = splitmix64(seed);
+                from_vertex_ids[i] = seed % 3000;
+                to_vertex_ids[i] = (seed >> 32) % 3000;
+            }
+
+            gphrx_add_edges(&graph, from_vertex_ids, to_vertex_ids, edge_count);
+
+            // Every edge added, then random pairs (most of which are not edges), some past the end of the
+            // graph
+            for (size_t i = edge_count; i < query_count; ++i)
+            {
+                seed = splitmix64(seed);
+                from_vertex_ids[i] = seed % 3100;
+                to_vertex_ids[i] = (seed >> 32) % 3100;
+            }
+
+            memset(out_bits, 0xFF, (query_count + 7) / 8);
+            gphrx_does_edges_exist(&graph, from_vertex_ids, to_vertex_ids, out_bits, query_count);
+
+            for (size_t i = 0; i < query_count; ++i)
+            {
+                bool is_found = (out_bits[i / 8] >> (i % 8)) & 1;
+                bool does_exist = gphrx_does_edge_exist(&graph, from_vertex_ids[i], to_vertex_ids[i]);
+
+                assert(is_found == (i < edge_count || does_exist), "Incorrect edge lookup");
+            }
+
+            assert(out_bits[query_count / 8] >> (query_count % 8) == 0, "Bits past the queries should be clear");
+
+            free(from_vertex_ids);
+            free(to_vertex_ids);
+            free(out_bits);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // To vertex IDs that don't fit in 32 bits
+    GphrxGraph graph = new_directed_gphrx();
+
+    gphrx_add_edge(&graph, 5, 1ULL << 40);
+    gphrx_add_edge(&graph, 5, 3);
+
+    u64 from_vertex_ids[] = { 5, 5, 5, 4, 5 };
+    u64 to_vertex_ids[] = { 1ULL << 40, 3, (1ULL << 40) + 1, 3, 2 };
+    u8 out_bits = 0;
+
+    gphrx_does_edges_exist(&graph, from_vertex_ids, to_vertex_ids, &out_bits, 5);
+    assert(out_bits == 0x03, "Incorrect edge lookup");
+
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+typedef struct {
+    GphrxGraph *graph;
+    GphrxGraph *unindexed_graph;
+    _Atomic u64 mismatch_count;
+} VertexIndexTestContext;
+
+static void query_vertex_index_in_range(void *context_ptr, size_t start, size_t end, u32 thread_idx)
+{
+    VertexIndexTestContext *context = context_ptr;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        u64 from_vertex_id = splitmix64(i) % 3000;
+        u64 to_vertex_id = splitmix64(i + 1) % 3000;
+
+        if (gphrx_does_edge_exist(context->graph, from_vertex_id, to_vertex_id) !=
+            gphrx_does_edge_exist(context->unindexed_graph, from_vertex_id, to_vertex_id))
+        {
+            atomic_fetch_add(&context->mismatch_count, 1);
+        }
+    }
+}
+
+static TEST_RESULT test_gphrx_vertex_index()
+{
+    // Enough vertices to fill part of a node, exactly one node, one level, and several levels
+    size_t vertex_counts[] = { 0, 1, 7, 8, 9, 72, 73, 81, 82, 5000 };
+
+    for (u32 c = 0; c < sizeof(vertex_counts) / sizeof(vertex_counts[0]); ++c)
+    {
+        size_t vertex_count = vertex_counts[c];
+        GphrxGraph graph = new_directed_gphrx();
+
+        u64 seed = 11 + c;
+
+        // Sparse IDs, the last of which doesn't fit in 32 bits
+        for (size_t k = 0; k < vertex_count; ++k)
+        {
+            u64 vertex_id = k + 1 == vertex_count ? 1ULL << 40 : k * 65537 + 3;
+
+            seed = splitmix64(seed);
+
+            for (u64 j = 0; j < 1 + seed % 4; ++j)
+                gphrx_add_edge(&graph, vertex_id, (seed >> (8 * j)) % 1000);
+        }
+
+        GphrxGraph unindexed_graph = duplicate_gphrx(&graph);
+
+        gphrx_shrink(&graph);
+        assert(graph.vertex_index != 0, "Shrinking should enable the vertex index");
+        assert(atomic_load(&graph.vertex_index->state) == GPHRX_VERTEX_INDEX_UNBUILT, "Index built too early");
+        assert(unindexed_graph.vertex_index == 0, "Duplicate should not be indexed");
+
+        for (size_t k = 0; k <= vertex_count; ++k)
+        {
+            u64 vertex_id = k + 1 == vertex_count ? 1ULL << 40 : k * 65537 + 3;
+
+            // The vertex, IDs on either side of it, and the largest ID
+            u64 query_ids[] = { vertex_id, vertex_id - 1, vertex_id + 1, UINT64_MAX };
+
+            for (u32 q = 0; q < sizeof(query_ids) / sizeof(query_ids[0]); ++q)
+            {
+                size_t end;
+                size_t start = _gphrx_find_vertex_edge_range(&graph, query_ids[q], &end);
+
+                size_t expected_end;
+                size_t expected_start = _gphrx_find_vertex_edge_range(&unindexed_graph, query_ids[q], &expected_end);
+
+                assert(start == expected_start && end == expected_end, "Incorrect indexed vertex range");
+            }
+
+            for (u64 w = 0; w < 1000; w += 7)
+            {
+                assert(gphrx_does_edge_exist(&graph, vertex_id, w) ==
+                       gphrx_does_edge_exist(&unindexed_graph, vertex_id, w),
+                       "Incorrect indexed edge lookup");
+            }
+        }
+
+        assert(graph.vertex_index != 0 &&
+               atomic_load(&graph.vertex_index->state) == GPHRX_VERTEX_INDEX_BUILT,
+               "Index should be built by the first query");
+
+        // Batched lookups, unsorted so that vertices are looked up out of order
+        const size_t query_count = 2000;
+
+        u64 *from_vertex_ids = malloc(sizeof(u64) * query_count);
+        u64 *to_vertex_ids = malloc(sizeof(u64) * query_count);
+        u8 *out_bits = malloc((query_count + 7) / 8);
+
+        for (size_t i = 0; i < query_count; ++i)
+        {
+            seed = splitmix64(seed);
+
+            u64 k = vertex_count == 0 ? 0 : seed % vertex_count;
+            from_vertex_ids[i] = k + 1 == vertex_count ? 1ULL << 40 : k * 65537 + 3 + (seed >> 62);
+            to_vertex_ids[i] = (seed >> 16) % 1000;
+        }
+
+        gphrx_does_edges_exist(&graph, from_vertex_ids, to_vertex_ids, out_bits, query_count);
+
+        for (size_t i = 0; i < query_count; ++i)
+        {
+            bool is_found = (out_bits[i / 8] >> (i % 8)) & 1;
+
+            assert(is_found == gphrx_does_edge_exist(&unindexed_graph, from_vertex_ids[i], to_vertex_ids[i]),
+                   "Incorrect indexed batch lookup");
+        }
+
+        free(from_vertex_ids);
+        free(to_vertex_ids);
+        free(out_bits);
+
+        // Adding an edge that already exists changes nothing, but any other change drops the index
+        if (vertex_count > 1)
+        {
+            gphrx_add_edge(&graph, 3, splitmix64(11 + c) % 1000);
+            assert(graph.vertex_index != 0, "Index dropped by a no-op");
+        }
+
+        gphrx_add_edge(&graph, 2, 999);
+        assert(graph.vertex_index == 0, "Index not dropped by a change");
+        assert(gphrx_does_edge_exist(&graph, 2, 999), "Edge missing after change");
+
+        gphrx_shrink(&graph);
+        assert(gphrx_does_edge_exist(&graph, 2, 999), "Edge missing after rebuilding the index");
+        assert(!gphrx_does_edge_exist(&graph, 2, 998), "Edge should not exist");
+
+        assert(gphrx_remove_edge(&graph, 2, 999) == GPHRX_NO_ERROR, "Failed to remove edge");
+        assert(graph.vertex_index == 0, "Index not dropped by a change");
+        assert(!gphrx_does_edge_exist(&graph, 2, 999), "Edge not removed");
+
+        // Removing a vertex without edges leaves the other vertices' edges alone
+        size_t edge_count = graph.adjacency_matrix.col_indices.size;
+
+        gphrx_remove_vertex(&graph, 5000);
+        assert(graph.adjacency_matrix.col_indices.size == edge_count, "Removed edges of another vertex");
+
+        free_gphrx(&graph);
+        free_gphrx(&unindexed_graph);
+    }
+
+    // Threads that query a newly shrunk graph at once race to build the index
+    GphrxGraph graph = new_undirected_gphrx();
 
-static TEST_RESULT test_gphrx_shrink()
-{
-    GphrxGraph undirected_graph = new_undirected_gphrx();
-    GphrxGraph directed_graph = new_directed_gphrx();
+    for (u64 i = 0; i < 20000; ++i)
+        gphrx_add_edge(&graph, splitmix64(i) % 3000, splitmix64(i + 1) % 3000);
 
-    dynarr8_expand(&undirected_graph.adjacency_matrix.col_indices, 500);
-    dynarr8_expand(&undirected_graph.adjacency_matrix.row_indices, 300);
-    assert(undirected_graph.adjacency_matrix.col_indices.capacity == 500, "Incorrect matrix cols size");
-    assert(undirected_graph.adjacency_matrix.row_indices.capacity == 300, "Incorrect matrix rows size");
+    GphrxGraph unindexed_graph = duplicate_gphrx(&graph);
 
-    dynarr8_expand(&directed_graph.adjacency_matrix.col_indices, 500);
-    dynarr8_expand(&directed_graph.adjacency_matrix.row_indices, 300);
-    assert(directed_graph.adjacency_matrix.col_indices.capacity == 500, "Incorrect matrix cols size");
-    assert(directed_graph.adjacency_matrix.row_indices.capacity == 300, "Incorrect matrix rows size");
+    VertexIndexTestContext context = {
+        .graph = &graph,
+        .unindexed_graph = &unindexed_graph,
+        .mismatch_count = 0,
+    };
 
-    gphrx_shrink(&undirected_graph);
-    assert(undirected_graph.adjacency_matrix.col_indices.capacity == 0, "Incorrect matrix cols size");
-    assert(undirected_graph.adjacency_matrix.row_indices.capacity == 0, "Incorrect matrix rows size");
+    gphrx_set_num_threads(4);
+    gphrx_shrink(&graph);
 
-    gphrx_shrink(&directed_graph);
-    assert(directed_graph.adjacency_matrix.col_indices.capacity == 0, "Incorrect matrix cols size");
-    assert(directed_graph.adjacency_matrix.row_indices.capacity == 0, "Incorrect matrix rows size");
+    _gphrx_parallel_for(0, 40000, 64, query_vertex_index_in_range, &context);
 
-    free_gphrx(&undirected_graph);
-    free_gphrx(&directed_graph);
-    
-    return TEST_PASS;
-}
+    gphrx_set_num_threads(0);
 
-static TEST_RESULT test_gphrx_does_edge_exist()
-{
-    GphrxGraph undirected_graph = new_undirected_gphrx();
-    GphrxGraph directed_graph = new_directed_gphrx();
+    assert(atomic_load(&context.mismatch_count) == 0, "Incorrect edge lookup while building the index");
+    assert(atomic_load(&graph.vertex_index->state) == GPHRX_VERTEX_INDEX_BUILT, "Index not built");
 
-    assert(!gphrx_does_edge_exist(&undirected_graph, 1, 1000), "Edge should not exist");
-    assert(!gphrx_does_edge_exist(&undirected_graph, 1000, 1), "Edge should not exist");
-    assert(!gphrx_does_edge_exist(&directed_graph, 1, 1000), "Edge should not exist");
-    
-    gphrx_add_edge(&undirected_graph, 1, 1000);
-    gphrx_add_edge(&directed_graph, 1, 1000);
-    
-    assert(gphrx_does_edge_exist(&undirected_graph, 1, 1000), "Edge should exist");
-    assert(gphrx_does_edge_exist(&undirected_graph, 1000, 1), "Edge should exist");
-    assert(gphrx_does_edge_exist(&directed_graph, 1, 1000), "Edge should exist");
-    
-    assert(!gphrx_does_edge_exist(&directed_graph, 1000, 1), "Edge should not exist");
-    gphrx_add_edge(&directed_graph, 1000, 1);
-    assert(gphrx_does_edge_exist(&directed_graph, 1000, 1), "Edge should exist");
+    free_gphrx(&graph);
+    free_gphrx(&unindexed_graph);
 
-    assert(!gphrx_does_edge_exist(&undirected_graph, 100, 100), "Edge should not exist");
-    assert(!gphrx_does_edge_exist(&directed_graph, 100, 100), "Edge should not exist");
-    
-    gphrx_add_edge(&undirected_graph, 100, 100);
-    gphrx_add_edge(&directed_graph, 100, 100);
-    
-    assert(gphrx_does_edge_exist(&undirected_graph, 100, 100), "Edge should exist");
-    assert(gphrx_does_edge_exist(&directed_graph, 100, 100), "Edge should exist");
-    
-    free_gphrx(&undirected_graph);
-    free_gphrx(&directed_graph);
-    
     return TEST_PASS;
 }
 
@@ -1257,6 +3017,60 @@ static TEST_RESULT test_gphrx_add_edge()
     return TEST_PASS;
 }
 
+static TEST_RESULT test_gphrx_add_edges()
+{
+    u64 from_vertex_ids[] = {8, 3, 3, 0, 12, 3, 5, 7, 5, 2, 3};
+    u64 to_vertex_ids[] = {3, 8, 1, 0, 4, 8, 5, 2, 9, 7, 1};
+    size_t count = sizeof(from_vertex_ids) / sizeof(u64);
+
+    for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+    {
+        GphrxGraph batched = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+        GphrxGraph sequential = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+        // Some of the batch is already in the graph
+        gphrx_add_edge(&batched, 3, 8);
+        gphrx_add_edge(&batched, 7, 2);
+        gphrx_add_edge(&batched, 4, 6);
+
+        gphrx_add_edge(&sequential, 3, 8);
+        gphrx_add_edge(&sequential, 7, 2);
+        gphrx_add_edge(&sequential, 4, 6);
+
+        gphrx_add_edges(&batched, from_vertex_ids, to_vertex_ids, count);
+
+        for (size_t i = 0; i < count; ++i)
+            gphrx_add_edge(&sequential, from_vertex_ids[i], to_vertex_ids[i]);
+
+        assert(batched.adjacency_matrix.dimension == sequential.adjacency_matrix.dimension,
+               "Incorrect adjacency matrix dimension");
+        assert(batched.adjacency_matrix.col_indices.size == sequential.adjacency_matrix.col_indices.size,
+               "Incorrect adjacency matrix");
+        assert(batched.adjacency_matrix.row_indices.size == sequential.adjacency_matrix.row_indices.size,
+               "Incorrect adjacency matrix");
+
+        for (size_t i = 0; i < sequential.adjacency_matrix.col_indices.size; ++i)
+        {
+            assert(dynarr8_get(&batched.adjacency_matrix.col_indices, i).u64_val ==
+                   dynarr8_get(&sequential.adjacency_matrix.col_indices, i).u64_val,
+                   "Incorrect adjacency matrix");
+            assert(dynarr8_get(&batched.adjacency_matrix.row_indices, i).u64_val ==
+                   dynarr8_get(&sequential.adjacency_matrix.row_indices, i).u64_val,
+                   "Incorrect adjacency matrix");
+        }
+
+        // An empty batch changes nothing
+        size_t edge_count = batched.adjacency_matrix.col_indices.size;
+        gphrx_add_edges(&batched, from_vertex_ids, to_vertex_ids, 0);
+        assert(batched.adjacency_matrix.col_indices.size == edge_count, "Empty batch changed the graph");
+
+        free_gphrx(&batched);
+        free_gphrx(&sequential);
+    }
+
+    return TEST_PASS;
+}
+
 static TEST_RESULT test_gphrx_remove_edge()
 {
     GphrxErrorCode error = 0;
@@ -1434,6 +3248,228 @@ static TEST_RESULT test_gphrx_find_avg_pool_matrix()
     return TEST_PASS;
 }
 
+static TEST_RESULT test_gphrx_parallel_pooling_and_serialization()
+{
+    GphrxGraph graph = new_directed_gphrx();
+
+    // Vertex 0 is a hub so that one block column holds far more edges than the others
+    for (u64 to = 0; to < 3000; ++to)
+        gphrx_add_edge(&graph, 0, to);
+
+    for (u64 from = 1; from < 3000; ++from)
+    {
+        for (u64 k = 0; k < 40; ++k)
+            gphrx_add_edge(&graph, from, (from * 7 + k * k * 13) % 3000);
+    }
+
+    u64 block_dimensions[] = {1, 7, 64, 1000};
+
+    for (size_t b = 0; b < sizeof(block_dimensions) / sizeof(u64); ++b)
+    {
+        gphrx_set_num_threads(1);
+        GphrxCsrMatrix serial = gphrx_find_avg_pool_matrix(&graph, block_dimensions[b]);
+
+        gphrx_set_num_threads(4);
+        GphrxCsrMatrix parallel = gphrx_find_avg_pool_matrix(&graph, block_dimensions[b]);
+
+        assert(serial.entries.size == parallel.entries.size, "Parallel avg pool matrix differs");
+
+        for (size_t i = 0; i < serial.entries.size; ++i)
+        {
+            assert(serial.entries.arr[i].dbl_val == parallel.entries.arr[i].dbl_val, "Parallel avg pool matrix differs");
+            assert(serial.col_indices.arr[i].u64_val == parallel.col_indices.arr[i].u64_val, "Parallel avg pool matrix differs");
+            assert(serial.row_indices.arr[i].u64_val == parallel.row_indices.arr[i].u64_val, "Parallel avg pool matrix differs");
+        }
+
+        free_gphrx_csr_matrix(&serial);
+        free_gphrx_csr_matrix(&parallel);
+    }
+
+    u64 quantile_blocks_per_row[] = {1, 3, 40, 3000};
+
+    for (size_t b = 0; b < sizeof(quantile_blocks_per_row) / sizeof(u64); ++b)
+    {
+        DynamicArray8 boundaries = gphrx_find_degree_quantile_boundaries(&graph, quantile_blocks_per_row[b]);
+
+        gphrx_set_num_threads(1);
+        GphrxCsrMatrix serial = gphrx_find_avg_pool_matrix_with_boundaries(&graph, &boundaries);
+
+        gphrx_set_num_threads(4);
+        GphrxCsrMatrix parallel = gphrx_find_avg_pool_matrix_with_boundaries(&graph, &boundaries);
+
+        assert(serial.entries.size == parallel.entries.size, "Parallel avg pool matrix differs");
+
+        for (size_t i = 0; i < serial.entries.size; ++i)
+        {
+            assert(serial.entries.arr[i].dbl_val == parallel.entries.arr[i].dbl_val, "Parallel avg pool matrix differs");
+            assert(serial.col_indices.arr[i].u64_val == parallel.col_indices.arr[i].u64_val, "Parallel avg pool matrix differs");
+            assert(serial.row_indices.arr[i].u64_val == parallel.row_indices.arr[i].u64_val, "Parallel avg pool matrix differs");
+        }
+
+        free_gphrx_csr_matrix(&serial);
+        free_gphrx_csr_matrix(&parallel);
+        free_gphrx_block_boundaries(&boundaries);
+    }
+
+    byte *arr = gphrx_to_byte_array(&graph);
+
+    GphrxErrorCode error;
+    GphrxGraph graph_from_arr = gphrx_from_byte_array(arr, &error);
+
+    assert(error == GPHRX_NO_ERROR, "Error converting from byte array");
+    assert(graph_from_arr.adjacency_matrix.col_indices.size == graph.adjacency_matrix.col_indices.size,
+           "Incorrect edge count after conversion");
+
+    for (size_t i = 0; i < graph.adjacency_matrix.col_indices.size; ++i)
+    {
+        assert(graph_from_arr.adjacency_matrix.col_indices.arr[i].u64_val == graph.adjacency_matrix.col_indices.arr[i].u64_val,
+               "Incorrect column index after conversion");
+        assert(graph_from_arr.adjacency_matrix.row_indices.arr[i].u64_val == graph.adjacency_matrix.row_indices.arr[i].u64_val,
+               "Incorrect row index after conversion");
+    }
+
+    gphrx_set_num_threads(0);
+
+    free_gphrx_byte_array(arr);
+    free_gphrx(&graph_from_arr);
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_find_vertex_edge_offsets()
+{
+    GphrxGraph graph = new_directed_gphrx();
+
+    size_t *offsets = _gphrx_find_vertex_edge_offsets(&graph.adjacency_matrix);
+    assert(offsets[0] == 0, "Incorrect offsets for empty graph");
+    free(offsets);
+
+    // Vertices 0, 2, 5 and 6 have no outgoing edges; vertex 6 is only a destination
+    gphrx_add_edge(&graph, 1, 4);
+    gphrx_add_edge(&graph, 1, 2);
+    gphrx_add_edge(&graph, 3, 3);
+    gphrx_add_edge(&graph, 4, 0);
+    gphrx_add_edge(&graph, 4, 6);
+    gphrx_add_edge(&graph, 4, 1);
+
+    size_t expected_offsets[] = {0, 0, 2, 2, 3, 6, 6, 6};
+
+    offsets = _gphrx_find_vertex_edge_offsets(&graph.adjacency_matrix);
+
+    assert(graph.adjacency_matrix.dimension == 7, "Incorrect dimension");
+
+    for (u64 v = 0; v <= graph.adjacency_matrix.dimension; ++v)
+        assert(offsets[v] == expected_offsets[v], "Incorrect vertex edge offset");
+
+    free(offsets);
+
+    // Large enough to be found in parallel
+    GphrxGraph large_graph = new_directed_gphrx();
+
+    for (u64 from = 0; from < 20000; from += 3)
+    {
+        for (u64 to = 0; to < from % 50; ++to)
+            gphrx_add_edge(&large_graph, from, to);
+    }
+
+    gphrx_set_num_threads(4);
+    offsets = _gphrx_find_vertex_edge_offsets(&large_graph.adjacency_matrix);
+    gphrx_set_num_threads(0);
+
+    size_t expected_offset = 0;
+    for (u64 v = 0; v < large_graph.adjacency_matrix.dimension; ++v)
+    {
+        assert(offsets[v] == expected_offset, "Incorrect vertex edge offset");
+        expected_offset += (v % 3 == 0) ? v % 50 : 0;
+    }
+
+    assert(offsets[large_graph.adjacency_matrix.dimension] == large_graph.adjacency_matrix.col_indices.size,
+           "Incorrect final vertex edge offset");
+
+    free(offsets);
+    free_gphrx(&large_graph);
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_avg_pool_sampler()
+{
+    u64 to_edges_1[] = {0, 2, 4, 7, 3};
+    u64 to_edges_5[] = {6, 8, 0, 1, 5, 4, 2};
+    
+    GphrxGraph undirected_graph = new_undirected_gphrx();
+
+    gphrx_add_edge(&undirected_graph, 7, 8);
+    gphrx_add_vertex(&undirected_graph, 1, to_edges_1, 5);
+    gphrx_add_vertex(&undirected_graph, 5, to_edges_5, 7);
+
+    u64 edge_count = undirected_graph.adjacency_matrix.col_indices.size;
+
+    GphrxCsrMatrix exact_matrix = gphrx_find_avg_pool_matrix(&undirected_graph, 3);
+    GphrxAvgPoolSampler sampler = new_gphrx_avg_pool_sampler(&undirected_graph, 3, 42);
+
+    assert(sampler.dimension == exact_matrix.dimension, "Incorrect sampler dimension");
+    assert(sampler.sampled_count == 0, "Incorrect sampled count");
+
+    u64 sampled = gphrx_avg_pool_sampler_refine(&sampler, &undirected_graph, 8);
+    assert(sampled == 8, "Incorrect sampled count");
+    assert(sampler.sampled_count == 8, "Incorrect sampled count");
+
+    GphrxCsrMatrix margins;
+    GphrxCsrMatrix estimate = gphrx_avg_pool_sampler_estimate(&sampler, 1.96, &margins);
+
+    assert(margins.entries.size == estimate.entries.size, "Incorrect margin matrix");
+    assert(margins.dimension == estimate.dimension, "Incorrect margin matrix");
+
+    // Scaled counts must add back up to the number of edges in the graph
+    double total = 0.0;
+    for (size_t i = 0; i < estimate.entries.size; ++i)
+    {
+        total += dynarr8_get(&estimate.entries, i).dbl_val * 9.0;
+
+        assert(dynarr8_get(&margins.col_indices, i).u64_val == dynarr8_get(&estimate.col_indices, i).u64_val,
+               "Incorrect margin matrix");
+        assert(dynarr8_get(&margins.row_indices, i).u64_val == dynarr8_get(&estimate.row_indices, i).u64_val,
+               "Incorrect margin matrix");
+        assert(dynarr8_get(&margins.entries, i).dbl_val >= 0.0, "Incorrect margin");
+    }
+
+    assert((u64) (total + 0.5) == edge_count, "Incorrect scaling of sampled counts");
+
+    free_gphrx_csr_matrix(&estimate);
+    free_gphrx_csr_matrix(&margins);
+
+    // Asking for more samples than remain only samples the remaining edges
+    sampled = gphrx_avg_pool_sampler_refine(&sampler, &undirected_graph, edge_count);
+    assert(sampled == edge_count - 8, "Incorrect sampled count");
+    assert(gphrx_avg_pool_sampler_refine(&sampler, &undirected_graph, 1) == 0, "Sample was not exhausted");
+
+    estimate = gphrx_avg_pool_sampler_estimate(&sampler, 1.96, &margins);
+
+    assert(estimate.entries.size == exact_matrix.entries.size, "Sampled estimate did not converge");
+    
+    for (size_t i = 0; i < estimate.entries.size; ++i)
+    {
+        assert(dynarr8_get(&estimate.col_indices, i).u64_val == dynarr8_get(&exact_matrix.col_indices, i).u64_val,
+               "Sampled estimate did not converge");
+        assert(dynarr8_get(&estimate.row_indices, i).u64_val == dynarr8_get(&exact_matrix.row_indices, i).u64_val,
+               "Sampled estimate did not converge");
+        assert(dynarr8_get(&estimate.entries, i).dbl_val == dynarr8_get(&exact_matrix.entries, i).dbl_val,
+               "Sampled estimate did not converge");
+        assert(dynarr8_get(&margins.entries, i).dbl_val == 0.0, "Margin of exhausted sample should be zero");
+    }
+
+    free_gphrx_csr_matrix(&estimate);
+    free_gphrx_csr_matrix(&margins);
+    free_gphrx_avg_pool_sampler(&sampler);
+    free_gphrx_csr_matrix(&exact_matrix);
+    free_gphrx(&undirected_graph);
+
+    return TEST_PASS;
+}
+
 static TEST_RESULT test_approximate_gphrx()
 {
     u64 to_edges_1[] = {0, 2, 4, 7, 3};
@@ -1517,6 +3553,68 @@ static TEST_RESULT test_approximate_gphrx()
     return TEST_PASS;
 }
 
+static TEST_RESULT test_gphrx_degree_quantile_approximation()
+{
+    u64 hub_edges[] = {1, 2, 3, 4, 5, 6};
+
+    GphrxGraph directed_graph = new_directed_gphrx();
+
+    gphrx_add_vertex(&directed_graph, 0, hub_edges, 6);
+    gphrx_add_edge(&directed_graph, 8, 9);
+
+    // Degrees are 6 for the hub, 1 for each of vertices 1-6, 8, and 9, and 0 for vertex 7
+    DynamicArray8 boundaries = gphrx_find_degree_quantile_boundaries(&directed_graph, 4);
+
+    assert(boundaries.size == 5, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 0).u64_val == 0, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 1).u64_val == 1, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 2).u64_val == 2, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 3).u64_val == 5, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 4).u64_val == 10, "Incorrect block boundaries");
+
+    free_gphrx_block_boundaries(&boundaries);
+
+    boundaries = gphrx_find_degree_quantile_boundaries(&directed_graph, 2);
+
+    assert(boundaries.size == 3, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 1).u64_val == 2, "Incorrect block boundaries");
+    assert(dynarr8_get(&boundaries, 2).u64_val == 10, "Incorrect block boundaries");
+
+    GphrxCsrMatrix occurrence_matrix = gphrx_find_avg_pool_matrix_with_boundaries(&directed_graph, &boundaries);
+
+    assert(occurrence_matrix.dimension == 2, "Incorrect occurrence matrix");
+    assert(occurrence_matrix.entries.size == 3, "Incorrect occurrence matrix");
+
+    assert(dynarr8_get(&occurrence_matrix.col_indices, 0).u64_val == 0, "Incorrect occurrence matrix");
+    assert(dynarr8_get(&occurrence_matrix.row_indices, 0).u64_val == 0, "Incorrect occurrence matrix");
+    assert(dynarr8_get(&occurrence_matrix.entries, 0).dbl_val == 0.25, "Incorrect occurrence matrix");
+
+    assert(dynarr8_get(&occurrence_matrix.col_indices, 1).u64_val == 0, "Incorrect occurrence matrix");
+    assert(dynarr8_get(&occurrence_matrix.row_indices, 1).u64_val == 1, "Incorrect occurrence matrix");
+    assert(dynarr8_get(&occurrence_matrix.entries, 1).dbl_val == 0.3125, "Incorrect occurrence matrix");
+
+    assert(dynarr8_get(&occurrence_matrix.col_indices, 2).u64_val == 1, "Incorrect occurrence matrix");
+    assert(dynarr8_get(&occurrence_matrix.row_indices, 2).u64_val == 1, "Incorrect occurrence matrix");
+    assert(dynarr8_get(&occurrence_matrix.entries, 2).dbl_val == 0.015625, "Incorrect occurrence matrix");
+
+    free_gphrx_csr_matrix(&occurrence_matrix);
+
+    GphrxGraph approx_graph = approximate_gphrx_with_boundaries(&directed_graph, &boundaries, 0.25);
+
+    assert(!approx_graph.is_undirected, "Incorrect graph approximation");
+    assert(approx_graph.adjacency_matrix.dimension == 2, "Incorrect graph approximation");
+    assert(approx_graph.adjacency_matrix.col_indices.size == 2, "Incorrect graph approximation");
+    assert(gphrx_does_edge_exist(&approx_graph, 0, 0), "Incorrect graph approximation");
+    assert(gphrx_does_edge_exist(&approx_graph, 0, 1), "Incorrect graph approximation");
+    assert(!gphrx_does_edge_exist(&approx_graph, 1, 1), "Incorrect graph approximation");
+
+    free_gphrx(&approx_graph);
+    free_gphrx_block_boundaries(&boundaries);
+    free_gphrx(&directed_graph);
+
+    return TEST_PASS;
+}
+
 static TEST_RESULT test_gphrx_to_from_byte_array()
 {
     u64 to_edges[] = {3, 2, 100, 20, 9};
@@ -1606,6 +3704,131 @@ static TEST_RESULT test_gphrx_to_from_byte_array()
 }
       
 
+#if defined(SIMD_AVX2)
+static TARGET_AVX2 void check_fast_divisor_divide_u32_x4(u64 divisor_value)
+{
+    FastDivisor divisor = new_fast_divisor(divisor_value);
+
+    if (divisor.is_pow_2 || divisor.magic_32 == 0)
+        return;
+
+    __m256i magic_32 = _mm256_set1_epi64x(divisor.magic_32);
+    __m128i shift = _mm_cvtsi32_si128(divisor.shift);
+
+    for (u64 n = 0; n < 100000; n += 4)
+    {
+        u64 lanes[4] = {n * 42943, n * 7 + 1, 4294967295ULL - n, n};
+        u64 quotients[4];
+
+        _mm256_storeu_si256((__m256i*) quotients,
+                            fast_divisor_divide_u32_x4(_mm256_loadu_si256((__m256i*) lanes), magic_32, shift));
+
+        for (int lane = 0; lane < 4; ++lane)
+            assert(quotients[lane] == (lanes[lane] & 0xFFFFFFFF) / divisor_value ||
+                   lanes[lane] > 0xFFFFFFFF, "Incorrect vectorized quotient");
+    }
+}
+#endif
+
+static TEST_RESULT test_fast_divisor_divide()
+{
+    u64 divisors[] = {1, 2, 3, 5, 7, 8, 10, 12, 100, 641, 1000, 4096, 65537, 1ULL << 32,
+                      (1ULL << 32) + 1, 0x7FFFFFFFFFFFFFFFULL, 0x8000000000000001ULL, 0xFFFFFFFFFFFFFFFFULL};
+    u64 operands[] = {0, 1, 2, 3, 99, 100, 101, 65535, 4294967295ULL, 4294967296ULL, 123456789012345ULL,
+                      0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL};
+
+    for (size_t d = 0; d < sizeof(divisors) / sizeof(u64); ++d)
+    {
+        FastDivisor divisor = new_fast_divisor(divisors[d]);
+
+        for (size_t n = 0; n < sizeof(operands) / sizeof(u64); ++n)
+            assert(fast_divisor_divide(&divisor, operands[n]) == operands[n] / divisors[d], "Incorrect quotient");
+
+        // Sweep the region around multiples of the divisor, where rounding errors would show up
+        for (u64 multiple = 1; multiple < 1000; ++multiple)
+        {
+            u64 product = divisors[d] * multiple;
+
+            if (product / multiple != divisors[d])
+                break;
+
+            assert(fast_divisor_divide(&divisor, product - 1) == (product - 1) / divisors[d], "Incorrect quotient");
+            assert(fast_divisor_divide(&divisor, product) == product / divisors[d], "Incorrect quotient");
+            assert(fast_divisor_divide(&divisor, product + 1) == (product + 1) / divisors[d], "Incorrect quotient");
+        }
+
+        if (divisors[d] < (1ULL << 32))
+        {
+            assert(divisor.is_pow_2 || divisor.magic_32 != 0, "Missing 32-bit multiplier");
+        }
+    }
+
+#if defined(SIMD_AVX2)
+    if (simd_level() >= SIMD_LEVEL_AVX2)
+    {
+        for (size_t d = 0; d < sizeof(divisors) / sizeof(u64); ++d)
+            check_fast_divisor_divide_u32_x4(divisors[d]);
+    }
+#endif
+
+    return TEST_PASS;
+}
+
+// Every SIMD level the CPU supports gives the same results as the scalar code
+static TEST_RESULT test_gphrx_simd_levels()
+{
+    GphrxGraph graph = new_random_test_graph(false, 5000, 60000, 7);
+    GphrxGraph indexed_graph = duplicate_gphrx(&graph);
+    gphrx_shrink(&indexed_graph);
+
+    cap_simd_level(SIMD_LEVEL_NONE);
+
+    // 7 isn't a power of two, so pooling divides by the 32-bit multiplier
+    GphrxCsrMatrix expected_matrix = gphrx_find_avg_pool_matrix(&graph, 7);
+    gphrx_csr_matrix_threshold_and_scale(&expected_matrix, 2.0 / 49.0, 3.0);
+
+    for (SimdLevel level = SIMD_LEVEL_NONE; level <= SIMD_LEVEL_AVX512; ++level)
+    {
+        cap_simd_level(level);
+
+        GphrxCsrMatrix matrix = gphrx_find_avg_pool_matrix(&graph, 7);
+        gphrx_csr_matrix_threshold_and_scale(&matrix, 2.0 / 49.0, 3.0);
+
+        assert(matrix.entries.size == expected_matrix.entries.size, "Incorrect matrix size");
+
+        for (size_t i = 0; i < matrix.entries.size; ++i)
+        {
+            assert(dynarr8_get(&matrix.entries, i).dbl_val == dynarr8_get(&expected_matrix.entries, i).dbl_val,
+                   "Incorrect entry");
+            assert(dynarr8_get(&matrix.col_indices, i).u64_val == dynarr8_get(&expected_matrix.col_indices, i).u64_val,
+                   "Incorrect column");
+            assert(dynarr8_get(&matrix.row_indices, i).u64_val == dynarr8_get(&expected_matrix.row_indices, i).u64_val,
+                   "Incorrect row");
+        }
+
+        free_gphrx_csr_matrix(&matrix);
+
+        for (u64 vertex_id = 0; vertex_id <= 5000; ++vertex_id)
+        {
+            size_t end;
+            size_t start = _gphrx_find_vertex_edge_range(&indexed_graph, vertex_id, &end);
+
+            size_t expected_end;
+            size_t expected_start = _gphrx_find_vertex_edge_range(&graph, vertex_id, &expected_end);
+
+            assert(start == expected_start && end == expected_end, "Incorrect indexed vertex range");
+        }
+    }
+
+    cap_simd_level(SIMD_LEVEL_AVX512);
+
+    free_gphrx_csr_matrix(&expected_matrix);
+    free_gphrx(&indexed_graph);
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
 ModuleTestSet gphrx_h_register_tests()
 {
     ModuleTestSet set = {
@@ -1616,20 +3839,31 @@ ModuleTestSet gphrx_h_register_tests()
 
     register_test(&set, test_new_gphrx);
     register_test(&set, test_duplicate_gphrx);
+    register_test(&set, test_duplicate_gphrx_concurrently);
     register_test(&set, test_free_gphrx);
     register_test(&set, test_free_gphrx_csr_matrix);
     register_test(&set, test_free_gphrx_csr_adj_matrix);
     register_test(&set, test_gphrx_csr_matrix_to_string);
     register_test(&set, test_gphrx_csr_adj_matrix_to_string);
+    register_test(&set, test_gphrx_csr_matrix_threshold_and_scale);
     register_test(&set, test_gphrx_shrink);
     register_test(&set, test_gphrx_does_edge_exist);
+    register_test(&set, test_gphrx_does_edges_exist);
+    register_test(&set, test_gphrx_vertex_index);
     register_test(&set, test_gphrx_add_vertex);
     register_test(&set, test_gphrx_remove_vertex);
     register_test(&set, test_gphrx_add_edge);
+    register_test(&set, test_gphrx_add_edges);
     register_test(&set, test_gphrx_remove_edge);
     register_test(&set, test_gphrx_find_avg_pool_matrix);
+    register_test(&set, test_gphrx_parallel_pooling_and_serialization);
+    register_test(&set, test_gphrx_find_vertex_edge_offsets);
+    register_test(&set, test_gphrx_avg_pool_sampler);
     register_test(&set, test_approximate_gphrx);
+    register_test(&set, test_gphrx_degree_quantile_approximation);
+    register_test(&set, test_fast_divisor_divide);
     register_test(&set, test_gphrx_to_from_byte_array);
+    register_test(&set, test_gphrx_simd_levels);
 
     return set;
 }
@@ -0,0 +1,707 @@
+#include "ingest.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// Ids distinguish buffers (and threads) in the thread-local log cache, since a freed buffer's address may
+// be reused. Zero means none.
+static atomic_ullong next_buffer_id = 1;
+static atomic_ullong next_thread_id = 1;
+
+static _Thread_local u64 thread_id = 0;
+static _Thread_local u64 cached_buffer_id = 0;
+static _Thread_local GphrxIngestLog *cached_log = 0;
+
+static GphrxIngestSegment *new_segment(u64 first_index)
+{
+    GphrxIngestSegment *segment = malloc(sizeof(GphrxIngestSegment));
+    assert(segment != 0, "malloc failure");
+
+    segment->first_index = first_index;
+    atomic_init(&segment->next, 0);
+    segment->retired_epoch = 0;
+    segment->next_retired = 0;
+
+    return segment;
+}
+
+static void *run_merger(void *arg);
+
+DLLEXPORT GphrxIngestBuffer *new_gphrx_ingest_buffer(GphrxVersionedGraph *restrict versioned_graph,
+                                                    u32 merge_interval_ms)
+{
+    GphrxIngestBuffer *buffer = malloc(sizeof(GphrxIngestBuffer));
+    assert(buffer != 0, "malloc failure");
+
+    buffer->versioned_graph = versioned_graph;
+    buffer->id = atomic_fetch_add(&next_buffer_id, 1);
+    atomic_init(&buffer->logs, 0);
+
+    pthread_mutex_init(&buffer->merge_lock, 0);
+    buffer->retired = 0;
+
+    buffer->has_merger_thread = merge_interval_ms != 0;
+    buffer->merge_interval_ms = merge_interval_ms;
+    pthread_mutex_init(&buffer->merger_lock, 0);
+    pthread_cond_init(&buffer->merger_cond, 0);
+    buffer->should_merger_stop = false;
+
+    // Without a merger thread, edges still reach the graph through explicit flushes
+    if (buffer->has_merger_thread && pthread_create(&buffer->merger_thread, 0, run_merger, buffer) != 0)
+        buffer->has_merger_thread = false;
+
+    return buffer;
+}
+
+DLLEXPORT void free_gphrx_ingest_buffer(GphrxIngestBuffer *restrict buffer)
+{
+    if (buffer->has_merger_thread)
+    {
+        pthread_mutex_lock(&buffer->merger_lock);
+        buffer->should_merger_stop = true;
+        pthread_cond_signal(&buffer->merger_cond);
+        pthread_mutex_unlock(&buffer->merger_lock);
+
+        pthread_join(buffer->merger_thread, 0);
+    }
+
+    gphrx_ingest_flush(buffer);
+
+    GphrxIngestLog *log = atomic_load(&buffer->logs);
+    while (log)
+    {
+        GphrxIngestLog *next_log = log->next;
+
+        GphrxIngestSegment *segment = atomic_load(&log->head);
+        while (segment)
+        {
+            GphrxIngestSegment *next_segment = atomic_load(&segment->next);
+            free(segment);
+            segment = next_segment;
+        }
+
+        free(log);
+        log = next_log;
+    }
+
+    GphrxIngestSegment *segment = buffer->retired;
+    while (segment)
+    {
+        GphrxIngestSegment *next_segment = segment->next_retired;
+        free(segment);
+        segment = next_segment;
+    }
+
+    pthread_cond_destroy(&buffer->merger_cond);
+    pthread_mutex_destroy(&buffer->merger_lock);
+    pthread_mutex_destroy(&buffer->merge_lock);
+
+    free(buffer);
+}
+
+static GphrxIngestLog *log_for_current_thread(GphrxIngestBuffer *restrict buffer)
+{
+    if (cached_buffer_id == buffer->id)
+        return cached_log;
+
+    if (thread_id == 0)
+        thread_id = atomic_fetch_add(&next_thread_id, 1);
+
+    // A thread that alternates between buffers finds its log again rather than starting another one
+    GphrxIngestLog *log = atomic_load(&buffer->logs);
+    while (log && log->owner_id != thread_id)
+        log = log->next;
+
+    if (!log)
+    {
+        log = aligned_alloc(_Alignof(GphrxIngestLog), sizeof(GphrxIngestLog));
+        assert(log != 0, "aligned_alloc failure");
+
+        GphrxIngestSegment *segment = new_segment(0);
+
+        atomic_init(&log->published_count, 0);
+        log->tail = segment;
+        log->owner_id = thread_id;
+
+        atomic_init(&log->consumed_count, 0);
+        atomic_init(&log->head, segment);
+        log->merge_target = 0;
+
+        log->next = atomic_load(&buffer->logs);
+        while (!atomic_compare_exchange_weak(&buffer->logs, &log->next, log));
+    }
+
+    cached_buffer_id = buffer->id;
+    cached_log = log;
+
+    return log;
+}
+
+static void append_to_log(GphrxIngestLog *restrict log, u64 *from_vertex_ids, u64 *to_vertex_ids, size_t count)
+{
+    // Only this thread writes the count, so it can't have changed since it was last stored
+    u64 published_count = atomic_load_explicit(&log->published_count, memory_order_relaxed);
+
+    while (count > 0)
+    {
+        u64 position = published_count - log->tail->first_index;
+
+        // The merger only unlinks segments that have a successor, so the producer's tail is never freed
+        // from under it. The new segment is linked before any of its entries are published, so anyone who
+        // sees an entry can reach it.
+        if (position == GPHRX_INGEST_SEGMENT_CAPACITY)
+        {
+            GphrxIngestSegment *segment = new_segment(published_count);
+            atomic_store_explicit(&log->tail->next, segment, memory_order_release);
+            log->tail = segment;
+
+            position = 0;
+        }
+
+        size_t batch_size = GPHRX_INGEST_SEGMENT_CAPACITY - position;
+        if (batch_size > count)
+            batch_size = count;
+
+        memcpy(log->tail->from_vertex_ids + position, from_vertex_ids, batch_size * sizeof(u64));
+        memcpy(log->tail->to_vertex_ids + position, to_vertex_ids, batch_size * sizeof(u64));
+
+        published_count += batch_size;
+        from_vertex_ids += batch_size;
+        to_vertex_ids += batch_size;
+        count -= batch_size;
+
+        atomic_store_explicit(&log->published_count, published_count, memory_order_release);
+    }
+}
+
+DLLEXPORT void gphrx_ingest_add_edge(GphrxIngestBuffer *restrict buffer, u64 from_vertex_id, u64 to_vertex_id)
+{
+    append_to_log(log_for_current_thread(buffer), &from_vertex_id, &to_vertex_id, 1);
+}
+
+DLLEXPORT void gphrx_ingest_add_edges(GphrxIngestBuffer *restrict buffer,
+                                      u64 *from_vertex_ids,
+                                      u64 *to_vertex_ids,
+                                      size_t count)
+{
+    if (count == 0)
+        return;
+
+    append_to_log(log_for_current_thread(buffer), from_vertex_ids, to_vertex_ids, count);
+}
+
+// Must be called with the merge lock held
+static void reclaim_segments_locked(GphrxIngestBuffer *restrict buffer)
+{
+    u64 oldest_pinned_epoch = _vgphrx_oldest_pinned_epoch(buffer->versioned_graph);
+
+    // A query that announced itself in or before the epoch in which a segment was unlinked may still be
+    // reading it
+    GphrxIngestSegment **link = &buffer->retired;
+    while (*link)
+    {
+        GphrxIngestSegment *segment = *link;
+
+        if (segment->retired_epoch < oldest_pinned_epoch)
+        {
+            *link = segment->next_retired;
+            free(segment);
+        }
+        else
+        {
+            link = &segment->next_retired;
+        }
+    }
+}
+
+DLLEXPORT u64 gphrx_ingest_flush(GphrxIngestBuffer *restrict buffer)
+{
+    pthread_mutex_lock(&buffer->merge_lock);
+
+    // Logs pushed after this load hold only edges added after the flush started, which the next flush merges
+    GphrxIngestLog *first_log = atomic_load(&buffer->logs);
+
+    size_t pending_count = 0;
+    for (GphrxIngestLog *log = first_log; log; log = log->next)
+    {
+        log->merge_target = atomic_load_explicit(&log->published_count, memory_order_acquire);
+        pending_count += log->merge_target - atomic_load_explicit(&log->consumed_count, memory_order_relaxed);
+    }
+
+    if (pending_count == 0)
+    {
+        reclaim_segments_locked(buffer);
+        pthread_mutex_unlock(&buffer->merge_lock);
+
+        return vgphrx_current_version(buffer->versioned_graph);
+    }
+
+    u64 *from_vertex_ids = malloc(sizeof(u64) * pending_count);
+    u64 *to_vertex_ids = malloc(sizeof(u64) * pending_count);
+
+    assert(from_vertex_ids != 0, "malloc failure");
+    assert(to_vertex_ids != 0, "malloc failure");
+
+    size_t gathered_count = 0;
+    for (GphrxIngestLog *log = first_log; log; log = log->next)
+    {
+        u64 index = atomic_load_explicit(&log->consumed_count, memory_order_relaxed);
+        GphrxIngestSegment *segment = atomic_load_explicit(&log->head, memory_order_relaxed);
+
+        while (index < log->merge_target)
+        {
+            while (index >= segment->first_index + GPHRX_INGEST_SEGMENT_CAPACITY)
+                segment = atomic_load_explicit(&segment->next, memory_order_acquire);
+
+            u64 end = segment->first_index + GPHRX_INGEST_SEGMENT_CAPACITY;
+            if (end > log->merge_target)
+                end = log->merge_target;
+
+            memcpy(from_vertex_ids + gathered_count,
+                   segment->from_vertex_ids + (index - segment->first_index),
+                   (end - index) * sizeof(u64));
+            memcpy(to_vertex_ids + gathered_count,
+                   segment->to_vertex_ids + (index - segment->first_index),
+                   (end - index) * sizeof(u64));
+
+            gathered_count += end - index;
+            index = end;
+        }
+    }
+
+    GphrxGraph *working_graph = vgphrx_begin_write(buffer->versioned_graph);
+    gphrx_add_edges(working_graph, from_vertex_ids, to_vertex_ids, pending_count);
+    u64 version = vgphrx_end_write(buffer->versioned_graph, true);
+
+    free(from_vertex_ids);
+    free(to_vertex_ids);
+
+    // The edges are marked consumed only once the snapshot holding them is current, so a query that sees
+    // them consumed also sees them in the snapshot it loads afterwards
+    for (GphrxIngestLog *log = first_log; log; log = log->next)
+        atomic_store(&log->consumed_count, log->merge_target);
+
+    GphrxIngestSegment *unlinked = 0;
+    for (GphrxIngestLog *log = first_log; log; log = log->next)
+    {
+        GphrxIngestSegment *segment = atomic_load_explicit(&log->head, memory_order_relaxed);
+        GphrxIngestSegment *next = atomic_load_explicit(&segment->next, memory_order_acquire);
+
+        while (next && log->merge_target >= segment->first_index + GPHRX_INGEST_SEGMENT_CAPACITY)
+        {
+            atomic_store(&log->head, next);
+
+            segment->next_retired = unlinked;
+            unlinked = segment;
+
+            segment = next;
+            next = atomic_load_explicit(&segment->next, memory_order_acquire);
+        }
+    }
+
+    if (unlinked)
+    {
+        u64 retired_epoch = atomic_fetch_add(&buffer->versioned_graph->epoch, 1);
+
+        GphrxIngestSegment *last = unlinked;
+        for (;; last = last->next_retired)
+        {
+            last->retired_epoch = retired_epoch;
+
+            if (!last->next_retired)
+                break;
+        }
+
+        last->next_retired = buffer->retired;
+        buffer->retired = unlinked;
+    }
+
+    reclaim_segments_locked(buffer);
+
+    pthread_mutex_unlock(&buffer->merge_lock);
+
+    return version;
+}
+
+DLLEXPORT u64 gphrx_ingest_pending_count(GphrxIngestBuffer *restrict buffer)
+{
+    u64 pending_count = 0;
+
+    for (GphrxIngestLog *log = atomic_load(&buffer->logs); log; log = log->next)
+    {
+        u64 consumed_count = atomic_load(&log->consumed_count);
+        u64 published_count = atomic_load(&log->published_count);
+
+        if (published_count > consumed_count)
+            pending_count += published_count - consumed_count;
+    }
+
+    return pending_count;
+}
+
+static bool is_edge_pending_in_log(GphrxIngestLog *restrict log,
+                                   u64 from_vertex_id,
+                                   u64 to_vertex_id,
+                                   bool is_undirected)
+{
+    // Entries below the consumed count are in the current snapshot, and the head never moves past it, so
+    // everything from the later of the two up to the published count is pending
+    u64 consumed_count = atomic_load(&log->consumed_count);
+    GphrxIngestSegment *segment = atomic_load(&log->head);
+    u64 published_count = atomic_load_explicit(&log->published_count, memory_order_acquire);
+
+    u64 index = consumed_count > segment->first_index ? consumed_count : segment->first_index;
+
+    while (index < published_count)
+    {
+        while (index >= segment->first_index + GPHRX_INGEST_SEGMENT_CAPACITY)
+            segment = atomic_load_explicit(&segment->next, memory_order_acquire);
+
+        u64 end = segment->first_index + GPHRX_INGEST_SEGMENT_CAPACITY;
+        if (end > published_count)
+            end = published_count;
+
+        for (u64 i = index - segment->first_index; i < end - segment->first_index; ++i)
+        {
+            u64 from = segment->from_vertex_ids[i];
+            u64 to = segment->to_vertex_ids[i];
+
+            if ((from == from_vertex_id && to == to_vertex_id) ||
+                (is_undirected && from == to_vertex_id && to == from_vertex_id))
+            {
+                return true;
+            }
+        }
+
+        index = end;
+    }
+
+    return false;
+}
+
+DLLEXPORT bool gphrx_ingest_does_edge_exist(GphrxIngestBuffer *restrict buffer,
+                                            u64 from_vertex_id,
+                                            u64 to_vertex_id)
+{
+    GphrxVersionedGraph *versioned_graph = buffer->versioned_graph;
+
+    // Keeps both the segments being scanned and the snapshot loaded afterwards from being freed
+    u32 slot = _vgphrx_announce_reader(versioned_graph);
+
+    // The snapshot must be loaded after the logs are scanned: an edge merged in between is then either seen
+    // pending or found in the newer snapshot
+    bool is_undirected = atomic_load(&versioned_graph->current)->graph.is_undirected;
+    bool does_edge_exist = false;
+
+    for (GphrxIngestLog *log = atomic_load(&buffer->logs); log && !does_edge_exist; log = log->next)
+        does_edge_exist = is_edge_pending_in_log(log, from_vertex_id, to_vertex_id, is_undirected);
+
+    GphrxSnapshot *snapshot = atomic_load(&versioned_graph->current);
+
+    if (!does_edge_exist)
+        does_edge_exist = gphrx_does_edge_exist(&snapshot->graph, from_vertex_id, to_vertex_id);
+
+    GphrxSnapshotGuard guard = {
+        .graph = &snapshot->graph,
+        .version = snapshot->version,
+        .slot = slot,
+    };
+
+    vgphrx_unpin(versioned_graph, &guard);
+
+    return does_edge_exist;
+}
+
+static void *run_merger(void *arg)
+{
+    GphrxIngestBuffer *buffer = arg;
+
+    pthread_mutex_lock(&buffer->merger_lock);
+
+    while (!buffer->should_merger_stop)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        u64 nanoseconds = deadline.tv_nsec + (u64) (buffer->merge_interval_ms % 1000) * 1000000;
+        deadline.tv_sec += buffer->merge_interval_ms / 1000 + nanoseconds / 1000000000;
+        deadline.tv_nsec = nanoseconds % 1000000000;
+
+        int error = 0;
+        while (!buffer->should_merger_stop && error != ETIMEDOUT)
+            error = pthread_cond_timedwait(&buffer->merger_cond, &buffer->merger_lock, &deadline);
+
+        if (buffer->should_merger_stop)
+            break;
+
+        pthread_mutex_unlock(&buffer->merger_lock);
+        gphrx_ingest_flush(buffer);
+        pthread_mutex_lock(&buffer->merger_lock);
+    }
+
+    pthread_mutex_unlock(&buffer->merger_lock);
+
+    return 0;
+}
+
+
+#ifdef TEST_MODE
+
+static TEST_RESULT test_gphrx_ingest_buffer()
+{
+    GphrxGraph graph = new_directed_gphrx();
+    gphrx_add_edge(&graph, 1, 2);
+
+    GphrxVersionedGraph *versioned_graph = new_vgphrx(&graph);
+    GphrxIngestBuffer *buffer = new_gphrx_ingest_buffer(versioned_graph, 0);
+
+    assert(gphrx_ingest_pending_count(buffer) == 0, "Incorrect pending count");
+    assert(gphrx_ingest_flush(buffer) == 0, "Empty flush published a version");
+
+    gphrx_ingest_add_edge(buffer, 3, 4);
+
+    // Spans several segments
+    u64 edge_count = GPHRX_INGEST_SEGMENT_CAPACITY * 2 + 100;
+    u64 *from_vertex_ids = malloc(sizeof(u64) * edge_count);
+    u64 *to_vertex_ids = malloc(sizeof(u64) * edge_count);
+
+    for (u64 i = 0; i < edge_count; ++i)
+    {
+        from_vertex_ids[i] = 100 + i;
+        to_vertex_ids[i] = 101 + i;
+    }
+
+    gphrx_ingest_add_edges(buffer, from_vertex_ids, to_vertex_ids, edge_count);
+
+    assert(gphrx_ingest_pending_count(buffer) == edge_count + 1, "Incorrect pending count");
+    assert(gphrx_ingest_does_edge_exist(buffer, 1, 2), "Merged edge not found");
+    assert(gphrx_ingest_does_edge_exist(buffer, 3, 4), "Pending edge not found");
+    assert(!gphrx_ingest_does_edge_exist(buffer, 4, 3), "Reverse of directed edge found");
+    assert(gphrx_ingest_does_edge_exist(buffer, 100 + GPHRX_INGEST_SEGMENT_CAPACITY + 7,
+                                        101 + GPHRX_INGEST_SEGMENT_CAPACITY + 7),
+           "Pending edge not found");
+
+    GphrxSnapshotGuard guard = vgphrx_pin(versioned_graph);
+    assert(!gphrx_does_edge_exist(guard.graph, 3, 4), "Pending edge merged early");
+
+    // The pinned reader keeps the merged segments from being freed
+    assert(gphrx_ingest_flush(buffer) == 1, "Incorrect published version");
+    assert(gphrx_ingest_pending_count(buffer) == 0, "Incorrect pending count");
+    assert(buffer->retired != 0, "Segments freed while a reader was pinned");
+
+    GphrxIngestLog *log = atomic_load(&buffer->logs);
+    assert(log->next == 0, "Single producer has several logs");
+    assert(atomic_load(&log->head) == log->tail, "Merged segments not unlinked");
+
+    vgphrx_unpin(versioned_graph, &guard);
+
+    assert(gphrx_ingest_flush(buffer) == 1, "Empty flush published a version");
+    assert(buffer->retired == 0, "Segments not freed after reader unpinned");
+
+    guard = vgphrx_pin(versioned_graph);
+    assert(guard.graph->adjacency_matrix.col_indices.size == edge_count + 2, "Incorrect merged edge count");
+    assert(gphrx_does_edge_exist(guard.graph, 3, 4), "Edge missing after merge");
+
+    for (u64 i = 0; i < edge_count; i += 97)
+    {
+        assert(gphrx_does_edge_exist(guard.graph, from_vertex_ids[i], to_vertex_ids[i]),
+               "Edge missing after merge");
+    }
+
+    vgphrx_unpin(versioned_graph, &guard);
+
+    // Edges already in the graph are not added again
+    gphrx_ingest_add_edge(buffer, 1, 2);
+    gphrx_ingest_add_edge(buffer, 3, 4);
+    gphrx_ingest_add_edge(buffer, 3, 4);
+    gphrx_ingest_flush(buffer);
+
+    guard = vgphrx_pin(versioned_graph);
+    assert(guard.graph->adjacency_matrix.col_indices.size == edge_count + 2, "Duplicate edges merged");
+    vgphrx_unpin(versioned_graph, &guard);
+
+    free_gphrx_ingest_buffer(buffer);
+    free_vgphrx(versioned_graph);
+
+    // Undirected edges are found in either direction whether or not they have been merged
+    graph = new_undirected_gphrx();
+    versioned_graph = new_vgphrx(&graph);
+    buffer = new_gphrx_ingest_buffer(versioned_graph, 0);
+
+    gphrx_ingest_add_edge(buffer, 5, 6);
+    assert(gphrx_ingest_does_edge_exist(buffer, 5, 6), "Pending edge not found");
+    assert(gphrx_ingest_does_edge_exist(buffer, 6, 5), "Reverse of pending undirected edge not found");
+
+    // Freeing the buffer merges what is left
+    free_gphrx_ingest_buffer(buffer);
+
+    guard = vgphrx_pin(versioned_graph);
+    assert(gphrx_does_edge_exist(guard.graph, 5, 6), "Edge not merged when buffer freed");
+    assert(gphrx_does_edge_exist(guard.graph, 6, 5), "Edge not merged when buffer freed");
+    vgphrx_unpin(versioned_graph, &guard);
+
+    free_vgphrx(versioned_graph);
+
+    free(from_vertex_ids);
+    free(to_vertex_ids);
+
+    return TEST_PASS;
+}
+
+#define CONCURRENT_TEST_PRODUCERS 4
+#define CONCURRENT_TEST_EDGES_PER_PRODUCER 50000
+#define CONCURRENT_TEST_BATCH_SIZE 1000
+
+typedef struct {
+    GphrxIngestBuffer *buffer;
+    _Atomic u64 progress[CONCURRENT_TEST_PRODUCERS];
+    atomic_uint producers_done;
+    atomic_uint failures;
+    atomic_uint queries_checked;
+} ConcurrentTestContext;
+
+typedef struct {
+    ConcurrentTestContext *context;
+    u32 producer_idx;
+} ConcurrentTestProducer;
+
+static void *concurrent_test_producer(void *arg)
+{
+    ConcurrentTestProducer *producer = arg;
+    ConcurrentTestContext *context = producer->context;
+    u64 from_vertex_id = producer->producer_idx;
+
+    // Half of the producers add edges one at a time and half in batches
+    if (producer->producer_idx % 2 == 0)
+    {
+        for (u64 i = 0; i < CONCURRENT_TEST_EDGES_PER_PRODUCER; ++i)
+        {
+            gphrx_ingest_add_edge(context->buffer, from_vertex_id, i);
+            atomic_store(context->progress + producer->producer_idx, i + 1);
+        }
+    }
+    else
+    {
+        u64 from_vertex_ids[CONCURRENT_TEST_BATCH_SIZE];
+        u64 to_vertex_ids[CONCURRENT_TEST_BATCH_SIZE];
+
+        for (u64 i = 0; i < CONCURRENT_TEST_EDGES_PER_PRODUCER; i += CONCURRENT_TEST_BATCH_SIZE)
+        {
+            for (u64 j = 0; j < CONCURRENT_TEST_BATCH_SIZE; ++j)
+            {
+                from_vertex_ids[j] = from_vertex_id;
+                to_vertex_ids[j] = i + j;
+            }
+
+            gphrx_ingest_add_edges(context->buffer, from_vertex_ids, to_vertex_ids, CONCURRENT_TEST_BATCH_SIZE);
+            atomic_store(context->progress + producer->producer_idx, i + CONCURRENT_TEST_BATCH_SIZE);
+        }
+    }
+
+    atomic_fetch_add(&context->producers_done, 1);
+
+    return 0;
+}
+
+static void *concurrent_test_query(void *arg)
+{
+    ConcurrentTestContext *context = arg;
+
+    while (atomic_load(&context->producers_done) < CONCURRENT_TEST_PRODUCERS)
+    {
+        for (u32 i = 0; i < CONCURRENT_TEST_PRODUCERS; ++i)
+        {
+            u64 progress = atomic_load(context->progress + i);
+
+            // Every edge a producer has finished adding must be visible, merged or not
+            if (progress > 0 && !gphrx_ingest_does_edge_exist(context->buffer, i, progress - 1))
+                atomic_fetch_add(&context->failures, 1);
+
+            if (gphrx_ingest_does_edge_exist(context->buffer, i, CONCURRENT_TEST_EDGES_PER_PRODUCER))
+                atomic_fetch_add(&context->failures, 1);
+
+            atomic_fetch_add(&context->queries_checked, 1);
+        }
+    }
+
+    return 0;
+}
+
+static TEST_RESULT test_gphrx_ingest_concurrent_producers()
+{
+    GphrxGraph graph = new_directed_gphrx();
+    GphrxVersionedGraph *versioned_graph = new_vgphrx(&graph);
+
+    ConcurrentTestContext context = {
+        .buffer = new_gphrx_ingest_buffer(versioned_graph, 1),
+    };
+
+    for (u32 i = 0; i < CONCURRENT_TEST_PRODUCERS; ++i)
+        atomic_init(context.progress + i, 0);
+
+    atomic_init(&context.producers_done, 0);
+    atomic_init(&context.failures, 0);
+    atomic_init(&context.queries_checked, 0);
+
+    pthread_t query_thread;
+    pthread_create(&query_thread, 0, concurrent_test_query, &context);
+
+    pthread_t producer_threads[CONCURRENT_TEST_PRODUCERS];
+    ConcurrentTestProducer producers[CONCURRENT_TEST_PRODUCERS];
+
+    for (u32 i = 0; i < CONCURRENT_TEST_PRODUCERS; ++i)
+    {
+        producers[i].context = &context;
+        producers[i].producer_idx = i;
+
+        pthread_create(producer_threads + i, 0, concurrent_test_producer, producers + i);
+    }
+
+    for (u32 i = 0; i < CONCURRENT_TEST_PRODUCERS; ++i)
+        pthread_join(producer_threads[i], 0);
+
+    pthread_join(query_thread, 0);
+
+    assert(atomic_load(&context.failures) == 0, "Query missed an added edge or found a missing one");
+    assert(atomic_load(&context.queries_checked) > 0, "No queries checked");
+
+    gphrx_ingest_flush(context.buffer);
+    assert(gphrx_ingest_pending_count(context.buffer) == 0, "Edges pending after flush");
+
+    free_gphrx_ingest_buffer(context.buffer);
+
+    GphrxSnapshotGuard guard = vgphrx_pin(versioned_graph);
+
+    assert(guard.graph->adjacency_matrix.col_indices.size ==
+           CONCURRENT_TEST_PRODUCERS * CONCURRENT_TEST_EDGES_PER_PRODUCER,
+           "Incorrect merged edge count");
+
+    for (u64 i = 0; i < CONCURRENT_TEST_PRODUCERS; ++i)
+    {
+        for (u64 j = 0; j < CONCURRENT_TEST_EDGES_PER_PRODUCER; j += 101)
+            assert(gphrx_does_edge_exist(guard.graph, i, j), "Edge missing after merge");
+    }
+
+    vgphrx_unpin(versioned_graph, &guard);
+    free_vgphrx(versioned_graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet ingest_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_ingest_buffer);
+    register_test(&set, test_gphrx_ingest_concurrent_producers);
+
+    return set;
+}
+
+#endif
@@ -1,11 +1,89 @@
 #include "intrinsics.h"
 
+#include <stdatomic.h>
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define SIMD_LEVEL_UNKNOWN 0xFF
+
+static _Atomic SimdLevel detected_simd_level = SIMD_LEVEL_UNKNOWN;
+
+#ifdef TEST_MODE
+static _Atomic SimdLevel simd_level_cap = SIMD_LEVEL_AVX512;
+#endif
+
+static SimdLevel detect_simd_level()
+{
+#if defined(SIMD_RUNTIME_DISPATCH)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD_LEVEL_AVX512;
+
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_LEVEL_AVX2;
+
+    return SIMD_LEVEL_NONE;
+#elif defined(SIMD_AVX512)
+    return SIMD_LEVEL_AVX512;
+#elif defined(SIMD_AVX2)
+    return SIMD_LEVEL_AVX2;
+#else
+    return SIMD_LEVEL_NONE;
+#endif
+}
+
+SimdLevel simd_level()
+{
+    // Threads that race to detect the level all find the same one
+    SimdLevel level = atomic_load_explicit(&detected_simd_level, memory_order_relaxed);
+
+    if (level == SIMD_LEVEL_UNKNOWN)
+    {
+        level = detect_simd_level();
+        atomic_store_explicit(&detected_simd_level, level, memory_order_relaxed);
+    }
+
+#ifdef TEST_MODE
+    SimdLevel cap = atomic_load_explicit(&simd_level_cap, memory_order_relaxed);
+
+    if (level > cap)
+        level = cap;
+#endif
+
+    return level;
+}
+
+#ifdef TEST_MODE
+void cap_simd_level(SimdLevel level)
+{
+    atomic_store_explicit(&simd_level_cap, level, memory_order_relaxed);
+}
+#endif
+
 u8 is_system_big_endian()
 {
     static const i32 __one = 1;
     return ((*(byte*)&__one) == 0);
 }
 
+size_t system_page_size()
+{
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwPageSize;
+#else
+    long page_size = sysconf(_SC_PAGESIZE);
+    return page_size > 0 ? (size_t) page_size : 4096;
+#endif
+}
+
 u16 u16_reverse_bits(u16 value)
 {
     return (value << 8) | (value >> 8);
@@ -23,3 +101,47 @@ u64 u64_reverse_bits(u64 value)
     value = ((value << 16) & 0xFFFF0000FFFF0000ULL) | ((value >> 16) & 0x0000FFFF0000FFFFULL);
     return (value << 32) | (value >> 32);
 }
+
+u8 u64_log2_floor(u64 value)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, value);
+    return (u8) idx;
+#else
+    return (u8) (63 - __builtin_clzll(value));
+#endif
+}
+
+FastDivisor new_fast_divisor(u64 divisor)
+{
+    FastDivisor fast_divisor = {
+        .magic = 0,
+        .magic_32 = 0,
+        .shift = u64_log2_floor(divisor),
+        .is_pow_2 = true,
+    };
+
+    if (fast_mod_pow_2(divisor, divisor) == 0)
+        return fast_divisor;
+
+    // With l = ceil(log2(divisor)), magic = floor(2^64 * (2^l - divisor) / divisor) + 1 and the quotient is
+    // (t + ((n - t) >> 1)) >> (l - 1) where t is the high 64 bits of magic * n
+    u8 ceil_log2 = fast_divisor.shift + 1;
+    u64 numerator_high = (ceil_log2 == 64 ? 0 : (1ULL << ceil_log2)) - divisor;
+
+#ifdef _MSC_VER
+    u64 remainder;
+    fast_divisor.magic = _udiv128(numerator_high, 0, divisor, &remainder) + 1;
+#else
+    fast_divisor.magic = (u64) ((((unsigned __int128) numerator_high) << 64) / divisor) + 1;
+#endif
+
+    if (ceil_log2 <= 32)
+        fast_divisor.magic_32 = (u32) ((((u64) numerator_high) << 32) / divisor + 1);
+
+    fast_divisor.shift = ceil_log2 - 1;
+    fast_divisor.is_pow_2 = false;
+
+    return fast_divisor;
+}
@@ -0,0 +1,556 @@
+#include "pagerank.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "components.h"
+#include "spmv.h"
+#include "threadpool.h"
+
+#define PAGERANK_GRAIN_SIZE 65536
+
+DLLEXPORT GphrxPageRankOptions gphrx_default_pagerank_options()
+{
+    GphrxPageRankOptions options = {
+        .damping_factor = GPHRX_PAGERANK_DEFAULT_DAMPING_FACTOR,
+        .tolerance = GPHRX_PAGERANK_DEFAULT_TOLERANCE,
+        .max_iterations = GPHRX_PAGERANK_DEFAULT_MAX_ITERATIONS,
+    };
+
+    return options;
+}
+
+typedef struct {
+    double *scores;
+    double *next_scores;
+    double *contributions;
+    double *inverse_out_degrees;
+    double base_score;
+    double damping_factor;
+} PageRankContext;
+
+// Finds what each vertex passes along each of its out-edges, and sums the scores of vertices without any
+static void find_contributions(void *context, size_t start, size_t end, void *partial)
+{
+    PageRankContext *pagerank = context;
+    double *dangling_sum = partial;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        pagerank->contributions[v] = pagerank->scores[v] * pagerank->inverse_out_degrees[v];
+
+        if (pagerank->inverse_out_degrees[v] == 0.0)
+            *dangling_sum += pagerank->scores[v];
+    }
+}
+
+// Turns the summed contributions in `next_scores` into scores, and sums how much the scores changed
+static void find_next_scores(void *context, size_t start, size_t end, void *partial)
+{
+    PageRankContext *pagerank = context;
+    double *residual = partial;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        double score = pagerank->base_score + pagerank->damping_factor * pagerank->next_scores[v];
+
+        *residual += fabs(score - pagerank->scores[v]);
+        pagerank->next_scores[v] = score;
+    }
+}
+
+static void add_sums(void *context, void *accumulator, void *partial)
+{
+    *(double*) accumulator += *(double*) partial;
+}
+
+static double sum_scores(double *scores, u64 vertex_count)
+{
+    double sum = 0.0;
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        sum += scores[v];
+
+    return sum;
+}
+
+DLLEXPORT GphrxPageRankResult gphrx_pagerank(GphrxGraph *restrict graph,
+                                             GphrxPageRankOptions *restrict options,
+                                             double *restrict initial_scores)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    GphrxPageRankResult result = {
+        .vertex_count = vertex_count,
+        .scores = malloc(sizeof(double) * (vertex_count + 1)),
+        .iteration_count = 0,
+        .residual = 0.0,
+    };
+
+    assert(result.scores != 0, "malloc failure");
+
+    if (vertex_count == 0)
+        return result;
+
+    double initial_sum = initial_scores != 0 ? sum_scores(initial_scores, vertex_count) : 0.0;
+
+    if (initial_sum > 0.0)
+    {
+        for (u64 v = 0; v < vertex_count; ++v)
+            result.scores[v] = initial_scores[v] / initial_sum;
+    }
+    else
+    {
+        for (u64 v = 0; v < vertex_count; ++v)
+            result.scores[v] = 1.0 / (double) vertex_count;
+    }
+
+    GphrxSpmvOperator op = new_gphrx_spmv_operator(graph);
+
+    PageRankContext context = {
+        .scores = result.scores,
+        .next_scores = malloc(sizeof(double) * vertex_count),
+        .contributions = malloc(sizeof(double) * vertex_count),
+        .inverse_out_degrees = malloc(sizeof(double) * vertex_count),
+        .damping_factor = options->damping_factor,
+    };
+
+    assert(context.next_scores != 0 && context.contributions != 0 && context.inverse_out_degrees != 0,
+           "malloc failure");
+
+    // Multiplying by a precomputed inverse keeps the per-iteration loop free of divides, so it vectorizes
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        size_t out_degree = op.col_offsets[v + 1] - op.col_offsets[v];
+        context.inverse_out_degrees[v] = out_degree == 0 ? 0.0 : 1.0 / (double) out_degree;
+    }
+
+    result.residual = INFINITY;
+
+    while (result.iteration_count < options->max_iterations && result.residual > options->tolerance)
+    {
+        double dangling_sum = 0.0;
+        _gphrx_parallel_reduce(0,
+                               vertex_count,
+                               PAGERANK_GRAIN_SIZE,
+                               &dangling_sum,
+                               sizeof(double),
+                               find_contributions,
+                               add_sums,
+                               &context);
+
+        gphrx_spmv(&op, context.contributions, context.next_scores, GPHRX_SPMV_PULL);
+
+        context.base_score = (1.0 - options->damping_factor + options->damping_factor * dangling_sum) /
+            (double) vertex_count;
+
+        result.residual = 0.0;
+        _gphrx_parallel_reduce(0,
+                               vertex_count,
+                               PAGERANK_GRAIN_SIZE,
+                               &result.residual,
+                               sizeof(double),
+                               find_next_scores,
+                               add_sums,
+                               &context);
+
+        // A guess from block scores misplaces mass between the ends of edges that cross blocks. On bipartite
+        // parts of the graph that error only flips sign each iteration, decaying no faster than the damping
+        // factor, so the guess is averaged with the first step away from it to cancel most of it.
+        if (initial_sum > 0.0 && result.iteration_count == 0)
+        {
+            for (u64 v = 0; v < vertex_count; ++v)
+                context.next_scores[v] = 0.5 * (context.next_scores[v] + context.scores[v]);
+        }
+
+        double *scores = context.scores;
+        context.scores = context.next_scores;
+        context.next_scores = scores;
+
+        ++result.iteration_count;
+    }
+
+    // The final scores may have ended up in the buffer allocated for the next scores
+    if (context.scores != result.scores)
+    {
+        free(result.scores);
+        result.scores = context.scores;
+    }
+    else
+    {
+        free(context.next_scores);
+    }
+
+    free(context.contributions);
+    free(context.inverse_out_degrees);
+    free_gphrx_spmv_operator(&op);
+
+    return result;
+}
+
+DLLEXPORT void gphrx_pagerank_warm_start(GphrxGraph *restrict graph,
+                                         GphrxPageRankResult *restrict approximation_result,
+                                         u64 block_dimension,
+                                         DynamicArray8 *restrict boundaries,
+                                         double *restrict scores)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    u64 vertex_count = matrix->dimension;
+
+    if (vertex_count == 0)
+        return;
+
+    assert(boundaries != 0 || block_dimension != 0, "Block dimension must not be zero");
+
+    u64 block_count = approximation_result->vertex_count;
+
+    for (u64 block = 0; block < block_count; ++block)
+    {
+        u64 block_start = boundaries != 0 ? dynarr8_get(boundaries, block).u64_val : block * block_dimension;
+        u64 block_end = boundaries != 0 ? dynarr8_get(boundaries, block + 1).u64_val : block_start + block_dimension;
+
+        if (block_start >= vertex_count)
+            break;
+
+        if (block_end > vertex_count)
+            block_end = vertex_count;
+
+        double score = approximation_result->scores[block] / (double) (block_end - block_start);
+        for (u64 v = block_start; v < block_end; ++v)
+            scores[v] = score;
+    }
+
+    // No edge joins two weak components, so mass that the block scores move between them only drifts back
+    // through teleports, which takes about as many iterations as a cold start needs in total. Each component
+    // is given back the share it holds in a cold start.
+    GphrxComponentsResult components = gphrx_find_components(graph);
+
+    double *component_sums = calloc(components.component_count, sizeof(double));
+    assert(component_sums != 0, "malloc failure");
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        component_sums[components.labels[v]] += scores[v];
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        u64 component = components.labels[v];
+        double share = (double) components.sizes[component] / (double) vertex_count;
+
+        scores[v] = component_sums[component] > 0.0
+            ? scores[v] * share / component_sums[component]
+            : share / (double) components.sizes[component];
+    }
+
+    free(component_sums);
+    free_gphrx_components_result(&components);
+}
+
+DLLEXPORT GphrxPageRankResult gphrx_pagerank_from_approximation(GphrxGraph *restrict graph,
+                                                                u64 block_dimension,
+                                                                double threshold,
+                                                                GphrxPageRankOptions *restrict options)
+{
+    GphrxGraph approx_graph = approximate_gphrx(graph, block_dimension, threshold);
+    GphrxPageRankResult approx_result = gphrx_pagerank(&approx_graph, options, 0);
+
+    // Graphs too small to approximate are approximated by a copy of themselves
+    if (approx_graph.adjacency_matrix.dimension == graph->adjacency_matrix.dimension)
+        block_dimension = 1;
+
+    double *initial_scores = malloc(sizeof(double) * (graph->adjacency_matrix.dimension + 1));
+    assert(initial_scores != 0, "malloc failure");
+
+    gphrx_pagerank_warm_start(graph, &approx_result, block_dimension, 0, initial_scores);
+
+    GphrxPageRankResult result = gphrx_pagerank(graph, options, initial_scores);
+
+    free(initial_scores);
+    free_gphrx_pagerank_result(&approx_result);
+    free_gphrx(&approx_graph);
+
+    return result;
+}
+
+DLLEXPORT void free_gphrx_pagerank_result(GphrxPageRankResult *restrict result)
+{
+    free(result->scores);
+}
+
+
+#ifdef TEST_MODE
+
+// Edges lead into blocks of vertices with probability growing with the block's position, so that the
+// approximation's block-level structure carries most of the information about the scores
+static GphrxGraph new_block_skewed_test_graph(bool is_undirected, u64 block_count, u64 block_size, u64 seed)
+{
+    GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+    u64 rng_state = seed;
+
+    u64 weight_sum = block_count * (block_count + 1) * (2 * block_count + 1) / 6;
+
+    for (u64 i = 0; i < block_count * block_size * 20; ++i)
+    {
+        u64 target = test_random(&rng_state) % weight_sum;
+        u64 block = 0;
+
+        while (target >= (block + 1) * (block + 1))
+        {
+            target -= (block + 1) * (block + 1);
+            ++block;
+        }
+
+        u64 from = test_random(&rng_state) % (block_count * block_size);
+        gphrx_add_edge(&graph, from, block * block_size + test_random(&rng_state) % block_size);
+    }
+
+    return graph;
+}
+
+// A block-skewed component and many small path-shaped components, which are bipartite, as in collaboration
+// graphs with many small groups of authors. The vertex IDs are shuffled so that blocks mix components.
+static GphrxGraph new_multi_component_test_graph(bool is_undirected, u64 seed)
+{
+    GphrxGraph components_graph = new_block_skewed_test_graph(is_undirected, 20, 100, seed);
+    u64 vertex_count = components_graph.adjacency_matrix.dimension;
+
+    for (u64 i = 0; i < 300; ++i)
+    {
+        u64 size = 2 + i % 5;
+
+        for (u64 v = vertex_count; v + 1 < vertex_count + size; ++v)
+            gphrx_add_edge(&components_graph, v, v + 1);
+
+        vertex_count += size;
+    }
+
+    // 7919 is a prime larger than the vertex count, so multiplying by it permutes the IDs
+    GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+    GphrxCsrAdjacencyMatrix *matrix = &components_graph.adjacency_matrix;
+
+    for (size_t i = 0; i < matrix->col_indices.size; ++i)
+    {
+        u64 from = dynarr8_get(&matrix->col_indices, i).u64_val;
+        u64 to = dynarr8_get(&matrix->row_indices, i).u64_val;
+
+        gphrx_add_edge(&graph, from * 7919 % vertex_count, to * 7919 % vertex_count);
+    }
+
+    free_gphrx(&components_graph);
+
+    return graph;
+}
+
+// Straightforward power iteration for checking results against
+static double *find_expected_pagerank(GphrxGraph *restrict graph, double damping_factor, u32 iteration_count)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+
+    double *scores = malloc(sizeof(double) * vertex_count);
+    double *next_scores = malloc(sizeof(double) * vertex_count);
+    u64 *out_degrees = calloc(vertex_count, sizeof(u64));
+
+    for (size_t i = 0; i < edge_count; ++i)
+        ++out_degrees[dynarr8_get(&graph->adjacency_matrix.col_indices, i).u64_val];
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        scores[v] = 1.0 / (double) vertex_count;
+
+    for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+    {
+        double dangling_sum = 0.0;
+
+        for (u64 v = 0; v < vertex_count; ++v)
+        {
+            if (out_degrees[v] == 0)
+                dangling_sum += scores[v];
+        }
+
+        for (u64 v = 0; v < vertex_count; ++v)
+            next_scores[v] = (1.0 - damping_factor + damping_factor * dangling_sum) / (double) vertex_count;
+
+        for (size_t i = 0; i < edge_count; ++i)
+        {
+            u64 from = dynarr8_get(&graph->adjacency_matrix.col_indices, i).u64_val;
+            u64 to = dynarr8_get(&graph->adjacency_matrix.row_indices, i).u64_val;
+
+            next_scores[to] += damping_factor * scores[from] / (double) out_degrees[from];
+        }
+
+        double *swap = scores;
+        scores = next_scores;
+        next_scores = swap;
+    }
+
+    free(next_scores);
+    free(out_degrees);
+
+    return scores;
+}
+
+static TEST_RESULT test_gphrx_pagerank()
+{
+    GphrxPageRankOptions options = gphrx_default_pagerank_options();
+
+    for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+    {
+        GphrxGraph graph = new_block_skewed_test_graph(is_undirected, 20, 100, 9 + is_undirected);
+
+        gphrx_set_num_threads(4);
+        GphrxPageRankResult result = gphrx_pagerank(&graph, &options, 0);
+        gphrx_set_num_threads(0);
+
+        assert(result.vertex_count == graph.adjacency_matrix.dimension, "Incorrect vertex count");
+        assert(result.residual <= options.tolerance, "PageRank did not converge");
+        assert(result.iteration_count > 1 && result.iteration_count < options.max_iterations,
+               "Incorrect iteration count");
+
+        double *expected = find_expected_pagerank(&graph, options.damping_factor, 200);
+
+        double sum = 0.0;
+        for (u64 v = 0; v < result.vertex_count; ++v)
+        {
+            assert(fabs(result.scores[v] - expected[v]) < 1e-8, "Incorrect score");
+            sum += result.scores[v];
+        }
+
+        assert(fabs(sum - 1.0) < 1e-9, "Scores do not sum to one");
+
+        // Starting from the scores themselves converges immediately
+        GphrxPageRankResult restarted_result = gphrx_pagerank(&graph, &options, result.scores);
+        assert(restarted_result.iteration_count == 1, "Incorrect iteration count");
+
+        // Starting from the approximation's scores converges to the same scores
+        GphrxPageRankResult warm_result = gphrx_pagerank_from_approximation(&graph, 100, 0.01, &options);
+
+        assert(warm_result.residual <= options.tolerance, "PageRank did not converge");
+        assert(warm_result.iteration_count <= result.iteration_count, "Warm start took more iterations");
+
+        for (u64 v = 0; v < result.vertex_count; ++v)
+            assert(fabs(warm_result.scores[v] - expected[v]) < 1e-8, "Incorrect score");
+
+        free(expected);
+        free_gphrx_pagerank_result(&result);
+        free_gphrx_pagerank_result(&restarted_result);
+        free_gphrx_pagerank_result(&warm_result);
+        free_gphrx(&graph);
+    }
+
+    // A warm start keeps each component's share of the mass, so the small components don't hold it back
+    GphrxPageRankOptions long_options = options;
+    long_options.max_iterations = 1000;
+
+    for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+    {
+        GphrxGraph graph = new_multi_component_test_graph(is_undirected, 11 + is_undirected);
+        GphrxPageRankResult result = gphrx_pagerank(&graph, &long_options, 0);
+
+        assert(result.residual <= long_options.tolerance, "PageRank did not converge");
+
+        u64 block_dimensions[3] = { 2, 10, 100 };
+        double thresholds[2] = { 0.0, 0.01 };
+
+        for (u32 i = 0; i < 3; ++i)
+        {
+            for (u32 j = 0; j < 2; ++j)
+            {
+                GphrxPageRankResult warm_result =
+                    gphrx_pagerank_from_approximation(&graph, block_dimensions[i], thresholds[j], &long_options);
+
+                assert(warm_result.residual <= long_options.tolerance, "PageRank did not converge");
+                assert(warm_result.iteration_count <= result.iteration_count, "Warm start took more iterations");
+
+                for (u64 v = 0; v < result.vertex_count; ++v)
+                    assert(fabs(warm_result.scores[v] - result.scores[v]) < 1e-8, "Incorrect score");
+
+                free_gphrx_pagerank_result(&warm_result);
+            }
+        }
+
+        free_gphrx_pagerank_result(&result);
+        free_gphrx(&graph);
+    }
+
+    GphrxGraph empty_graph = new_directed_gphrx();
+    GphrxPageRankResult empty_result = gphrx_pagerank(&empty_graph, &options, 0);
+
+    assert(empty_result.vertex_count == 0 && empty_result.iteration_count == 0, "Incorrect empty result");
+
+    free_gphrx_pagerank_result(&empty_result);
+    free_gphrx(&empty_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_pagerank_warm_start()
+{
+    GphrxGraph graph = new_directed_gphrx();
+
+    gphrx_add_edge(&graph, 0, 1);
+    gphrx_add_edge(&graph, 2, 1);
+    gphrx_add_edge(&graph, 3, 2);
+
+    double block_scores[2] = { 0.75, 0.25 };
+
+    GphrxPageRankResult approx_result = {
+        .vertex_count = 2,
+        .scores = block_scores,
+    };
+
+    double scores[4];
+    gphrx_pagerank_warm_start(&graph, &approx_result, 2, 0, scores);
+
+    assert(fabs(scores[0] - 0.375) < 1e-12 && fabs(scores[1] - 0.375) < 1e-12, "Incorrect warm start");
+    assert(fabs(scores[2] - 0.125) < 1e-12 && fabs(scores[3] - 0.125) < 1e-12, "Incorrect warm start");
+
+    // Blocks of uneven size
+    DynamicArray8 boundaries = new_dynarr8();
+    u64 boundary_ids[3] = { 0, 1, 4 };
+
+    for (u32 i = 0; i < 3; ++i)
+    {
+        Byte8Val boundary_bv = { .u64_val = boundary_ids[i] };
+        dynarr8_push(&boundaries, boundary_bv);
+    }
+
+    gphrx_pagerank_warm_start(&graph, &approx_result, 0, &boundaries, scores);
+
+    assert(fabs(scores[0] - 0.75) < 1e-12 && fabs(scores[1] - 0.25 / 3.0) < 1e-12, "Incorrect warm start");
+    assert(fabs(scores[2] - 0.25 / 3.0) < 1e-12 && fabs(scores[3] - 0.25 / 3.0) < 1e-12, "Incorrect warm start");
+
+    // The block scores put 0.6 of the mass on {0, 1} and 0.4 on {2, 3}, but each component keeps half
+    GphrxGraph split_graph = new_directed_gphrx();
+
+    gphrx_add_edge(&split_graph, 0, 1);
+    gphrx_add_edge(&split_graph, 2, 3);
+
+    double split_block_scores[2] = { 0.9, 0.1 };
+    approx_result.scores = split_block_scores;
+
+    gphrx_pagerank_warm_start(&split_graph, &approx_result, 3, 0, scores);
+
+    assert(fabs(scores[0] - 0.25) < 1e-12 && fabs(scores[1] - 0.25) < 1e-12, "Incorrect warm start");
+    assert(fabs(scores[2] - 0.375) < 1e-12 && fabs(scores[3] - 0.125) < 1e-12, "Incorrect warm start");
+
+    free_dynarr8(&boundaries);
+    free_gphrx(&split_graph);
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet pagerank_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_pagerank);
+    register_test(&set, test_gphrx_pagerank_warm_start);
+
+    return set;
+}
+
+#endif
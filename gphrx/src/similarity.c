@@ -0,0 +1,330 @@
+#include "similarity.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "dynarray.h"
+#include "sort.h"
+#include "threadpool.h"
+#include "triangles.h"
+
+// Pairs per range of the scoring loop
+#define QUERY_GRAIN_SIZE 256
+
+typedef struct {
+    GPHRX_CACHE_ALIGNED DynamicArrayU64 matches;
+} SimilarityThreadState;
+
+typedef struct {
+    GphrxGraph *graph;
+    u64 *neighbors;
+
+    // Null if each vertex's edges are found by searching the graph (or its vertex index)
+    size_t *offsets;
+
+    // The pairs' first vertices in sorted order, and the index of the pair each came from
+    u64 *sorted_from_vertex_ids;
+    u64 *query_indices;
+    u64 *to_vertex_ids;
+
+    GphrxSimilarityResult *result;
+    SimilarityThreadState *threads;
+} SimilaritySearch;
+
+// Returns the index of the vertex's first edge and sets `*end` to the index after its last
+static size_t find_neighbors(SimilaritySearch *restrict search, u64 vertex_id, size_t *end)
+{
+    if (vertex_id >= search->graph->adjacency_matrix.dimension)
+    {
+        *end = 0;
+        return 0;
+    }
+
+    if (search->offsets != 0)
+    {
+        *end = search->offsets[vertex_id + 1];
+        return search->offsets[vertex_id];
+    }
+
+    return _gphrx_find_vertex_edge_range(search->graph, vertex_id, end);
+}
+
+static void score_queries(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    SimilaritySearch *search = context;
+    SimilarityThreadState *state = search->threads + thread_idx;
+    GphrxSimilarityResult *result = search->result;
+
+    u64 from_vertex_id = 0;
+    size_t from_start = 0;
+    size_t from_end = 0;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        if (i == start || search->sorted_from_vertex_ids[i] != from_vertex_id)
+        {
+            from_vertex_id = search->sorted_from_vertex_ids[i];
+            from_start = find_neighbors(search, from_vertex_id, &from_end);
+        }
+
+        u64 query = search->query_indices[i];
+
+        size_t to_end;
+        size_t to_start = find_neighbors(search, search->to_vertex_ids[query], &to_end);
+
+        size_t from_count = from_end - from_start;
+        size_t to_count = to_end - to_start;
+
+        dynarr_u64_reserve(&state->matches, from_count < to_count ? from_count : to_count);
+
+        u64 common_count = gphrx_intersect_sorted(search->neighbors + from_start,
+                                                  from_count,
+                                                  search->neighbors + to_start,
+                                                  to_count,
+                                                  state->matches.arr);
+
+        double adamic_adar = 0.0;
+
+        for (u64 k = 0; k < common_count; ++k)
+        {
+            size_t neighbor_end;
+            size_t neighbor_start = find_neighbors(search, state->matches.arr[k], &neighbor_end);
+
+            if (neighbor_end - neighbor_start > 1)
+                adamic_adar += 1.0 / log((double) (neighbor_end - neighbor_start));
+        }
+
+        u64 union_count = from_count + to_count - common_count;
+
+        result->common_neighbor_counts[query] = common_count;
+        result->jaccard_scores[query] = union_count == 0 ? 0.0 : (double) common_count / union_count;
+        result->adamic_adar_scores[query] = adamic_adar;
+    }
+}
+
+DLLEXPORT GphrxSimilarityResult gphrx_find_similarities(GphrxGraph *restrict graph,
+                                                        u64 *from_vertex_ids,
+                                                        u64 *to_vertex_ids,
+                                                        size_t count)
+{
+    GphrxSimilarityResult result = {
+        .query_count = count,
+        .common_neighbor_counts = malloc(sizeof(u64) * (count + 1)),
+        .jaccard_scores = malloc(sizeof(double) * (count + 1)),
+        .adamic_adar_scores = malloc(sizeof(double) * (count + 1)),
+    };
+
+    assert(result.common_neighbor_counts != 0 && result.jaccard_scores != 0 && result.adamic_adar_scores != 0,
+           "malloc failure");
+
+    if (count == 0)
+        return result;
+
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    u32 thread_count = gphrx_get_num_threads();
+
+    SimilaritySearch search = {
+        .graph = graph,
+        .neighbors = (u64*) matrix->row_indices.arr,
+        .offsets = 0,
+        .sorted_from_vertex_ids = malloc(sizeof(u64) * count),
+        .query_indices = malloc(sizeof(u64) * count),
+        .to_vertex_ids = to_vertex_ids,
+        .result = &result,
+        .threads = _gphrx_new_thread_states(sizeof(SimilarityThreadState), thread_count),
+    };
+
+    assert(search.sorted_from_vertex_ids != 0 && search.query_indices != 0, "malloc failure");
+
+    if (count >= matrix->dimension / GPHRX_SIMILARITY_INDEX_RATIO)
+        search.offsets = _gphrx_find_vertex_edge_offsets(matrix);
+
+    memcpy(search.sorted_from_vertex_ids, from_vertex_ids, sizeof(u64) * count);
+
+    for (size_t i = 0; i < count; ++i)
+        search.query_indices[i] = i;
+
+    gphrx_sort_edges(search.sorted_from_vertex_ids, search.query_indices, count);
+
+    for (u32 i = 0; i < thread_count; ++i)
+        search.threads[i].matches = new_dynarr_u64_with_capacity(64);
+
+    _gphrx_parallel_for(0, count, QUERY_GRAIN_SIZE, score_queries, &search);
+
+    for (u32 i = 0; i < thread_count; ++i)
+        free_dynarr_u64(&search.threads[i].matches);
+
+    free(search.offsets);
+    free(search.sorted_from_vertex_ids);
+    free(search.query_indices);
+    free(search.threads);
+
+    return result;
+}
+
+DLLEXPORT void free_gphrx_similarity_result(GphrxSimilarityResult *restrict result)
+{
+    free(result->common_neighbor_counts);
+    free(result->jaccard_scores);
+    free(result->adamic_adar_scores);
+}
+
+
+#ifdef TEST_MODE
+
+static u64 test_degree(GphrxGraph *restrict graph, u64 vertex_id)
+{
+    u64 degree = 0;
+
+    for (u64 w = 0; w < graph->adjacency_matrix.dimension; ++w)
+        degree += gphrx_does_edge_exist(graph, vertex_id, w);
+
+    return degree;
+}
+
+// Checks a result against scores found with `gphrx_does_edge_exist`
+static bool are_similarities_correct(GphrxGraph *restrict graph,
+                                     GphrxSimilarityResult *restrict result,
+                                     u64 *from_vertex_ids,
+                                     u64 *to_vertex_ids)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    for (size_t i = 0; i < result->query_count; ++i)
+    {
+        u64 u = from_vertex_ids[i];
+        u64 v = to_vertex_ids[i];
+
+        u64 common_count = 0;
+        u64 union_count = 0;
+        double adamic_adar = 0.0;
+
+        for (u64 w = 0; w < vertex_count; ++w)
+        {
+            bool is_from_neighbor = u < vertex_count && gphrx_does_edge_exist(graph, u, w);
+            bool is_to_neighbor = v < vertex_count && gphrx_does_edge_exist(graph, v, w);
+
+            union_count += is_from_neighbor || is_to_neighbor;
+
+            if (is_from_neighbor && is_to_neighbor)
+            {
+                ++common_count;
+
+                u64 degree = test_degree(graph, w);
+
+                if (degree > 1)
+                    adamic_adar += 1.0 / log((double) degree);
+            }
+        }
+
+        double jaccard = union_count == 0 ? 0.0 : (double) common_count / union_count;
+
+        if (result->common_neighbor_counts[i] != common_count ||
+            result->jaccard_scores[i] != jaccard ||
+            fabs(result->adamic_adar_scores[i] - adamic_adar) > 1e-9)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static TEST_RESULT test_gphrx_find_similarities()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    // Small enough that every vertex's edges are found by binary search, and large enough that the
+    // offsets of every vertex are found first
+    size_t query_counts[] = { 5, 1500 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = new_random_test_graph(is_undirected, 300, 6000, 3 + is_undirected);
+
+            for (u32 q = 0; q < sizeof(query_counts) / sizeof(query_counts[0]); ++q)
+            {
+                size_t count = query_counts[q];
+
+                u64 *from_vertex_ids = malloc(sizeof(u64) * count);
+                u64 *to_vertex_ids = malloc(sizeof(u64) * count);
+
+                u64 rng_state = 11 + q;
+
+                // Few distinct first vertices, so that runs of pairs share one, and some vertices past the
+                // end of the graph
+                for (size_t i = 0; i < count; ++i)
+                {
+                    from_vertex_ids[i] = test_random(&rng_state) % 40 * 8;
+                    to_vertex_ids[i] = test_random(&rng_state) % 310;
+                }
+
+                GphrxSimilarityResult result = gphrx_find_similarities(&graph, from_vertex_ids, to_vertex_ids, count);
+
+                assert(result.query_count == count, "Incorrect query count");
+                assert(are_similarities_correct(&graph, &result, from_vertex_ids, to_vertex_ids),
+                       "Incorrect similarities");
+
+                free_gphrx_similarity_result(&result);
+                free(from_vertex_ids);
+                free(to_vertex_ids);
+            }
+
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // 0 and 1 share neighbours 2 and 3, and 3 has edges to three vertices
+    GphrxGraph graph = new_directed_gphrx();
+
+    gphrx_add_edge(&graph, 0, 2);
+    gphrx_add_edge(&graph, 0, 3);
+    gphrx_add_edge(&graph, 1, 2);
+    gphrx_add_edge(&graph, 1, 3);
+    gphrx_add_edge(&graph, 1, 4);
+    gphrx_add_edge(&graph, 3, 0);
+    gphrx_add_edge(&graph, 3, 1);
+    gphrx_add_edge(&graph, 3, 4);
+
+    u64 from_vertex_ids[] = { 0, 1, 4 };
+    u64 to_vertex_ids[] = { 1, 1, 2 };
+
+    GphrxSimilarityResult result = gphrx_find_similarities(&graph, from_vertex_ids, to_vertex_ids, 3);
+
+    assert(result.common_neighbor_counts[0] == 2 && result.jaccard_scores[0] == 2.0 / 3.0, "Incorrect scores");
+    assert(fabs(result.adamic_adar_scores[0] - 1.0 / log(3.0)) < 1e-12, "Incorrect scores");
+    assert(result.common_neighbor_counts[1] == 3 && result.jaccard_scores[1] == 1.0, "Incorrect scores");
+    assert(result.common_neighbor_counts[2] == 0 && result.jaccard_scores[2] == 0.0, "Incorrect scores");
+    assert(result.adamic_adar_scores[2] == 0.0, "Incorrect scores");
+
+    free_gphrx_similarity_result(&result);
+
+    result = gphrx_find_similarities(&graph, 0, 0, 0);
+    assert(result.query_count == 0, "Incorrect query count");
+    free_gphrx_similarity_result(&result);
+
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet similarity_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_find_similarities);
+
+    return set;
+}
+
+#endif
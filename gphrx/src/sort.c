@@ -0,0 +1,581 @@
+#include "sort.h"
+
+#include <string.h>
+
+#include "threadpool.h"
+
+// The first pass buckets the keys by their most significant bits, out of cache and in parallel. Each bucket
+// is then small enough to finish in cache with byte-wide passes, least significant digit first. The MSD is
+// as wide as it takes to get buckets of around MSD_BUCKET_KEYS keys, within MIN_MSD_BITS and MAX_MSD_BITS
+// (past which the scatter writes to too many streams at once).
+#define MIN_MSD_BITS 8
+#define MAX_MSD_BITS 12
+#define MSD_BUCKET_KEYS 4096
+#define LSD_BITS 8
+#define LSD_BUCKETS (1 << LSD_BITS)
+
+#define RADIX_SORT_GRAIN_SIZE 65536
+
+// Below this, the fixed cost of the histograms outweighs the passes
+#define INSERTION_SORT_THRESHOLD 64
+
+// A digit of a key made of parallel lists (the first list most significant)
+typedef struct {
+    u32 list;
+    u32 shift;
+    u64 mask;
+} RadixDigit;
+
+typedef struct {
+    u64 *src[2];
+    u64 *dst[2];
+    u32 list_count;
+    size_t count;
+    size_t chunk_size;
+
+    RadixDigit msd;
+    size_t msd_bucket_count;
+
+    // Per-chunk counts of each MSD bucket, which become the per-chunk scatter offsets, and the start of
+    // each bucket once scattered
+    size_t *bucket_offsets;
+    size_t *bucket_starts;
+
+    // Digits below the MSD that are not the same in every key, least significant first
+    RadixDigit lsd_digits[2 * (64 / LSD_BITS)];
+    u32 lsd_digit_count;
+} RadixSort;
+
+static void count_msd_digits(void *context, size_t first_chunk, size_t end_chunk, u32 thread_idx)
+{
+    RadixSort *sort = context;
+    u64 *keys = sort->src[sort->msd.list];
+    u32 shift = sort->msd.shift;
+    u64 mask = sort->msd.mask;
+
+    for (size_t chunk = first_chunk; chunk < end_chunk; ++chunk)
+    {
+        size_t start = chunk * sort->chunk_size;
+        size_t end = start + sort->chunk_size < sort->count ? start + sort->chunk_size : sort->count;
+
+        size_t *counts = sort->bucket_offsets + chunk * sort->msd_bucket_count;
+        memset(counts, 0, sizeof(size_t) * sort->msd_bucket_count);
+
+        for (size_t i = start; i < end; ++i)
+            ++counts[(keys[i] >> shift) & mask];
+    }
+}
+
+static void scatter_msd_digits(void *context, size_t first_chunk, size_t end_chunk, u32 thread_idx)
+{
+    RadixSort *sort = context;
+    u64 *keys = sort->src[sort->msd.list];
+    u32 shift = sort->msd.shift;
+    u64 mask = sort->msd.mask;
+
+    for (size_t chunk = first_chunk; chunk < end_chunk; ++chunk)
+    {
+        size_t start = chunk * sort->chunk_size;
+        size_t end = start + sort->chunk_size < sort->count ? start + sort->chunk_size : sort->count;
+        size_t *offsets = sort->bucket_offsets + chunk * sort->msd_bucket_count;
+
+        if (sort->list_count == 1)
+        {
+            u64 *dst = sort->dst[0];
+
+            for (size_t i = start; i < end; ++i)
+                dst[offsets[(keys[i] >> shift) & mask]++] = keys[i];
+        }
+        else
+        {
+            for (size_t i = start; i < end; ++i)
+            {
+                size_t pos = offsets[(keys[i] >> shift) & mask]++;
+
+                sort->dst[0][pos] = sort->src[0][i];
+                sort->dst[1][pos] = sort->src[1][i];
+            }
+        }
+    }
+}
+
+// Stable counting sort of [start, end) by one digit. Returns false, having moved nothing, if every key in
+// the range has the same digit.
+static bool sort_range_by_digit(u64 **from, u64 **to, u32 list_count, size_t start, size_t end, RadixDigit digit)
+{
+    u64 *keys = from[digit.list];
+    size_t offsets[LSD_BUCKETS] = {0};
+
+    for (size_t i = start; i < end; ++i)
+        ++offsets[(keys[i] >> digit.shift) & digit.mask];
+
+    size_t total = start;
+    for (u32 bucket = 0; bucket < LSD_BUCKETS; ++bucket)
+    {
+        if (offsets[bucket] == end - start)
+            return false;
+
+        size_t bucket_count = offsets[bucket];
+        offsets[bucket] = total;
+        total += bucket_count;
+    }
+
+    if (list_count == 1)
+    {
+        for (size_t i = start; i < end; ++i)
+            to[0][offsets[(keys[i] >> digit.shift) & digit.mask]++] = keys[i];
+    }
+    else
+    {
+        for (size_t i = start; i < end; ++i)
+        {
+            size_t pos = offsets[(keys[i] >> digit.shift) & digit.mask]++;
+
+            to[0][pos] = from[0][i];
+            to[1][pos] = from[1][i];
+        }
+    }
+
+    return true;
+}
+
+static void insertion_sort(u64 **lists, u32 list_count, size_t count);
+
+// Finishes each bucket in the scattered lists, using the same range of the original lists (which the
+// scatter has emptied) as the other side of each pass. The sorted bucket ends up in the original lists.
+static void sort_msd_buckets(void *context, size_t first_bucket, size_t end_bucket, u32 thread_idx)
+{
+    RadixSort *sort = context;
+
+    for (size_t bucket = first_bucket; bucket < end_bucket; ++bucket)
+    {
+        size_t start = sort->bucket_starts[bucket];
+        size_t end = sort->bucket_starts[bucket + 1];
+
+        u64 *from[2] = {sort->dst[0], sort->dst[1]};
+        u64 *to[2] = {sort->src[0], sort->src[1]};
+
+        if (end - start < INSERTION_SORT_THRESHOLD)
+        {
+            u64 *lists[2] = {from[0] + start, from[1] + start};
+            insertion_sort(lists, sort->list_count, end - start);
+        }
+        else
+        {
+            for (u32 i = 0; i < sort->lsd_digit_count; ++i)
+            {
+                if (!sort_range_by_digit(from, to, sort->list_count, start, end, sort->lsd_digits[i]))
+                    continue;
+
+                for (u32 list = 0; list < 2; ++list)
+                {
+                    u64 *temp = from[list];
+                    from[list] = to[list];
+                    to[list] = temp;
+                }
+            }
+        }
+
+        if (from[0] != sort->src[0])
+        {
+            for (u32 list = 0; list < sort->list_count; ++list)
+                memcpy(sort->src[list] + start, from[list] + start, sizeof(u64) * (end - start));
+        }
+    }
+}
+
+typedef struct {
+    u64 *lists[2];
+    u32 list_count;
+    u64 reference[2];
+} DifferingBitsContext;
+
+// ORs together every key XORed with the list's reference value, giving the bits that differ from it. The
+// loop has no dependencies between iterations, so the compiler vectorises it.
+static void find_differing_bits(void *context, size_t start, size_t end, void *partial)
+{
+    DifferingBitsContext *bits_context = context;
+    u64 *differing_bits = partial;
+
+    for (u32 list = 0; list < bits_context->list_count; ++list)
+    {
+        u64 *keys = bits_context->lists[list];
+        u64 reference = bits_context->reference[list];
+        u64 bits = 0;
+
+        for (size_t i = start; i < end; ++i)
+            bits |= keys[i] ^ reference;
+
+        differing_bits[list] |= bits;
+    }
+}
+
+static void combine_differing_bits(void *context, void *accumulator, void *partial)
+{
+    u64 *accumulated_bits = accumulator;
+    u64 *partial_bits = partial;
+
+    accumulated_bits[0] |= partial_bits[0];
+    accumulated_bits[1] |= partial_bits[1];
+}
+
+static void differing_bits(u64 **lists, u32 list_count, size_t count, u64 *reference, u64 *bits)
+{
+    DifferingBitsContext context = {
+        .lists = {lists[0], list_count > 1 ? lists[1] : 0},
+        .list_count = list_count,
+        .reference = {reference[0], list_count > 1 ? reference[1] : 0},
+    };
+
+    bits[0] = 0;
+    bits[1] = 0;
+
+    _gphrx_parallel_reduce(0,
+                           count,
+                           RADIX_SORT_GRAIN_SIZE,
+                           bits,
+                           2 * sizeof(u64),
+                           find_differing_bits,
+                           combine_differing_bits,
+                           &context);
+}
+
+static bool is_key_less(u64 **lists, u32 list_count, size_t a, size_t b)
+{
+    for (u32 list = 0; list < list_count; ++list)
+    {
+        if (lists[list][a] != lists[list][b])
+            return lists[list][a] < lists[list][b];
+    }
+
+    return false;
+}
+
+static void insertion_sort(u64 **lists, u32 list_count, size_t count)
+{
+    for (size_t i = 1; i < count; ++i)
+    {
+        for (size_t j = i; j > 0 && is_key_less(lists, list_count, j, j - 1); --j)
+        {
+            for (u32 list = 0; list < list_count; ++list)
+            {
+                u64 temp = lists[list][j];
+                lists[list][j] = lists[list][j - 1];
+                lists[list][j - 1] = temp;
+            }
+        }
+    }
+}
+
+static u32 highest_set_bit(u64 value)
+{
+    u32 bit = 0;
+
+    while (value >>= 1)
+        ++bit;
+
+    return bit;
+}
+
+static void radix_sort(u64 **lists, u32 list_count, size_t count)
+{
+    if (count < INSERTION_SORT_THRESHOLD)
+    {
+        insertion_sort(lists, list_count, count);
+        return;
+    }
+
+    // A digit that is the same in every key doesn't change the order, and which digits those are doesn't
+    // depend on the order, so they can all be found up front
+    u64 reference[2] = {lists[0][0], list_count > 1 ? lists[1][0] : 0};
+    u64 bits[2];
+    differing_bits(lists, list_count, count, reference, bits);
+
+    u32 msd_list = 0;
+    while (msd_list < list_count && bits[msd_list] == 0)
+        ++msd_list;
+
+    if (msd_list == list_count)
+        return;
+
+    RadixSort sort = {
+        .src = {lists[0], lists[1 % list_count]},
+        .list_count = list_count,
+        .count = count,
+        .lsd_digit_count = 0,
+    };
+
+    // The MSD covers the highest bits that differ, so every key in a bucket shares everything above it
+    u32 msd_top = highest_set_bit(bits[msd_list]) + 1;
+    u32 msd_bits = MIN_MSD_BITS;
+    while (msd_bits < MAX_MSD_BITS && (count >> msd_bits) > MSD_BUCKET_KEYS)
+        ++msd_bits;
+
+    if (msd_bits > msd_top)
+        msd_bits = msd_top;
+
+    sort.msd.list = msd_list;
+    sort.msd.shift = msd_top - msd_bits;
+    sort.msd.mask = (1ULL << msd_bits) - 1;
+    sort.msd_bucket_count = 1ULL << msd_bits;
+
+    for (u32 list_idx = list_count; list_idx > msd_list; --list_idx)
+    {
+        u32 list = list_idx - 1;
+        u32 limit = list == msd_list ? sort.msd.shift : 64;
+
+        for (u32 shift = 0; shift < limit; shift += LSD_BITS)
+        {
+            u32 digit_bits = limit - shift < LSD_BITS ? limit - shift : LSD_BITS;
+            u64 mask = (1ULL << digit_bits) - 1;
+
+            if (((bits[list] >> shift) & mask) == 0)
+                continue;
+
+            RadixDigit digit = {.list = list, .shift = shift, .mask = mask};
+            sort.lsd_digits[sort.lsd_digit_count++] = digit;
+        }
+    }
+
+    for (u32 list = 0; list < list_count; ++list)
+    {
+        sort.dst[list] = malloc(sizeof(u64) * count);
+        assert(sort.dst[list] != 0, "malloc failure");
+    }
+
+    if (list_count == 1)
+        sort.dst[1] = sort.dst[0];
+
+    // A chunk per thread keeps the scatter's writes in as few streams as possible
+    size_t chunk_count = gphrx_get_num_threads();
+    if (chunk_count > (count + RADIX_SORT_GRAIN_SIZE - 1) / RADIX_SORT_GRAIN_SIZE)
+        chunk_count = (count + RADIX_SORT_GRAIN_SIZE - 1) / RADIX_SORT_GRAIN_SIZE;
+
+    sort.chunk_size = (count + chunk_count - 1) / chunk_count;
+    sort.bucket_offsets = malloc(sizeof(size_t) * chunk_count * sort.msd_bucket_count);
+    sort.bucket_starts = malloc(sizeof(size_t) * (sort.msd_bucket_count + 1));
+
+    assert(sort.bucket_offsets != 0, "malloc failure");
+    assert(sort.bucket_starts != 0, "malloc failure");
+
+    _gphrx_parallel_for(0, chunk_count, 1, count_msd_digits, &sort);
+
+    // Bucket-major, then chunk-major, so each chunk's keys land after those of earlier chunks and the sort
+    // is stable
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < sort.msd_bucket_count; ++bucket)
+    {
+        sort.bucket_starts[bucket] = total;
+
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+        {
+            size_t *bucket_count = sort.bucket_offsets + chunk * sort.msd_bucket_count + bucket;
+            size_t chunk_bucket_count = *bucket_count;
+
+            *bucket_count = total;
+            total += chunk_bucket_count;
+        }
+    }
+    sort.bucket_starts[sort.msd_bucket_count] = total;
+
+    _gphrx_parallel_for(0, chunk_count, 1, scatter_msd_digits, &sort);
+
+    // Buckets can differ wildly in size (e.g. a bucket of edges from a hub), so they are balanced by size
+    _gphrx_parallel_for_balanced(0, sort.msd_bucket_count, sort.bucket_starts, RADIX_SORT_GRAIN_SIZE, sort_msd_buckets, &sort);
+
+    for (u32 list = 0; list < list_count; ++list)
+        free(sort.dst[list]);
+
+    free(sort.bucket_offsets);
+    free(sort.bucket_starts);
+}
+
+void _gphrx_radix_sort_u64(u64 *keys, size_t count)
+{
+    radix_sort(&keys, 1, count);
+}
+
+typedef struct {
+    u64 *from_vertex_ids;
+    u64 *to_vertex_ids;
+    u64 *keys;
+} PackedEdgesContext;
+
+static void pack_edges(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    PackedEdgesContext *packed = context;
+
+    for (size_t i = start; i < end; ++i)
+        packed->keys[i] = (packed->from_vertex_ids[i] << 32) | packed->to_vertex_ids[i];
+}
+
+static void unpack_edges(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    PackedEdgesContext *packed = context;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        packed->from_vertex_ids[i] = packed->keys[i] >> 32;
+        packed->to_vertex_ids[i] = packed->keys[i] & 0xFFFFFFFF;
+    }
+}
+
+DLLEXPORT void gphrx_sort_edges(u64 *from_vertex_ids, u64 *to_vertex_ids, size_t count)
+{
+    u64 *lists[2] = {from_vertex_ids, to_vertex_ids};
+
+    if (count < INSERTION_SORT_THRESHOLD)
+    {
+        insertion_sort(lists, 2, count);
+        return;
+    }
+
+    // The bits that differ from zero are the bits set in any ID
+    u64 zero[2] = {0, 0};
+    u64 set_bits[2];
+    differing_bits(lists, 2, count, zero, set_bits);
+
+    if ((set_bits[0] | set_bits[1]) >> 32 != 0)
+    {
+        radix_sort(lists, 2, count);
+        return;
+    }
+
+    // Packing halves the memory moved by each pass
+    PackedEdgesContext context = {
+        .from_vertex_ids = from_vertex_ids,
+        .to_vertex_ids = to_vertex_ids,
+        .keys = malloc(sizeof(u64) * count),
+    };
+
+    assert(context.keys != 0, "malloc failure");
+
+    _gphrx_parallel_for(0, count, RADIX_SORT_GRAIN_SIZE, pack_edges, &context);
+    _gphrx_radix_sort_u64(context.keys, count);
+    _gphrx_parallel_for(0, count, RADIX_SORT_GRAIN_SIZE, unpack_edges, &context);
+
+    free(context.keys);
+}
+
+
+#ifdef TEST_MODE
+
+static int compare_u64(const void *a, const void *b)
+{
+    u64 key_a = *(const u64*) a;
+    u64 key_b = *(const u64*) b;
+
+    return key_a < key_b ? -1 : (key_a > key_b ? 1 : 0);
+}
+
+static int compare_u64_pairs(const void *a, const void *b)
+{
+    int order = compare_u64(a, b);
+    return order != 0 ? order : compare_u64((const u64*) a + 1, (const u64*) b + 1);
+}
+
+static TEST_RESULT test_gphrx_radix_sort_u64()
+{
+    size_t counts[] = {0, 1, 5, 63, 64, 1000, 300000};
+    u64 masks[] = {0xFFFFFFFFFFFFFFFF, 0xFFFFF, 0xFF00FF000000FF00, 0};
+
+    // Several threads, so the keys are split into several chunks even when the machine has one processor
+    gphrx_set_num_threads(4);
+
+    for (u32 i = 0; i < sizeof(counts) / sizeof(size_t); ++i)
+    {
+        for (u32 j = 0; j < sizeof(masks) / sizeof(u64); ++j)
+        {
+            u64 *keys = malloc(sizeof(u64) * (counts[i] + 1));
+            u64 *expected = malloc(sizeof(u64) * (counts[i] + 1));
+
+            u64 rng_state = i * 31 + j;
+            for (size_t k = 0; k < counts[i]; ++k)
+            {
+                u64 key = test_random(&rng_state) ^ (test_random(&rng_state) << 31) ^ (test_random(&rng_state) << 62);
+                keys[k] = key & masks[j];
+                expected[k] = keys[k];
+            }
+
+            _gphrx_radix_sort_u64(keys, counts[i]);
+            qsort(expected, counts[i], sizeof(u64), compare_u64);
+
+            for (size_t k = 0; k < counts[i]; ++k)
+                assert(keys[k] == expected[k], "Keys sorted incorrectly");
+
+            free(keys);
+            free(expected);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_sort_edges()
+{
+    size_t counts[] = {0, 1, 40, 5000, 200000};
+
+    gphrx_set_num_threads(4);
+
+    // IDs that fit in 32 bits are sorted as packed keys, the rest as pairs of keys
+    for (u32 is_wide = 0; is_wide < 2; ++is_wide)
+    {
+        for (u32 i = 0; i < sizeof(counts) / sizeof(size_t); ++i)
+        {
+            size_t count = counts[i];
+
+            u64 *from_vertex_ids = malloc(sizeof(u64) * (count + 1));
+            u64 *to_vertex_ids = malloc(sizeof(u64) * (count + 1));
+            u64 *expected = malloc(sizeof(u64) * 2 * (count + 1));
+
+            u64 rng_state = i + 7 * is_wide;
+            for (size_t k = 0; k < count; ++k)
+            {
+                // Few distinct from IDs, so many edges share one and are ordered by their to IDs
+                from_vertex_ids[k] = test_random(&rng_state) % 1000;
+                to_vertex_ids[k] = test_random(&rng_state) % 100000;
+
+                if (is_wide && k % 3 == 0)
+                    from_vertex_ids[k] += 1ULL << 40;
+
+                expected[2 * k] = from_vertex_ids[k];
+                expected[2 * k + 1] = to_vertex_ids[k];
+            }
+
+            gphrx_sort_edges(from_vertex_ids, to_vertex_ids, count);
+            qsort(expected, count, 2 * sizeof(u64), compare_u64_pairs);
+
+            for (size_t k = 0; k < count; ++k)
+            {
+                assert(from_vertex_ids[k] == expected[2 * k], "Edges sorted incorrectly");
+                assert(to_vertex_ids[k] == expected[2 * k + 1], "Edges sorted incorrectly");
+            }
+
+            free(from_vertex_ids);
+            free(to_vertex_ids);
+            free(expected);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet sort_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_radix_sort_u64);
+    register_test(&set, test_gphrx_sort_edges);
+
+    return set;
+}
+
+#endif
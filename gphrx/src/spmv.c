@@ -0,0 +1,534 @@
+#include "spmv.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "threadpool.h"
+
+// Matrix entries per range of a product, and vector values per range of the scan that picks a direction
+#define SPMV_GRAIN_COST 16384
+#define SPMV_SCAN_GRAIN_SIZE 65536
+
+// Groups a matrix's entries by row with a counting sort. Entries are visited in column order, so each row's
+// entries come out sorted by column.
+static void group_entries_by_row(GphrxSpmvOperator *restrict op,
+                                 u64 *col_indices,
+                                 u64 *row_indices,
+                                 double *entries)
+{
+    op->row_offsets = calloc(op->dimension + 1, sizeof(size_t));
+    op->row_col_indices = malloc(sizeof(u64) * (op->entry_count + 1));
+    op->row_entries = malloc(sizeof(double) * (op->entry_count + 1));
+
+    size_t *next_slots = malloc(sizeof(size_t) * (op->dimension + 1));
+
+    assert(op->row_offsets != 0 && op->row_col_indices != 0 && op->row_entries != 0 && next_slots != 0,
+           "malloc failure");
+
+    for (size_t i = 0; i < op->entry_count; ++i)
+        ++op->row_offsets[row_indices[i] + 1];
+
+    for (u64 row = 0; row < op->dimension; ++row)
+        op->row_offsets[row + 1] += op->row_offsets[row];
+
+    memcpy(next_slots, op->row_offsets, sizeof(size_t) * (op->dimension + 1));
+
+    for (size_t i = 0; i < op->entry_count; ++i)
+    {
+        size_t slot = next_slots[row_indices[i]]++;
+
+        op->row_col_indices[slot] = col_indices[i];
+        op->row_entries[slot] = entries[i];
+    }
+
+    free(next_slots);
+}
+
+DLLEXPORT GphrxSpmvOperator new_gphrx_spmv_operator(GphrxGraph *restrict graph)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+
+    GphrxSpmvOperator op = {
+        .dimension = matrix->dimension,
+        .entry_count = matrix->col_indices.size,
+        .has_entries = false,
+        .col_offsets = _gphrx_find_vertex_edge_offsets(matrix),
+        .col_row_indices = dynarr8_share(&matrix->row_indices),
+        .col_entries = {0},
+        .row_entries = 0,
+    };
+
+    if (graph->is_undirected)
+    {
+        op.row_offsets = op.col_offsets;
+        op.row_col_indices = (u64*) op.col_row_indices.arr;
+    }
+    else
+    {
+        op.row_col_indices = _gphrx_find_vertex_in_edges(matrix, &op.row_offsets);
+    }
+
+    return op;
+}
+
+DLLEXPORT GphrxSpmvOperator new_gphrx_spmv_operator_from_matrix(GphrxCsrMatrix *restrict matrix)
+{
+    GphrxCsrAdjacencyMatrix entry_positions = {
+        .dimension = matrix->dimension,
+        .col_indices = matrix->col_indices,
+        .row_indices = matrix->row_indices,
+    };
+
+    GphrxSpmvOperator op = {
+        .dimension = matrix->dimension,
+        .entry_count = matrix->entries.size,
+        .has_entries = true,
+        .col_offsets = _gphrx_find_vertex_edge_offsets(&entry_positions),
+        .col_row_indices = dynarr8_share(&matrix->row_indices),
+        .col_entries = dynarr8_share(&matrix->entries),
+    };
+
+    group_entries_by_row(&op,
+                         (u64*) matrix->col_indices.arr,
+                         (u64*) matrix->row_indices.arr,
+                         (double*) matrix->entries.arr);
+
+    return op;
+}
+
+DLLEXPORT void free_gphrx_spmv_operator(GphrxSpmvOperator *restrict op)
+{
+    if (op->row_offsets != op->col_offsets)
+    {
+        free(op->row_offsets);
+        free(op->row_col_indices);
+    }
+
+    free(op->col_offsets);
+    free(op->row_entries);
+
+    free_dynarr8(&op->col_row_indices);
+
+    if (op->has_entries)
+        free_dynarr8(&op->col_entries);
+}
+
+typedef struct {
+    GphrxSpmvOperator *op;
+    double *x;
+    double *y;
+} SpmvContext;
+
+static FORCEINLINE double gather_sum(double *restrict x, u64 *restrict indices, size_t start, size_t end)
+{
+    double sum = 0.0;
+
+    for (size_t i = start; i < end; ++i)
+        sum += x[indices[i]];
+
+    return sum;
+}
+
+static FORCEINLINE double gather_dot(double *restrict x,
+                                     u64 *restrict indices,
+                                     double *restrict entries,
+                                     size_t start,
+                                     size_t end)
+{
+    double sum = 0.0;
+
+    for (size_t i = start; i < end; ++i)
+        sum += x[indices[i]] * entries[i];
+
+    return sum;
+}
+
+#if defined(SIMD_AVX512)
+static FORCEINLINE TARGET_AVX512 double gather_sum_avx512(double *restrict x,
+                                                          u64 *restrict indices,
+                                                          size_t start,
+                                                          size_t end)
+{
+    size_t i = start;
+    __m512d sums = _mm512_setzero_pd();
+
+    for (; i + 8 <= end; i += 8)
+        sums = _mm512_add_pd(sums, _mm512_i64gather_pd(_mm512_loadu_si512((void*) (indices + i)), x, 8));
+
+    return _mm512_reduce_add_pd(sums) + gather_sum(x, indices, i, end);
+}
+
+static FORCEINLINE TARGET_AVX512 double gather_dot_avx512(double *restrict x,
+                                                          u64 *restrict indices,
+                                                          double *restrict entries,
+                                                          size_t start,
+                                                          size_t end)
+{
+    size_t i = start;
+    __m512d sums = _mm512_setzero_pd();
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m512d values = _mm512_i64gather_pd(_mm512_loadu_si512((void*) (indices + i)), x, 8);
+        sums = _mm512_add_pd(sums, _mm512_mul_pd(values, _mm512_loadu_pd(entries + i)));
+    }
+
+    return _mm512_reduce_add_pd(sums) + gather_dot(x, indices, entries, i, end);
+}
+#endif
+
+#if defined(SIMD_AVX2)
+static FORCEINLINE TARGET_AVX2 double sum_lanes_avx2(__m256d sums)
+{
+    __m128d half_sums = _mm_add_pd(_mm256_castpd256_pd128(sums), _mm256_extractf128_pd(sums, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half_sums, _mm_unpackhi_pd(half_sums, half_sums)));
+}
+
+static FORCEINLINE TARGET_AVX2 double gather_sum_avx2(double *restrict x,
+                                                      u64 *restrict indices,
+                                                      size_t start,
+                                                      size_t end)
+{
+    size_t i = start;
+    __m256d sums = _mm256_setzero_pd();
+
+    for (; i + 4 <= end; i += 4)
+        sums = _mm256_add_pd(sums, _mm256_i64gather_pd(x, _mm256_loadu_si256((__m256i*) (indices + i)), 8));
+
+    return sum_lanes_avx2(sums) + gather_sum(x, indices, i, end);
+}
+
+static FORCEINLINE TARGET_AVX2 double gather_dot_avx2(double *restrict x,
+                                                      u64 *restrict indices,
+                                                      double *restrict entries,
+                                                      size_t start,
+                                                      size_t end)
+{
+    size_t i = start;
+    __m256d sums = _mm256_setzero_pd();
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m256d values = _mm256_i64gather_pd(x, _mm256_loadu_si256((__m256i*) (indices + i)), 8);
+        sums = _mm256_add_pd(sums, _mm256_mul_pd(values, _mm256_loadu_pd(entries + i)));
+    }
+
+    return sum_lanes_avx2(sums) + gather_dot(x, indices, entries, i, end);
+}
+#endif
+
+// Pulls each row's value from its in-edges. It is inlined into a copy for each SIMD level along with that
+// level's gathers, so the gathers aren't indirect calls.
+static FORCEINLINE void pull_row_range(SpmvContext *restrict spmv,
+                                       size_t start_row,
+                                       size_t end_row,
+                                       double (*sum)(double*, u64*, size_t, size_t),
+                                       double (*dot)(double*, u64*, double*, size_t, size_t))
+{
+    GphrxSpmvOperator *op = spmv->op;
+
+    for (size_t row = start_row; row < end_row; ++row)
+    {
+        size_t start = op->row_offsets[row];
+        size_t end = op->row_offsets[row + 1];
+
+        if (op->has_entries)
+            spmv->y[row] = dot(spmv->x, op->row_col_indices, op->row_entries, start, end);
+        else
+            spmv->y[row] = sum(spmv->x, op->row_col_indices, start, end);
+    }
+}
+
+#if defined(SIMD_AVX512)
+static TARGET_AVX512 void pull_row_range_avx512(SpmvContext *restrict spmv, size_t start_row, size_t end_row)
+{
+    pull_row_range(spmv, start_row, end_row, gather_sum_avx512, gather_dot_avx512);
+}
+#endif
+
+#if defined(SIMD_AVX2)
+static TARGET_AVX2 void pull_row_range_avx2(SpmvContext *restrict spmv, size_t start_row, size_t end_row)
+{
+    pull_row_range(spmv, start_row, end_row, gather_sum_avx2, gather_dot_avx2);
+}
+#endif
+
+static void pull_rows(void *context, size_t start_row, size_t end_row, u32 thread_idx)
+{
+    SpmvContext *spmv = context;
+
+#if defined(SIMD_AVX512)
+    if (simd_level() == SIMD_LEVEL_AVX512)
+        pull_row_range_avx512(spmv, start_row, end_row);
+    else
+#endif
+#if defined(SIMD_AVX2)
+    if (simd_level() == SIMD_LEVEL_AVX2)
+        pull_row_range_avx2(spmv, start_row, end_row);
+    else
+#endif
+        pull_row_range(spmv, start_row, end_row, gather_sum, gather_dot);
+}
+
+static void atomic_add_double(double *target, double value)
+{
+    _Atomic u64 *target_bits = (_Atomic u64*) target;
+    u64 expected = atomic_load_explicit(target_bits, memory_order_relaxed);
+
+    for (;;)
+    {
+        double sum;
+        memcpy(&sum, &expected, sizeof(double));
+        sum += value;
+
+        u64 desired;
+        memcpy(&desired, &sum, sizeof(double));
+
+        if (atomic_compare_exchange_weak_explicit(target_bits,
+                                                  &expected,
+                                                  desired,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+            return;
+    }
+}
+
+static void push_cols(void *context, size_t start_col, size_t end_col, u32 thread_idx)
+{
+    SpmvContext *spmv = context;
+    GphrxSpmvOperator *op = spmv->op;
+
+    u64 *row_indices = (u64*) op->col_row_indices.arr;
+    double *entries = (double*) op->col_entries.arr;
+
+    for (size_t col = start_col; col < end_col; ++col)
+    {
+        double value = spmv->x[col];
+
+        if (value == 0.0)
+            continue;
+
+        for (size_t i = op->col_offsets[col]; i < op->col_offsets[col + 1]; ++i)
+            atomic_add_double(spmv->y + row_indices[i], op->has_entries ? value * entries[i] : value);
+    }
+}
+
+static void zero_values(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    SpmvContext *spmv = context;
+    memset(spmv->y + start, 0, (end - start) * sizeof(double));
+}
+
+static void count_active_entries(void *context, size_t start_col, size_t end_col, void *partial)
+{
+    SpmvContext *spmv = context;
+    size_t *active_entry_count = partial;
+
+    for (size_t col = start_col; col < end_col; ++col)
+    {
+        if (spmv->x[col] != 0.0)
+            *active_entry_count += spmv->op->col_offsets[col + 1] - spmv->op->col_offsets[col];
+    }
+}
+
+static void add_counts(void *context, void *accumulator, void *partial)
+{
+    *(size_t*) accumulator += *(size_t*) partial;
+}
+
+DLLEXPORT void gphrx_spmv(GphrxSpmvOperator *restrict op,
+                          double *restrict x,
+                          double *restrict y,
+                          GphrxSpmvDirection direction)
+{
+    SpmvContext context = {
+        .op = op,
+        .x = x,
+        .y = y,
+    };
+
+    if (direction == GPHRX_SPMV_AUTO)
+    {
+        size_t active_entry_count = 0;
+
+        _gphrx_parallel_reduce(0,
+                               op->dimension,
+                               SPMV_SCAN_GRAIN_SIZE,
+                               &active_entry_count,
+                               sizeof(size_t),
+                               count_active_entries,
+                               add_counts,
+                               &context);
+
+        bool is_sparse = active_entry_count < op->entry_count / GPHRX_SPMV_PUSH_RATIO;
+        direction = is_sparse ? GPHRX_SPMV_PUSH : GPHRX_SPMV_PULL;
+    }
+
+    if (direction == GPHRX_SPMV_PUSH)
+    {
+        _gphrx_parallel_for(0, op->dimension, SPMV_SCAN_GRAIN_SIZE, zero_values, &context);
+        _gphrx_parallel_for_balanced(0, op->dimension, op->col_offsets, SPMV_GRAIN_COST, push_cols, &context);
+    }
+    else
+    {
+        _gphrx_parallel_for_balanced(0, op->dimension, op->row_offsets, SPMV_GRAIN_COST, pull_rows, &context);
+    }
+}
+
+
+#ifdef TEST_MODE
+
+#include <math.h>
+
+// Checks every direction of product against a product computed straight from the matrix's lists
+static bool are_products_correct(GphrxSpmvOperator *restrict op,
+                                 DynamicArray8 *restrict col_indices,
+                                 DynamicArray8 *restrict row_indices,
+                                 DynamicArray8 *restrict entries,
+                                 double *restrict x)
+{
+    double *expected = calloc(op->dimension, sizeof(double));
+    double *y = malloc(sizeof(double) * op->dimension);
+
+    for (size_t i = 0; i < col_indices->size; ++i)
+    {
+        double entry = entries != 0 ? dynarr8_get(entries, i).dbl_val : 1.0;
+        expected[dynarr8_get(row_indices, i).u64_val] += entry * x[dynarr8_get(col_indices, i).u64_val];
+    }
+
+    bool is_correct = true;
+
+    for (GphrxSpmvDirection direction = GPHRX_SPMV_AUTO; direction <= GPHRX_SPMV_PULL; ++direction)
+    {
+        // Filled with garbage, which a product must overwrite
+        memset(y, 0x7F, sizeof(double) * op->dimension);
+
+        gphrx_spmv(op, x, y, direction);
+
+        for (u64 v = 0; v < op->dimension; ++v)
+            is_correct = is_correct && fabs(y[v] - expected[v]) <= 1e-9 * (1.0 + fabs(expected[v]));
+    }
+
+    free(expected);
+    free(y);
+
+    return is_correct;
+}
+
+static TEST_RESULT test_gphrx_spmv()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+            u64 rng_state = 5 + is_undirected;
+
+            for (u32 i = 0; i < 20000; ++i)
+            {
+                // Skewed so that some vertices have many more in-edges than others
+                u64 to = test_random(&rng_state) % 3000;
+                gphrx_add_edge(&graph, test_random(&rng_state) % 3000, to * to % 3000);
+            }
+
+            GphrxSpmvOperator op = new_gphrx_spmv_operator(&graph);
+            assert(op.dimension == graph.adjacency_matrix.dimension, "Incorrect operator dimension");
+
+            double *x = calloc(op.dimension, sizeof(double));
+
+            // A sparse input is pushed by GPHRX_SPMV_AUTO, and a dense one pulled
+            x[17] = 1.5;
+            x[2021] = -0.25;
+            assert(are_products_correct(&op, &graph.adjacency_matrix.col_indices,
+                                        &graph.adjacency_matrix.row_indices, 0, x), "Incorrect product");
+
+            for (u64 v = 0; v < op.dimension; ++v)
+                x[v] = (double) (test_random(&rng_state) % 1000) / 100.0;
+
+            assert(are_products_correct(&op, &graph.adjacency_matrix.col_indices,
+                                        &graph.adjacency_matrix.row_indices, 0, x), "Incorrect product");
+
+            // The operator shares the graph's lists, so it is unaffected by later changes to the graph
+            GphrxCsrMatrix matrix = gphrx_find_avg_pool_matrix(&graph, 7);
+            gphrx_add_edge(&graph, 0, 1);
+            free_gphrx(&graph);
+
+            double *expected = malloc(sizeof(double) * op.dimension);
+            double *y = malloc(sizeof(double) * op.dimension);
+
+            gphrx_spmv(&op, x, expected, GPHRX_SPMV_PUSH);
+
+            GphrxSpmvOperator matrix_op = new_gphrx_spmv_operator_from_matrix(&matrix);
+            assert(matrix_op.dimension == matrix.dimension, "Incorrect operator dimension");
+
+            // Pulls gather with every SIMD level the CPU supports, down to none
+            for (SimdLevel level = SIMD_LEVEL_NONE; level <= SIMD_LEVEL_AVX512; ++level)
+            {
+                cap_simd_level(level);
+
+                gphrx_spmv(&op, x, y, GPHRX_SPMV_PULL);
+
+                for (u64 v = 0; v < op.dimension; ++v)
+                    assert(fabs(y[v] - expected[v]) <= 1e-9 * (1.0 + fabs(expected[v])), "Incorrect product");
+
+                assert(are_products_correct(&matrix_op, &matrix.col_indices, &matrix.row_indices, &matrix.entries, x),
+                       "Incorrect product");
+            }
+
+            cap_simd_level(SIMD_LEVEL_AVX512);
+
+            // Nor is the matrix's operator affected by thresholding and scaling the matrix in place
+            gphrx_spmv(&matrix_op, x, expected, GPHRX_SPMV_PUSH);
+            gphrx_csr_matrix_threshold_and_scale(&matrix, 2.0 / 49.0, 3.0);
+
+            for (GphrxSpmvDirection direction = GPHRX_SPMV_AUTO; direction <= GPHRX_SPMV_PULL; ++direction)
+            {
+                gphrx_spmv(&matrix_op, x, y, direction);
+
+                for (u64 v = 0; v < matrix_op.dimension; ++v)
+                    assert(fabs(y[v] - expected[v]) <= 1e-9 * (1.0 + fabs(expected[v])), "Incorrect product");
+            }
+
+            free_gphrx_spmv_operator(&op);
+
+            free_gphrx_spmv_operator(&matrix_op);
+            free_gphrx_csr_matrix(&matrix);
+
+            free(x);
+            free(expected);
+            free(y);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // An empty graph has an empty operator
+    GphrxGraph empty_graph = new_directed_gphrx();
+    GphrxSpmvOperator empty_op = new_gphrx_spmv_operator(&empty_graph);
+
+    gphrx_spmv(&empty_op, 0, 0, GPHRX_SPMV_AUTO);
+
+    free_gphrx_spmv_operator(&empty_op);
+    free_gphrx(&empty_graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet spmv_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_spmv);
+
+    return set;
+}
+
+#endif
@@ -0,0 +1,871 @@
+#include "sssp.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "dynarray.h"
+#include "threadpool.h"
+
+// Bucket vertices per range of a relaxation pass, and frontier vertices per range of the parent pass
+#define RELAX_GRAIN_SIZE 64
+#define PARENT_GRAIN_SIZE 64
+
+// Buckets each thread keeps a list for, starting at the current bucket. Vertices that land further ahead wait
+// in one overflow list until the buckets catch up with them, so a single heavy edge can't make a search
+// allocate a list for every bucket it skips over.
+#define BUCKET_WINDOW 64
+
+// A thread keeps relaxing its own share of the current bucket without waiting for the other threads while
+// the share is smaller than this
+#define LOCAL_BUCKET_LIMIT 1000
+
+// Bucket numbers are capped so that they fit in a u64 however small delta is. Vertices past the cap share
+// the last bucket, which is still relaxed until it empties.
+#define MAX_BUCKET ((u64) 1 << 62)
+
+// Precision of a graph without weights, on which every edge weighs one
+#define UNIT_WEIGHTS 0
+
+typedef struct {
+    GPHRX_CACHE_ALIGNED DynamicArrayU64 buckets[BUCKET_WINDOW];
+    DynamicArrayU64 overflow;
+    DynamicArrayU64 scratch;
+
+    // Lowest bucket the vertices in `overflow` were put in. The window can't move past it until they are
+    // moved into the buckets.
+    u64 overflow_bucket;
+} SsspThreadState;
+
+typedef struct {
+    u32 thread_count;
+    u64 vertex_count;
+
+    GphrxWeightPrecision precision;
+    double inv_delta;
+    double max_distance;
+
+    // Bucket being relaxed. Bucket b holds the vertices with tentative distances in [b * delta, (b + 1) *
+    // delta), in the list `buckets[b % BUCKET_WINDOW]` of whichever thread lowered their distance.
+    u64 bucket;
+
+    u64 dimension;
+    size_t *offsets;
+    u64 *edges;
+    void *weights;
+
+    // Tentative distances, as the bits of non-negative doubles (which sort in the same order as the doubles)
+    _Atomic u64 *distances;
+
+    DynamicArrayU64 frontier;
+
+    // Vertices given a parent so far by the parent pass
+    _Atomic u64 *visited;
+
+    double *result_distances;
+    u64 *parents;
+    u64 *nearest_sources;
+
+    SsspThreadState *threads;
+} SsspSearch;
+
+static FORCEINLINE u64 distance_to_bits(double distance)
+{
+    u64 bits;
+    memcpy(&bits, &distance, sizeof(u64));
+    return bits;
+}
+
+static FORCEINLINE double bits_to_distance(u64 bits)
+{
+    double distance;
+    memcpy(&distance, &bits, sizeof(u64));
+    return distance;
+}
+
+static FORCEINLINE u64 bucket_of(SsspSearch *restrict search, double distance)
+{
+    double bucket = distance * search->inv_delta;
+    return bucket < (double) MAX_BUCKET ? (u64) bucket : MAX_BUCKET;
+}
+
+static FORCEINLINE double edge_weight(SsspSearch *restrict search, size_t edge, GphrxWeightPrecision precision)
+{
+    if (precision == GPHRX_WEIGHT_F32)
+        return (double) ((float*) search->weights)[edge];
+    else if (precision == GPHRX_WEIGHT_F64)
+        return ((double*) search->weights)[edge];
+    else
+        return 1.0;
+}
+
+static void push_to_bucket(SsspSearch *restrict search, SsspThreadState *restrict state, u64 v, double distance)
+{
+    // A lowered distance is never below the current bucket, since it is a distance in the current bucket or
+    // above plus a non-negative weight
+    u64 bucket = bucket_of(search, distance);
+
+    if (bucket - search->bucket < BUCKET_WINDOW)
+        dynarr_u64_push(state->buckets + bucket % BUCKET_WINDOW, v);
+    else
+    {
+        dynarr_u64_push(&state->overflow, v);
+
+        if (bucket < state->overflow_bucket)
+            state->overflow_bucket = bucket;
+    }
+}
+
+static FORCEINLINE void relax_vertices_with(SsspSearch *restrict search,
+                                            SsspThreadState *restrict state,
+                                            u64 *vertices,
+                                            size_t count,
+                                            GphrxWeightPrecision precision)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        u64 u = vertices[i];
+        double distance = bits_to_distance(atomic_load_explicit(search->distances + u, memory_order_relaxed));
+
+        // The vertex's distance was lowered into an earlier bucket after it was put in this one, so it has
+        // already been relaxed
+        if (bucket_of(search, distance) < search->bucket)
+            continue;
+
+        for (size_t edge = search->offsets[u]; edge < search->offsets[u + 1]; ++edge)
+        {
+            double new_distance = distance + edge_weight(search, edge, precision);
+
+            if (!(new_distance <= search->max_distance))
+                continue;
+
+            u64 v = search->edges[edge];
+            u64 new_bits = distance_to_bits(new_distance);
+            u64 old_bits = atomic_load_explicit(search->distances + v, memory_order_relaxed);
+
+            while (new_bits < old_bits)
+            {
+                if (atomic_compare_exchange_weak_explicit(search->distances + v,
+                                                          &old_bits,
+                                                          new_bits,
+                                                          memory_order_relaxed,
+                                                          memory_order_relaxed))
+                {
+                    push_to_bucket(search, state, v, new_distance);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static void relax_vertices(SsspSearch *restrict search, SsspThreadState *restrict state, u64 *vertices, size_t count)
+{
+    if (search->precision == GPHRX_WEIGHT_F32)
+        relax_vertices_with(search, state, vertices, count, GPHRX_WEIGHT_F32);
+    else if (search->precision == GPHRX_WEIGHT_F64)
+        relax_vertices_with(search, state, vertices, count, GPHRX_WEIGHT_F64);
+    else
+        relax_vertices_with(search, state, vertices, count, UNIT_WEIGHTS);
+}
+
+static void relax_bucket(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    SsspSearch *search = context;
+    SsspThreadState *state = search->threads + thread_idx;
+
+    relax_vertices(search, state, search->frontier.arr + start, end - start);
+
+    // Vertices this thread put back in the current bucket are relaxed here, without waiting for the other
+    // threads, until there are enough of them to be worth sharing
+    DynamicArrayU64 *bucket = state->buckets + search->bucket % BUCKET_WINDOW;
+
+    while (bucket->size != 0 && bucket->size < LOCAL_BUCKET_LIMIT)
+    {
+        DynamicArrayU64 vertices = *bucket;
+        *bucket = state->scratch;
+        state->scratch = vertices;
+
+        relax_vertices(search, state, state->scratch.arr, state->scratch.size);
+        state->scratch.size = 0;
+    }
+}
+
+// Returns the lowest non-empty bucket in the window below `limit`, or UINT64_MAX if there is none
+static u64 find_window_bucket(SsspSearch *restrict search, u64 limit)
+{
+    for (u64 bucket = search->bucket; bucket < search->bucket + BUCKET_WINDOW && bucket < limit; ++bucket)
+    {
+        for (u32 i = 0; i < search->thread_count; ++i)
+        {
+            if (search->threads[i].buckets[bucket % BUCKET_WINDOW].size != 0)
+                return bucket;
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+// Moves the search to the lowest non-empty bucket, returning false once every bucket is empty
+static bool advance_bucket(SsspSearch *restrict search)
+{
+    u64 overflow_bucket = UINT64_MAX;
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+    {
+        if (search->threads[i].overflow_bucket < overflow_bucket)
+            overflow_bucket = search->threads[i].overflow_bucket;
+    }
+
+    u64 lowest_bucket = find_window_bucket(search, overflow_bucket);
+
+    if (lowest_bucket != UINT64_MAX)
+    {
+        search->bucket = lowest_bucket;
+        return true;
+    }
+
+    if (overflow_bucket == UINT64_MAX)
+        return false;
+
+    // The window is empty up to the lowest bucket an overflowing vertex could be in, so the window is moved
+    // to start at the lowest bucket either holds, and the overflowing vertices that then fall in the window
+    // are moved into their buckets. Vertices whose distances were lowered into a bucket that has already
+    // been relaxed are dropped; they were pushed again when their distances were lowered.
+    u64 previous_bucket = search->bucket;
+    lowest_bucket = find_window_bucket(search, UINT64_MAX);
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+    {
+        DynamicArrayU64 *overflow = &search->threads[i].overflow;
+
+        for (size_t j = 0; j < overflow->size; ++j)
+        {
+            u64 bucket = bucket_of(search, bits_to_distance(search->distances[overflow->arr[j]]));
+
+            if (bucket >= previous_bucket && bucket < lowest_bucket)
+                lowest_bucket = bucket;
+        }
+    }
+
+    search->bucket = lowest_bucket;
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+    {
+        SsspThreadState *state = search->threads + i;
+        size_t kept_count = 0;
+
+        state->overflow_bucket = UINT64_MAX;
+
+        for (size_t j = 0; j < state->overflow.size; ++j)
+        {
+            u64 v = state->overflow.arr[j];
+            u64 bucket = bucket_of(search, bits_to_distance(search->distances[v]));
+
+            if (bucket < previous_bucket || lowest_bucket == UINT64_MAX)
+                continue;
+
+            if (bucket - lowest_bucket < BUCKET_WINDOW)
+            {
+                dynarr_u64_push(state->buckets + bucket % BUCKET_WINDOW, v);
+            }
+            else
+            {
+                state->overflow.arr[kept_count++] = v;
+
+                if (bucket < state->overflow_bucket)
+                    state->overflow_bucket = bucket;
+            }
+        }
+
+        state->overflow.size = kept_count;
+    }
+
+    return lowest_bucket != UINT64_MAX;
+}
+
+// Gathers every thread's list for the current bucket into the frontier and empties the lists
+static void gather_bucket(SsspSearch *restrict search)
+{
+    size_t size = 0;
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+        size += search->threads[i].buckets[search->bucket % BUCKET_WINDOW].size;
+
+    search->frontier.size = 0;
+    dynarr_u64_reserve(&search->frontier, size);
+
+    for (u32 i = 0; i < search->thread_count; ++i)
+    {
+        DynamicArrayU64 *bucket = search->threads[i].buckets + search->bucket % BUCKET_WINDOW;
+
+        dynarr_u64_append(&search->frontier, bucket->arr, bucket->size);
+        bucket->size = 0;
+    }
+}
+
+// Gives the vertices that the frontier's edges lead to along shortest paths the frontier as their parents.
+// Every distance was set from a settled distance plus the weight of an edge, so the sum is reproduced exactly
+// here.
+static void expand_shortest_path_edges(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    SsspSearch *search = context;
+    SsspThreadState *state = search->threads + thread_idx;
+
+    for (size_t i = start; i < end; ++i)
+    {
+        u64 u = search->frontier.arr[i];
+
+        if (u >= search->dimension)
+            continue;
+
+        double distance = search->result_distances[u];
+
+        for (size_t edge = search->offsets[u]; edge < search->offsets[u + 1]; ++edge)
+        {
+            u64 v = search->edges[edge];
+            double v_distance = bits_to_distance(atomic_load_explicit(search->distances + v, memory_order_relaxed));
+
+            if (v_distance == INFINITY || distance + edge_weight(search, edge, search->precision) != v_distance)
+                continue;
+
+            if (!_gphrx_atomic_bitmap_try_set(search->visited, v))
+                continue;
+
+            search->result_distances[v] = v_distance;
+            search->parents[v] = u;
+            search->nearest_sources[v] = search->nearest_sources[u];
+
+            dynarr_u64_push(&state->scratch, v);
+        }
+    }
+}
+
+static GphrxSsspResult find_shortest_paths(GphrxCsrAdjacencyMatrix *restrict matrix,
+                                           GphrxWeightPrecision precision,
+                                           void *weights,
+                                           u64 *source_vertex_ids,
+                                           u64 source_count,
+                                           double delta,
+                                           double max_distance)
+{
+    // Sources past the highest vertex ID are vertices without edges
+    u64 vertex_count = matrix->dimension;
+
+    for (u64 i = 0; i < source_count; ++i)
+    {
+        if (source_vertex_ids[i] >= vertex_count)
+            vertex_count = source_vertex_ids[i] + 1;
+    }
+
+    GphrxSsspResult result = {
+        .vertex_count = vertex_count,
+        .reached_count = 0,
+        .distances = malloc(sizeof(double) * vertex_count),
+        .parents = malloc(sizeof(u64) * vertex_count),
+        .nearest_sources = malloc(sizeof(u64) * vertex_count),
+    };
+
+    assert(result.distances != 0 && result.parents != 0 && result.nearest_sources != 0, "malloc failure");
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        result.distances[v] = INFINITY;
+
+    memset(result.parents, 0xFF, sizeof(u64) * vertex_count);
+    memset(result.nearest_sources, 0xFF, sizeof(u64) * vertex_count);
+
+    size_t edge_count = matrix->col_indices.size;
+
+    if (!(delta > 0.0))
+    {
+        double weight_sum = 0.0;
+
+        if (precision == GPHRX_WEIGHT_F32)
+        {
+            for (size_t edge = 0; edge < edge_count; ++edge)
+                weight_sum += ((float*) weights)[edge];
+        }
+        else if (precision == GPHRX_WEIGHT_F64)
+        {
+            for (size_t edge = 0; edge < edge_count; ++edge)
+                weight_sum += ((double*) weights)[edge];
+        }
+        else
+        {
+            weight_sum = (double) edge_count;
+        }
+
+        // Buckets about as wide as the weight of the lightest of a vertex's edges keep the work close to
+        // Dijkstra's algorithm while still settling many vertices per bucket
+        double mean_degree = matrix->dimension != 0 ? (double) edge_count / (double) matrix->dimension : 1.0;
+
+        delta = edge_count != 0 && weight_sum > 0.0 ? weight_sum / (double) edge_count : 1.0;
+        delta /= mean_degree > 1.0 ? mean_degree : 1.0;
+    }
+
+    u32 thread_count = gphrx_get_num_threads();
+    u64 word_count = (vertex_count + 63) / 64;
+
+    SsspSearch search = {
+        .thread_count = thread_count,
+        .vertex_count = vertex_count,
+        .precision = precision,
+        .inv_delta = 1.0 / delta,
+        .max_distance = max_distance,
+        .bucket = 0,
+        .dimension = matrix->dimension,
+        .offsets = _gphrx_find_vertex_edge_offsets(matrix),
+        .edges = (u64*) matrix->row_indices.arr,
+        .weights = weights,
+        .distances = malloc(sizeof(u64) * vertex_count),
+        .frontier = new_dynarr_u64_with_capacity(source_count + 1),
+        .visited = calloc(word_count + 1, sizeof(u64)),
+        .result_distances = result.distances,
+        .parents = result.parents,
+        .nearest_sources = result.nearest_sources,
+        .threads = _gphrx_new_thread_states(sizeof(SsspThreadState), thread_count),
+    };
+
+    assert(search.distances != 0 && search.visited != 0, "malloc failure");
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        for (u32 j = 0; j < BUCKET_WINDOW; ++j)
+            search.threads[i].buckets[j] = new_dynarr_u64_with_capacity(16);
+
+        search.threads[i].overflow = new_dynarr_u64_with_capacity(16);
+        search.threads[i].scratch = new_dynarr_u64_with_capacity(16);
+        search.threads[i].overflow_bucket = UINT64_MAX;
+    }
+
+    u64 unreached_bits = distance_to_bits(INFINITY);
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        atomic_init(search.distances + v, unreached_bits);
+
+    for (u64 i = 0; i < source_count; ++i)
+    {
+        u64 source = source_vertex_ids[i];
+
+        if (atomic_load(search.distances + source) == 0)
+            continue;
+
+        atomic_store(search.distances + source, 0);
+
+        if (source < matrix->dimension)
+            dynarr_u64_push(search.threads[0].buckets, source);
+    }
+
+    while (advance_bucket(&search))
+    {
+        gather_bucket(&search);
+        _gphrx_parallel_for(0, search.frontier.size, RELAX_GRAIN_SIZE, relax_bucket, &search);
+    }
+
+    // The parent pass runs breadth-first from the sources over the edges that lie on shortest paths
+    search.frontier.size = 0;
+
+    for (u64 i = 0; i < source_count; ++i)
+    {
+        u64 source = source_vertex_ids[i];
+
+        if (!_gphrx_atomic_bitmap_try_set(search.visited, source))
+            continue;
+
+        result.distances[source] = 0.0;
+        result.parents[source] = source;
+        result.nearest_sources[source] = source;
+
+        dynarr_u64_push(&search.frontier, source);
+    }
+
+    while (search.frontier.size != 0)
+    {
+        result.reached_count += search.frontier.size;
+
+        _gphrx_parallel_for(0, search.frontier.size, PARENT_GRAIN_SIZE, expand_shortest_path_edges, &search);
+
+        search.frontier.size = 0;
+
+        for (u32 i = 0; i < thread_count; ++i)
+        {
+            DynamicArrayU64 *scratch = &search.threads[i].scratch;
+
+            dynarr_u64_append(&search.frontier, scratch->arr, scratch->size);
+            scratch->size = 0;
+        }
+    }
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        for (u32 j = 0; j < BUCKET_WINDOW; ++j)
+            free_dynarr_u64(search.threads[i].buckets + j);
+
+        free_dynarr_u64(&search.threads[i].overflow);
+        free_dynarr_u64(&search.threads[i].scratch);
+    }
+
+    free_dynarr_u64(&search.frontier);
+
+    free(search.offsets);
+    free(search.distances);
+    free(search.visited);
+    free(search.threads);
+
+    return result;
+}
+
+DLLEXPORT GphrxSsspResult wgphrx_sssp(GphrxWeightedGraph *restrict graph,
+                                      u64 source_vertex_id,
+                                      double delta,
+                                      double max_distance)
+{
+    return wgphrx_multi_source_sssp(graph, &source_vertex_id, 1, delta, max_distance);
+}
+
+DLLEXPORT GphrxSsspResult wgphrx_multi_source_sssp(GphrxWeightedGraph *restrict graph,
+                                                   u64 *source_vertex_ids,
+                                                   u64 source_count,
+                                                   double delta,
+                                                   double max_distance)
+{
+    void *weights = graph->precision == GPHRX_WEIGHT_F32
+        ? (void*) graph->weights.f32.arr
+        : (void*) graph->weights.f64.arr;
+
+    return find_shortest_paths(&graph->adjacency_matrix,
+                               graph->precision,
+                               weights,
+                               source_vertex_ids,
+                               source_count,
+                               delta,
+                               max_distance);
+}
+
+DLLEXPORT GphrxSsspResult gphrx_sssp(GphrxGraph *restrict graph, u64 source_vertex_id, double delta, double max_distance)
+{
+    return gphrx_multi_source_sssp(graph, &source_vertex_id, 1, delta, max_distance);
+}
+
+DLLEXPORT GphrxSsspResult gphrx_multi_source_sssp(GphrxGraph *restrict graph,
+                                                  u64 *source_vertex_ids,
+                                                  u64 source_count,
+                                                  double delta,
+                                                  double max_distance)
+{
+    return find_shortest_paths(&graph->adjacency_matrix,
+                               UNIT_WEIGHTS,
+                               0,
+                               source_vertex_ids,
+                               source_count,
+                               delta,
+                               max_distance);
+}
+
+DLLEXPORT void free_gphrx_sssp_result(GphrxSsspResult *restrict result)
+{
+    free(result->distances);
+    free(result->parents);
+    free(result->nearest_sources);
+}
+
+
+#ifdef TEST_MODE
+
+// Random edges with whole-number weights from zero to `max_weight`, so that every distance is exact. The
+// weighted graph and the unweighted graph have the same edges.
+static void new_random_test_graphs(bool is_undirected,
+                                   GphrxWeightPrecision precision,
+                                   u64 vertex_count,
+                                   size_t edge_count,
+                                   u64 max_weight,
+                                   u64 seed,
+                                   GphrxWeightedGraph *restrict weighted_graph,
+                                   GphrxGraph *restrict graph)
+{
+    *weighted_graph = is_undirected ? new_undirected_wgphrx(precision) : new_directed_wgphrx(precision);
+    *graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+    u64 rng_state = seed;
+
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        u64 from_vertex_id = test_random(&rng_state) % vertex_count;
+        u64 to_vertex_id = test_random(&rng_state) % vertex_count;
+        double weight = (double) (test_random(&rng_state) % (max_weight + 1));
+
+        wgphrx_add_edge(weighted_graph, from_vertex_id, to_vertex_id, weight);
+        gphrx_add_edge(graph, from_vertex_id, to_vertex_id);
+    }
+}
+
+// Distances from the nearest of the sources by a plain serial Dijkstra's algorithm
+static double *find_expected_distances(GphrxWeightedGraph *restrict graph,
+                                       u64 vertex_count,
+                                       u64 *source_vertex_ids,
+                                       u64 source_count)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    size_t *offsets = _gphrx_find_vertex_edge_offsets(matrix);
+
+    double *distances = malloc(sizeof(double) * vertex_count);
+    bool *is_settled = calloc(vertex_count, sizeof(bool));
+
+    for (u64 v = 0; v < vertex_count; ++v)
+        distances[v] = INFINITY;
+
+    for (u64 i = 0; i < source_count; ++i)
+        distances[source_vertex_ids[i]] = 0.0;
+
+    while (true)
+    {
+        u64 u = UINT64_MAX;
+
+        for (u64 v = 0; v < vertex_count; ++v)
+        {
+            if (!is_settled[v] && distances[v] != INFINITY && (u == UINT64_MAX || distances[v] < distances[u]))
+                u = v;
+        }
+
+        if (u == UINT64_MAX)
+            break;
+
+        is_settled[u] = true;
+
+        if (u >= matrix->dimension)
+            continue;
+
+        for (size_t edge = offsets[u]; edge < offsets[u + 1]; ++edge)
+        {
+            u64 v = dynarr8_get(&matrix->row_indices, edge).u64_val;
+            double weight = graph->precision == GPHRX_WEIGHT_F32
+                ? (double) dynarr4_get(&graph->weights.f32, edge).flt_val
+                : dynarr8_get(&graph->weights.f64, edge).dbl_val;
+
+            if (distances[u] + weight < distances[v])
+                distances[v] = distances[u] + weight;
+        }
+    }
+
+    free(offsets);
+    free(is_settled);
+
+    return distances;
+}
+
+// Checks a search's distances against Dijkstra's algorithm (leaving out those past `max_distance`), and that
+// following the parents from any reached vertex leads along edges of the graph, one shortest-path edge at a
+// time, to its nearest source
+static bool is_sssp_correct(GphrxWeightedGraph *restrict graph,
+                            GphrxSsspResult *restrict result,
+                            u64 *source_vertex_ids,
+                            u64 source_count,
+                            double max_distance)
+{
+    double *expected = find_expected_distances(graph, result->vertex_count, source_vertex_ids, source_count);
+
+    u64 reached_count = 0;
+    bool is_correct = true;
+
+    for (u64 v = 0; v < result->vertex_count && is_correct; ++v)
+    {
+        if (expected[v] > max_distance)
+            expected[v] = INFINITY;
+
+        is_correct = result->distances[v] == expected[v];
+
+        if (!is_correct)
+            break;
+
+        if (expected[v] == INFINITY)
+        {
+            is_correct = result->parents[v] == GPHRX_UNREACHED && result->nearest_sources[v] == GPHRX_UNREACHED;
+            continue;
+        }
+
+        ++reached_count;
+
+        u64 u = v;
+
+        for (u64 steps = 0; steps < result->vertex_count && result->parents[u] != u && is_correct; ++steps)
+        {
+            u64 parent = result->parents[u];
+            GphrxErrorCode error;
+
+            is_correct = parent < result->vertex_count &&
+                result->nearest_sources[parent] == result->nearest_sources[v] &&
+                result->distances[parent] + wgphrx_get_edge_weight(graph, parent, u, &error) == result->distances[u] &&
+                error == GPHRX_NO_ERROR;
+
+            u = parent;
+        }
+
+        is_correct = is_correct && result->parents[u] == u && result->nearest_sources[v] == u &&
+            result->distances[u] == 0.0;
+    }
+
+    is_correct = is_correct && result->reached_count == reached_count;
+
+    free(expected);
+
+    return is_correct;
+}
+
+static TEST_RESULT test_wgphrx_sssp()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    // Deltas below the smallest weight, the default, and past the largest weight (a single bucket). The
+    // smallest makes most vertices overflow the bucket window.
+    double deltas[] = { 0.25, 0.0, 1000.0 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxWeightPrecision precision = is_undirected ? GPHRX_WEIGHT_F32 : GPHRX_WEIGHT_F64;
+
+            GphrxWeightedGraph weighted_graph;
+            GphrxGraph graph;
+
+            new_random_test_graphs(is_undirected, precision, 1500, 6000, 20, 5 + is_undirected, &weighted_graph, &graph);
+
+            for (u32 d = 0; d < sizeof(deltas) / sizeof(deltas[0]); ++d)
+            {
+                for (u64 source = 0; source < 1500; source += 499)
+                {
+                    GphrxSsspResult result = wgphrx_sssp(&weighted_graph, source, deltas[d], INFINITY);
+
+                    assert(result.vertex_count == weighted_graph.adjacency_matrix.dimension, "Incorrect vertex count");
+                    assert(is_sssp_correct(&weighted_graph, &result, &source, 1, INFINITY), "Incorrect search");
+
+                    free_gphrx_sssp_result(&result);
+                }
+
+                u64 sources[] = { 3, 700, 1400, 700 };
+
+                GphrxSsspResult result = wgphrx_multi_source_sssp(&weighted_graph, sources, 4, deltas[d], INFINITY);
+                assert(is_sssp_correct(&weighted_graph, &result, sources, 4, INFINITY), "Incorrect search");
+                free_gphrx_sssp_result(&result);
+
+                // Vertices past the limit are left unreached
+                result = wgphrx_multi_source_sssp(&weighted_graph, sources, 4, deltas[d], 12.0);
+                assert(is_sssp_correct(&weighted_graph, &result, sources, 4, 12.0), "Incorrect search");
+                assert(result.reached_count < result.vertex_count, "Incorrect search");
+                free_gphrx_sssp_result(&result);
+            }
+
+            // Unit weights give the same distances as a breadth-first search
+            GphrxSsspResult result = gphrx_sssp(&graph, 17, 0.0, INFINITY);
+            GphrxBfsResult bfs_result = gphrx_bfs(&graph, 17);
+
+            assert(result.vertex_count == bfs_result.vertex_count, "Incorrect vertex count");
+            assert(result.reached_count == bfs_result.reached_count, "Incorrect reached count");
+
+            for (u64 v = 0; v < result.vertex_count; ++v)
+            {
+                double expected = bfs_result.distances[v] == GPHRX_UNREACHED
+                    ? INFINITY
+                    : (double) bfs_result.distances[v];
+
+                assert(result.distances[v] == expected, "Incorrect search");
+            }
+
+            free_gphrx_sssp_result(&result);
+            free_gphrx_bfs_result(&bfs_result);
+
+            free_wgphrx(&weighted_graph);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // A cycle of zero-weight edges gets parents that form a tree
+    GphrxWeightedGraph cycle = new_directed_wgphrx(GPHRX_WEIGHT_F64);
+
+    wgphrx_add_edge(&cycle, 0, 1, 2.0);
+    wgphrx_add_edge(&cycle, 1, 2, 0.0);
+    wgphrx_add_edge(&cycle, 2, 3, 0.0);
+    wgphrx_add_edge(&cycle, 3, 1, 0.0);
+    wgphrx_add_edge(&cycle, 3, 4, 0.5);
+    wgphrx_add_edge(&cycle, 0, 4, 3.0);
+
+    u64 source = 0;
+    GphrxSsspResult result = wgphrx_sssp(&cycle, source, 0.0, INFINITY);
+
+    assert(is_sssp_correct(&cycle, &result, &source, 1, INFINITY), "Incorrect search");
+    assert(result.distances[3] == 2.0 && result.distances[4] == 2.5, "Incorrect search");
+    assert(result.parents[1] == 0 && result.parents[4] == 3, "Incorrect search");
+
+    free_gphrx_sssp_result(&result);
+
+    // A source past the end of the graph is an isolated vertex
+    result = wgphrx_sssp(&cycle, 10, 0.0, INFINITY);
+    assert(result.vertex_count == 11 && result.reached_count == 1, "Incorrect search");
+    assert(result.distances[10] == 0.0 && result.distances[0] == INFINITY, "Incorrect search");
+    free_gphrx_sssp_result(&result);
+
+    free_wgphrx(&cycle);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_sssp_on_approximation()
+{
+    GphrxWeightedGraph weighted_graph;
+    GphrxGraph graph;
+
+    new_random_test_graphs(true, GPHRX_WEIGHT_F64, 1000, 8000, 9, 11, &weighted_graph, &graph);
+
+    // Shift the weights to [1, 10] so that the smallest weight is one
+    for (size_t edge = 0; edge < weighted_graph.weights.f64.size; ++edge)
+        weighted_graph.weights.f64.arr[edge].dbl_val += 1.0;
+
+    GphrxGraph approx_graph = approximate_gphrx(&graph, 10, 0.01);
+
+    GphrxSsspResult result = wgphrx_sssp(&weighted_graph, 5, 0.0, INFINITY);
+    GphrxSsspResult approx_result = gphrx_sssp(&approx_graph, 5 / 10, 1.0, INFINITY);
+
+    // Every edge falls in a block that is kept at this threshold, so a vertex is at least as far from the
+    // source as its block is from the source's block
+    for (u64 v = 0; v < result.vertex_count; ++v)
+        assert(approx_result.distances[v / 10] <= result.distances[v], "Incorrect search");
+
+    // Bounding the search on the full graph by the approximation keeps every vertex within the bound
+    double max_distance = 4.0 * approx_result.distances[999 / 10];
+    GphrxSsspResult bounded_result = wgphrx_sssp(&weighted_graph, 5, 0.0, max_distance);
+
+    for (u64 v = 0; v < result.vertex_count; ++v)
+    {
+        double expected = result.distances[v] <= max_distance ? result.distances[v] : INFINITY;
+        assert(bounded_result.distances[v] == expected, "Incorrect search");
+    }
+
+    free_gphrx_sssp_result(&result);
+    free_gphrx_sssp_result(&approx_result);
+    free_gphrx_sssp_result(&bounded_result);
+    free_wgphrx(&weighted_graph);
+    free_gphrx(&graph);
+    free_gphrx(&approx_graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet sssp_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_wgphrx_sssp);
+    register_test(&set, test_gphrx_sssp_on_approximation);
+
+    return set;
+}
+
+#endif
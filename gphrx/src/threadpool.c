@@ -0,0 +1,946 @@
+#include "threadpool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// Number of ranges a loop is split into per thread. More ranges balance uneven work better at the cost of
+// more handoffs.
+#define RANGES_PER_THREAD 4
+
+// Number of chunks a work-stealing loop is split into per thread. Stealing takes half of a queue at a
+// time, so a thread that falls behind can shed most of its chunks in a few steals.
+#define CHUNKS_PER_THREAD 16
+
+// Runs a thread's share of a job. Every thread in the pool (and the thread that posted the job) calls the
+// runner once and the job is complete when all the calls have returned.
+typedef void (*JobRunner)(void *job, u32 thread_idx);
+
+typedef struct {
+    GphrxParallelForFunc func;
+    void *context;
+    size_t start;
+    size_t end;
+    size_t range_size;
+    size_t range_count;
+    atomic_size_t next_range;
+} ParallelJob;
+
+// A thread's queue of chunks in a work-stealing loop. The queue is a contiguous run of chunk indices
+// [head, tail), packed into one word (tail in the upper 32 bits) so that the owner taking from the head
+// and thieves taking from the tail synchronize with a single compare-and-swap. Chunk indices are never
+// reused within a loop, so a stale compare-and-swap cannot succeed.
+typedef struct {
+    GPHRX_CACHE_ALIGNED _Atomic u64 chunks;
+} WorkDeque;
+
+typedef struct {
+    GphrxParallelForFunc func;
+    void *context;
+    size_t *chunk_bounds;
+    u32 thread_count;
+    WorkDeque *deques;
+} StealingJob;
+
+// Everything below is guarded by pool_lock. A single job runs at a time; a loop that finds the pool busy
+// runs on its own thread rather than queueing, so concurrent callers never oversubscribe the machine.
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_posted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_finished = PTHREAD_COND_INITIALIZER;
+static pthread_once_t fork_handlers_once = PTHREAD_ONCE_INIT;
+
+static pthread_t *workers = 0;
+static u32 worker_count = 0;
+static u32 requested_thread_count = 0;
+static u32 default_thread_count = 0;
+
+static bool is_job_running = false;
+static bool is_shutting_down = false;
+static u64 job_generation = 0;
+static u64 workers_start_generation = 0;
+static u32 busy_worker_count = 0;
+static JobRunner current_runner = 0;
+static void *current_job = 0;
+
+static _Thread_local bool is_pool_worker = false;
+
+static u32 find_default_thread_count()
+{
+    char *env_value = getenv(GPHRX_NUM_THREADS_ENV_VAR);
+
+    if (env_value)
+    {
+        char *end;
+        unsigned long parsed = strtoul(env_value, &end, 10);
+
+        if (end != env_value && *end == '\0' && parsed > 0 && parsed <= UINT32_MAX)
+            return (u32) parsed;
+    }
+
+    long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return processor_count > 0 ? (u32) processor_count : 1;
+}
+
+// Must be called with pool_lock held
+static u32 thread_count_locked()
+{
+    if (requested_thread_count != 0)
+        return requested_thread_count;
+
+    if (default_thread_count == 0)
+        default_thread_count = find_default_thread_count();
+
+    return default_thread_count;
+}
+
+static void run_job_ranges(void *parallel_job, u32 thread_idx)
+{
+    ParallelJob *job = parallel_job;
+
+    while (true)
+    {
+        size_t range = atomic_fetch_add_explicit(&job->next_range, 1, memory_order_relaxed);
+
+        if (range >= job->range_count)
+            break;
+
+        size_t range_start = job->start + range * job->range_size;
+        size_t range_end = job->end - range_start > job->range_size ? range_start + job->range_size : job->end;
+
+        job->func(job->context, range_start, range_end, thread_idx);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    u32 thread_idx = (u32) (uintptr_t) arg;
+    is_pool_worker = true;
+
+    pthread_mutex_lock(&pool_lock);
+
+    // The job that caused the pool to start may have been posted before this thread got the lock
+    u64 seen_generation = workers_start_generation;
+
+    while (true)
+    {
+        while (job_generation == seen_generation && !is_shutting_down)
+            pthread_cond_wait(&job_posted, &pool_lock);
+
+        if (is_shutting_down)
+            break;
+
+        seen_generation = job_generation;
+        JobRunner runner = current_runner;
+        void *job = current_job;
+
+        pthread_mutex_unlock(&pool_lock);
+        runner(job, thread_idx);
+        pthread_mutex_lock(&pool_lock);
+
+        if (--busy_worker_count == 0)
+            pthread_cond_broadcast(&job_finished);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+
+    return 0;
+}
+
+static void fork_prepare()
+{
+    pthread_mutex_lock(&pool_lock);
+}
+
+static void fork_parent()
+{
+    pthread_mutex_unlock(&pool_lock);
+}
+
+// Only the forking thread survives in the child, so the pool is forgotten (not joined) and restarted
+// lazily if the child runs a parallel kernel
+static void fork_child()
+{
+    free(workers);
+    workers = 0;
+    worker_count = 0;
+    is_job_running = false;
+    is_shutting_down = false;
+    busy_worker_count = 0;
+    current_runner = 0;
+    current_job = 0;
+
+    pthread_mutex_init(&pool_lock, 0);
+    pthread_cond_init(&job_posted, 0);
+    pthread_cond_init(&job_finished, 0);
+}
+
+static void register_fork_handlers()
+{
+    pthread_atfork(fork_prepare, fork_parent, fork_child);
+}
+
+// Must be called with pool_lock held and no job running. Returns the number of workers actually running,
+// which is less than requested if the system refuses to create more threads.
+static u32 start_workers_locked(u32 count)
+{
+    pthread_once(&fork_handlers_once, register_fork_handlers);
+
+    workers = malloc(sizeof(pthread_t) * count);
+    assert(workers != 0, "malloc failure");
+
+    workers_start_generation = job_generation;
+    worker_count = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+        // Thread index zero is reserved for the thread that posts the job
+        if (pthread_create(workers + i, 0, worker_main, (void*) (uintptr_t) (i + 1)) != 0)
+            break;
+
+        ++worker_count;
+    }
+
+    return worker_count;
+}
+
+// Must be called with pool_lock held and is_job_running set (so no job can be posted while the lock is
+// released to join the workers)
+static void stop_workers_locked()
+{
+    is_shutting_down = true;
+    pthread_cond_broadcast(&job_posted);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (u32 i = 0; i < worker_count; ++i)
+        pthread_join(workers[i], 0);
+
+    pthread_mutex_lock(&pool_lock);
+
+    free(workers);
+    workers = 0;
+    worker_count = 0;
+    is_shutting_down = false;
+}
+
+DLLEXPORT void gphrx_set_num_threads(u32 thread_count)
+{
+    pthread_mutex_lock(&pool_lock);
+
+    while (is_job_running)
+        pthread_cond_wait(&job_finished, &pool_lock);
+
+    requested_thread_count = thread_count;
+
+    // Re-read the environment the next time the default is needed
+    if (thread_count == 0)
+        default_thread_count = 0;
+
+    if (workers && worker_count + 1 != thread_count_locked())
+    {
+        is_job_running = true;
+        stop_workers_locked();
+        is_job_running = false;
+
+        pthread_cond_broadcast(&job_finished);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+}
+
+DLLEXPORT u32 gphrx_get_num_threads()
+{
+    pthread_mutex_lock(&pool_lock);
+    u32 thread_count = thread_count_locked();
+    pthread_mutex_unlock(&pool_lock);
+
+    return thread_count;
+}
+
+// Claims the pool for a job with `work` units of work, of which each thread should get at least
+// `grain_size`. Returns the number of threads that will run the job (the pool's workers plus the calling
+// thread), or zero if the job should instead run inline on the calling thread. A successful claim must be
+// followed by `run_on_claimed_pool`.
+static u32 claim_pool(size_t work, size_t grain_size)
+{
+    if (is_pool_worker || work / 2 < grain_size)
+        return 0;
+
+    pthread_mutex_lock(&pool_lock);
+
+    u32 thread_count = thread_count_locked();
+
+    if (thread_count <= 1 || is_job_running)
+    {
+        pthread_mutex_unlock(&pool_lock);
+        return 0;
+    }
+
+    if (!workers && start_workers_locked(thread_count - 1) == 0)
+    {
+        free(workers);
+        workers = 0;
+
+        pthread_mutex_unlock(&pool_lock);
+        return 0;
+    }
+
+    is_job_running = true;
+    thread_count = worker_count + 1;
+
+    pthread_mutex_unlock(&pool_lock);
+
+    return thread_count;
+}
+
+static void run_on_claimed_pool(JobRunner runner, void *job)
+{
+    pthread_mutex_lock(&pool_lock);
+
+    current_runner = runner;
+    current_job = job;
+    busy_worker_count = worker_count;
+    ++job_generation;
+
+    pthread_cond_broadcast(&job_posted);
+    pthread_mutex_unlock(&pool_lock);
+
+    is_pool_worker = true;
+    runner(job, 0);
+    is_pool_worker = false;
+
+    pthread_mutex_lock(&pool_lock);
+
+    while (busy_worker_count > 0)
+        pthread_cond_wait(&job_finished, &pool_lock);
+
+    current_runner = 0;
+    current_job = 0;
+    is_job_running = false;
+
+    // Wake anyone in gphrx_set_num_threads waiting for the pool to go idle
+    pthread_cond_broadcast(&job_finished);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void _gphrx_parallel_for(size_t start, size_t end, size_t grain_size, GphrxParallelForFunc func, void *context)
+{
+    if (end <= start)
+        return;
+
+    if (grain_size < 1)
+        grain_size = 1;
+
+    size_t index_count = end - start;
+    u32 thread_count = claim_pool(index_count, grain_size);
+
+    if (thread_count == 0)
+    {
+        func(context, start, end, 0);
+        return;
+    }
+
+    size_t target_range_count = (size_t) thread_count * RANGES_PER_THREAD;
+    size_t range_size = index_count / target_range_count
+        + (index_count % target_range_count == 0 ? 0 : 1);
+
+    if (range_size < grain_size)
+        range_size = grain_size;
+
+    ParallelJob job = {
+        .func = func,
+        .context = context,
+        .start = start,
+        .end = end,
+        .range_size = range_size,
+        .range_count = index_count / range_size + (index_count % range_size == 0 ? 0 : 1),
+    };
+
+    atomic_init(&job.next_range, 0);
+
+    run_on_claimed_pool(run_job_ranges, &job);
+}
+
+static FORCEINLINE u64 pack_deque(u64 head, u64 tail)
+{
+    return (tail << 32) | head;
+}
+
+static void run_stolen_chunks(void *stealing_job, u32 thread_idx)
+{
+    StealingJob *job = stealing_job;
+    WorkDeque *own_deque = job->deques + thread_idx;
+
+    while (true)
+    {
+        // Work through the head of our own queue
+        u64 chunks = atomic_load_explicit(&own_deque->chunks, memory_order_acquire);
+
+        while (true)
+        {
+            u64 head = chunks & 0xFFFFFFFF;
+            u64 tail = chunks >> 32;
+
+            if (head >= tail)
+                break;
+
+            if (atomic_compare_exchange_weak_explicit(&own_deque->chunks, &chunks, pack_deque(head + 1, tail),
+                                                      memory_order_acq_rel, memory_order_acquire))
+            {
+                job->func(job->context, job->chunk_bounds[head], job->chunk_bounds[head + 1], thread_idx);
+                chunks = atomic_load_explicit(&own_deque->chunks, memory_order_acquire);
+            }
+        }
+
+        // Our queue is empty, so steal the back half of the first non-empty queue after ours
+        bool did_steal = false;
+
+        for (u32 offset = 1; offset < job->thread_count && !did_steal; ++offset)
+        {
+            WorkDeque *victim = job->deques + (thread_idx + offset) % job->thread_count;
+            u64 victim_chunks = atomic_load_explicit(&victim->chunks, memory_order_acquire);
+
+            while (true)
+            {
+                u64 head = victim_chunks & 0xFFFFFFFF;
+                u64 tail = victim_chunks >> 32;
+
+                if (head >= tail)
+                    break;
+
+                u64 stolen_count = (tail - head + 1) / 2;
+
+                if (atomic_compare_exchange_weak_explicit(&victim->chunks,
+                                                          &victim_chunks,
+                                                          pack_deque(head, tail - stolen_count),
+                                                          memory_order_acq_rel,
+                                                          memory_order_acquire))
+                {
+                    // Keep the first stolen chunk and queue the rest where other thieves can find them
+                    u64 first_stolen = tail - stolen_count;
+                    atomic_store_explicit(&own_deque->chunks, pack_deque(first_stolen + 1, tail), memory_order_release);
+
+                    job->func(job->context,
+                              job->chunk_bounds[first_stolen],
+                              job->chunk_bounds[first_stolen + 1],
+                              thread_idx);
+
+                    did_steal = true;
+                    break;
+                }
+            }
+        }
+
+        if (!did_steal)
+            return;
+    }
+}
+
+// Returns the cost of the indices in [start, end): one per index plus the difference in cost offsets
+static FORCEINLINE size_t range_cost(size_t *cost_offsets, size_t start, size_t end)
+{
+    return (cost_offsets[end] - cost_offsets[start]) + (end - start);
+}
+
+void _gphrx_parallel_for_balanced(size_t start,
+                                  size_t end,
+                                  size_t *cost_offsets,
+                                  size_t grain_cost,
+                                  GphrxParallelForFunc func,
+                                  void *context)
+{
+    if (end <= start)
+        return;
+
+    if (grain_cost < 1)
+        grain_cost = 1;
+
+    size_t total_cost = range_cost(cost_offsets, start, end);
+    u32 thread_count = claim_pool(total_cost, grain_cost);
+
+    if (thread_count == 0)
+    {
+        func(context, start, end, 0);
+        return;
+    }
+
+    size_t target_chunk_count = (size_t) thread_count * CHUNKS_PER_THREAD;
+    size_t chunk_cost = total_cost / target_chunk_count + (total_cost % target_chunk_count == 0 ? 0 : 1);
+
+    if (chunk_cost < grain_cost)
+        chunk_cost = grain_cost;
+
+    size_t *chunk_bounds = malloc(sizeof(size_t) * (target_chunk_count + 1));
+    assert(chunk_bounds != 0, "malloc failure");
+
+    // Each chunk ends at the first index where the running cost reaches a multiple of the chunk cost. An
+    // index that costs more than a chunk on its own (a hub vertex, say) becomes a chunk by itself.
+    u32 chunk_count = 0;
+    chunk_bounds[0] = start;
+
+    for (size_t chunk = 1; chunk < target_chunk_count; ++chunk)
+    {
+        size_t target_cost = chunk * chunk_cost;
+
+        if (target_cost >= total_cost)
+            break;
+
+        size_t low = chunk_bounds[chunk_count] + 1;
+        size_t high = end;
+
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+
+            if (range_cost(cost_offsets, start, middle) < target_cost)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        if (low >= end)
+            break;
+
+        chunk_bounds[++chunk_count] = low;
+    }
+
+    chunk_bounds[++chunk_count] = end;
+
+    WorkDeque *deques = _gphrx_new_thread_states(sizeof(WorkDeque), thread_count);
+
+    // Threads start with equal shares of the chunks; stealing evens out whatever imbalance remains
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        u64 head = (u64) chunk_count * t / thread_count;
+        u64 tail = (u64) chunk_count * (t + 1) / thread_count;
+
+        atomic_init(&deques[t].chunks, pack_deque(head, tail));
+    }
+
+    StealingJob job = {
+        .func = func,
+        .context = context,
+        .chunk_bounds = chunk_bounds,
+        .thread_count = thread_count,
+        .deques = deques,
+    };
+
+    run_on_claimed_pool(run_stolen_chunks, &job);
+
+    free(deques);
+    free(chunk_bounds);
+}
+
+typedef struct {
+    size_t start;
+    size_t end;
+    size_t range_size;
+    byte *partials;
+    size_t result_size;
+    GphrxParallelReduceFunc func;
+    void *context;
+} ParallelReduction;
+
+static void reduce_ranges(void *context, size_t first_range, size_t end_range, u32 thread_idx)
+{
+    ParallelReduction *reduction = context;
+
+    for (size_t range = first_range; range < end_range; ++range)
+    {
+        size_t range_start = reduction->start + range * reduction->range_size;
+        size_t range_end = reduction->end - range_start > reduction->range_size
+            ? range_start + reduction->range_size
+            : reduction->end;
+
+        reduction->func(reduction->context,
+                        range_start,
+                        range_end,
+                        reduction->partials + range * reduction->result_size);
+    }
+}
+
+void *_gphrx_new_thread_states(size_t state_size, u32 thread_count)
+{
+    void *states = aligned_alloc(GPHRX_CACHE_LINE_SIZE, state_size * thread_count);
+    assert(states != 0, "aligned_alloc failure");
+
+    return states;
+}
+
+void _gphrx_parallel_reduce(size_t start,
+                            size_t end,
+                            size_t grain_size,
+                            void *result,
+                            size_t result_size,
+                            GphrxParallelReduceFunc func,
+                            GphrxParallelCombineFunc combine,
+                            void *context)
+{
+    if (end <= start)
+        return;
+
+    if (grain_size < 1)
+        grain_size = 1;
+
+    size_t index_count = end - start;
+    u32 thread_count = gphrx_get_num_threads();
+
+    if (is_pool_worker || thread_count <= 1 || index_count / 2 < grain_size)
+    {
+        func(context, start, end, result);
+        return;
+    }
+
+    // The ranges are fixed up front (rather than handed out as in `_gphrx_parallel_for`) so that each has a
+    // partial of its own and the partials can be combined in index order
+    size_t range_count = (size_t) thread_count * RANGES_PER_THREAD;
+
+    if (index_count / range_count < grain_size)
+        range_count = index_count / grain_size;
+
+    size_t range_size = index_count / range_count + (index_count % range_count == 0 ? 0 : 1);
+    range_count = index_count / range_size + (index_count % range_size == 0 ? 0 : 1);
+
+    ParallelReduction reduction = {
+        .start = start,
+        .end = end,
+        .range_size = range_size,
+        .partials = malloc(range_count * result_size),
+        .result_size = result_size,
+        .func = func,
+        .context = context,
+    };
+
+    assert(reduction.partials != 0, "malloc failure");
+
+    for (size_t range = 0; range < range_count; ++range)
+        memcpy(reduction.partials + range * result_size, result, result_size);
+
+    _gphrx_parallel_for(0, range_count, 1, reduce_ranges, &reduction);
+
+    for (size_t range = 0; range < range_count; ++range)
+        combine(context, result, reduction.partials + range * result_size);
+
+    free(reduction.partials);
+}
+
+
+#ifdef TEST_MODE
+
+typedef struct {
+    u32 *visit_counts;
+    atomic_uint max_thread_idx;
+    atomic_uint nested_calls;
+} ParallelForTestContext;
+
+static void count_nested_visit(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    ParallelForTestContext *test_context = context;
+    atomic_fetch_add(&test_context->nested_calls, 1);
+}
+
+static void count_visits(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    ParallelForTestContext *test_context = context;
+
+    for (size_t i = start; i < end; ++i)
+        ++test_context->visit_counts[i];
+
+    u32 max_idx = atomic_load(&test_context->max_thread_idx);
+    while (thread_idx > max_idx && !atomic_compare_exchange_weak(&test_context->max_thread_idx, &max_idx, thread_idx));
+
+    // A loop started from inside a loop runs inline on the calling thread as a single range
+    _gphrx_parallel_for(0, 1000000, 1, count_nested_visit, context);
+}
+
+static TEST_RESULT test_gphrx_parallel_for()
+{
+    u32 thread_counts[] = {1, 2, 4, 7};
+    size_t index_count = 100003;
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(u32); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+        assert(gphrx_get_num_threads() == thread_counts[t], "Incorrect thread count");
+
+        ParallelForTestContext context = {
+            .visit_counts = calloc(index_count + 10, sizeof(u32)),
+        };
+
+        atomic_init(&context.max_thread_idx, 0);
+        atomic_init(&context.nested_calls, 0);
+
+        _gphrx_parallel_for(10, index_count + 10, 100, count_visits, &context);
+
+        for (size_t i = 0; i < 10; ++i)
+            assert(context.visit_counts[i] == 0, "Index outside of the range was visited");
+
+        for (size_t i = 10; i < index_count + 10; ++i)
+            assert(context.visit_counts[i] == 1, "Index was not visited exactly once");
+
+        assert(atomic_load(&context.max_thread_idx) < thread_counts[t], "Thread index out of range");
+
+        u32 range_count = atomic_load(&context.nested_calls);
+        assert(range_count >= 1 && range_count <= thread_counts[t] * RANGES_PER_THREAD, "Incorrect range count");
+
+        if (thread_counts[t] == 1)
+        {
+            assert(range_count == 1, "Loop was split without threads to run it");
+        }
+
+        // Empty and tiny ranges run inline
+        atomic_store(&context.nested_calls, 0);
+        _gphrx_parallel_for(5, 5, 1, count_nested_visit, &context);
+        _gphrx_parallel_for(0, 150, 100, count_nested_visit, &context);
+        assert(atomic_load(&context.nested_calls) == 1, "Small loop was split");
+
+        free(context.visit_counts);
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+typedef struct {
+    size_t *cost_offsets;
+    atomic_uint *visit_counts;
+    atomic_size_t chunk_count;
+    atomic_size_t max_chunk_cost;
+    atomic_uint max_thread_idx;
+} BalancedTestContext;
+
+static void count_balanced_visits(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    BalancedTestContext *test_context = context;
+
+    for (size_t i = start; i < end; ++i)
+        atomic_fetch_add(test_context->visit_counts + i, 1);
+
+    atomic_fetch_add(&test_context->chunk_count, 1);
+
+    // Only multi-index chunks are bounded; a single index may cost any amount
+    if (end - start > 1)
+    {
+        size_t cost = range_cost(test_context->cost_offsets, start, end - 1);
+        size_t max_cost = atomic_load(&test_context->max_chunk_cost);
+        while (cost > max_cost && !atomic_compare_exchange_weak(&test_context->max_chunk_cost, &max_cost, cost));
+    }
+
+    u32 max_idx = atomic_load(&test_context->max_thread_idx);
+    while (thread_idx > max_idx && !atomic_compare_exchange_weak(&test_context->max_thread_idx, &max_idx, thread_idx));
+}
+
+static TEST_RESULT test_gphrx_parallel_for_balanced()
+{
+    size_t index_count = 50000;
+    size_t *cost_offsets = malloc(sizeof(size_t) * (index_count + 1));
+
+    // Heavy-tailed costs: index i costs about index_count / (i + 1), so the first few indices dominate
+    cost_offsets[0] = 0;
+    for (size_t i = 0; i < index_count; ++i)
+        cost_offsets[i + 1] = cost_offsets[i] + index_count / (i + 1);
+
+    u32 thread_counts[] = {1, 2, 5};
+    size_t grain_cost = 1000;
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(u32); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        BalancedTestContext context = {
+            .cost_offsets = cost_offsets,
+            .visit_counts = calloc(index_count, sizeof(atomic_uint)),
+        };
+
+        atomic_init(&context.chunk_count, 0);
+        atomic_init(&context.max_chunk_cost, 0);
+        atomic_init(&context.max_thread_idx, 0);
+
+        _gphrx_parallel_for_balanced(0, index_count, cost_offsets, grain_cost, count_balanced_visits, &context);
+
+        for (size_t i = 0; i < index_count; ++i)
+            assert(atomic_load(context.visit_counts + i) == 1, "Index was not visited exactly once");
+
+        assert(atomic_load(&context.max_thread_idx) < thread_counts[t], "Thread index out of range");
+
+        if (thread_counts[t] == 1)
+        {
+            assert(atomic_load(&context.chunk_count) == 1, "Loop was split without threads to run it");
+        }
+        else
+        {
+            size_t total_cost = range_cost(cost_offsets, 0, index_count);
+            size_t chunk_cost = total_cost / (thread_counts[t] * CHUNKS_PER_THREAD) + 1;
+
+            assert(atomic_load(&context.chunk_count) > thread_counts[t], "Loop was not split");
+            assert(atomic_load(&context.chunk_count) <= thread_counts[t] * CHUNKS_PER_THREAD, "Too many chunks");
+
+            // A chunk stops growing once it reaches the chunk cost
+            assert(atomic_load(&context.max_chunk_cost) < chunk_cost, "Chunk is too costly");
+        }
+
+        // A sub-range of the offsets is split on its own costs
+        memset(context.visit_counts, 0, index_count * sizeof(atomic_uint));
+        _gphrx_parallel_for_balanced(100, 40000, cost_offsets, grain_cost, count_balanced_visits, &context);
+
+        for (size_t i = 0; i < index_count; ++i)
+            assert(atomic_load(context.visit_counts + i) == (i >= 100 && i < 40000), "Incorrect visits in sub-range");
+
+        free(context.visit_counts);
+    }
+
+    free(cost_offsets);
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+static void sum_range(void *context, size_t start, size_t end, void *partial)
+{
+    u64 *values = context;
+    u64 *sum = partial;
+
+    for (size_t i = start; i < end; ++i)
+        *sum += values[i];
+}
+
+static void combine_sums(void *context, void *accumulator, void *partial)
+{
+    *(u64*) accumulator += *(u64*) partial;
+}
+
+static void concat_range(void *context, size_t start, size_t end, void *partial)
+{
+    size_t *bounds = partial;
+
+    // An untouched partial holds the identity (SIZE_MAX, SIZE_MAX)
+    if (bounds[0] == SIZE_MAX)
+        bounds[0] = start;
+
+    assert(bounds[1] == SIZE_MAX || bounds[1] == start, "Ranges given to a partial are not contiguous");
+    bounds[1] = end;
+}
+
+static void combine_concat(void *context, void *accumulator, void *partial)
+{
+    size_t *acc_bounds = accumulator;
+    size_t *partial_bounds = partial;
+
+    // Partials must be combined in index order, so each one continues where the accumulator left off
+    if (acc_bounds[0] == SIZE_MAX)
+        acc_bounds[0] = partial_bounds[0];
+    else
+        assert(acc_bounds[1] == partial_bounds[0], "Partials combined out of order");
+
+    acc_bounds[1] = partial_bounds[1];
+}
+
+static TEST_RESULT test_gphrx_parallel_reduce()
+{
+    size_t value_count = 250001;
+    u64 *values = malloc(sizeof(u64) * value_count);
+
+    for (size_t i = 0; i < value_count; ++i)
+        values[i] = i * 3 + 1;
+
+    u64 expected_sum = 3 * ((value_count - 1) * value_count / 2) + value_count;
+
+    u32 thread_counts[] = {1, 3, 8};
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(u32); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        u64 sum = 0;
+        _gphrx_parallel_reduce(0, value_count, 1000, &sum, sizeof(u64), sum_range, combine_sums, values);
+        assert(sum == expected_sum, "Incorrect sum");
+
+        sum = 5;
+        _gphrx_parallel_reduce(7, 7, 1, &sum, sizeof(u64), sum_range, combine_sums, values);
+        assert(sum == 5, "Empty reduction changed the result");
+
+        size_t bounds[2] = {SIZE_MAX, SIZE_MAX};
+        _gphrx_parallel_reduce(3, value_count, 10, bounds, sizeof(bounds), concat_range, combine_concat, 0);
+        assert(bounds[0] == 3, "Incorrect reduction start");
+        assert(bounds[1] == value_count, "Incorrect reduction end");
+    }
+
+    free(values);
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_set_num_threads()
+{
+    char *initial_env_value = getenv(GPHRX_NUM_THREADS_ENV_VAR);
+    char *saved_env_value = initial_env_value ? strdup(initial_env_value) : 0;
+
+    setenv(GPHRX_NUM_THREADS_ENV_VAR, "5", 1);
+    gphrx_set_num_threads(0);
+    assert(gphrx_get_num_threads() == 5, "Thread count not read from the environment");
+
+    gphrx_set_num_threads(2);
+    assert(gphrx_get_num_threads() == 2, "Explicit thread count did not override the environment");
+
+    setenv(GPHRX_NUM_THREADS_ENV_VAR, "not a number", 1);
+    gphrx_set_num_threads(0);
+    assert(gphrx_get_num_threads() >= 1, "Invalid environment variable not ignored");
+
+    setenv(GPHRX_NUM_THREADS_ENV_VAR, "0", 1);
+    gphrx_set_num_threads(0);
+    assert(gphrx_get_num_threads() >= 1, "Zero environment variable not ignored");
+
+    if (saved_env_value)
+    {
+        setenv(GPHRX_NUM_THREADS_ENV_VAR, saved_env_value, 1);
+        free(saved_env_value);
+    }
+    else
+    {
+        unsetenv(GPHRX_NUM_THREADS_ENV_VAR);
+    }
+
+    // Resizing a running pool restarts it
+    u64 values[4096];
+
+    for (size_t i = 0; i < 4096; ++i)
+        values[i] = 1;
+
+    u32 thread_counts[] = {4, 3, 3, 1, 6};
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(u32); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        u64 sum = 0;
+        _gphrx_parallel_reduce(0, 4096, 16, &sum, sizeof(u64), sum_range, combine_sums, values);
+
+        assert(sum == 4096, "Incorrect sum after resizing pool");
+    }
+
+    gphrx_set_num_threads(0);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet threadpool_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_parallel_for);
+    register_test(&set, test_gphrx_parallel_for_balanced);
+    register_test(&set, test_gphrx_parallel_reduce);
+    register_test(&set, test_gphrx_set_num_threads);
+
+    return set;
+}
+
+#endif
@@ -0,0 +1,858 @@
+#include "triangles.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "threadpool.h"
+
+// Vertices per range of the passes that build the oriented graph, and intersected neighbours per range of
+// the triangle search
+#define VERTEX_GRAIN_SIZE 1024
+#define TRIANGLE_GRAIN_COST 4096
+
+// Returns the index of the first value in arr[start..count) that is not less than `value`
+static size_t gallop(u64 *restrict arr, size_t start, size_t count, u64 value)
+{
+    size_t low = start;
+    size_t high = start;
+    size_t step = 1;
+
+    while (high < count && arr[high] < value)
+    {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+
+    if (high > count)
+        high = count;
+
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+
+        if (arr[mid] < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+static u64 intersect_galloping(u64 *restrict small,
+                               size_t small_count,
+                               u64 *restrict large,
+                               size_t large_count,
+                               u64 *restrict matches)
+{
+    u64 count = 0;
+    size_t j = 0;
+
+    for (size_t i = 0; i < small_count; ++i)
+    {
+        j = gallop(large, j, large_count, small[i]);
+
+        if (j == large_count)
+            break;
+
+        if (large[j] == small[i])
+        {
+            if (matches != 0)
+                matches[count] = small[i];
+
+            ++count;
+            ++j;
+        }
+    }
+
+    return count;
+}
+
+// Merges the lists from a[i] and b[j] onwards, adding to the `count` matches already found
+static FORCEINLINE u64 intersect_merging(u64 *restrict a,
+                                         size_t a_count,
+                                         u64 *restrict b,
+                                         size_t b_count,
+                                         u64 *restrict matches,
+                                         size_t i,
+                                         size_t j,
+                                         u64 count)
+{
+    while (i < a_count && j < b_count)
+    {
+        if (a[i] < b[j])
+        {
+            ++i;
+        }
+        else if (a[i] > b[j])
+        {
+            ++j;
+        }
+        else
+        {
+            if (matches != 0)
+                matches[count] = a[i];
+
+            ++count;
+            ++i;
+            ++j;
+        }
+    }
+
+    return count;
+}
+
+// The vectorized merges compare a block of each list against the other and then move past whichever block
+// ends lower (or both, if they end on the same value). A value's match can only be in the block it is
+// compared against, so each match is counted once. The ends of the lists are merged one value at a time.
+#if defined(SIMD_AVX512)
+static TARGET_AVX512 u64 intersect_merging_avx512(u64 *restrict a,
+                                                  size_t a_count,
+                                                  u64 *restrict b,
+                                                  size_t b_count,
+                                                  u64 *restrict matches)
+{
+    size_t i = 0;
+    size_t j = 0;
+    u64 count = 0;
+
+    while (i + 8 <= a_count && j + 8 <= b_count)
+    {
+        __m512i a_vec = _mm512_loadu_si512((void*) (a + i));
+        __mmask8 mask = 0;
+
+        for (u32 k = 0; k < 8; ++k)
+            mask |= _mm512_cmpeq_epi64_mask(a_vec, _mm512_set1_epi64(b[j + k]));
+
+        if (matches != 0)
+            _mm512_mask_compressstoreu_epi64(matches + count, mask, a_vec);
+
+        count += u64_popcount(mask);
+
+        u64 a_last = a[i + 7];
+        u64 b_last = b[j + 7];
+
+        i += a_last <= b_last ? 8 : 0;
+        j += b_last <= a_last ? 8 : 0;
+    }
+
+    return intersect_merging(a, a_count, b, b_count, matches, i, j, count);
+}
+#endif
+
+#if defined(SIMD_AVX2)
+static TARGET_AVX2 u64 intersect_merging_avx2(u64 *restrict a,
+                                              size_t a_count,
+                                              u64 *restrict b,
+                                              size_t b_count,
+                                              u64 *restrict matches)
+{
+    size_t i = 0;
+    size_t j = 0;
+    u64 count = 0;
+
+    while (i + 4 <= a_count && j + 4 <= b_count)
+    {
+        __m256i a_vec = _mm256_loadu_si256((__m256i*) (a + i));
+
+        __m256i equal = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi64(a_vec, _mm256_set1_epi64x(b[j])),
+                            _mm256_cmpeq_epi64(a_vec, _mm256_set1_epi64x(b[j + 1]))),
+            _mm256_or_si256(_mm256_cmpeq_epi64(a_vec, _mm256_set1_epi64x(b[j + 2])),
+                            _mm256_cmpeq_epi64(a_vec, _mm256_set1_epi64x(b[j + 3]))));
+
+        u64 mask = (u64) _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+
+        if (matches != 0)
+        {
+            for (u64 bits = mask; bits != 0; bits &= bits - 1)
+                matches[count++] = a[i + u64_trailing_zeros(bits)];
+        }
+        else
+        {
+            count += u64_popcount(mask);
+        }
+
+        u64 a_last = a[i + 3];
+        u64 b_last = b[j + 3];
+
+        i += a_last <= b_last ? 4 : 0;
+        j += b_last <= a_last ? 4 : 0;
+    }
+
+    return intersect_merging(a, a_count, b, b_count, matches, i, j, count);
+}
+#endif
+
+DLLEXPORT u64 gphrx_intersect_sorted(u64 *restrict a,
+                                     size_t a_count,
+                                     u64 *restrict b,
+                                     size_t b_count,
+                                     u64 *restrict matches)
+{
+    if (a_count == 0 || b_count == 0)
+        return 0;
+
+    // Lists that don't overlap have nothing in common
+    if (a[a_count - 1] < b[0] || b[b_count - 1] < a[0])
+        return 0;
+
+    if (a_count * GPHRX_INTERSECT_GALLOP_RATIO < b_count)
+        return intersect_galloping(a, a_count, b, b_count, matches);
+
+    if (b_count * GPHRX_INTERSECT_GALLOP_RATIO < a_count)
+        return intersect_galloping(b, b_count, a, a_count, matches);
+
+#if defined(SIMD_AVX512)
+    if (simd_level() == SIMD_LEVEL_AVX512)
+        return intersect_merging_avx512(a, a_count, b, b_count, matches);
+#endif
+
+#if defined(SIMD_AVX2)
+    if (simd_level() == SIMD_LEVEL_AVX2)
+        return intersect_merging_avx2(a, a_count, b, b_count, matches);
+#endif
+
+    return intersect_merging(a, a_count, b, b_count, matches, 0, 0, 0);
+}
+
+typedef struct {
+    GPHRX_CACHE_ALIGNED u64 triangle_count;
+    u64 *matches;
+} TriangleThreadState;
+
+typedef struct {
+    u64 vertex_count;
+
+    // Each vertex's distinct neighbours, which on a directed graph means the vertices it has an edge to or
+    // from. A vertex may be in its own list on an undirected graph; it never is on a directed one.
+    size_t *offsets;
+    u64 *neighbors;
+
+    // Only used while building a directed graph's neighbour lists
+    size_t *out_offsets;
+    u64 *out_neighbors;
+    size_t *in_offsets;
+    u64 *in_neighbors;
+
+    // Number of neighbours of each vertex other than itself
+    u64 *degrees;
+
+    // The neighbours that each vertex's edges are oriented towards
+    size_t *oriented_offsets;
+    u64 *oriented_neighbors;
+
+    // Only found for clustering coefficients
+    _Atomic u64 *triangle_counts;
+
+    TriangleThreadState *threads;
+} TriangleSearch;
+
+// Merges v's out- and in-neighbours into one list without repeats or v itself, returning its length. If
+// `neighbors` is null, the list is only counted.
+static size_t merge_neighbors(TriangleSearch *restrict search, u64 v, u64 *restrict neighbors)
+{
+    u64 *out = search->out_neighbors + search->out_offsets[v];
+    u64 *in = search->in_neighbors + search->in_offsets[v];
+
+    size_t out_count = search->out_offsets[v + 1] - search->out_offsets[v];
+    size_t in_count = search->in_offsets[v + 1] - search->in_offsets[v];
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t count = 0;
+
+    while (i < out_count || j < in_count)
+    {
+        u64 w;
+
+        if (j == in_count || (i < out_count && out[i] < in[j]))
+        {
+            w = out[i++];
+        }
+        else
+        {
+            if (i < out_count && out[i] == in[j])
+                ++i;
+
+            w = in[j++];
+        }
+
+        if (w == v)
+            continue;
+
+        if (neighbors != 0)
+            neighbors[count] = w;
+
+        ++count;
+    }
+
+    return count;
+}
+
+static void count_merged_neighbors(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    TriangleSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+        search->degrees[v] = merge_neighbors(search, v, 0);
+}
+
+static void fill_merged_neighbors(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    TriangleSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+        merge_neighbors(search, v, search->neighbors + search->offsets[v]);
+}
+
+static void count_undirected_degrees(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    TriangleSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        search->degrees[v] = search->offsets[v + 1] - search->offsets[v];
+
+        // Lists are sorted, so a self-loop is wherever the neighbours pass v
+        size_t self = gallop(search->neighbors, search->offsets[v], search->offsets[v + 1], v);
+
+        if (self < search->offsets[v + 1] && search->neighbors[self] == v)
+            --search->degrees[v];
+    }
+}
+
+static bool is_ranked_higher(TriangleSearch *restrict search, u64 w, u64 v)
+{
+    return search->degrees[w] > search->degrees[v] || (search->degrees[w] == search->degrees[v] && w > v);
+}
+
+static void count_oriented_neighbors(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    TriangleSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        size_t count = 0;
+
+        for (size_t edge = search->offsets[v]; edge < search->offsets[v + 1]; ++edge)
+            count += is_ranked_higher(search, search->neighbors[edge], v);
+
+        search->oriented_offsets[v + 1] = count;
+    }
+}
+
+static void fill_oriented_neighbors(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    TriangleSearch *search = context;
+
+    for (size_t v = start; v < end; ++v)
+    {
+        u64 *oriented = search->oriented_neighbors + search->oriented_offsets[v];
+
+        for (size_t edge = search->offsets[v]; edge < search->offsets[v + 1]; ++edge)
+        {
+            if (is_ranked_higher(search, search->neighbors[edge], v))
+                *oriented++ = search->neighbors[edge];
+        }
+    }
+}
+
+// Prefix-sums the counts in offsets[1..count] into offsets and returns the total
+static size_t sum_offsets(size_t *offsets, u64 count)
+{
+    offsets[0] = 0;
+
+    for (u64 v = 0; v < count; ++v)
+        offsets[v + 1] += offsets[v];
+
+    return offsets[count];
+}
+
+static void find_vertex_triangles(void *context, size_t start, size_t end, u32 thread_idx)
+{
+    TriangleSearch *search = context;
+    TriangleThreadState *state = search->threads + thread_idx;
+
+    for (size_t u = start; u < end; ++u)
+    {
+        u64 *u_neighbors = search->oriented_neighbors + search->oriented_offsets[u];
+        size_t u_count = search->oriented_offsets[u + 1] - search->oriented_offsets[u];
+
+        u64 u_triangle_count = 0;
+
+        for (size_t i = 0; i < u_count; ++i)
+        {
+            u64 v = u_neighbors[i];
+
+            u64 count = gphrx_intersect_sorted(u_neighbors,
+                                               u_count,
+                                               search->oriented_neighbors + search->oriented_offsets[v],
+                                               search->oriented_offsets[v + 1] - search->oriented_offsets[v],
+                                               search->triangle_counts != 0 ? state->matches : 0);
+
+            u_triangle_count += count;
+
+            if (search->triangle_counts == 0 || count == 0)
+                continue;
+
+            atomic_fetch_add_explicit(search->triangle_counts + v, count, memory_order_relaxed);
+
+            for (u64 k = 0; k < count; ++k)
+                atomic_fetch_add_explicit(search->triangle_counts + state->matches[k], 1, memory_order_relaxed);
+        }
+
+        state->triangle_count += u_triangle_count;
+
+        if (search->triangle_counts != 0 && u_triangle_count != 0)
+            atomic_fetch_add_explicit(search->triangle_counts + u, u_triangle_count, memory_order_relaxed);
+    }
+}
+
+// Orients the graph's edges and finds its triangles. If `triangle_counts` is not null, it is filled with
+// each vertex's count, and if `degrees` is not null, with each vertex's number of neighbours.
+static u64 find_triangles(GphrxGraph *restrict graph, u64 *triangle_counts, u64 *degrees)
+{
+    GphrxCsrAdjacencyMatrix *matrix = &graph->adjacency_matrix;
+    u64 vertex_count = matrix->dimension;
+
+    if (vertex_count == 0)
+        return 0;
+
+    u32 thread_count = gphrx_get_num_threads();
+
+    TriangleSearch search = {
+        .vertex_count = vertex_count,
+        .offsets = 0,
+        .neighbors = 0,
+        .out_offsets = 0,
+        .out_neighbors = 0,
+        .in_offsets = 0,
+        .in_neighbors = 0,
+        .degrees = degrees != 0 ? degrees : malloc(sizeof(u64) * vertex_count),
+        .oriented_offsets = malloc(sizeof(size_t) * (vertex_count + 1)),
+        .oriented_neighbors = 0,
+        .triangle_counts = (_Atomic u64*) triangle_counts,
+        .threads = _gphrx_new_thread_states(sizeof(TriangleThreadState), thread_count),
+    };
+
+    assert(search.degrees != 0 && search.oriented_offsets != 0, "malloc failure");
+
+    if (graph->is_undirected)
+    {
+        search.offsets = _gphrx_find_vertex_edge_offsets(matrix);
+        search.neighbors = (u64*) matrix->row_indices.arr;
+
+        _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, count_undirected_degrees, &search);
+    }
+    else
+    {
+        search.out_offsets = _gphrx_find_vertex_edge_offsets(matrix);
+        search.out_neighbors = (u64*) matrix->row_indices.arr;
+        search.in_neighbors = _gphrx_find_vertex_in_edges(matrix, &search.in_offsets);
+
+        _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, count_merged_neighbors, &search);
+
+        search.offsets = malloc(sizeof(size_t) * (vertex_count + 1));
+        assert(search.offsets != 0, "malloc failure");
+
+        memcpy(search.offsets + 1, search.degrees, sizeof(u64) * vertex_count);
+
+        search.neighbors = malloc(sizeof(u64) * (sum_offsets(search.offsets, vertex_count) + 1));
+        assert(search.neighbors != 0, "malloc failure");
+
+        _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, fill_merged_neighbors, &search);
+
+        free(search.out_offsets);
+        free(search.in_offsets);
+        free(search.in_neighbors);
+    }
+
+    _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, count_oriented_neighbors, &search);
+
+    search.oriented_neighbors = malloc(sizeof(u64) * (sum_offsets(search.oriented_offsets, vertex_count) + 1));
+    assert(search.oriented_neighbors != 0, "malloc failure");
+
+    _gphrx_parallel_for(0, vertex_count, VERTEX_GRAIN_SIZE, fill_oriented_neighbors, &search);
+
+    // An intersection has no more matches than the shorter list has values
+    u64 max_oriented_degree = 0;
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        if (search.oriented_offsets[v + 1] - search.oriented_offsets[v] > max_oriented_degree)
+            max_oriented_degree = search.oriented_offsets[v + 1] - search.oriented_offsets[v];
+    }
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        search.threads[i].triangle_count = 0;
+        search.threads[i].matches = 0;
+
+        if (triangle_counts != 0)
+        {
+            search.threads[i].matches = malloc(sizeof(u64) * (max_oriented_degree + 1));
+            assert(search.threads[i].matches != 0, "malloc failure");
+        }
+    }
+
+    if (triangle_counts != 0)
+        memset(triangle_counts, 0, sizeof(u64) * vertex_count);
+
+    _gphrx_parallel_for_balanced(0,
+                                 vertex_count,
+                                 search.oriented_offsets,
+                                 TRIANGLE_GRAIN_COST,
+                                 find_vertex_triangles,
+                                 &search);
+
+    u64 triangle_count = 0;
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        triangle_count += search.threads[i].triangle_count;
+        free(search.threads[i].matches);
+    }
+
+    free(search.offsets);
+
+    if (!graph->is_undirected)
+        free(search.neighbors);
+
+    if (degrees == 0)
+        free(search.degrees);
+
+    free(search.oriented_offsets);
+    free(search.oriented_neighbors);
+    free(search.threads);
+
+    return triangle_count;
+}
+
+DLLEXPORT u64 gphrx_count_triangles(GphrxGraph *restrict graph)
+{
+    return find_triangles(graph, 0, 0);
+}
+
+DLLEXPORT GphrxClusteringResult gphrx_find_clustering_coefficients(GphrxGraph *restrict graph)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    GphrxClusteringResult result = {
+        .vertex_count = vertex_count,
+        .triangle_count = 0,
+        .triangle_counts = malloc(sizeof(u64) * (vertex_count + 1)),
+        .coefficients = malloc(sizeof(double) * (vertex_count + 1)),
+        .average_coefficient = 0.0,
+    };
+
+    assert(result.triangle_counts != 0 && result.coefficients != 0, "malloc failure");
+
+    // The degrees are only used once the triangles are found, so they share the coefficients' buffer
+    u64 *degrees = (u64*) result.coefficients;
+
+    result.triangle_count = find_triangles(graph, result.triangle_counts, degrees);
+
+    double coefficient_sum = 0.0;
+
+    for (u64 v = 0; v < vertex_count; ++v)
+    {
+        u64 degree = degrees[v];
+        double coefficient = 0.0;
+
+        if (degree >= 2)
+            coefficient = 2.0 * result.triangle_counts[v] / ((double) degree * (degree - 1));
+
+        result.coefficients[v] = coefficient;
+        coefficient_sum += coefficient;
+    }
+
+    if (vertex_count != 0)
+        result.average_coefficient = coefficient_sum / vertex_count;
+
+    return result;
+}
+
+DLLEXPORT void free_gphrx_clustering_result(GphrxClusteringResult *restrict result)
+{
+    free(result->triangle_counts);
+    free(result->coefficients);
+}
+
+
+#ifdef TEST_MODE
+
+// Fills `list` with `count` distinct sorted values below `count * spread`
+static void fill_test_sorted_list(u64 *list, size_t count, u64 spread, u64 *rng_state)
+{
+    u64 value = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        value += 1 + test_random(rng_state) % spread;
+        list[i] = value;
+    }
+}
+
+// Finds each vertex's triangle count by checking every pair of its neighbours, ignoring the direction of
+// edges and self-loops
+static u64 *find_test_triangle_counts(GphrxGraph *restrict graph)
+{
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    bool *is_adjacent = calloc(vertex_count * vertex_count, sizeof(bool));
+
+    for (size_t i = 0; i < graph->adjacency_matrix.col_indices.size; ++i)
+    {
+        u64 u = dynarr8_get(&graph->adjacency_matrix.col_indices, i).u64_val;
+        u64 v = dynarr8_get(&graph->adjacency_matrix.row_indices, i).u64_val;
+
+        if (u != v)
+        {
+            is_adjacent[u * vertex_count + v] = true;
+            is_adjacent[v * vertex_count + u] = true;
+        }
+    }
+
+    u64 *counts = calloc(vertex_count, sizeof(u64));
+
+    for (u64 u = 0; u < vertex_count; ++u)
+    {
+        for (u64 v = u + 1; v < vertex_count; ++v)
+        {
+            if (!is_adjacent[u * vertex_count + v])
+                continue;
+
+            for (u64 w = v + 1; w < vertex_count; ++w)
+            {
+                if (is_adjacent[u * vertex_count + w] && is_adjacent[v * vertex_count + w])
+                {
+                    ++counts[u];
+                    ++counts[v];
+                    ++counts[w];
+                }
+            }
+        }
+    }
+
+    free(is_adjacent);
+
+    return counts;
+}
+
+static TEST_RESULT test_gphrx_intersect_sorted()
+{
+    u64 rng_state = 5;
+
+    size_t sizes[][2] = { {0, 10}, {1, 1}, {7, 9}, {100, 100}, {1000, 37}, {3, 2000}, {64, 64}, {500, 16} };
+
+    u64 *a = malloc(sizeof(u64) * 2000);
+    u64 *b = malloc(sizeof(u64) * 2000);
+    u64 *matches = malloc(sizeof(u64) * 2000);
+    u64 *expected = malloc(sizeof(u64) * 2000);
+
+    for (u32 t = 0; t < sizeof(sizes) / sizeof(sizes[0]); ++t)
+    {
+        for (u64 spread = 1; spread <= 8; spread *= 2)
+        {
+            size_t a_count = sizes[t][0];
+            size_t b_count = sizes[t][1];
+
+            // The longer list is spread more thinly so that the two cover similar ranges
+            fill_test_sorted_list(a, a_count, spread * (a_count < b_count ? b_count / (a_count + 1) + 1 : 1), &rng_state);
+            fill_test_sorted_list(b, b_count, spread * (b_count < a_count ? a_count / (b_count + 1) + 1 : 1), &rng_state);
+
+            u64 expected_count = 0;
+
+            for (size_t i = 0, j = 0; i < a_count && j < b_count;)
+            {
+                if (a[i] < b[j])
+                {
+                    ++i;
+                }
+                else if (a[i] > b[j])
+                {
+                    ++j;
+                }
+                else
+                {
+                    expected[expected_count++] = a[i];
+                    ++i;
+                    ++j;
+                }
+            }
+
+            // Every SIMD level the CPU supports, down to none
+            for (SimdLevel level = SIMD_LEVEL_NONE; level <= SIMD_LEVEL_AVX512; ++level)
+            {
+                cap_simd_level(level);
+
+                assert(gphrx_intersect_sorted(a, a_count, b, b_count, 0) == expected_count, "Incorrect count");
+                assert(gphrx_intersect_sorted(b, b_count, a, a_count, 0) == expected_count, "Incorrect count");
+
+                assert(gphrx_intersect_sorted(a, a_count, b, b_count, matches) == expected_count, "Incorrect count");
+
+                for (u64 i = 0; i < expected_count; ++i)
+                    assert(matches[i] == expected[i], "Incorrect match");
+            }
+        }
+    }
+
+    cap_simd_level(SIMD_LEVEL_AVX512);
+
+    // Identical lists match completely
+    fill_test_sorted_list(a, 1000, 3, &rng_state);
+    memcpy(b, a, sizeof(u64) * 1000);
+    assert(gphrx_intersect_sorted(a, 1000, b, 1000, 0) == 1000, "Incorrect count");
+
+    free(a);
+    free(b);
+    free(matches);
+    free(expected);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_count_triangles()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = new_skewed_random_test_graph(is_undirected, 400, 6000, 3 + is_undirected);
+
+            u64 *expected = find_test_triangle_counts(&graph);
+            u64 expected_count = 0;
+
+            for (u64 v = 0; v < graph.adjacency_matrix.dimension; ++v)
+                expected_count += expected[v];
+
+            expected_count /= 3;
+
+            assert(expected_count > 1000, "Test graph has too few triangles");
+            assert(gphrx_count_triangles(&graph) == expected_count, "Incorrect triangle count");
+
+            free(expected);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // A directed cycle and a pair of opposite edges are still triangles once direction is ignored
+    GphrxGraph graph = new_directed_gphrx();
+
+    gphrx_add_edge(&graph, 0, 1);
+    gphrx_add_edge(&graph, 1, 2);
+    gphrx_add_edge(&graph, 2, 0);
+    gphrx_add_edge(&graph, 0, 2);
+    gphrx_add_edge(&graph, 2, 2);
+
+    assert(gphrx_count_triangles(&graph) == 1, "Incorrect triangle count");
+
+    gphrx_add_edge(&graph, 3, 1);
+    gphrx_add_edge(&graph, 3, 2);
+
+    assert(gphrx_count_triangles(&graph) == 2, "Incorrect triangle count");
+
+    free_gphrx(&graph);
+
+    GphrxGraph empty_graph = new_undirected_gphrx();
+    assert(gphrx_count_triangles(&empty_graph) == 0, "Incorrect triangle count");
+    free_gphrx(&empty_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_gphrx_find_clustering_coefficients()
+{
+    u32 thread_counts[] = { 1, 4 };
+
+    for (u32 t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+    {
+        gphrx_set_num_threads(thread_counts[t]);
+
+        for (u32 is_undirected = 0; is_undirected < 2; ++is_undirected)
+        {
+            GphrxGraph graph = new_skewed_random_test_graph(is_undirected, 300, 3000, 7 + is_undirected);
+            GphrxClusteringResult result = gphrx_find_clustering_coefficients(&graph);
+
+            u64 *expected = find_test_triangle_counts(&graph);
+            u64 expected_count = 0;
+
+            assert(result.vertex_count == graph.adjacency_matrix.dimension, "Incorrect vertex count");
+
+            for (u64 v = 0; v < result.vertex_count; ++v)
+            {
+                assert(result.triangle_counts[v] == expected[v], "Incorrect vertex triangle count");
+                expected_count += expected[v];
+
+                u64 degree = 0;
+
+                for (u64 w = 0; w < result.vertex_count; ++w)
+                {
+                    if (w != v && (gphrx_does_edge_exist(&graph, v, w) || gphrx_does_edge_exist(&graph, w, v)))
+                        ++degree;
+                }
+
+                double coefficient = degree < 2 ? 0.0 : 2.0 * expected[v] / ((double) degree * (degree - 1));
+                assert(result.coefficients[v] == coefficient, "Incorrect clustering coefficient");
+            }
+
+            assert(result.triangle_count == expected_count / 3, "Incorrect triangle count");
+
+            free(expected);
+            free_gphrx_clustering_result(&result);
+            free_gphrx(&graph);
+        }
+    }
+
+    gphrx_set_num_threads(0);
+
+    // A square with one diagonal, and a vertex hanging off one corner
+    GphrxGraph graph = new_undirected_gphrx();
+
+    gphrx_add_edge(&graph, 0, 1);
+    gphrx_add_edge(&graph, 1, 2);
+    gphrx_add_edge(&graph, 2, 3);
+    gphrx_add_edge(&graph, 3, 0);
+    gphrx_add_edge(&graph, 0, 2);
+    gphrx_add_edge(&graph, 3, 4);
+
+    GphrxClusteringResult result = gphrx_find_clustering_coefficients(&graph);
+
+    assert(result.triangle_count == 2, "Incorrect triangle count");
+    assert(result.triangle_counts[0] == 2 && result.triangle_counts[1] == 1 && result.triangle_counts[4] == 0,
+           "Incorrect vertex triangle count");
+    assert(result.coefficients[0] == 2.0 / 3.0 && result.coefficients[1] == 1.0, "Incorrect clustering coefficient");
+    assert(result.coefficients[3] == 1.0 / 3.0 && result.coefficients[4] == 0.0, "Incorrect clustering coefficient");
+    assert(result.average_coefficient == (2.0 / 3.0 + 1.0 + 2.0 / 3.0 + 1.0 / 3.0) / 5.0,
+           "Incorrect average clustering coefficient");
+
+    free_gphrx_clustering_result(&result);
+    free_gphrx(&graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet triangles_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_gphrx_intersect_sorted);
+    register_test(&set, test_gphrx_count_triangles);
+    register_test(&set, test_gphrx_find_clustering_coefficients);
+
+    return set;
+}
+
+#endif
@@ -0,0 +1,442 @@
+#include "vgphrx.h"
+
+#include <sched.h>
+#include <stdint.h>
+
+// Readers start looking for a free slot at a per-thread position so that threads spread across the slots
+static atomic_uint next_preferred_slot = 0;
+static _Thread_local u32 preferred_slot = UINT32_MAX;
+
+DLLEXPORT GphrxVersionedGraph *new_vgphrx(GphrxGraph *restrict graph)
+{
+    GphrxVersionedGraph *versioned_graph = aligned_alloc(_Alignof(GphrxVersionedGraph),
+                                                         sizeof(GphrxVersionedGraph));
+    GphrxSnapshot *snapshot = malloc(sizeof(GphrxSnapshot));
+
+    assert(versioned_graph != 0, "aligned_alloc failure");
+    assert(snapshot != 0, "malloc failure");
+
+    snapshot->version = 0;
+    snapshot->graph = *graph;
+    snapshot->retired_epoch = 0;
+    snapshot->next_retired = 0;
+
+    atomic_init(&versioned_graph->current, snapshot);
+
+    // Zero marks a free reader slot, so epochs start at one
+    atomic_init(&versioned_graph->epoch, 1);
+
+    for (u32 i = 0; i < GPHRX_VERSIONED_READER_SLOTS; ++i)
+        atomic_init(&versioned_graph->reader_slots[i].epoch, 0);
+
+    pthread_mutex_init(&versioned_graph->writer_lock, 0);
+    versioned_graph->working_graph = duplicate_gphrx(&snapshot->graph);
+    versioned_graph->is_working_graph_dirty = false;
+    versioned_graph->retired = 0;
+    versioned_graph->retired_count = 0;
+
+    return versioned_graph;
+}
+
+DLLEXPORT void free_vgphrx(GphrxVersionedGraph *restrict versioned_graph)
+{
+    for (u32 i = 0; i < GPHRX_VERSIONED_READER_SLOTS; ++i)
+    {
+        assert(atomic_load(&versioned_graph->reader_slots[i].epoch) == 0,
+               "Versioned graph freed while a snapshot is pinned");
+    }
+
+    GphrxSnapshot *snapshot = atomic_load(&versioned_graph->current);
+    free_gphrx(&snapshot->graph);
+    free(snapshot);
+
+    snapshot = versioned_graph->retired;
+    while (snapshot)
+    {
+        GphrxSnapshot *next = snapshot->next_retired;
+
+        free_gphrx(&snapshot->graph);
+        free(snapshot);
+
+        snapshot = next;
+    }
+
+    free_gphrx(&versioned_graph->working_graph);
+    pthread_mutex_destroy(&versioned_graph->writer_lock);
+
+    free(versioned_graph);
+}
+
+u32 _vgphrx_announce_reader(GphrxVersionedGraph *restrict versioned_graph)
+{
+    if (preferred_slot == UINT32_MAX)
+        preferred_slot = atomic_fetch_add(&next_preferred_slot, 1) % GPHRX_VERSIONED_READER_SLOTS;
+
+    u32 slot = preferred_slot;
+
+    // Announce the epoch before loading the snapshot. A writer that replaces the snapshot after this point
+    // will see the announcement and keep the snapshot; one that replaced it before will have advanced the
+    // epoch, so the load below sees its replacement. Both sides use sequentially consistent operations so
+    // the announcement can't be reordered after the load.
+    for (u32 attempts = 1; ; ++attempts)
+    {
+        u64 free_epoch = 0;
+        u64 epoch = atomic_load(&versioned_graph->epoch);
+
+        if (atomic_compare_exchange_strong(&versioned_graph->reader_slots[slot].epoch, &free_epoch, epoch))
+            break;
+
+        slot = (slot + 1) % GPHRX_VERSIONED_READER_SLOTS;
+
+        if (attempts % GPHRX_VERSIONED_READER_SLOTS == 0)
+            sched_yield();
+    }
+
+    return slot;
+}
+
+u64 _vgphrx_oldest_pinned_epoch(GphrxVersionedGraph *restrict versioned_graph)
+{
+    u64 oldest_pinned_epoch = UINT64_MAX;
+
+    for (u32 i = 0; i < GPHRX_VERSIONED_READER_SLOTS; ++i)
+    {
+        u64 epoch = atomic_load(&versioned_graph->reader_slots[i].epoch);
+
+        if (epoch != 0 && epoch < oldest_pinned_epoch)
+            oldest_pinned_epoch = epoch;
+    }
+
+    return oldest_pinned_epoch;
+}
+
+DLLEXPORT GphrxSnapshotGuard vgphrx_pin(GphrxVersionedGraph *restrict versioned_graph)
+{
+    u32 slot = _vgphrx_announce_reader(versioned_graph);
+    GphrxSnapshot *snapshot = atomic_load(&versioned_graph->current);
+
+    GphrxSnapshotGuard guard = {
+        .graph = &snapshot->graph,
+        .version = snapshot->version,
+        .slot = slot,
+    };
+
+    return guard;
+}
+
+DLLEXPORT void vgphrx_unpin(GphrxVersionedGraph *restrict versioned_graph, GphrxSnapshotGuard *restrict guard)
+{
+    atomic_store_explicit(&versioned_graph->reader_slots[guard->slot].epoch, 0, memory_order_release);
+    guard->graph = 0;
+}
+
+DLLEXPORT u64 vgphrx_current_version(GphrxVersionedGraph *restrict versioned_graph)
+{
+    // Snapshots are only freed once replaced and unpinned, so the current one can't be freed while its
+    // version is read
+    GphrxSnapshotGuard guard = vgphrx_pin(versioned_graph);
+    u64 version = guard.version;
+    vgphrx_unpin(versioned_graph, &guard);
+
+    return version;
+}
+
+// Must be called with the writer lock held
+static void reclaim_locked(GphrxVersionedGraph *restrict versioned_graph)
+{
+    u64 oldest_pinned_epoch = _vgphrx_oldest_pinned_epoch(versioned_graph);
+
+    // A reader that pinned in or before the epoch in which a snapshot was retired may still hold it
+    GphrxSnapshot **link = &versioned_graph->retired;
+    while (*link)
+    {
+        GphrxSnapshot *snapshot = *link;
+
+        if (snapshot->retired_epoch < oldest_pinned_epoch)
+        {
+            *link = snapshot->next_retired;
+
+            free_gphrx(&snapshot->graph);
+            free(snapshot);
+
+            --versioned_graph->retired_count;
+        }
+        else
+        {
+            link = &snapshot->next_retired;
+        }
+    }
+}
+
+// Must be called with the writer lock held
+static u64 publish_locked(GphrxVersionedGraph *restrict versioned_graph)
+{
+    GphrxSnapshot *previous = atomic_load(&versioned_graph->current);
+
+    if (!versioned_graph->is_working_graph_dirty)
+    {
+        reclaim_locked(versioned_graph);
+        return previous->version;
+    }
+
+    GphrxSnapshot *snapshot = malloc(sizeof(GphrxSnapshot));
+    assert(snapshot != 0, "malloc failure");
+
+    snapshot->version = previous->version + 1;
+    snapshot->graph = duplicate_gphrx(&versioned_graph->working_graph);
+    snapshot->retired_epoch = 0;
+    snapshot->next_retired = 0;
+
+    atomic_store(&versioned_graph->current, snapshot);
+
+    previous->retired_epoch = atomic_fetch_add(&versioned_graph->epoch, 1);
+    previous->next_retired = versioned_graph->retired;
+    versioned_graph->retired = previous;
+    ++versioned_graph->retired_count;
+
+    versioned_graph->is_working_graph_dirty = false;
+
+    reclaim_locked(versioned_graph);
+
+    return snapshot->version;
+}
+
+DLLEXPORT GphrxGraph *vgphrx_begin_write(GphrxVersionedGraph *restrict versioned_graph)
+{
+    pthread_mutex_lock(&versioned_graph->writer_lock);
+
+    // The caller may change anything, so assume it does
+    versioned_graph->is_working_graph_dirty = true;
+    _gphrx_drop_vertex_index(&versioned_graph->working_graph);
+
+    return &versioned_graph->working_graph;
+}
+
+DLLEXPORT u64 vgphrx_end_write(GphrxVersionedGraph *restrict versioned_graph, bool publish)
+{
+    u64 version = publish
+        ? publish_locked(versioned_graph)
+        : atomic_load(&versioned_graph->current)->version;
+
+    pthread_mutex_unlock(&versioned_graph->writer_lock);
+
+    return version;
+}
+
+DLLEXPORT void vgphrx_add_edge(GphrxVersionedGraph *restrict versioned_graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    pthread_mutex_lock(&versioned_graph->writer_lock);
+
+    gphrx_add_edge(&versioned_graph->working_graph, from_vertex_id, to_vertex_id);
+    versioned_graph->is_working_graph_dirty = true;
+
+    pthread_mutex_unlock(&versioned_graph->writer_lock);
+}
+
+DLLEXPORT GphrxErrorCode vgphrx_remove_edge(GphrxVersionedGraph *restrict versioned_graph,
+                                            u64 from_vertex_id,
+                                            u64 to_vertex_id)
+{
+    pthread_mutex_lock(&versioned_graph->writer_lock);
+
+    GphrxErrorCode error = gphrx_remove_edge(&versioned_graph->working_graph, from_vertex_id, to_vertex_id);
+
+    if (error == GPHRX_NO_ERROR)
+        versioned_graph->is_working_graph_dirty = true;
+
+    pthread_mutex_unlock(&versioned_graph->writer_lock);
+
+    return error;
+}
+
+DLLEXPORT u64 vgphrx_publish(GphrxVersionedGraph *restrict versioned_graph)
+{
+    pthread_mutex_lock(&versioned_graph->writer_lock);
+    u64 version = publish_locked(versioned_graph);
+    pthread_mutex_unlock(&versioned_graph->writer_lock);
+
+    return version;
+}
+
+DLLEXPORT void vgphrx_reclaim(GphrxVersionedGraph *restrict versioned_graph)
+{
+    pthread_mutex_lock(&versioned_graph->writer_lock);
+    reclaim_locked(versioned_graph);
+    pthread_mutex_unlock(&versioned_graph->writer_lock);
+}
+
+
+#ifdef TEST_MODE
+
+static TEST_RESULT test_vgphrx_pin_and_publish()
+{
+    GphrxGraph graph = new_directed_gphrx();
+    gphrx_add_edge(&graph, 1, 2);
+
+    GphrxVersionedGraph *versioned_graph = new_vgphrx(&graph);
+
+    assert(vgphrx_current_version(versioned_graph) == 0, "Incorrect initial version");
+
+    GphrxSnapshotGuard first = vgphrx_pin(versioned_graph);
+    assert(first.version == 0, "Incorrect pinned version");
+    assert(gphrx_does_edge_exist(first.graph, 1, 2), "Edge missing from snapshot");
+
+    vgphrx_add_edge(versioned_graph, 3, 4);
+    assert(vgphrx_remove_edge(versioned_graph, 1, 2) == GPHRX_NO_ERROR, "Error removing edge");
+    assert(vgphrx_remove_edge(versioned_graph, 7, 7) == GPHRX_ERROR_NOT_FOUND, "Removed missing edge");
+
+    // Writes are invisible until published
+    GphrxSnapshotGuard unpublished = vgphrx_pin(versioned_graph);
+    assert(unpublished.version == 0, "Unpublished write changed the version");
+    assert(!gphrx_does_edge_exist(unpublished.graph, 3, 4), "Unpublished edge visible");
+    assert(unpublished.slot != first.slot, "Two pins share a slot");
+    vgphrx_unpin(versioned_graph, &unpublished);
+
+    assert(vgphrx_publish(versioned_graph) == 1, "Incorrect published version");
+
+    // The old snapshot stays intact while pinned
+    assert(gphrx_does_edge_exist(first.graph, 1, 2), "Pinned snapshot changed");
+    assert(!gphrx_does_edge_exist(first.graph, 3, 4), "Pinned snapshot changed");
+    assert(versioned_graph->retired_count == 1, "Pinned snapshot was reclaimed");
+
+    GphrxSnapshotGuard second = vgphrx_pin(versioned_graph);
+    assert(second.version == 1, "Incorrect pinned version");
+    assert(!gphrx_does_edge_exist(second.graph, 1, 2), "Removed edge visible after publish");
+    assert(gphrx_does_edge_exist(second.graph, 3, 4), "Added edge not visible after publish");
+
+    vgphrx_unpin(versioned_graph, &first);
+    assert(first.graph == 0, "Guard not cleared");
+
+    // Publishing without changes keeps the version but still reclaims
+    assert(vgphrx_publish(versioned_graph) == 1, "Publish without changes created a version");
+    assert(versioned_graph->retired_count == 0, "Unpinned snapshot was not reclaimed");
+
+    GphrxGraph *working_graph = vgphrx_begin_write(versioned_graph);
+    gphrx_add_edge(working_graph, 5, 6);
+    gphrx_add_edge(working_graph, 6, 5);
+    assert(vgphrx_end_write(versioned_graph, false) == 1, "Write without publishing changed the version");
+
+    // The second snapshot is still pinned, so it outlives the publish
+    working_graph = vgphrx_begin_write(versioned_graph);
+    gphrx_remove_edge(working_graph, 6, 5);
+    assert(vgphrx_end_write(versioned_graph, true) == 2, "Incorrect published version");
+    assert(versioned_graph->retired_count == 1, "Pinned snapshot was reclaimed");
+
+    GphrxSnapshotGuard third = vgphrx_pin(versioned_graph);
+    assert(gphrx_does_edge_exist(third.graph, 5, 6), "Added edge not visible after publish");
+    assert(!gphrx_does_edge_exist(third.graph, 6, 5), "Removed edge visible after publish");
+    vgphrx_unpin(versioned_graph, &third);
+
+    vgphrx_unpin(versioned_graph, &second);
+    vgphrx_reclaim(versioned_graph);
+    assert(versioned_graph->retired_count == 0, "Unpinned snapshot was not reclaimed");
+
+    free_vgphrx(versioned_graph);
+
+    return TEST_PASS;
+}
+
+#define CONCURRENT_TEST_PUBLISHES 200
+#define CONCURRENT_TEST_EDGES_PER_PUBLISH 10
+#define CONCURRENT_TEST_READERS 4
+
+typedef struct {
+    GphrxVersionedGraph *versioned_graph;
+    atomic_bool is_writer_done;
+    atomic_uint failures;
+    atomic_uint snapshots_checked;
+} ConcurrentTestContext;
+
+static void *concurrent_test_reader(void *arg)
+{
+    ConcurrentTestContext *context = arg;
+
+    while (!atomic_load(&context->is_writer_done))
+    {
+        GphrxSnapshotGuard guard = vgphrx_pin(context->versioned_graph);
+
+        // Version v holds exactly the edges (i, i + 1) for i < v * CONCURRENT_TEST_EDGES_PER_PUBLISH
+        u64 expected_edges = guard.version * CONCURRENT_TEST_EDGES_PER_PUBLISH;
+
+        if (guard.graph->adjacency_matrix.col_indices.size != expected_edges)
+            atomic_fetch_add(&context->failures, 1);
+
+        for (u64 i = 0; i < expected_edges; i += 7)
+        {
+            if (!gphrx_does_edge_exist(guard.graph, i, i + 1))
+                atomic_fetch_add(&context->failures, 1);
+        }
+
+        if (gphrx_does_edge_exist(guard.graph, expected_edges, expected_edges + 1))
+            atomic_fetch_add(&context->failures, 1);
+
+        atomic_fetch_add(&context->snapshots_checked, 1);
+
+        vgphrx_unpin(context->versioned_graph, &guard);
+    }
+
+    return 0;
+}
+
+static TEST_RESULT test_vgphrx_concurrent_readers()
+{
+    GphrxGraph graph = new_directed_gphrx();
+
+    ConcurrentTestContext context = {
+        .versioned_graph = new_vgphrx(&graph),
+    };
+
+    atomic_init(&context.is_writer_done, false);
+    atomic_init(&context.failures, 0);
+    atomic_init(&context.snapshots_checked, 0);
+
+    pthread_t readers[CONCURRENT_TEST_READERS];
+    for (u32 i = 0; i < CONCURRENT_TEST_READERS; ++i)
+        pthread_create(readers + i, 0, concurrent_test_reader, &context);
+
+    u64 next_edge = 0;
+    for (u32 publish = 0; publish < CONCURRENT_TEST_PUBLISHES; ++publish)
+    {
+        GphrxGraph *working_graph = vgphrx_begin_write(context.versioned_graph);
+
+        for (u32 i = 0; i < CONCURRENT_TEST_EDGES_PER_PUBLISH; ++i, ++next_edge)
+            gphrx_add_edge(working_graph, next_edge, next_edge + 1);
+
+        vgphrx_end_write(context.versioned_graph, true);
+
+        if (publish % 16 == 0)
+            sched_yield();
+    }
+
+    atomic_store(&context.is_writer_done, true);
+
+    for (u32 i = 0; i < CONCURRENT_TEST_READERS; ++i)
+        pthread_join(readers[i], 0);
+
+    assert(atomic_load(&context.failures) == 0, "Reader saw an inconsistent snapshot");
+    assert(atomic_load(&context.snapshots_checked) > 0, "Readers checked no snapshots");
+    assert(vgphrx_current_version(context.versioned_graph) == CONCURRENT_TEST_PUBLISHES, "Incorrect final version");
+
+    vgphrx_reclaim(context.versioned_graph);
+    assert(context.versioned_graph->retired_count == 0, "Snapshots not reclaimed after readers finished");
+
+    free_vgphrx(context.versioned_graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet vgphrx_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_vgphrx_pin_and_publish);
+    register_test(&set, test_vgphrx_concurrent_readers);
+
+    return set;
+}
+
+#endif
@@ -0,0 +1,782 @@
+#include "wgphrx.h"
+
+static GphrxWeightedGraph new_wgphrx(bool is_undirected, GphrxWeightPrecision precision)
+{
+    assert(precision == GPHRX_WEIGHT_F32 || precision == GPHRX_WEIGHT_F64, "Invalid weight precision");
+
+    GphrxCsrAdjacencyMatrix adjacency_matrix = {
+        .dimension = 0,
+        .col_indices = new_dynarr8(),
+        .row_indices = new_dynarr8(),
+    };
+
+    GphrxWeightedGraph graph = {
+        .is_undirected = is_undirected,
+        .precision = precision,
+        .adjacency_matrix = adjacency_matrix,
+    };
+
+    if (precision == GPHRX_WEIGHT_F32)
+        graph.weights.f32 = new_dynarr4();
+    else
+        graph.weights.f64 = new_dynarr8();
+
+    return graph;
+}
+
+static double get_weight(GphrxWeightedGraph *restrict graph, size_t idx)
+{
+    if (graph->precision == GPHRX_WEIGHT_F32)
+        return (double) dynarr4_get(&graph->weights.f32, idx).flt_val;
+    else
+        return dynarr8_get(&graph->weights.f64, idx).dbl_val;
+}
+
+static void set_weight(GphrxWeightedGraph *restrict graph, size_t idx, double weight)
+{
+    if (graph->precision == GPHRX_WEIGHT_F32)
+        graph->weights.f32.arr[idx].flt_val = (float) weight;
+    else
+        graph->weights.f64.arr[idx].dbl_val = weight;
+}
+
+static void push_weight_at(GphrxWeightedGraph *restrict graph, size_t idx, double weight)
+{
+    if (graph->precision == GPHRX_WEIGHT_F32)
+    {
+        Byte4Val weight_bv = { .flt_val = (float) weight };
+        dynarr4_push_at(&graph->weights.f32, weight_bv, idx);
+    }
+    else
+    {
+        Byte8Val weight_bv = { .dbl_val = weight };
+        dynarr8_push_at(&graph->weights.f64, weight_bv, idx);
+    }
+}
+
+static void remove_weight_at(GphrxWeightedGraph *restrict graph, size_t idx)
+{
+    if (graph->precision == GPHRX_WEIGHT_F32)
+        dynarr4_remove_at(&graph->weights.f32, idx);
+    else
+        dynarr8_remove_at(&graph->weights.f64, idx);
+}
+
+static bool is_edge_at(GphrxCsrAdjacencyMatrix *restrict matrix, size_t idx, u64 from_vertex_id, u64 to_vertex_id)
+{
+    return idx < matrix->col_indices.size &&
+        dynarr8_get(&matrix->col_indices, idx).u64_val == from_vertex_id &&
+        dynarr8_get(&matrix->row_indices, idx).u64_val == to_vertex_id;
+}
+
+DLLEXPORT GphrxWeightedGraph new_undirected_wgphrx(GphrxWeightPrecision precision)
+{
+    return new_wgphrx(true, precision);
+}
+
+DLLEXPORT GphrxWeightedGraph new_directed_wgphrx(GphrxWeightPrecision precision)
+{
+    return new_wgphrx(false, precision);
+}
+
+DLLEXPORT GphrxWeightedGraph duplicate_wgphrx(GphrxWeightedGraph *restrict graph)
+{
+    GphrxGraph unweighted_graph = {
+        .is_undirected = graph->is_undirected,
+        .adjacency_matrix = graph->adjacency_matrix,
+    };
+
+    GphrxGraph duplicate_unweighted_graph = duplicate_gphrx(&unweighted_graph);
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+
+    GphrxWeightedGraph duplicate_graph = {
+        .is_undirected = graph->is_undirected,
+        .precision = graph->precision,
+        .adjacency_matrix = duplicate_unweighted_graph.adjacency_matrix,
+    };
+
+    if (graph->precision == GPHRX_WEIGHT_F32)
+    {
+        duplicate_graph.weights.f32 = new_dynarr4_with_capacity(edge_count + 1);
+        duplicate_graph.weights.f32.size = edge_count;
+        memcpy(duplicate_graph.weights.f32.arr, graph->weights.f32.arr, edge_count * sizeof(float));
+    }
+    else
+    {
+        duplicate_graph.weights.f64 = new_dynarr8_with_capacity(edge_count + 1);
+        duplicate_graph.weights.f64.size = edge_count;
+        memcpy(duplicate_graph.weights.f64.arr, graph->weights.f64.arr, edge_count * sizeof(double));
+    }
+
+    return duplicate_graph;
+}
+
+DLLEXPORT void free_wgphrx(GphrxWeightedGraph *restrict graph)
+{
+    free_gphrx_csr_adj_matrix(&graph->adjacency_matrix);
+
+    if (graph->precision == GPHRX_WEIGHT_F32)
+        free_dynarr4(&graph->weights.f32);
+    else
+        free_dynarr8(&graph->weights.f64);
+}
+
+DLLEXPORT void wgphrx_shrink(GphrxWeightedGraph *restrict graph)
+{
+    dynarr8_shrink(&graph->adjacency_matrix.col_indices);
+    dynarr8_shrink(&graph->adjacency_matrix.row_indices);
+
+    if (graph->precision == GPHRX_WEIGHT_F32)
+        dynarr4_shrink(&graph->weights.f32);
+    else
+        dynarr8_shrink(&graph->weights.f64);
+}
+
+DLLEXPORT bool wgphrx_does_edge_exist(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    if (from_vertex_id >= graph->adjacency_matrix.dimension || to_vertex_id >= graph->adjacency_matrix.dimension)
+        return false;
+
+    size_t edge_idx = _gphrx_index_of_edge(&graph->adjacency_matrix, from_vertex_id, to_vertex_id);
+    return is_edge_at(&graph->adjacency_matrix, edge_idx, from_vertex_id, to_vertex_id);
+}
+
+DLLEXPORT double wgphrx_get_edge_weight(GphrxWeightedGraph *restrict graph,
+                                        u64 from_vertex_id,
+                                        u64 to_vertex_id,
+                                        GphrxErrorCode *restrict error)
+{
+    *error = GPHRX_NO_ERROR;
+
+    if (from_vertex_id < graph->adjacency_matrix.dimension && to_vertex_id < graph->adjacency_matrix.dimension)
+    {
+        size_t edge_idx = _gphrx_index_of_edge(&graph->adjacency_matrix, from_vertex_id, to_vertex_id);
+
+        if (is_edge_at(&graph->adjacency_matrix, edge_idx, from_vertex_id, to_vertex_id))
+            return get_weight(graph, edge_idx);
+    }
+
+    *error = GPHRX_ERROR_NOT_FOUND;
+    return 0.0;
+}
+
+static void add_directed_edge(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id, double weight)
+{
+    size_t edge_idx = from_vertex_id >= graph->adjacency_matrix.dimension
+        ? graph->adjacency_matrix.col_indices.size
+        : _gphrx_index_of_edge(&graph->adjacency_matrix, from_vertex_id, to_vertex_id);
+
+    if (is_edge_at(&graph->adjacency_matrix, edge_idx, from_vertex_id, to_vertex_id))
+    {
+        // The edge already exists
+        set_weight(graph, edge_idx, weight);
+        return;
+    }
+
+    Byte8Val from_vertex_id_bv = { .u64_val = from_vertex_id };
+    Byte8Val to_vertex_id_bv = { .u64_val = to_vertex_id };
+
+    dynarr8_push_at(&graph->adjacency_matrix.col_indices, from_vertex_id_bv, edge_idx);
+    dynarr8_push_at(&graph->adjacency_matrix.row_indices, to_vertex_id_bv, edge_idx);
+    push_weight_at(graph, edge_idx, weight);
+}
+
+DLLEXPORT void wgphrx_add_edge(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id, double weight)
+{
+    add_directed_edge(graph, from_vertex_id, to_vertex_id, weight);
+
+    if (from_vertex_id + 1 > graph->adjacency_matrix.dimension)
+        graph->adjacency_matrix.dimension = from_vertex_id + 1;
+
+    if (graph->is_undirected && from_vertex_id != to_vertex_id)
+        add_directed_edge(graph, to_vertex_id, from_vertex_id, weight);
+
+    if (to_vertex_id + 1 > graph->adjacency_matrix.dimension)
+        graph->adjacency_matrix.dimension = to_vertex_id + 1;
+}
+
+static GphrxErrorCode remove_directed_edge(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    size_t edge_idx = _gphrx_index_of_edge(&graph->adjacency_matrix, from_vertex_id, to_vertex_id);
+
+    if (!is_edge_at(&graph->adjacency_matrix, edge_idx, from_vertex_id, to_vertex_id))
+        return GPHRX_ERROR_NOT_FOUND;
+
+    dynarr8_remove_at(&graph->adjacency_matrix.col_indices, edge_idx);
+    dynarr8_remove_at(&graph->adjacency_matrix.row_indices, edge_idx);
+    remove_weight_at(graph, edge_idx);
+
+    return GPHRX_NO_ERROR;
+}
+
+DLLEXPORT GphrxErrorCode wgphrx_remove_edge(GphrxWeightedGraph *restrict graph, u64 from_vertex_id, u64 to_vertex_id)
+{
+    if (graph->adjacency_matrix.col_indices.size == 0)
+        return GPHRX_ERROR_NOT_FOUND;
+
+    GphrxErrorCode error = remove_directed_edge(graph, from_vertex_id, to_vertex_id);
+
+    if (error == GPHRX_NO_ERROR && graph->is_undirected && from_vertex_id != to_vertex_id)
+        remove_directed_edge(graph, to_vertex_id, from_vertex_id);
+
+    return error;
+}
+
+typedef struct {
+    u64 occurrences;
+    double weight_sum;
+} WeightedBlock;
+
+// Pools the occurrences and weights of every edge into a dense, row-major array of blocks in a single pass
+// over the edges.
+static WeightedBlock *pool_weighted_blocks(GphrxWeightedGraph *restrict graph, u64 block_dimension, u64 blocks_per_row)
+{
+    WeightedBlock *blocks = calloc(blocks_per_row * blocks_per_row + 1, sizeof(WeightedBlock));
+
+    assert(blocks != 0, "calloc failure");
+
+    u64 *col_indices = (u64*) graph->adjacency_matrix.col_indices.arr;
+    u64 *row_indices = (u64*) graph->adjacency_matrix.row_indices.arr;
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+
+    FastDivisor divisor = new_fast_divisor(block_dimension);
+
+    if (graph->precision == GPHRX_WEIGHT_F32)
+    {
+        float *weights = (float*) graph->weights.f32.arr;
+
+        for (size_t i = 0; i < edge_count; ++i)
+        {
+            WeightedBlock *block = blocks
+                + fast_divisor_divide(&divisor, row_indices[i]) * blocks_per_row
+                + fast_divisor_divide(&divisor, col_indices[i]);
+
+            ++block->occurrences;
+            block->weight_sum += weights[i];
+        }
+    }
+    else
+    {
+        double *weights = (double*) graph->weights.f64.arr;
+
+        for (size_t i = 0; i < edge_count; ++i)
+        {
+            WeightedBlock *block = blocks
+                + fast_divisor_divide(&divisor, row_indices[i]) * blocks_per_row
+                + fast_divisor_divide(&divisor, col_indices[i]);
+
+            ++block->occurrences;
+            block->weight_sum += weights[i];
+        }
+    }
+
+    return blocks;
+}
+
+DLLEXPORT GphrxCsrMatrix wgphrx_find_avg_pool_matrix(GphrxWeightedGraph *restrict graph, u64 block_dimension)
+{
+    if (block_dimension < 1)
+        block_dimension = 1;
+
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    if (block_dimension > vertex_count && vertex_count != 0)
+        block_dimension = vertex_count;
+
+    u64 blocks_per_row = _gphrx_avg_pool_blocks_per_row(vertex_count, block_dimension);
+    u64 block_count = blocks_per_row * blocks_per_row;
+
+    WeightedBlock *blocks = pool_weighted_blocks(graph, block_dimension, blocks_per_row);
+
+    GphrxCsrMatrix avg_pool_matrix = {
+        .dimension = blocks_per_row,
+        .entries = new_dynarr8_with_capacity(block_count + 1),
+        .col_indices = new_dynarr8_with_capacity(block_count + 1),
+        .row_indices = new_dynarr8_with_capacity(block_count + 1),
+    };
+
+    double block_size = (double) block_dimension * (double) block_dimension;
+    for (size_t col = 0; col < blocks_per_row; ++col)
+    {
+        for (size_t row = 0; row < blocks_per_row; ++row)
+        {
+            WeightedBlock *block = blocks + row * blocks_per_row + col;
+
+            if (block->occurrences != 0)
+            {
+                Byte8Val entry_bv = { .dbl_val = block->weight_sum / block_size };
+                Byte8Val col_bv = { .u64_val = col };
+                Byte8Val row_bv = { .u64_val = row };
+
+                dynarr8_push(&avg_pool_matrix.entries, entry_bv);
+                dynarr8_push(&avg_pool_matrix.col_indices, col_bv);
+                dynarr8_push(&avg_pool_matrix.row_indices, row_bv);
+            }
+        }
+    }
+
+    free(blocks);
+
+    return avg_pool_matrix;
+}
+
+DLLEXPORT GphrxWeightedGraph approximate_wgphrx(GphrxWeightedGraph *restrict graph, u64 block_dimension, double threshold)
+{
+    if (block_dimension <= 1 || graph->adjacency_matrix.col_indices.size <= 1)
+        return duplicate_wgphrx(graph);
+
+    u64 vertex_count = graph->adjacency_matrix.dimension;
+
+    if (block_dimension > vertex_count)
+        block_dimension = vertex_count;
+
+    u64 blocks_per_row = _gphrx_avg_pool_blocks_per_row(vertex_count, block_dimension);
+
+    if (threshold > 1.0f)
+        threshold = 1.0f;
+    else if (threshold <= 0.0f)
+        threshold = 0.00000001f;
+
+    WeightedBlock *blocks = pool_weighted_blocks(graph, block_dimension, blocks_per_row);
+
+    GphrxWeightedGraph approx_graph = new_wgphrx(graph->is_undirected, graph->precision);
+    approx_graph.adjacency_matrix.dimension = blocks_per_row;
+
+    double block_size = (double) block_dimension * (double) block_dimension;
+    for (size_t col = 0; col < blocks_per_row; ++col)
+    {
+        for (size_t row = 0; row < blocks_per_row; ++row)
+        {
+            WeightedBlock *block = blocks + row * blocks_per_row + col;
+
+            if (block->occurrences != 0 && block->occurrences / block_size >= threshold)
+            {
+                Byte8Val col_bv = { .u64_val = col };
+                Byte8Val row_bv = { .u64_val = row };
+
+                dynarr8_push(&approx_graph.adjacency_matrix.col_indices, col_bv);
+                dynarr8_push(&approx_graph.adjacency_matrix.row_indices, row_bv);
+                push_weight_at(&approx_graph,
+                               approx_graph.adjacency_matrix.col_indices.size - 1,
+                               block->weight_sum / block_size);
+            }
+        }
+    }
+
+    free(blocks);
+
+    return approx_graph;
+}
+
+static void write_u32_big_endian(byte *restrict buffer, size_t *restrict pos, u32 value)
+{
+    if (!is_system_big_endian())
+        value = u32_reverse_bits(value);
+
+    memcpy(buffer + *pos, &value, sizeof(u32));
+    *pos += sizeof(u32);
+}
+
+static void write_u64_big_endian(byte *restrict buffer, size_t *restrict pos, u64 value)
+{
+    if (!is_system_big_endian())
+        value = u64_reverse_bits(value);
+
+    memcpy(buffer + *pos, &value, sizeof(u64));
+    *pos += sizeof(u64);
+}
+
+static u32 read_u32_big_endian(byte *restrict buffer, size_t *restrict pos)
+{
+    u32 value;
+    memcpy(&value, buffer + *pos, sizeof(u32));
+    *pos += sizeof(u32);
+
+    return is_system_big_endian() ? value : u32_reverse_bits(value);
+}
+
+static u64 read_u64_big_endian(byte *restrict buffer, size_t *restrict pos)
+{
+    u64 value;
+    memcpy(&value, buffer + *pos, sizeof(u64));
+    *pos += sizeof(u64);
+
+    return is_system_big_endian() ? value : u64_reverse_bits(value);
+}
+
+DLLEXPORT byte *wgphrx_to_byte_array(GphrxWeightedGraph *restrict graph)
+{
+    size_t edge_count = graph->adjacency_matrix.col_indices.size;
+    size_t header_size = 2 * sizeof(u32) + 2 * sizeof(u64) + 2 * sizeof(u8);
+    size_t buffer_size = header_size + edge_count * (2 * sizeof(u64) + graph->precision);
+
+    byte *buffer = malloc(buffer_size);
+    size_t pos = 0;
+
+    assert(buffer != 0, "malloc failure");
+
+    write_u32_big_endian(buffer, &pos, GPHRX_HEADER_MAGIC_NUMBER);
+    write_u32_big_endian(buffer, &pos, GPHRX_BYTE_ARRAY_VERSION);
+    write_u64_big_endian(buffer, &pos, graph->adjacency_matrix.dimension);
+    write_u64_big_endian(buffer, &pos, (u64) edge_count);
+
+    buffer[pos++] = (u8) graph->is_undirected;
+    buffer[pos++] = graph->precision;
+
+    for (size_t i = 0; i < edge_count; ++i)
+        write_u64_big_endian(buffer, &pos, graph->adjacency_matrix.col_indices.arr[i].u64_val);
+
+    for (size_t i = 0; i < edge_count; ++i)
+        write_u64_big_endian(buffer, &pos, graph->adjacency_matrix.row_indices.arr[i].u64_val);
+
+    if (graph->precision == GPHRX_WEIGHT_F32)
+    {
+        for (size_t i = 0; i < edge_count; ++i)
+            write_u32_big_endian(buffer, &pos, graph->weights.f32.arr[i].u32_val);
+    }
+    else
+    {
+        for (size_t i = 0; i < edge_count; ++i)
+            write_u64_big_endian(buffer, &pos, graph->weights.f64.arr[i].u64_val);
+    }
+
+    return buffer;
+}
+
+DLLEXPORT GphrxWeightedGraph wgphrx_from_byte_array(byte *restrict arr, GphrxErrorCode *restrict error)
+{
+    *error = GPHRX_NO_ERROR;
+    GphrxWeightedGraph graph = {0};
+
+    size_t pos = 0;
+    GphrxByteArrayHeader header;
+
+    header.magic_number = read_u32_big_endian(arr, &pos);
+
+    if (header.magic_number != GPHRX_HEADER_MAGIC_NUMBER)
+    {
+        *error = GPHRX_ERROR_INVALID_FORMAT;
+        return graph;
+    }
+
+    header.version = read_u32_big_endian(arr, &pos);
+    header.adjacency_matrix_dimension = read_u64_big_endian(arr, &pos);
+    header.csr_adjacency_matrix_size = read_u64_big_endian(arr, &pos);
+    header.is_undirected = arr[pos++];
+    header.is_weighted = arr[pos++];
+
+    if (header.is_weighted != 0 && header.is_weighted != GPHRX_WEIGHT_F32 && header.is_weighted != GPHRX_WEIGHT_F64)
+    {
+        *error = GPHRX_ERROR_INVALID_FORMAT;
+        return graph;
+    }
+
+    size_t edge_count = header.csr_adjacency_matrix_size;
+    GphrxWeightPrecision precision = header.is_weighted == 0 ? GPHRX_WEIGHT_F64 : header.is_weighted;
+
+    graph.is_undirected = header.is_undirected;
+    graph.precision = precision;
+    graph.adjacency_matrix.dimension = header.adjacency_matrix_dimension;
+    graph.adjacency_matrix.col_indices = new_dynarr8_with_capacity(edge_count + 1);
+    graph.adjacency_matrix.row_indices = new_dynarr8_with_capacity(edge_count + 1);
+    graph.adjacency_matrix.col_indices.size = edge_count;
+    graph.adjacency_matrix.row_indices.size = edge_count;
+
+    for (size_t i = 0; i < edge_count; ++i)
+        graph.adjacency_matrix.col_indices.arr[i].u64_val = read_u64_big_endian(arr, &pos);
+
+    for (size_t i = 0; i < edge_count; ++i)
+        graph.adjacency_matrix.row_indices.arr[i].u64_val = read_u64_big_endian(arr, &pos);
+
+    if (precision == GPHRX_WEIGHT_F32)
+    {
+        graph.weights.f32 = new_dynarr4_with_capacity(edge_count + 1);
+        graph.weights.f32.size = edge_count;
+
+        for (size_t i = 0; i < edge_count; ++i)
+            graph.weights.f32.arr[i].u32_val = read_u32_big_endian(arr, &pos);
+    }
+    else
+    {
+        graph.weights.f64 = new_dynarr8_with_capacity(edge_count + 1);
+        graph.weights.f64.size = edge_count;
+
+        for (size_t i = 0; i < edge_count; ++i)
+        {
+            if (header.is_weighted == 0)
+                graph.weights.f64.arr[i].dbl_val = 1.0;
+            else
+                graph.weights.f64.arr[i].u64_val = read_u64_big_endian(arr, &pos);
+        }
+    }
+
+    return graph;
+}
+
+#ifdef TEST_MODE
+
+static TEST_RESULT test_new_wgphrx()
+{
+    GphrxWeightedGraph undirected_graph = new_undirected_wgphrx(GPHRX_WEIGHT_F64);
+    GphrxWeightedGraph directed_graph = new_directed_wgphrx(GPHRX_WEIGHT_F32);
+
+    assert(undirected_graph.is_undirected, "Incorrect graph metadata");
+    assert(!directed_graph.is_undirected, "Incorrect graph metadata");
+
+    assert(undirected_graph.precision == GPHRX_WEIGHT_F64, "Incorrect graph metadata");
+    assert(directed_graph.precision == GPHRX_WEIGHT_F32, "Incorrect graph metadata");
+
+    assert(undirected_graph.adjacency_matrix.col_indices.size == 0, "Incorrect initial adjacency matrix");
+    assert(undirected_graph.adjacency_matrix.dimension == 0, "Incorrect initial adjacency matrix");
+    assert(undirected_graph.weights.f64.size == 0, "Incorrect initial weights");
+    assert(directed_graph.adjacency_matrix.col_indices.size == 0, "Incorrect initial adjacency matrix");
+    assert(directed_graph.adjacency_matrix.dimension == 0, "Incorrect initial adjacency matrix");
+    assert(directed_graph.weights.f32.size == 0, "Incorrect initial weights");
+
+    free_wgphrx(&undirected_graph);
+    free_wgphrx(&directed_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_wgphrx_add_edge()
+{
+    GphrxErrorCode error;
+    GphrxWeightedGraph undirected_graph = new_undirected_wgphrx(GPHRX_WEIGHT_F64);
+
+    wgphrx_add_edge(&undirected_graph, 4, 1, 2.5);
+    wgphrx_add_edge(&undirected_graph, 0, 7, 10.0);
+    wgphrx_add_edge(&undirected_graph, 3, 3, 1.25);
+
+    assert(undirected_graph.adjacency_matrix.dimension == 8, "Incorrect graph dimension");
+    assert(undirected_graph.adjacency_matrix.col_indices.size == 5, "Incorrect edge count");
+    assert(undirected_graph.weights.f64.size == 5, "Incorrect weight count");
+
+    assert(wgphrx_get_edge_weight(&undirected_graph, 4, 1, &error) == 2.5, "Incorrect edge weight");
+    assert(error == GPHRX_NO_ERROR, "Edge not found");
+    assert(wgphrx_get_edge_weight(&undirected_graph, 1, 4, &error) == 2.5, "Incorrect edge weight");
+    assert(wgphrx_get_edge_weight(&undirected_graph, 7, 0, &error) == 10.0, "Incorrect edge weight");
+    assert(wgphrx_get_edge_weight(&undirected_graph, 3, 3, &error) == 1.25, "Incorrect edge weight");
+
+    wgphrx_get_edge_weight(&undirected_graph, 4, 0, &error);
+    assert(error == GPHRX_ERROR_NOT_FOUND, "Nonexistent edge found");
+
+    // Adding an existing edge updates its weight in both directions
+    wgphrx_add_edge(&undirected_graph, 1, 4, 6.0);
+
+    assert(undirected_graph.adjacency_matrix.col_indices.size == 5, "Incorrect edge count");
+    assert(wgphrx_get_edge_weight(&undirected_graph, 4, 1, &error) == 6.0, "Incorrect edge weight");
+    assert(wgphrx_get_edge_weight(&undirected_graph, 1, 4, &error) == 6.0, "Incorrect edge weight");
+
+    free_wgphrx(&undirected_graph);
+
+    GphrxWeightedGraph directed_graph = new_directed_wgphrx(GPHRX_WEIGHT_F32);
+
+    wgphrx_add_edge(&directed_graph, 2, 5, 0.5);
+    wgphrx_add_edge(&directed_graph, 2, 1, 1.5);
+    wgphrx_add_edge(&directed_graph, 0, 2, 3.0);
+
+    assert(directed_graph.adjacency_matrix.col_indices.size == 3, "Incorrect edge count");
+    assert(directed_graph.weights.f32.size == 3, "Incorrect weight count");
+
+    assert(wgphrx_does_edge_exist(&directed_graph, 2, 5), "Edge not found");
+    assert(!wgphrx_does_edge_exist(&directed_graph, 5, 2), "Nonexistent edge found");
+
+    // Weights must stay parallel to the edges as edges are inserted
+    assert(directed_graph.weights.f32.arr[0].flt_val == 3.0f, "Incorrect edge weight");
+    assert(directed_graph.weights.f32.arr[1].flt_val == 1.5f, "Incorrect edge weight");
+    assert(directed_graph.weights.f32.arr[2].flt_val == 0.5f, "Incorrect edge weight");
+
+    free_wgphrx(&directed_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_wgphrx_remove_edge()
+{
+    GphrxErrorCode error;
+    GphrxWeightedGraph undirected_graph = new_undirected_wgphrx(GPHRX_WEIGHT_F32);
+
+    wgphrx_add_edge(&undirected_graph, 4, 1, 2.5);
+    wgphrx_add_edge(&undirected_graph, 0, 7, 10.0);
+    wgphrx_add_edge(&undirected_graph, 3, 3, 1.25);
+    wgphrx_add_edge(&undirected_graph, 3, 4, 8.0);
+
+    assert(wgphrx_remove_edge(&undirected_graph, 7, 0) == GPHRX_NO_ERROR, "Failed to remove edge");
+    assert(wgphrx_remove_edge(&undirected_graph, 3, 3) == GPHRX_NO_ERROR, "Failed to remove edge");
+    assert(wgphrx_remove_edge(&undirected_graph, 2, 3) == GPHRX_ERROR_NOT_FOUND, "Removed nonexistent edge");
+
+    assert(undirected_graph.adjacency_matrix.col_indices.size == 4, "Incorrect edge count");
+    assert(undirected_graph.weights.f32.size == 4, "Incorrect weight count");
+
+    assert(!wgphrx_does_edge_exist(&undirected_graph, 0, 7), "Edge not removed");
+    assert(!wgphrx_does_edge_exist(&undirected_graph, 7, 0), "Edge not removed");
+    assert(!wgphrx_does_edge_exist(&undirected_graph, 3, 3), "Edge not removed");
+
+    assert(wgphrx_get_edge_weight(&undirected_graph, 1, 4, &error) == 2.5, "Incorrect edge weight");
+    assert(wgphrx_get_edge_weight(&undirected_graph, 4, 3, &error) == 8.0, "Incorrect edge weight");
+
+    free_wgphrx(&undirected_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_wgphrx_find_avg_pool_matrix()
+{
+    GphrxWeightedGraph directed_graph = new_directed_wgphrx(GPHRX_WEIGHT_F64);
+
+    wgphrx_add_edge(&directed_graph, 0, 1, 2.0);
+    wgphrx_add_edge(&directed_graph, 1, 1, 4.0);
+    wgphrx_add_edge(&directed_graph, 2, 1, 3.0);
+    wgphrx_add_edge(&directed_graph, 3, 2, 9.0);
+    wgphrx_add_edge(&directed_graph, 0, 4, 1.0);
+
+    GphrxCsrMatrix avg_pool_matrix = wgphrx_find_avg_pool_matrix(&directed_graph, 2);
+
+    assert(avg_pool_matrix.dimension == 3, "Incorrect avg pool matrix");
+    assert(avg_pool_matrix.entries.size == 4, "Incorrect avg pool matrix");
+
+    // Block (col 0, row 0) holds edges 0->1 and 1->1
+    assert(dynarr8_get(&avg_pool_matrix.col_indices, 0).u64_val == 0, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.row_indices, 0).u64_val == 0, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.entries, 0).dbl_val == 1.5, "Incorrect avg pool matrix");
+
+    // Block (col 0, row 2) holds edge 0->4
+    assert(dynarr8_get(&avg_pool_matrix.col_indices, 1).u64_val == 0, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.row_indices, 1).u64_val == 2, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.entries, 1).dbl_val == 0.25, "Incorrect avg pool matrix");
+
+    // Block (col 1, row 0) holds edge 2->1
+    assert(dynarr8_get(&avg_pool_matrix.col_indices, 2).u64_val == 1, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.row_indices, 2).u64_val == 0, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.entries, 2).dbl_val == 0.75, "Incorrect avg pool matrix");
+
+    // Block (col 1, row 1) holds edge 3->2
+    assert(dynarr8_get(&avg_pool_matrix.col_indices, 3).u64_val == 1, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.row_indices, 3).u64_val == 1, "Incorrect avg pool matrix");
+    assert(dynarr8_get(&avg_pool_matrix.entries, 3).dbl_val == 2.25, "Incorrect avg pool matrix");
+
+    free_gphrx_csr_matrix(&avg_pool_matrix);
+    free_wgphrx(&directed_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_approximate_wgphrx()
+{
+    GphrxErrorCode error;
+    GphrxWeightedGraph directed_graph = new_directed_wgphrx(GPHRX_WEIGHT_F32);
+
+    wgphrx_add_edge(&directed_graph, 0, 1, 2.0);
+    wgphrx_add_edge(&directed_graph, 1, 1, 4.0);
+    wgphrx_add_edge(&directed_graph, 2, 1, 3.0);
+    wgphrx_add_edge(&directed_graph, 3, 2, 9.0);
+    wgphrx_add_edge(&directed_graph, 0, 4, 1.0);
+
+    GphrxWeightedGraph approx_graph = approximate_wgphrx(&directed_graph, 2, 0.5);
+
+    assert(approx_graph.precision == GPHRX_WEIGHT_F32, "Incorrect graph approximation");
+    assert(approx_graph.adjacency_matrix.dimension == 3, "Incorrect graph approximation");
+    assert(approx_graph.adjacency_matrix.col_indices.size == 1, "Incorrect graph approximation");
+    assert(approx_graph.weights.f32.size == 1, "Incorrect graph approximation");
+
+    assert(wgphrx_get_edge_weight(&approx_graph, 0, 0, &error) == 1.5, "Incorrect graph approximation");
+
+    free_wgphrx(&approx_graph);
+
+    approx_graph = approximate_wgphrx(&directed_graph, 2, 0.25);
+
+    assert(approx_graph.adjacency_matrix.col_indices.size == 4, "Incorrect graph approximation");
+    assert(wgphrx_get_edge_weight(&approx_graph, 0, 2, &error) == 0.25, "Incorrect graph approximation");
+    assert(wgphrx_get_edge_weight(&approx_graph, 1, 1, &error) == 2.25, "Incorrect graph approximation");
+
+    free_wgphrx(&approx_graph);
+    free_wgphrx(&directed_graph);
+
+    return TEST_PASS;
+}
+
+static TEST_RESULT test_wgphrx_to_from_byte_array()
+{
+    GphrxErrorCode error;
+    GphrxWeightPrecision precisions[] = {GPHRX_WEIGHT_F32, GPHRX_WEIGHT_F64};
+
+    for (int p = 0; p < 2; ++p)
+    {
+        GphrxWeightedGraph undirected_graph = new_undirected_wgphrx(precisions[p]);
+
+        wgphrx_add_edge(&undirected_graph, 2, 1002, 0.5);
+        wgphrx_add_edge(&undirected_graph, 8, 3, 7.0);
+        wgphrx_add_edge(&undirected_graph, 501, 1003, 100.25);
+
+        byte *arr = wgphrx_to_byte_array(&undirected_graph);
+
+        // The precision is stored in the header's is_weighted byte
+        assert(arr[25] == precisions[p], "Incorrect header");
+
+        GphrxWeightedGraph graph_from_arr = wgphrx_from_byte_array(arr, &error);
+
+        assert(error == GPHRX_NO_ERROR, "Error unpacking graph from byte array");
+        assert(graph_from_arr.is_undirected, "Incorrectly loaded graph");
+        assert(graph_from_arr.precision == precisions[p], "Incorrectly loaded graph");
+        assert(graph_from_arr.adjacency_matrix.dimension == undirected_graph.adjacency_matrix.dimension,
+               "Incorrectly loaded graph");
+        assert(graph_from_arr.adjacency_matrix.col_indices.size == undirected_graph.adjacency_matrix.col_indices.size,
+               "Incorrectly loaded graph adjacency matrix");
+
+        for (size_t i = 0; i < undirected_graph.adjacency_matrix.col_indices.size; ++i)
+        {
+            assert(undirected_graph.adjacency_matrix.col_indices.arr[i].u64_val ==
+                   graph_from_arr.adjacency_matrix.col_indices.arr[i].u64_val,
+                   "Incorrectly loaded graph adjacency matrix");
+            assert(undirected_graph.adjacency_matrix.row_indices.arr[i].u64_val ==
+                   graph_from_arr.adjacency_matrix.row_indices.arr[i].u64_val,
+                   "Incorrectly loaded graph adjacency matrix");
+            assert(get_weight(&undirected_graph, i) == get_weight(&graph_from_arr, i), "Incorrectly loaded weights");
+        }
+
+        free(arr);
+        free_wgphrx(&graph_from_arr);
+        free_wgphrx(&undirected_graph);
+    }
+
+    // Unweighted byte arrays load with unit weights
+    GphrxGraph unweighted_graph = new_directed_gphrx();
+    gphrx_add_edge(&unweighted_graph, 1, 1000);
+    gphrx_add_edge(&unweighted_graph, 500, 7);
+
+    byte *arr = gphrx_to_byte_array(&unweighted_graph);
+    GphrxWeightedGraph graph_from_arr = wgphrx_from_byte_array(arr, &error);
+
+    assert(error == GPHRX_NO_ERROR, "Error unpacking graph from byte array");
+    assert(!graph_from_arr.is_undirected, "Incorrectly loaded graph");
+    assert(graph_from_arr.adjacency_matrix.col_indices.size == 2, "Incorrectly loaded graph adjacency matrix");
+    assert(wgphrx_get_edge_weight(&graph_from_arr, 1, 1000, &error) == 1.0, "Incorrectly loaded weights");
+    assert(wgphrx_get_edge_weight(&graph_from_arr, 500, 7, &error) == 1.0, "Incorrectly loaded weights");
+
+    free(arr);
+    free_wgphrx(&graph_from_arr);
+    free_gphrx(&unweighted_graph);
+
+    return TEST_PASS;
+}
+
+ModuleTestSet wgphrx_h_register_tests()
+{
+    ModuleTestSet set = {
+        .module_name = __FILE__,
+        .tests = {0},
+        .count = 0,
+    };
+
+    register_test(&set, test_new_wgphrx);
+    register_test(&set, test_wgphrx_add_edge);
+    register_test(&set, test_wgphrx_remove_edge);
+    register_test(&set, test_wgphrx_find_avg_pool_matrix);
+    register_test(&set, test_approximate_wgphrx);
+    register_test(&set, test_wgphrx_to_from_byte_array);
+
+    return set;
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "test.h"
 
+#include "gphrx.h"
+
 jmp_buf ENV_JUMP_BUFFER;
 
 void _register_test(ModuleTestSet* test_set, char *test_name, TestFunc test_func)
@@ -15,3 +17,44 @@ void _register_test(ModuleTestSet* test_set, char *test_name, TestFunc test_func
     test_set->tests[test_set->count++] = test;
 }
 
+u64 test_random(u64 *state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 33;
+}
+
+static GphrxGraph new_test_graph(bool is_undirected, u64 vertex_count, size_t edge_count, bool skew_degrees, u64 seed)
+{
+    GphrxGraph graph = is_undirected ? new_undirected_gphrx() : new_directed_gphrx();
+
+    u64 *from_vertex_ids = malloc(sizeof(u64) * (edge_count + 1));
+    u64 *to_vertex_ids = malloc(sizeof(u64) * (edge_count + 1));
+
+    u64 rng_state = seed;
+
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        u64 r = test_random(&rng_state) % vertex_count;
+
+        // Squaring skews the degrees towards low vertex IDs
+        from_vertex_ids[i] = skew_degrees ? r * r / vertex_count : r;
+        to_vertex_ids[i] = test_random(&rng_state) % vertex_count;
+    }
+
+    gphrx_add_edges(&graph, from_vertex_ids, to_vertex_ids, edge_count);
+
+    free(from_vertex_ids);
+    free(to_vertex_ids);
+
+    return graph;
+}
+
+GphrxGraph new_random_test_graph(bool is_undirected, u64 vertex_count, size_t edge_count, u64 seed)
+{
+    return new_test_graph(is_undirected, vertex_count, edge_count, false, seed);
+}
+
+GphrxGraph new_skewed_random_test_graph(bool is_undirected, u64 vertex_count, size_t edge_count, u64 seed)
+{
+    return new_test_graph(is_undirected, vertex_count, edge_count, true, seed);
+}
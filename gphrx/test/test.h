@@ -38,5 +38,24 @@ typedef struct {
 #define register_test(test_set, test_func) _register_test(test_set, #test_func, test_func)
 void _register_test(ModuleTestSet* test_set, char *test_name, TestFunc test_func);
 
+// Deterministic pseudo-random numbers for test fixtures: advances a 64-bit LCG state and returns its top 31
+// bits
+u64 test_random(u64 *state);
+
 #define __TEST_H
 #endif
+
+// Graph fixtures need the graph types, so they are declared when gphrx.h includes this header after
+// declaring them
+#if defined(GPHRX_TEST_GRAPH_FIXTURES) && !defined(__TEST_GRAPH_FIXTURES_H)
+
+// A graph of `edge_count` random edges (fewer once duplicates are merged) between vertices below
+// `vertex_count`
+GphrxGraph new_random_test_graph(bool is_undirected, u64 vertex_count, size_t edge_count, u64 seed);
+
+// Like `new_random_test_graph`, but with the from vertex IDs skewed towards zero, so that a few vertices
+// have far more edges than the rest
+GphrxGraph new_skewed_random_test_graph(bool is_undirected, u64 vertex_count, size_t edge_count, u64 seed);
+
+#define __TEST_GRAPH_FIXTURES_H
+#endif
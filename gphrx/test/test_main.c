@@ -5,10 +5,26 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "alloc.h"
+#include "bfs.h"
+#include "communities.h"
+#include "components.h"
+#include "cores.h"
+#include "dgphrx.h"
 #include "dynarray.h"
 #include "gphrx.h"
+#include "ingest.h"
 #include "intrinsics.h"
+#include "pagerank.h"
+#include "similarity.h"
+#include "sort.h"
+#include "spmv.h"
+#include "sssp.h"
 #include "test.h"
+#include "threadpool.h"
+#include "triangles.h"
+#include "vgphrx.h"
+#include "wgphrx.h"
 
 static void abort_handler(int signum)
 {
@@ -30,6 +46,22 @@ int main(int argc, char **argv)
     u32 test_set_count = 0;
     test_sets[test_set_count++] = dynarray_h_register_tests();
     test_sets[test_set_count++] = gphrx_h_register_tests();
+    test_sets[test_set_count++] = wgphrx_h_register_tests();
+    test_sets[test_set_count++] = threadpool_h_register_tests();
+    test_sets[test_set_count++] = vgphrx_h_register_tests();
+    test_sets[test_set_count++] = ingest_h_register_tests();
+    test_sets[test_set_count++] = dgphrx_h_register_tests();
+    test_sets[test_set_count++] = sort_h_register_tests();
+    test_sets[test_set_count++] = alloc_h_register_tests();
+    test_sets[test_set_count++] = bfs_h_register_tests();
+    test_sets[test_set_count++] = spmv_h_register_tests();
+    test_sets[test_set_count++] = pagerank_h_register_tests();
+    test_sets[test_set_count++] = components_h_register_tests();
+    test_sets[test_set_count++] = triangles_h_register_tests();
+    test_sets[test_set_count++] = similarity_h_register_tests();
+    test_sets[test_set_count++] = cores_h_register_tests();
+    test_sets[test_set_count++] = sssp_h_register_tests();
+    test_sets[test_set_count++] = communities_h_register_tests();
     
 
     printf("Running tests...\n");
@@ -85,6 +85,9 @@ def verify_graph(text_file_name, gphrx_file_name):
 
     graph = gphrx.GphrxGraph.load_from_file(gphrx_file_name)
 
-    for id_pair in id_pairs:
-        if not graph.does_edge_exist(id_to_new_id_map[id0], id_to_new_id_map[id1]):
+    new_id_pairs = [(id_to_new_id_map[id0], id_to_new_id_map[id1]) for id0, id1 in id_pairs]
+    edges_exist = graph.does_edges_exist(new_id_pairs)
+
+    for (id0, id1), edge_exists in zip(id_pairs, edges_exist):
+        if not edge_exists:
             print("Missing edge " + str(id0) + "-" + str(id1))
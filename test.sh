@@ -2,6 +2,7 @@ source .env
 
 FLAGS='-O0 -g -DDEBUG_MODE'
 WARNINGS='-Winline -Wno-invalid-noreturn'
+LIBS='-lm -pthread'
 COMPILER=clang
 
 OUTPUT_LOC="$OUTPUT_DIR/test.out"
@@ -10,4 +11,4 @@ TEST_INCLUDE_DIR='./gphrx/test'
 
 mkdir -p $OUTPUT_DIR
 
-$COMPILER -DDEBUG_MODE -DTEST_MODE $WARNINGS $FLAGS -I$INCLUDE_DIR -I$TEST_INCLUDE_DIR $FILES $BUILD_SPECIFIC_FILES -o $OUTPUT_LOC && $OUTPUT_LOC $@
+$COMPILER -DDEBUG_MODE -DTEST_MODE $WARNINGS $FLAGS -I$INCLUDE_DIR -I$TEST_INCLUDE_DIR $FILES $BUILD_SPECIFIC_FILES -o $OUTPUT_LOC $LIBS && $OUTPUT_LOC $@